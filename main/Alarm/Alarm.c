@@ -0,0 +1,1103 @@
+
+/**
+ *  @file       Alarm.c
+ *
+ *  @brief      Alarms and scheduled actions (night dimming, display off
+ *              hours, reminders), one-shot or recurring on given days.
+ *              The entries are kept in a hierarchical timer wheel, so the
+ *              next event is found in constant time, and a single one-shot
+ *              esp_timer is armed for it: nothing runs between two events,
+ *              the CPU can stay in light sleep until the next one.
+ *              The entries are stored as a settings table.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include <Alarm.h>
+#include <Alarm_prv.h>
+#include <Holtek.h>
+#include <TimeZone.h>
+#include <TickSync.h>
+#include <Settings.h>
+#include <HttpSrv.h>
+#include <Metrics.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static ALARM_NODE_TYPE px_Alarm_Node[ALARM_MAX_ENTRIES];
+static ALARM_WHEEL_TYPE x_Alarm_Wheel;
+
+// the wheel is used once the clock is set
+static bool b_Alarm_Scheduled;
+
+static ALARM_ACTION_FUNC px_Alarm_Action[NUM_OF_ALARM_ACTIONS];
+
+static esp_timer_handle_t x_Alarm_Timer;
+
+static SemaphoreHandle_t x_Alarm_Mutex;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t x_Alarm_Mutex_Buffer;
+#endif
+
+static const char *TAG = "Alarm";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static bool AlarmClockMinute(uint32_t *pu32_minute);
+static uint32_t AlarmNextExpiry(const ALARM_ENTRY_TYPE *px_entry, uint32_t u32_after);
+static uint32_t AlarmLocalToUtc(uint32_t u32_local_minute);
+static uint16_t *AlarmSlotHead(uint8_t u8_level, uint8_t u8_slot);
+static void AlarmWheelInsert(uint16_t u16_id);
+static void AlarmWheelUnlink(uint16_t u16_id);
+static uint32_t AlarmWheelNext(void);
+static void AlarmWheelAdvance(uint32_t u32_minute);
+static void AlarmWheelCascade(uint16_t u16_head);
+static bool AlarmRebuild(uint32_t u32_now);
+static void AlarmArm(void);
+static void AlarmTimerCallback(void *pv_arg);
+static uint16_t AlarmTableFill(void *pv_buffer, uint16_t u16_max_bytes);
+static void AlarmTableRestore(const void *pv_data, uint16_t u16_len);
+static void AlarmBrightness(uint16_t u16_id, uint8_t u8_arg);
+static uint8_t AlarmParseAction(const char *pc_name);
+static uint8_t AlarmParseDays(char *pc_days);
+static esp_err_t AlarmHttpGetHandler(httpd_req_t *px_req);
+static esp_err_t AlarmHttpPostHandler(httpd_req_t *px_req);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, restores the stored entries and,
+ *          if the clock is already set (i.e. after a software restart),
+ *          schedules them, then registers the network command. To be called
+ *          after Settings__Initialize(), TimeZone__Initialize() and the HTTP
+ *          server is started.
+ *
+ */
+void Alarm__Initialize(void)
+{
+  const esp_timer_create_args_t x_timer_args =
+  {
+    .callback = AlarmTimerCallback,
+    .name = "alarm",
+  };
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = ALARM_URI,
+    .method = HTTP_GET,
+    .handler = AlarmHttpGetHandler,
+    .user_ctx = NULL
+  };
+  const httpd_uri_t x_post_uri =
+  {
+    .uri = ALARM_URI,
+    .method = HTTP_POST,
+    .handler = AlarmHttpPostHandler,
+    .user_ctx = NULL
+  };
+  uint16_t u16_id;
+
+  for (u16_id = 0; u16_id < ALARM_MAX_ENTRIES; ++u16_id)
+  {
+    px_Alarm_Node[u16_id].level = ALARM_LEVEL_FREE;
+  }
+  px_Alarm_Action[ALARM_ACTION_BRIGHTNESS] = AlarmBrightness;
+
+#if CONFIG_APP_STATIC_ALLOCATION
+  x_Alarm_Mutex = xSemaphoreCreateMutexStatic(&x_Alarm_Mutex_Buffer);
+  SysMon__Register_Module(TAG, sizeof(x_Alarm_Mutex_Buffer));
+#else
+  x_Alarm_Mutex = xSemaphoreCreateMutex();
+#endif
+  ESP_ERROR_CHECK(esp_timer_create(&x_timer_args, &x_Alarm_Timer));
+
+  SysMon__Register_Module(TAG, sizeof(px_Alarm_Node) + sizeof(x_Alarm_Wheel) + sizeof(px_Alarm_Action));
+
+  // the entries are kept in the wheel nodes, the stored table is only read in the buffer of the settings
+  Settings__Restore_Table(SETTINGS_TABLE_ALARMS, ALARM_TABLE_MAX_BYTES, AlarmTableFill, AlarmTableRestore);
+  Alarm__Time_Changed();
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+  (void)HttpSrv__Register_Uri(&x_post_uri);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Sets the handler of an action, i.e. by the module owning it.
+ *
+ * @param e_action  action
+ * @param fn_action handler, run in the esp_timer task: it must not block
+ */
+void Alarm__Register_Action(ALARM_ACTION_ENUM e_action, ALARM_ACTION_FUNC fn_action)
+{
+  if ((e_action > ALARM_ACTION_NONE) && (e_action < NUM_OF_ALARM_ACTIONS))
+  {
+    px_Alarm_Action[e_action] = fn_action;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Adds an entry. A one-shot entry is removed after it runs.
+ *
+ * @param px_entry entry
+ *
+ * @return id of the entry, ALARM_ID_NONE if not valid, already past or if there is no room
+ */
+uint16_t Alarm__Add(const ALARM_ENTRY_TYPE *px_entry)
+{
+  uint32_t u32_expiry = ALARM_MINUTE_NONE;
+  uint32_t u32_now;
+  uint16_t u16_id;
+
+  if ((px_entry->action == ALARM_ACTION_NONE) || (px_entry->action >= NUM_OF_ALARM_ACTIONS) ||
+      ((px_entry->days & ~ALARM_DAYS_ALL) != 0) ||
+      ((px_entry->days != 0) && (px_entry->minute >= ALARM_MINUTES_PER_DAY)))
+  {
+    return ALARM_ID_NONE;
+  }
+
+  xSemaphoreTake(x_Alarm_Mutex, portMAX_DELAY);
+
+  if (b_Alarm_Scheduled == true)
+  {
+    // from the clock, the minute of the wheel only moves when an event runs
+    (void)AlarmClockMinute(&u32_now);
+    u32_expiry = AlarmNextExpiry(px_entry, MAX(u32_now, x_Alarm_Wheel.now));
+    if (u32_expiry == ALARM_MINUTE_NONE)
+    {
+      xSemaphoreGive(x_Alarm_Mutex);
+      return ALARM_ID_NONE;
+    }
+  }
+
+  for (u16_id = 0; u16_id < ALARM_MAX_ENTRIES; ++u16_id)
+  {
+    if (px_Alarm_Node[u16_id].level == ALARM_LEVEL_FREE)
+    {
+      break;
+    }
+  }
+
+  if (u16_id >= ALARM_MAX_ENTRIES)
+  {
+    xSemaphoreGive(x_Alarm_Mutex);
+    ESP_LOGW(TAG, "no room for another entry");
+    return ALARM_ID_NONE;
+  }
+
+  px_Alarm_Node[u16_id].entry = *px_entry;
+  px_Alarm_Node[u16_id].entry.spare = 0;
+  px_Alarm_Node[u16_id].level = ALARM_LEVEL_IDLE;
+  if (b_Alarm_Scheduled == true)
+  {
+    px_Alarm_Node[u16_id].expiry = u32_expiry;
+    AlarmWheelInsert(u16_id);
+  }
+
+  xSemaphoreGive(x_Alarm_Mutex);
+
+  Settings__Table_Changed(SETTINGS_TABLE_ALARMS);
+  AlarmArm();
+
+  return u16_id;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Removes an entry.
+ *
+ * @param u16_id entry, as returned by Alarm__Add()
+ *
+ * @return true if the entry existed
+ */
+bool Alarm__Remove(uint16_t u16_id)
+{
+  if (u16_id >= ALARM_MAX_ENTRIES)
+  {
+    return false;
+  }
+
+  xSemaphoreTake(x_Alarm_Mutex, portMAX_DELAY);
+  if (px_Alarm_Node[u16_id].level == ALARM_LEVEL_FREE)
+  {
+    xSemaphoreGive(x_Alarm_Mutex);
+    return false;
+  }
+
+  AlarmWheelUnlink(u16_id);
+  px_Alarm_Node[u16_id].level = ALARM_LEVEL_FREE;
+  xSemaphoreGive(x_Alarm_Mutex);
+
+  Settings__Table_Changed(SETTINGS_TABLE_ALARMS);
+  // the next event can be a different one now
+  AlarmArm();
+
+  return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Reads an entry.
+ *
+ * @param u16_id    entry
+ * @param px_entry  [out] entry
+ *
+ * @return true if the entry exists
+ */
+bool Alarm__Get(uint16_t u16_id, ALARM_ENTRY_TYPE *px_entry)
+{
+  bool b_ret = false;
+
+  if (u16_id >= ALARM_MAX_ENTRIES)
+  {
+    return false;
+  }
+
+  xSemaphoreTake(x_Alarm_Mutex, portMAX_DELAY);
+  if (px_Alarm_Node[u16_id].level != ALARM_LEVEL_FREE)
+  {
+    *px_entry = px_Alarm_Node[u16_id].entry;
+    b_ret = true;
+  }
+  xSemaphoreGive(x_Alarm_Mutex);
+
+  return b_ret;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Time of the next event, i.e. to choose the sleep duration.
+ *          It can be earlier than the real one after an entry has been
+ *          removed: the timer then only re-arms itself.
+ *
+ * @return UTC seconds since the epoch, -1 if nothing is scheduled
+ */
+int64_t Alarm__Get_Next(void)
+{
+  uint32_t u32_next;
+
+  xSemaphoreTake(x_Alarm_Mutex, portMAX_DELAY);
+  u32_next = (b_Alarm_Scheduled == true) ? AlarmWheelNext() : ALARM_MINUTE_NONE;
+  xSemaphoreGive(x_Alarm_Mutex);
+
+  return (u32_next == ALARM_MINUTE_NONE) ? -1 : ((int64_t)u32_next * 60);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Schedules all the entries again, to be called when the clock has
+ *          been set or has jumped, or when the time zone changed. One-shot
+ *          entries already past are removed without running.
+ *
+ */
+void Alarm__Time_Changed(void)
+{
+  uint32_t u32_now;
+  bool b_changed = false;
+
+  // not initialized yet, the entries are scheduled by Alarm__Initialize()
+  if ((x_Alarm_Mutex == NULL) || (AlarmClockMinute(&u32_now) == false))
+  {
+    return;
+  }
+
+  xSemaphoreTake(x_Alarm_Mutex, portMAX_DELAY);
+  b_changed = AlarmRebuild(u32_now);
+  xSemaphoreGive(x_Alarm_Mutex);
+
+  if (b_changed == true)
+  {
+    Settings__Table_Changed(SETTINGS_TABLE_ALARMS);
+  }
+
+  AlarmArm();
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Current UTC minute, on the time shown by the clock face: shared
+ *          with the other clocks of the LAN when the tick sync is on.
+ *
+ * @param pu32_minute [out] minutes since the epoch
+ *
+ * @return false if the clock is not set yet
+ */
+static bool AlarmClockMinute(uint32_t *pu32_minute)
+{
+  *pu32_minute = (uint32_t)(TickSync__Get_Time_Us() / 60000000);
+
+  return (*pu32_minute >= ALARM_CLOCK_VALID_MINUTE);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   First event of an entry after the given minute.
+ *
+ * @param px_entry  entry
+ * @param u32_after UTC minute, the event must be later
+ *
+ * @return UTC minute, ALARM_MINUTE_NONE if a one-shot entry is past
+ */
+static uint32_t AlarmNextExpiry(const ALARM_ENTRY_TYPE *px_entry, uint32_t u32_after)
+{
+  uint32_t u32_local_day;
+  uint32_t u32_expiry;
+  uint8_t u8_day;
+
+  if (px_entry->days == 0)
+  {
+    return (px_entry->minute > u32_after) ? px_entry->minute : ALARM_MINUTE_NONE;
+  }
+
+  u32_local_day = (uint32_t)(TimeZone__To_Local((int64_t)(u32_after + 1) * 60) / (60 * ALARM_MINUTES_PER_DAY));
+
+  // today and the next 7 days: the same day of next week when today's time is past
+  for (u8_day = 0; u8_day <= 7; ++u8_day)
+  {
+    // 1970-01-01 was a Thursday
+    if ((px_entry->days & (1u << ((u32_local_day + u8_day + 4) % 7))) == 0)
+    {
+      continue;
+    }
+
+    u32_expiry = AlarmLocalToUtc(((u32_local_day + u8_day) * ALARM_MINUTES_PER_DAY) + px_entry->minute);
+    if (u32_expiry > u32_after)
+    {
+      return u32_expiry;
+    }
+  }
+
+  return ALARM_MINUTE_NONE;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Converts a local minute to UTC. A local time repeated by a DST
+ *          change is taken at its first occurrence, a local time skipped by
+ *          it is moved forward by the change.
+ *
+ * @param u32_local_minute local minutes since the epoch
+ *
+ * @return UTC minutes since the epoch
+ */
+static uint32_t AlarmLocalToUtc(uint32_t u32_local_minute)
+{
+  int64_t s64_local_s = (int64_t)u32_local_minute * 60;
+  int64_t s64_before_s;
+  int64_t s64_after_s;
+  bool b_before_ok;
+  bool b_after_ok;
+
+  // with the offsets of the day before and after, transitions are far more apart
+  s64_before_s = s64_local_s - TimeZone__Get_Offset(s64_local_s - ALARM_DST_SEARCH_S);
+  s64_after_s = s64_local_s - TimeZone__Get_Offset(s64_local_s + ALARM_DST_SEARCH_S);
+
+  b_before_ok = (TimeZone__To_Local(s64_before_s) == s64_local_s);
+  b_after_ok = (TimeZone__To_Local(s64_after_s) == s64_local_s);
+
+  if ((b_before_ok == true) && (b_after_ok == true))
+  {
+    // repeated, or the same offset
+    return (uint32_t)(MIN(s64_before_s, s64_after_s) / 60);
+  }
+  if ((b_before_ok == false) && (b_after_ok == false))
+  {
+    // skipped
+    return (uint32_t)(MAX(s64_before_s, s64_after_s) / 60);
+  }
+
+  return (uint32_t)(((b_before_ok == true) ? s64_before_s : s64_after_s) / 60);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Head of the list of a wheel slot.
+ *
+ * @param u8_level  wheel level, ALARM_LEVEL_OVERFLOW for the overflow list
+ * @param u8_slot   slot
+ *
+ * @return pointer to the first entry
+ */
+static uint16_t *AlarmSlotHead(uint8_t u8_level, uint8_t u8_slot)
+{
+  if (u8_level == ALARM_LEVEL_OVERFLOW)
+  {
+    return &x_Alarm_Wheel.overflow_head;
+  }
+
+  return &x_Alarm_Wheel.head[u8_level][u8_slot];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Puts an entry in the wheel according to its expiry, which must
+ *          be later than the current minute of the wheel.
+ *
+ * @param u16_id entry
+ */
+static void AlarmWheelInsert(uint16_t u16_id)
+{
+  ALARM_NODE_TYPE *px_node = &px_Alarm_Node[u16_id];
+  uint32_t u32_diff = px_node->expiry ^ x_Alarm_Wheel.now;
+  uint16_t *pu16_head;
+  uint8_t u8_level;
+
+  // lowest level where the expiry is in the same block as the current minute
+  for (u8_level = 0; u8_level < ALARM_WHEEL_LEVELS; ++u8_level)
+  {
+    if ((u32_diff >> ((u8_level + 1) * ALARM_WHEEL_BITS)) == 0)
+    {
+      break;
+    }
+  }
+
+  px_node->level = u8_level;
+  if (u8_level == ALARM_LEVEL_OVERFLOW)
+  {
+    px_node->slot = 0;
+    x_Alarm_Wheel.overflow_min = MIN(x_Alarm_Wheel.overflow_min, px_node->expiry);
+  }
+  else
+  {
+    px_node->slot = (px_node->expiry >> (u8_level * ALARM_WHEEL_BITS)) & (ALARM_WHEEL_SLOTS - 1);
+    x_Alarm_Wheel.used[u8_level] |= (1ull << px_node->slot);
+    x_Alarm_Wheel.min[u8_level][px_node->slot] = MIN(x_Alarm_Wheel.min[u8_level][px_node->slot], px_node->expiry);
+  }
+
+  pu16_head = AlarmSlotHead(px_node->level, px_node->slot);
+  px_node->prev = ALARM_NODE_NONE;
+  px_node->next = *pu16_head;
+  if (*pu16_head != ALARM_NODE_NONE)
+  {
+    px_Alarm_Node[*pu16_head].prev = u16_id;
+  }
+  *pu16_head = u16_id;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Takes an entry out of the wheel, the entry is left idle.
+ *
+ * @param u16_id entry
+ */
+static void AlarmWheelUnlink(uint16_t u16_id)
+{
+  ALARM_NODE_TYPE *px_node = &px_Alarm_Node[u16_id];
+  uint16_t *pu16_head;
+
+  if (px_node->level > ALARM_LEVEL_OVERFLOW)
+  {
+    return;
+  }
+
+  pu16_head = AlarmSlotHead(px_node->level, px_node->slot);
+  if (px_node->prev != ALARM_NODE_NONE)
+  {
+    px_Alarm_Node[px_node->prev].next = px_node->next;
+  }
+  else
+  {
+    *pu16_head = px_node->next;
+  }
+  if (px_node->next != ALARM_NODE_NONE)
+  {
+    px_Alarm_Node[px_node->next].prev = px_node->prev;
+  }
+
+  if (*pu16_head == ALARM_NODE_NONE)
+  {
+    if (px_node->level == ALARM_LEVEL_OVERFLOW)
+    {
+      x_Alarm_Wheel.overflow_min = ALARM_MINUTE_NONE;
+    }
+    else
+    {
+      x_Alarm_Wheel.used[px_node->level] &= ~(1ull << px_node->slot);
+      x_Alarm_Wheel.min[px_node->level][px_node->slot] = ALARM_MINUTE_NONE;
+    }
+  }
+
+  px_node->level = ALARM_LEVEL_IDLE;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Next event, in constant time: the first used slot of the lowest
+ *          used level. Above level 0 the slot minimum is used, which after
+ *          a removal can be earlier than the real event.
+ *
+ * @return UTC minute, ALARM_MINUTE_NONE if the wheel is empty
+ */
+static uint32_t AlarmWheelNext(void)
+{
+  uint8_t u8_level;
+  uint8_t u8_slot;
+
+  if (x_Alarm_Wheel.used[0] != 0)
+  {
+    u8_slot = __builtin_ctzll(x_Alarm_Wheel.used[0]);
+    return ((x_Alarm_Wheel.now & ~(ALARM_WHEEL_SLOTS - 1)) | u8_slot);
+  }
+
+  for (u8_level = 1; u8_level < ALARM_WHEEL_LEVELS; ++u8_level)
+  {
+    if (x_Alarm_Wheel.used[u8_level] != 0)
+    {
+      u8_slot = __builtin_ctzll(x_Alarm_Wheel.used[u8_level]);
+      return x_Alarm_Wheel.min[u8_level][u8_slot];
+    }
+  }
+
+  return x_Alarm_Wheel.overflow_min;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Moves the current minute of the wheel forward, not later than the
+ *          next event. Only the slots of the new minute can hold entries to
+ *          be moved down: the ones in between are empty, as nothing is
+ *          earlier than the next event.
+ *
+ * @param u32_minute new current minute
+ */
+static void AlarmWheelAdvance(uint32_t u32_minute)
+{
+  uint32_t u32_diff = u32_minute ^ x_Alarm_Wheel.now;
+  uint16_t u16_head;
+  int8_t s8_level;
+  uint8_t u8_slot;
+
+  x_Alarm_Wheel.now = u32_minute;
+
+  if ((u32_diff >> (ALARM_WHEEL_LEVELS * ALARM_WHEEL_BITS)) != 0)
+  {
+    u16_head = x_Alarm_Wheel.overflow_head;
+    x_Alarm_Wheel.overflow_head = ALARM_NODE_NONE;
+    x_Alarm_Wheel.overflow_min = ALARM_MINUTE_NONE;
+    AlarmWheelCascade(u16_head);
+  }
+
+  // from the top, an entry can go down more than one level
+  for (s8_level = (ALARM_WHEEL_LEVELS - 1); s8_level > 0; --s8_level)
+  {
+    if ((u32_diff >> (s8_level * ALARM_WHEEL_BITS)) == 0)
+    {
+      continue;
+    }
+
+    u8_slot = (u32_minute >> (s8_level * ALARM_WHEEL_BITS)) & (ALARM_WHEEL_SLOTS - 1);
+    u16_head = x_Alarm_Wheel.head[s8_level][u8_slot];
+    x_Alarm_Wheel.head[s8_level][u8_slot] = ALARM_NODE_NONE;
+    x_Alarm_Wheel.min[s8_level][u8_slot] = ALARM_MINUTE_NONE;
+    x_Alarm_Wheel.used[s8_level] &= ~(1ull << u8_slot);
+    AlarmWheelCascade(u16_head);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Inserts again the entries of a list detached from the wheel.
+ *
+ * @param u16_head first entry of the list
+ */
+static void AlarmWheelCascade(uint16_t u16_head)
+{
+  uint16_t u16_next;
+
+  while (u16_head != ALARM_NODE_NONE)
+  {
+    u16_next = px_Alarm_Node[u16_head].next;
+    AlarmWheelInsert(u16_head);
+    u16_head = u16_next;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Empties the wheel and schedules all the entries from the given
+ *          minute. To be called with the mutex taken.
+ *
+ * @param u32_now current UTC minute
+ *
+ * @return true if past one-shot entries have been removed
+ */
+static bool AlarmRebuild(uint32_t u32_now)
+{
+  ALARM_NODE_TYPE *px_node;
+  bool b_changed = false;
+  uint16_t u16_id;
+
+  memset(x_Alarm_Wheel.head, 0xFF, sizeof(x_Alarm_Wheel.head));
+  memset(x_Alarm_Wheel.min, 0xFF, sizeof(x_Alarm_Wheel.min));
+  memset(x_Alarm_Wheel.used, 0x00, sizeof(x_Alarm_Wheel.used));
+  x_Alarm_Wheel.overflow_head = ALARM_NODE_NONE;
+  x_Alarm_Wheel.overflow_min = ALARM_MINUTE_NONE;
+  x_Alarm_Wheel.now = u32_now;
+
+  for (u16_id = 0; u16_id < ALARM_MAX_ENTRIES; ++u16_id)
+  {
+    px_node = &px_Alarm_Node[u16_id];
+    if (px_node->level == ALARM_LEVEL_FREE)
+    {
+      continue;
+    }
+
+    px_node->expiry = AlarmNextExpiry(&px_node->entry, u32_now);
+    if (px_node->expiry == ALARM_MINUTE_NONE)
+    {
+      ESP_LOGI(TAG, "entry %u past, removed", u16_id);
+      px_node->level = ALARM_LEVEL_FREE;
+      b_changed = true;
+      continue;
+    }
+
+    AlarmWheelInsert(u16_id);
+  }
+
+  b_Alarm_Scheduled = true;
+
+  return b_changed;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Arms the timer for the next event, or stops it if there is none.
+ *
+ */
+static void AlarmArm(void)
+{
+  uint32_t u32_next;
+  int64_t s64_delay_us;
+
+  xSemaphoreTake(x_Alarm_Mutex, portMAX_DELAY);
+  u32_next = (b_Alarm_Scheduled == true) ? AlarmWheelNext() : ALARM_MINUTE_NONE;
+  xSemaphoreGive(x_Alarm_Mutex);
+
+  (void)esp_timer_stop(x_Alarm_Timer);
+
+  if (u32_next == ALARM_MINUTE_NONE)
+  {
+    return;
+  }
+
+  s64_delay_us = ((int64_t)u32_next * 60000000) - TickSync__Get_Time_Us();
+
+  (void)esp_timer_start_once(x_Alarm_Timer, MAX(s64_delay_us, 0));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Runs the entries due, then arms the timer for the next event.
+ *          Runs in the esp_timer task.
+ *
+ * @param pv_arg not used
+ */
+static void AlarmTimerCallback(void *pv_arg)
+{
+  ALARM_NODE_TYPE *px_node;
+  ALARM_ACTION_FUNC fn_action;
+  uint32_t u32_now;
+  uint32_t u32_next;
+  uint16_t u16_id;
+  uint8_t u8_action;
+  uint8_t u8_arg;
+  bool b_changed = false;
+
+  if (AlarmClockMinute(&u32_now) == false)
+  {
+    return;
+  }
+
+  xSemaphoreTake(x_Alarm_Mutex, portMAX_DELAY);
+
+  // the clock has been moved back without Alarm__Time_Changed()
+  if (u32_now < x_Alarm_Wheel.now)
+  {
+    b_changed = AlarmRebuild(u32_now);
+  }
+
+  while (((u32_next = AlarmWheelNext()) != ALARM_MINUTE_NONE) && (u32_next <= u32_now))
+  {
+    AlarmWheelAdvance(u32_next);
+
+    // entries due now, their expiry is exactly u32_next
+    while ((u16_id = x_Alarm_Wheel.head[0][u32_next & (ALARM_WHEEL_SLOTS - 1)]) != ALARM_NODE_NONE)
+    {
+      px_node = &px_Alarm_Node[u16_id];
+      AlarmWheelUnlink(u16_id);
+
+      u8_action = px_node->entry.action;
+      fn_action = px_Alarm_Action[u8_action];
+      u8_arg = px_node->entry.arg;
+
+      px_node->expiry = AlarmNextExpiry(&px_node->entry, u32_next);
+      if (px_node->expiry != ALARM_MINUTE_NONE)
+      {
+        AlarmWheelInsert(u16_id);
+      }
+      else
+      {
+        px_node->level = ALARM_LEVEL_FREE;
+        b_changed = true;
+      }
+
+      // the action can use the module, i.e. to add an entry
+      xSemaphoreGive(x_Alarm_Mutex);
+
+      Metrics__Counter_Add(METRICS_ALARM_FIRED, 1);
+      if (fn_action != NULL)
+      {
+        fn_action(u16_id, u8_arg);
+      }
+      else
+      {
+        ESP_LOGW(TAG, "entry %u: no handler for action %u", u16_id, u8_action);
+      }
+
+      xSemaphoreTake(x_Alarm_Mutex, portMAX_DELAY);
+    }
+  }
+
+  // nothing due until the next event, the wheel can catch up with the clock
+  if (u32_now > x_Alarm_Wheel.now)
+  {
+    AlarmWheelAdvance(u32_now);
+  }
+
+  xSemaphoreGive(x_Alarm_Mutex);
+
+  Metrics__Counter_Add(METRICS_ALARM_WAKEUPS, 1);
+
+  if (b_changed == true)
+  {
+    Settings__Table_Changed(SETTINGS_TABLE_ALARMS);
+  }
+
+  AlarmArm();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Fills the table to be stored, called by the settings timer.
+ *
+ * @param pv_buffer     [out] table
+ * @param u16_max_bytes size of pv_buffer, ALARM_TABLE_MAX_BYTES
+ *
+ * @return bytes used
+ */
+static uint16_t AlarmTableFill(void *pv_buffer, uint16_t u16_max_bytes)
+{
+  ALARM_TABLE_HEADER_TYPE *px_header = pv_buffer;
+  ALARM_RECORD_TYPE *px_record = (ALARM_RECORD_TYPE *)(px_header + 1);
+  uint16_t u16_id;
+
+  px_header->version = ALARM_TABLE_VERSION;
+  px_header->num = 0;
+
+  xSemaphoreTake(x_Alarm_Mutex, portMAX_DELAY);
+  for (u16_id = 0; u16_id < ALARM_MAX_ENTRIES; ++u16_id)
+  {
+    if (px_Alarm_Node[u16_id].level != ALARM_LEVEL_FREE)
+    {
+      px_record[px_header->num].id = u16_id;
+      px_record[px_header->num].spare = 0;
+      px_record[px_header->num].entry = px_Alarm_Node[u16_id].entry;
+      px_header->num++;
+    }
+  }
+  xSemaphoreGive(x_Alarm_Mutex);
+
+  return (uint16_t)(sizeof(ALARM_TABLE_HEADER_TYPE) + (px_header->num * sizeof(ALARM_RECORD_TYPE)));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Restores the stored entries, keeping their ids. Called at boot by
+ *          Settings__Restore_Table().
+ *
+ * @param pv_data stored table
+ * @param u16_len bytes of the stored table, 0 if none
+ */
+static void AlarmTableRestore(const void *pv_data, uint16_t u16_len)
+{
+  const ALARM_TABLE_HEADER_TYPE *px_header = pv_data;
+  const ALARM_RECORD_TYPE *px_record = (const ALARM_RECORD_TYPE *)(px_header + 1);
+  uint16_t u16_index;
+
+  if ((u16_len >= sizeof(ALARM_TABLE_HEADER_TYPE)) && (px_header->version == ALARM_TABLE_VERSION) &&
+      (u16_len >= (sizeof(ALARM_TABLE_HEADER_TYPE) + (px_header->num * sizeof(ALARM_RECORD_TYPE)))))
+  {
+    for (u16_index = 0; u16_index < px_header->num; ++u16_index)
+    {
+      // entries of actions unknown to this firmware are dropped
+      if ((px_record[u16_index].id < ALARM_MAX_ENTRIES) &&
+          (px_record[u16_index].entry.action > ALARM_ACTION_NONE) &&
+          (px_record[u16_index].entry.action < NUM_OF_ALARM_ACTIONS))
+      {
+        px_Alarm_Node[px_record[u16_index].id].entry = px_record[u16_index].entry;
+        px_Alarm_Node[px_record[u16_index].id].level = ALARM_LEVEL_IDLE;
+      }
+    }
+
+    ESP_LOGI(TAG, "%u entries restored", px_header->num);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   ALARM_ACTION_BRIGHTNESS handler.
+ *
+ * @param u16_id  entry
+ * @param u8_arg  brightness
+ */
+static void AlarmBrightness(uint16_t u16_id, uint8_t u8_arg)
+{
+  Holtek__Set_Brightness(u8_arg);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Action of the alarm command.
+ *
+ * @param pc_name name of the action
+ *
+ * @return ALARM_ACTION_ENUM, ALARM_ACTION_NONE if unknown
+ */
+static uint8_t AlarmParseAction(const char *pc_name)
+{
+  uint8_t u8_action;
+
+  for (u8_action = (ALARM_ACTION_NONE + 1); u8_action < NUM_OF_ALARM_ACTIONS; ++u8_action)
+  {
+    if ((pc_name != NULL) && (strcmp(pc_name, ALARM_Action_Name[u8_action]) == 0))
+    {
+      return u8_action;
+    }
+  }
+
+  return ALARM_ACTION_NONE;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Days of the alarm command: "all", "working" or a comma separated
+ *          list of day names.
+ *
+ * @param pc_days days, modified
+ *
+ * @return ALARM_DAY_xxx, 0 if not valid
+ */
+static uint8_t AlarmParseDays(char *pc_days)
+{
+  char *pc_save = NULL;
+  char *pc_day;
+  uint8_t u8_days = 0;
+  uint8_t u8_idx;
+
+  if (pc_days == NULL)
+  {
+    return 0;
+  }
+  if (strcmp(pc_days, "all") == 0)
+  {
+    return ALARM_DAYS_ALL;
+  }
+  if (strcmp(pc_days, "working") == 0)
+  {
+    return ALARM_DAYS_WORKING;
+  }
+
+  for (pc_day = strtok_r(pc_days, ",", &pc_save); pc_day != NULL; pc_day = strtok_r(NULL, ",", &pc_save))
+  {
+    for (u8_idx = 0; (u8_idx < 7) && (strcmp(pc_day, ALARM_Day_Name[u8_idx]) != 0); ++u8_idx)
+    {
+    }
+    if (u8_idx == 7)
+    {
+      return 0;
+    }
+    u8_days |= (1u << u8_idx);
+  }
+
+  return u8_days;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   GET on the alarm command: the entries and the next event.
+ *
+ * @param px_req  request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t AlarmHttpGetHandler(httpd_req_t *px_req)
+{
+  ALARM_ENTRY_TYPE x_entry;
+  char pc_line[96];
+  char pc_days[32];
+  uint16_t u16_id;
+  uint8_t u8_idx;
+
+  httpd_resp_set_type(px_req, "text/plain");
+  for (u16_id = 0; u16_id < ALARM_MAX_ENTRIES; ++u16_id)
+  {
+    if (Alarm__Get(u16_id, &x_entry) == false)
+    {
+      continue;
+    }
+
+    if (x_entry.days == 0)
+    {
+      snprintf(pc_line, sizeof(pc_line), "entry %u once %lld %s %u\n", u16_id, (int64_t)x_entry.minute * 60,
+               ALARM_Action_Name[x_entry.action], x_entry.arg);
+    }
+    else
+    {
+      pc_days[0] = '\0';
+      for (u8_idx = 0; u8_idx < 7; ++u8_idx)
+      {
+        if ((x_entry.days & (1u << u8_idx)) != 0)
+        {
+          strcat(pc_days, (pc_days[0] != '\0') ? "," : "");
+          strcat(pc_days, ALARM_Day_Name[u8_idx]);
+        }
+      }
+      snprintf(pc_line, sizeof(pc_line), "entry %u %02u:%02u %s %s %u\n", u16_id,
+               (unsigned)(x_entry.minute / 60), (unsigned)(x_entry.minute % 60), pc_days,
+               ALARM_Action_Name[x_entry.action], x_entry.arg);
+    }
+    httpd_resp_send_chunk(px_req, pc_line, HTTPD_RESP_USE_STRLEN);
+  }
+  snprintf(pc_line, sizeof(pc_line), "next %lld\n", Alarm__Get_Next());
+  httpd_resp_send_chunk(px_req, pc_line, HTTPD_RESP_USE_STRLEN);
+
+  return httpd_resp_send_chunk(px_req, NULL, 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   POST on the alarm command: "add <hh:mm> <days> <action> [arg]"
+ *          adds a recurring entry at a local time, "once <utc seconds>
+ *          <action> [arg]" a one-shot entry, "del <id>" removes an entry.
+ *          The id of the entry added is returned.
+ *
+ * @param px_req  request
+ *
+ * @return ESP_OK, ESP_FAIL on a bad request
+ */
+static esp_err_t AlarmHttpPostHandler(httpd_req_t *px_req)
+{
+  ALARM_ENTRY_TYPE x_entry;
+  char pc_body[ALARM_HTTP_BODY_MAX + 1];
+  char pc_reply[16];
+  char *pc_save = NULL;
+  char *pc_cmd;
+  char *pc_time;
+  char *pc_arg;
+  char *pc_end;
+  unsigned long ul_hour;
+  unsigned long ul_minute;
+  long long ll_utc_s;
+  uint16_t u16_id;
+  int i_len;
+
+  i_len = httpd_req_recv(px_req, pc_body, MIN(px_req->content_len, ALARM_HTTP_BODY_MAX));
+  if (i_len <= 0)
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "empty request");
+    return ESP_FAIL;
+  }
+  pc_body[i_len] = '\0';
+  pc_body[strcspn(pc_body, "\r\n")] = '\0';
+
+  memset(&x_entry, 0x00, sizeof(x_entry));
+  pc_cmd = strtok_r(pc_body, " ", &pc_save);
+  pc_time = strtok_r(NULL, " ", &pc_save);
+
+  if ((pc_cmd != NULL) && (strcmp(pc_cmd, "del") == 0))
+  {
+    if ((pc_time == NULL) || (Alarm__Remove((uint16_t)strtoul(pc_time, NULL, 10)) == false))
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "unknown entry");
+      return ESP_FAIL;
+    }
+    return httpd_resp_sendstr(px_req, "OK\n");
+  }
+
+  if ((pc_cmd != NULL) && (strcmp(pc_cmd, "add") == 0) && (pc_time != NULL))
+  {
+    ul_hour = strtoul(pc_time, &pc_end, 10);
+    ul_minute = (*pc_end == ':') ? strtoul(&pc_end[1], &pc_end, 10) : 60;
+    if ((*pc_end != '\0') || (ul_hour > 23) || (ul_minute > 59))
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "bad time");
+      return ESP_FAIL;
+    }
+    x_entry.minute = (uint32_t)((ul_hour * 60) + ul_minute);
+    x_entry.days = AlarmParseDays(strtok_r(NULL, " ", &pc_save));
+    if (x_entry.days == 0)
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "bad days");
+      return ESP_FAIL;
+    }
+  }
+  else if ((pc_cmd != NULL) && (strcmp(pc_cmd, "once") == 0) && (pc_time != NULL))
+  {
+    ll_utc_s = strtoll(pc_time, &pc_end, 10);
+    if ((*pc_end != '\0') || (ll_utc_s < 0) || ((ll_utc_s / 60) >= ALARM_MINUTE_NONE))
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "bad time");
+      return ESP_FAIL;
+    }
+    x_entry.minute = (uint32_t)(ll_utc_s / 60);
+  }
+  else
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "unknown command");
+    return ESP_FAIL;
+  }
+
+  x_entry.action = AlarmParseAction(strtok_r(NULL, " ", &pc_save));
+  pc_arg = strtok_r(NULL, " ", &pc_save);
+  x_entry.arg = (pc_arg != NULL) ? (uint8_t)strtoul(pc_arg, NULL, 10) : 0;
+  if (x_entry.action == ALARM_ACTION_NONE)
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "unknown action");
+    return ESP_FAIL;
+  }
+
+  u16_id = Alarm__Add(&x_entry);
+  if (u16_id == ALARM_ID_NONE)
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "entry past or no room");
+    return ESP_FAIL;
+  }
+
+  snprintf(pc_reply, sizeof(pc_reply), "id %u\n", u16_id);
+  return httpd_resp_sendstr(px_req, pc_reply);
+}
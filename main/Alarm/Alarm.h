@@ -0,0 +1,40 @@
+
+/**
+ *  @file       Alarm.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef ALARM_H
+    #define ALARM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <Alarm_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+// runs an action, in the esp_timer task
+typedef void (*ALARM_ACTION_FUNC)(uint16_t u16_id, uint8_t u8_arg);
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void Alarm__Initialize(void);
+void Alarm__Register_Action(ALARM_ACTION_ENUM e_action, ALARM_ACTION_FUNC fn_action);
+uint16_t Alarm__Add(const ALARM_ENTRY_TYPE *px_entry);
+bool Alarm__Remove(uint16_t u16_id);
+bool Alarm__Get(uint16_t u16_id, ALARM_ENTRY_TYPE *px_entry);
+int64_t Alarm__Get_Next(void);
+void Alarm__Time_Changed(void);
+
+#endif
@@ -0,0 +1,64 @@
+
+/**
+ *  @file       Alarm_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef ALARM_PRM_H
+    #define ALARM_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+/*
+ * Actions run by an entry, the argument meaning depends on the action.
+ * The entries are stored with the action number: new actions must be appended.
+ */
+typedef enum
+{
+  ALARM_ACTION_NONE = 0,
+  ALARM_ACTION_BRIGHTNESS,          /*arg: display brightness 0..15 (i.e. night dimming)*/
+  ALARM_ACTION_DISPLAY_OFF,         /*arg: not used*/
+  ALARM_ACTION_DISPLAY_ON,          /*arg: not used*/
+  ALARM_ACTION_REMINDER,            /*arg: reminder number*/
+  NUM_OF_ALARM_ACTIONS
+}ALARM_ACTION_ENUM;
+
+// days of a recurring entry
+#define ALARM_DAY_SUN               (1u << 0)
+#define ALARM_DAY_MON               (1u << 1)
+#define ALARM_DAY_TUE               (1u << 2)
+#define ALARM_DAY_WED               (1u << 3)
+#define ALARM_DAY_THU               (1u << 4)
+#define ALARM_DAY_FRI               (1u << 5)
+#define ALARM_DAY_SAT               (1u << 6)
+#define ALARM_DAYS_WORKING          (ALARM_DAY_MON | ALARM_DAY_TUE | ALARM_DAY_WED | ALARM_DAY_THU | ALARM_DAY_FRI)
+#define ALARM_DAYS_ALL              (ALARM_DAYS_WORKING | ALARM_DAY_SAT | ALARM_DAY_SUN)
+
+#define ALARM_MINUTES_PER_DAY       (24 * 60)
+
+typedef struct
+{
+  uint32_t minute;                  // one-shot: UTC minutes since the epoch, recurring: local minute of the day
+  uint8_t days;                     // ALARM_DAY_xxx of a recurring entry, 0 for a one-shot entry
+  uint8_t action;                   // ALARM_ACTION_ENUM
+  uint8_t arg;                      // argument of the action
+  uint8_t spare;
+}ALARM_ENTRY_TYPE;
+
+#define ALARM_ID_NONE               0xFFFF
+
+// network command: GET for the entries, POST to add or remove one
+#define ALARM_URI                   "/alarm"
+
+#endif
@@ -0,0 +1,116 @@
+
+/**
+ *  @file       Alarm_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef ALARM_PRV_H
+    #define ALARM_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <Alarm_prm.h>
+#include <Settings_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// max number of entries, one-shot and recurring
+#define ALARM_MAX_ENTRIES           CONFIG_ALARM_MAX_ENTRIES
+
+/*
+ * Timer wheel, one minute resolution. Level n has 64 slots of 64^n minutes:
+ * an entry is kept at the lowest level where it shares the slot block with
+ * the current minute, so all the entries of a level are later than the ones
+ * of the levels below and the next event is the first used slot of the
+ * lowest used level. Entries later than 64^3 minutes (about 6 months) wait
+ * in the overflow list.
+ */
+#define ALARM_WHEEL_BITS            6
+#define ALARM_WHEEL_SLOTS           (1u << ALARM_WHEEL_BITS)
+#define ALARM_WHEEL_LEVELS          3
+
+#define ALARM_LEVEL_OVERFLOW        ALARM_WHEEL_LEVELS
+// entry stored but not scheduled, the clock is not set yet
+#define ALARM_LEVEL_IDLE            0xFE
+#define ALARM_LEVEL_FREE            0xFF
+
+#define ALARM_NODE_NONE             0xFFFF
+#define ALARM_MINUTE_NONE           UINT32_MAX
+
+// local to UTC: the offsets in use this far before and after are compared
+#define ALARM_DST_SEARCH_S          (24 * 60 * 60)
+
+// the clock is considered set after 2022-01-01 00:00 UTC
+#define ALARM_CLOCK_VALID_MINUTE    (1640995200u / 60)
+
+// longest body of the alarm command
+#define ALARM_HTTP_BODY_MAX         64
+
+// names of the actions and of the days in the alarm command
+static const char * const ALARM_Action_Name[NUM_OF_ALARM_ACTIONS] =
+{
+  [ALARM_ACTION_NONE]        = "none",
+  [ALARM_ACTION_BRIGHTNESS]  = "brightness",
+  [ALARM_ACTION_DISPLAY_OFF] = "off",
+  [ALARM_ACTION_DISPLAY_ON]  = "on",
+  [ALARM_ACTION_REMINDER]    = "reminder",
+};
+
+static const char * const ALARM_Day_Name[7] =
+{
+  "sun", "mon", "tue", "wed", "thu", "fri", "sat"
+};
+
+#if (ALARM_MAX_ENTRIES >= ALARM_NODE_NONE)
+#error "CONFIG_ALARM_MAX_ENTRIES too large"
+#endif
+
+typedef struct
+{
+  ALARM_ENTRY_TYPE entry;
+  uint32_t expiry;                  // UTC minute of the next event
+  uint16_t next;                    // list of the wheel slot
+  uint16_t prev;
+  uint8_t level;                    // wheel level, ALARM_LEVEL_xxx
+  uint8_t slot;
+}ALARM_NODE_TYPE;
+
+typedef struct
+{
+  uint32_t now;                                         // last minute processed
+  uint64_t used[ALARM_WHEEL_LEVELS];                    // slots not empty
+  uint16_t head[ALARM_WHEEL_LEVELS][ALARM_WHEEL_SLOTS];
+  uint32_t min[ALARM_WHEEL_LEVELS][ALARM_WHEEL_SLOTS];  // earliest expiry of the slot, not updated on removal
+  uint16_t overflow_head;
+  uint32_t overflow_min;
+}ALARM_WHEEL_TYPE;
+
+// stored table: header followed by the entries in use
+#define ALARM_TABLE_VERSION         1
+
+typedef struct
+{
+  uint16_t version;
+  uint16_t num;
+}ALARM_TABLE_HEADER_TYPE;
+
+typedef struct
+{
+  uint16_t id;
+  uint16_t spare;
+  ALARM_ENTRY_TYPE entry;
+}ALARM_RECORD_TYPE;
+
+#define ALARM_TABLE_MAX_BYTES       (sizeof(ALARM_TABLE_HEADER_TYPE) + (ALARM_MAX_ENTRIES * sizeof(ALARM_RECORD_TYPE)))
+
+_Static_assert(ALARM_TABLE_MAX_BYTES == SETTINGS_TABLE_ALARMS_BYTES, "Alarm: SETTINGS_TABLE_ALARMS_BYTES out of date");
+
+#endif
@@ -0,0 +1,340 @@
+
+/**
+ *  @file       Animation.c
+ *
+ *  @brief      Segment-wise transitions between two glyph masks (wipe, morph, slide).
+ *              Transitions are time based, so the result does not depend on
+ *              the frame rate used by the display task to sample them.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+
+#include <SysMon.h>
+#include <Animation.h>
+#include <Animation_prv.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static ANIM_CHANNEL_TYPE px_Anim_Channel[ANIM_NUM_OF_CHANNELS];
+
+// number of channels currently running a transition
+static volatile uint8_t u8_Anim_Active_Num;
+
+static portMUX_TYPE x_Anim_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static uint32_t AnimShift(uint32_t u32_mask, const uint8_t *pu8_shift_table);
+static uint32_t AnimWipe(const ANIM_CHANNEL_TYPE *px_channel, uint32_t u32_progress);
+static uint32_t AnimMorph(const ANIM_CHANNEL_TYPE *px_channel, uint32_t u32_progress);
+static uint32_t AnimSlide(const ANIM_CHANNEL_TYPE *px_channel, uint32_t u32_progress);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method
+ *
+ */
+void Animation__Initialize(void)
+{
+  memset(px_Anim_Channel, 0x00, sizeof(px_Anim_Channel));
+  u8_Anim_Active_Num = 0;
+
+  SysMon__Register_Module("Animation", sizeof(px_Anim_Channel));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Starts a transition on a channel. A transition already running on
+ *          the same channel is replaced.
+ *
+ * @param u8_channel      channel (logic digit) to animate
+ * @param u32_mask_old    glyph mask currently shown
+ * @param u32_mask_new    glyph mask to be shown at the end of the transition
+ * @param e_transition    transition type
+ * @param u32_duration_ms duration of the transition, 0 to use the default one
+ */
+void Animation__Start(uint8_t u8_channel, uint32_t u32_mask_old, uint32_t u32_mask_new, ANIM_TRANSITION_ENUM e_transition, uint32_t u32_duration_ms)
+{
+  ANIM_CHANNEL_TYPE *px_channel;
+
+  if ((u8_channel >= ANIM_NUM_OF_CHANNELS) || (e_transition >= NUM_OF_ANIM_TRANSITIONS))
+  {
+    return;
+  }
+
+  if (u32_duration_ms == 0)
+  {
+    u32_duration_ms = ANIM_DEFAULT_DURATION_MS;
+  }
+
+  px_channel = &px_Anim_Channel[u8_channel];
+
+  portENTER_CRITICAL(&x_Anim_Mux);
+  if (px_channel->active == true)
+  {
+    u8_Anim_Active_Num--;
+  }
+
+  px_channel->mask_old = (u32_mask_old & ANIM_SEGMENTS_MASK);
+  px_channel->mask_new = (u32_mask_new & ANIM_SEGMENTS_MASK);
+  px_channel->start_us = esp_timer_get_time();
+  px_channel->duration_us = (u32_duration_ms * 1000UL);
+  px_channel->transition = e_transition;
+  px_channel->active = ((e_transition != ANIM_TRANSITION_NONE) && (px_channel->mask_old != px_channel->mask_new));
+
+  if (px_channel->active == true)
+  {
+    u8_Anim_Active_Num++;
+  }
+  portEXIT_CRITICAL(&x_Anim_Mux);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Aborts the transition running on a channel, if any.
+ *
+ * @param u8_channel channel to stop
+ */
+void Animation__Stop(uint8_t u8_channel)
+{
+  if (u8_channel >= ANIM_NUM_OF_CHANNELS)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&x_Anim_Mux);
+  if (px_Anim_Channel[u8_channel].active == true)
+  {
+    px_Anim_Channel[u8_channel].active = false;
+    u8_Anim_Active_Num--;
+  }
+  portEXIT_CRITICAL(&x_Anim_Mux);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Tells if at least one transition is running. Used by the display
+ *          task to select the frame rate.
+ *
+ * @return true if a transition is running
+ */
+bool Animation__Is_Active(void)
+{
+  return (u8_Anim_Active_Num != 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Samples the transition of a channel at the given time. When the
+ *          transition is over the channel is released.
+ *
+ * @param u8_channel  channel to sample
+ * @param s64_now_us  sampling time, as returned by esp_timer_get_time()
+ * @param pu32_mask   [out] glyph mask to be shown, written only if the channel is animated
+ *
+ * @return true if the channel is animated and pu32_mask has been written
+ */
+bool Animation__Get_Mask(uint8_t u8_channel, int64_t s64_now_us, uint32_t *pu32_mask)
+{
+  ANIM_CHANNEL_TYPE x_channel;
+  int64_t s64_elapsed_us;
+  uint32_t u32_progress;
+
+  if ((u8_channel >= ANIM_NUM_OF_CHANNELS) || (px_Anim_Channel[u8_channel].active == false))
+  {
+    return false;
+  }
+
+  // take a consistent copy, Start() can be called from other tasks
+  portENTER_CRITICAL(&x_Anim_Mux);
+  x_channel = px_Anim_Channel[u8_channel];
+  portEXIT_CRITICAL(&x_Anim_Mux);
+
+  s64_elapsed_us = s64_now_us - x_channel.start_us;
+  if (s64_elapsed_us < 0)
+  {
+    s64_elapsed_us = 0;
+  }
+
+  if (s64_elapsed_us >= x_channel.duration_us)
+  {
+    // transition completed, show the final glyph one last time and release the channel
+    portENTER_CRITICAL(&x_Anim_Mux);
+    if ((px_Anim_Channel[u8_channel].active == true) && (px_Anim_Channel[u8_channel].start_us == x_channel.start_us))
+    {
+      px_Anim_Channel[u8_channel].active = false;
+      u8_Anim_Active_Num--;
+    }
+    portEXIT_CRITICAL(&x_Anim_Mux);
+
+    *pu32_mask = x_channel.mask_new;
+    return true;
+  }
+
+  u32_progress = (uint32_t)((s64_elapsed_us * ANIM_PROGRESS_FULL) / x_channel.duration_us);
+
+  switch (x_channel.transition)
+  {
+    case ANIM_TRANSITION_WIPE:
+      *pu32_mask = AnimWipe(&x_channel, u32_progress);
+      break;
+
+    case ANIM_TRANSITION_MORPH:
+      *pu32_mask = AnimMorph(&x_channel, u32_progress);
+      break;
+
+    case ANIM_TRANSITION_SLIDE:
+      *pu32_mask = AnimSlide(&x_channel, u32_progress);
+      break;
+
+    default:
+      *pu32_mask = x_channel.mask_new;
+      break;
+  }
+
+  return true;
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Moves every segment of a glyph according to a shift table,
+ *          segments that leave the digit are dropped.
+ *
+ * @param u32_mask        glyph mask
+ * @param pu8_shift_table destination of each segment
+ *
+ * @return shifted glyph mask
+ */
+static uint32_t AnimShift(uint32_t u32_mask, const uint8_t *pu8_shift_table)
+{
+  uint32_t u32_out = 0;
+  uint8_t u8_seg;
+
+  for (u8_seg = 0; u8_seg < ANIM_NUM_OF_SEGMENTS; ++u8_seg)
+  {
+    if (((u32_mask >> u8_seg) & 1UL) && (pu8_shift_table[u8_seg] != ANIM_SEG_DROP))
+    {
+      u32_out |= (1UL << pu8_shift_table[u8_seg]);
+    }
+  }
+
+  return u32_out;
+}
+
+/**
+ * @brief   Wipe: columns on the left of the wipe front show the new glyph,
+ *          the others still show the old one.
+ */
+static uint32_t AnimWipe(const ANIM_CHANNEL_TYPE *px_channel, uint32_t u32_progress)
+{
+  uint32_t u32_front = ((u32_progress * ANIM_WIPE_NUM_OF_COLUMNS) / ANIM_PROGRESS_FULL);
+  uint32_t u32_new_area = 0;
+  uint8_t u8_seg;
+
+  for (u8_seg = 0; u8_seg < ANIM_NUM_OF_SEGMENTS; ++u8_seg)
+  {
+    if (ANIM_Segment_Column[u8_seg] < u32_front)
+    {
+      u32_new_area |= (1UL << u8_seg);
+    }
+  }
+
+  return ((px_channel->mask_new & u32_new_area) | (px_channel->mask_old & ~u32_new_area));
+}
+
+/**
+ * @brief   Morph: segments shared by both glyphs stay on. During the first
+ *          half the old-only segments switch off one at a time, during the
+ *          second half the new-only segments switch on one at a time.
+ */
+static uint32_t AnimMorph(const ANIM_CHANNEL_TYPE *px_channel, uint32_t u32_progress)
+{
+  uint32_t u32_out = (px_channel->mask_old & px_channel->mask_new);
+  uint32_t u32_removed = (px_channel->mask_old & ~px_channel->mask_new);
+  uint32_t u32_added = (px_channel->mask_new & ~px_channel->mask_old);
+  uint32_t u32_half = (ANIM_PROGRESS_FULL / 2);
+  uint32_t u32_rank_limit;
+  uint8_t u8_seg;
+
+  if (u32_progress < u32_half)
+  {
+    // removed segments with rank below the limit are already off
+    u32_rank_limit = ((u32_progress * ANIM_NUM_OF_SEGMENTS) / u32_half);
+    for (u8_seg = 0; u8_seg < ANIM_NUM_OF_SEGMENTS; ++u8_seg)
+    {
+      if (((u32_removed >> u8_seg) & 1UL) && (ANIM_Segment_Morph_Rank[u8_seg] >= u32_rank_limit))
+      {
+        u32_out |= (1UL << u8_seg);
+      }
+    }
+  }
+  else
+  {
+    // added segments with rank below the limit are already on
+    u32_rank_limit = (((u32_progress - u32_half) * ANIM_NUM_OF_SEGMENTS) / u32_half);
+    for (u8_seg = 0; u8_seg < ANIM_NUM_OF_SEGMENTS; ++u8_seg)
+    {
+      if (((u32_added >> u8_seg) & 1UL) && (ANIM_Segment_Morph_Rank[u8_seg] < u32_rank_limit))
+      {
+        u32_out |= (1UL << u8_seg);
+      }
+    }
+  }
+
+  return u32_out;
+}
+
+/**
+ * @brief   Slide: the old glyph scrolls up and out of the digit while the
+ *          new one enters from the bottom.
+ */
+static uint32_t AnimSlide(const ANIM_CHANNEL_TYPE *px_channel, uint32_t u32_progress)
+{
+  uint32_t u32_step = ((u32_progress * ANIM_SLIDE_NUM_OF_STEPS) / ANIM_PROGRESS_FULL);
+  uint32_t u32_out;
+
+  switch (u32_step)
+  {
+    case 0:
+      u32_out = px_channel->mask_old;
+      break;
+
+    case 1:
+      u32_out = AnimShift(px_channel->mask_old, ANIM_Segment_Shift_Up);
+      break;
+
+    case 2:
+      u32_out = AnimShift(AnimShift(px_channel->mask_old, ANIM_Segment_Shift_Up), ANIM_Segment_Shift_Up) |
+                AnimShift(AnimShift(px_channel->mask_new, ANIM_Segment_Shift_Down), ANIM_Segment_Shift_Down);
+      break;
+
+    case 3:
+      u32_out = AnimShift(px_channel->mask_new, ANIM_Segment_Shift_Down);
+      break;
+
+    default:
+      u32_out = px_channel->mask_new;
+      break;
+  }
+
+  return u32_out;
+}
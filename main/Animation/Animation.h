@@ -0,0 +1,35 @@
+
+/**
+ *  @file       Animation.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022. 
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef ANIMATION_H
+    #define ANIMATION_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <Animation_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void Animation__Initialize(void);
+void Animation__Start(uint8_t u8_channel, uint32_t u32_mask_old, uint32_t u32_mask_new, ANIM_TRANSITION_ENUM e_transition, uint32_t u32_duration_ms);
+void Animation__Stop(uint8_t u8_channel);
+bool Animation__Is_Active(void);
+bool Animation__Get_Mask(uint8_t u8_channel, int64_t s64_now_us, uint32_t *pu32_mask);
+
+#endif
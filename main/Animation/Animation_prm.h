@@ -0,0 +1,39 @@
+
+/**
+ *  @file       Animation_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022. 
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef ANIMATION_PRM_H
+    #define ANIMATION_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <Holtek_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+// one animation channel per logic digit
+#define ANIM_NUM_OF_CHANNELS    NUM_OF_DIGITS
+
+/*
+ * Define here the segment-wise transitions that can be played
+ * between two glyph masks
+ */
+typedef enum
+{
+  ANIM_TRANSITION_NONE = 0,   /*new glyph is shown immediately*/
+  ANIM_TRANSITION_WIPE,       /*new glyph is revealed column by column, left to right*/
+  ANIM_TRANSITION_MORPH,      /*old-only segments fade out, then new-only segments fade in*/
+  ANIM_TRANSITION_SLIDE,      /*old glyph scrolls out on top while the new one enters from the bottom*/
+  NUM_OF_ANIM_TRANSITIONS
+}ANIM_TRANSITION_ENUM;
+
+#endif
@@ -0,0 +1,90 @@
+
+/**
+ *  @file       Animation_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef ANIMATION_PRV_H
+    #define ANIMATION_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <Animation_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// default transition duration, used when the caller passes 0
+#define ANIM_DEFAULT_DURATION_MS    CONFIG_HOLTEK_ANIM_DURATION_MS
+
+// number of segments handled by the transitions (a1 .. m, see DIGIT_SEG_TYPE)
+#define ANIM_NUM_OF_SEGMENTS        16
+#define ANIM_SEGMENTS_MASK          0x0000FFFFUL
+
+// progress is expressed in 1/256 units of the transition duration
+#define ANIM_PROGRESS_FULL          256
+
+// marker for segments that leave the digit when shifted
+#define ANIM_SEG_DROP               0xFF
+
+/**
+ * Geometry of the 16 segments digit, indexed by bit position in the glyph mask.
+ *
+ *   bit: 0=A1 1=A2 2=B 3=C 4=D1 5=D2 6=E 7=F 8=G1 9=G2 10=H 11=J 12=K 13=L 14=M 15=N
+ *
+ *   column   0    1    2    3    4
+ *   row 0         A1        A2
+ *   row 1    F    H    J    K    B
+ *   row 2         G1        G2
+ *   row 3    E    N    M    L    C
+ *   row 4         D1        D2
+ */
+#define ANIM_WIPE_NUM_OF_COLUMNS    5
+
+static const uint8_t ANIM_Segment_Column[ANIM_NUM_OF_SEGMENTS] =
+{
+  1, 3, 4, 4, 1, 3, 0, 0, 1, 3, 1, 2, 3, 3, 2, 1
+};
+
+// order used by the morph transition, spreads changes across the digit
+static const uint8_t ANIM_Segment_Morph_Rank[ANIM_NUM_OF_SEGMENTS] =
+{
+  0, 9, 4, 13, 8, 1, 12, 5, 14, 3, 10, 7, 2, 11, 6, 15
+};
+
+// destination of each segment when the glyph is moved one row up
+static const uint8_t ANIM_Segment_Shift_Up[ANIM_NUM_OF_SEGMENTS] =
+{
+  ANIM_SEG_DROP, ANIM_SEG_DROP, ANIM_SEG_DROP, 2, 8, 9, 7, ANIM_SEG_DROP,
+  0, 1, ANIM_SEG_DROP, ANIM_SEG_DROP, ANIM_SEG_DROP, 12, 11, 10
+};
+
+// destination of each segment when the glyph is moved one row down
+static const uint8_t ANIM_Segment_Shift_Down[ANIM_NUM_OF_SEGMENTS] =
+{
+  8, 9, 3, ANIM_SEG_DROP, ANIM_SEG_DROP, ANIM_SEG_DROP, ANIM_SEG_DROP, 6,
+  4, 5, 15, 14, 13, ANIM_SEG_DROP, ANIM_SEG_DROP, ANIM_SEG_DROP
+};
+
+// number of steps of the slide transition: old, up(old), up2(old)|down2(new), down(new), new
+#define ANIM_SLIDE_NUM_OF_STEPS     5
+
+typedef struct
+{
+  uint32_t mask_old;
+  uint32_t mask_new;
+  int64_t start_us;
+  uint32_t duration_us;
+  ANIM_TRANSITION_ENUM transition;
+  bool active;
+}ANIM_CHANNEL_TYPE;
+
+#endif
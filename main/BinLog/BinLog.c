@@ -0,0 +1,305 @@
+
+/**
+ *  @file       BinLog.c
+ *
+ *  @brief      Structured binary log for the hot paths: an event is an ID and
+ *              two integer arguments, stored with its time in a RAM ring in a
+ *              few hundred nanoseconds, without formatting and without the
+ *              UART. Each event is rate limited, the records over the limit
+ *              are only counted. The records are formatted on the console by
+ *              a low priority task and downloaded on /binlog, decoded on the
+ *              host by tools/binlog_decode.py.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include <BinLog.h>
+#include <BinLog_prv.h>
+#include <HttpSrv.h>
+#include <Metrics.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static BINLOG_RECORD_TYPE px_BinLog_Record[BINLOG_RECORDS];
+
+// records written since boot, the next one goes to px_BinLog_Record[head % BINLOG_RECORDS]
+static uint32_t u32_BinLog_Head;
+// records formatted by the log task
+static uint32_t u32_BinLog_Tail;
+static uint32_t u32_BinLog_Lost;
+
+static BINLOG_SITE_TYPE px_BinLog_Site[NUM_OF_BINLOG_EVENTS];
+
+static portMUX_TYPE x_BinLog_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t x_BinLog_Task_Hdl;
+
+static const char *TAG = "BinLog";
+
+// stack and TCB of the task, reserved at link time in static allocation mode
+SYSMON_TASK_POOL(x_BinLog_Task, BINLOG_TASK_STACK)
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static void BinLogTaskCallback(void *pv_args);
+static void BinLogFormat(const BINLOG_RECORD_TYPE *px_record);
+static esp_err_t BinLogHttpGetHandler(httpd_req_t *px_req);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method: starts the log task and registers
+ *          the endpoint, to be called after the HTTP server has been
+ *          started. Events can be recorded before, they are formatted once
+ *          the task runs.
+ *
+ */
+void BinLog__Initialize(void)
+{
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = BINLOG_URI,
+    .method = HTTP_GET,
+    .handler = BinLogHttpGetHandler,
+    .user_ctx = NULL
+  };
+
+  SysMon__Register_Module(TAG, sizeof(px_BinLog_Record) + sizeof(px_BinLog_Site) +
+                               SYSMON_TASK_POOL_BYTES(x_BinLog_Task));
+
+  SYSMON_TASK_CREATE(x_BinLog_Task, BinLogTaskCallback, "BinLog", BINLOG_TASK_STACK, NULL,
+                     BINLOG_TASK_PRIO, &x_BinLog_Task_Hdl, tskNO_AFFINITY);
+  SysMon__Register_Task(TAG, x_BinLog_Task_Hdl, BINLOG_TASK_STACK);
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Records an event, unless it is over its rate limit: then it is
+ *          only counted. Only a few stores in a critical section, it can be
+ *          called from the refresh loops; not from an ISR.
+ *
+ * @param e_event   event
+ * @param u32_a     first argument of the format
+ * @param u32_b     second argument of the format
+ */
+void BinLog__Event(BINLOG_EVENT_ENUM e_event, uint32_t u32_a, uint32_t u32_b)
+{
+  BINLOG_SITE_TYPE *px_site;
+  BINLOG_RECORD_TYPE *px_record;
+  int64_t s64_now_us;
+  bool b_kept = false;
+
+  if (e_event >= NUM_OF_BINLOG_EVENTS)
+  {
+    return;
+  }
+  px_site = &px_BinLog_Site[e_event];
+  s64_now_us = esp_timer_get_time();
+
+  portENTER_CRITICAL(&x_BinLog_Mux);
+  if ((s64_now_us - px_site->window_us) >= ((int64_t)BINLOG_Desc[e_event].interval_ms * 1000))
+  {
+    px_site->window_us = s64_now_us;
+    px_site->kept = 0;
+  }
+  if (px_site->kept < BINLOG_Desc[e_event].burst)
+  {
+    px_site->kept++;
+    px_record = &px_BinLog_Record[u32_BinLog_Head & (BINLOG_RECORDS - 1)];
+    px_record->time_lo = (uint32_t)s64_now_us;
+    px_record->time_hi = (uint16_t)(s64_now_us >> 32);
+    px_record->event = (uint8_t)e_event;
+    px_record->suppressed = px_site->suppressed;
+    px_record->a = u32_a;
+    px_record->b = u32_b;
+    u32_BinLog_Head++;
+    px_site->suppressed = 0;
+    b_kept = true;
+  }
+  else
+  {
+    px_site->suppressed_total++;
+    if (px_site->suppressed < UINT8_MAX)
+    {
+      px_site->suppressed++;
+    }
+  }
+  portEXIT_CRITICAL(&x_BinLog_Mux);
+
+  if ((b_kept == true) && (x_BinLog_Task_Hdl != NULL))
+  {
+    xTaskNotifyGive(x_BinLog_Task_Hdl);
+  }
+
+  Metrics__Counter_Add((b_kept == true) ? METRICS_BINLOG_RECORDS : METRICS_BINLOG_SUPPRESSED, 1);
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Log task: formats the new records on the console, notified by
+ *          BinLog__Event(), it does not wake up while the ring is empty.
+ *          Records overwritten before being formatted are counted as lost.
+ *
+ * @param pv_args NULL
+ */
+static void BinLogTaskCallback(void *pv_args)
+{
+  BINLOG_RECORD_TYPE x_record;
+  uint32_t u32_lost;
+  bool b_pending;
+
+  for (;;)
+  {
+    (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    do
+    {
+      u32_lost = 0;
+      portENTER_CRITICAL(&x_BinLog_Mux);
+      if ((u32_BinLog_Head - u32_BinLog_Tail) > BINLOG_RECORDS)
+      {
+        u32_lost = u32_BinLog_Head - u32_BinLog_Tail - BINLOG_RECORDS;
+        u32_BinLog_Lost += u32_lost;
+        u32_BinLog_Tail = u32_BinLog_Head - BINLOG_RECORDS;
+      }
+      b_pending = (u32_BinLog_Tail != u32_BinLog_Head);
+      if (b_pending == true)
+      {
+        x_record = px_BinLog_Record[u32_BinLog_Tail & (BINLOG_RECORDS - 1)];
+        u32_BinLog_Tail++;
+      }
+      portEXIT_CRITICAL(&x_BinLog_Mux);
+
+      if (u32_lost != 0)
+      {
+        Metrics__Counter_Add(METRICS_BINLOG_LOST, u32_lost);
+        ESP_LOGW(TAG, "%u records lost", u32_lost);
+      }
+#if BINLOG_CONSOLE
+      if (b_pending == true)
+      {
+        BinLogFormat(&x_record);
+      }
+#endif
+    } while (b_pending == true);
+  }
+}
+
+/**
+ * @brief   Writes a record on the console, with the tag and level of its
+ *          event, in the format of the ESP-IDF log.
+ *
+ * @param px_record record
+ */
+static void BinLogFormat(const BINLOG_RECORD_TYPE *px_record)
+{
+  static const char pc_letter[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+  const BINLOG_DESC_TYPE *px_desc = &BINLOG_Desc[px_record->event];
+  char pc_line[BINLOG_LINE_BYTES];
+  int64_t s64_time_us = ((int64_t)px_record->time_hi << 32) | px_record->time_lo;
+
+  // the level of the tag is checked by esp_log_write()
+  (void)snprintf(pc_line, sizeof(pc_line), px_desc->format, px_record->a, px_record->b);
+  if (px_record->suppressed == UINT8_MAX)
+  {
+    esp_log_write(px_desc->level, px_desc->tag, "%c (%u) %s: %s (255+ suppressed)\n",
+                  pc_letter[px_desc->level], (uint32_t)(s64_time_us / 1000), px_desc->tag, pc_line);
+  }
+  else if (px_record->suppressed != 0)
+  {
+    esp_log_write(px_desc->level, px_desc->tag, "%c (%u) %s: %s (%u suppressed)\n",
+                  pc_letter[px_desc->level], (uint32_t)(s64_time_us / 1000), px_desc->tag, pc_line,
+                  px_record->suppressed);
+  }
+  else
+  {
+    esp_log_write(px_desc->level, px_desc->tag, "%c (%u) %s: %s\n",
+                  pc_letter[px_desc->level], (uint32_t)(s64_time_us / 1000), px_desc->tag, pc_line);
+  }
+}
+
+/**
+ * @brief   GET on the log: header, suppression counters of each event and
+ *          the records kept, from the oldest one (format in BinLog_prv.h).
+ *          The records are copied in chunks, the newest ones may overwrite
+ *          the oldest during the download.
+ *
+ * @param px_req  request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t BinLogHttpGetHandler(httpd_req_t *px_req)
+{
+  BINLOG_HEADER_TYPE x_header;
+  uint32_t pu32_suppressed[NUM_OF_BINLOG_EVENTS];
+  BINLOG_RECORD_TYPE px_chunk[16];
+  uint32_t u32_first;
+  uint32_t u32_head;
+  uint32_t u32_idx;
+  uint8_t u8_num;
+  uint8_t u8_rec;
+  uint8_t u8_event;
+
+  x_header.magic = BINLOG_MAGIC;
+  x_header.version = BINLOG_VERSION;
+  x_header.events = NUM_OF_BINLOG_EVENTS;
+  x_header.now_us = esp_timer_get_time();
+
+  portENTER_CRITICAL(&x_BinLog_Mux);
+  u32_head = u32_BinLog_Head;
+  x_header.lost = u32_BinLog_Lost;
+  for (u8_event = 0; u8_event < NUM_OF_BINLOG_EVENTS; ++u8_event)
+  {
+    pu32_suppressed[u8_event] = px_BinLog_Site[u8_event].suppressed_total;
+  }
+  portEXIT_CRITICAL(&x_BinLog_Mux);
+
+  u32_first = (u32_head > BINLOG_RECORDS) ? (u32_head - BINLOG_RECORDS) : 0;
+  x_header.records = u32_head - u32_first;
+
+  httpd_resp_set_type(px_req, "application/octet-stream");
+  httpd_resp_send_chunk(px_req, (const char *)&x_header, sizeof(x_header));
+  httpd_resp_send_chunk(px_req, (const char *)pu32_suppressed, sizeof(pu32_suppressed));
+
+  for (u32_idx = u32_first; u32_idx < u32_head; u32_idx += u8_num)
+  {
+    u8_num = (uint8_t)MIN(u32_head - u32_idx, sizeof(px_chunk) / sizeof(px_chunk[0]));
+    portENTER_CRITICAL(&x_BinLog_Mux);
+    for (u8_rec = 0; u8_rec < u8_num; ++u8_rec)
+    {
+      px_chunk[u8_rec] = px_BinLog_Record[(u32_idx + u8_rec) & (BINLOG_RECORDS - 1)];
+    }
+    portEXIT_CRITICAL(&x_BinLog_Mux);
+    if (httpd_resp_send_chunk(px_req, (const char *)px_chunk, u8_num * sizeof(px_chunk[0])) != ESP_OK)
+    {
+      return ESP_OK;
+    }
+  }
+
+  return httpd_resp_send_chunk(px_req, NULL, 0);
+}
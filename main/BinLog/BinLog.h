@@ -0,0 +1,31 @@
+
+/**
+ *  @file       BinLog.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef BINLOG_H
+    #define BINLOG_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <BinLog_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void BinLog__Initialize(void);
+void BinLog__Event(BINLOG_EVENT_ENUM e_event, uint32_t u32_a, uint32_t u32_b);
+
+#endif
@@ -0,0 +1,41 @@
+
+/**
+ *  @file       BinLog_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef BINLOG_PRM_H
+    #define BINLOG_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+/*
+ * Define here the events, level, tag, format and rate limit of each one are
+ * in BINLOG_Desc[]. New events must be appended: the logs downloaded from
+ * older builds are decoded by their index (tools/binlog_decode.py).
+ */
+typedef enum
+{
+  BINLOG_HOLTEK_SPI_FAULT = 0,      /*a: SPI_HLTK_ENUM step, b: HOLTEK_SPI_FAULT_ENUM*/
+  BINLOG_HOLTEK_SPI_ESCALATE,       /*a: SPI_HLTK_ENUM step (bus reset, full init), b: resets*/
+  BINLOG_SPIBUS_DEADLINE_MISS,      /*a: SPIBUS_CLIENT_ENUM, b: wait (us)*/
+  BINLOG_WIFI_DISCONNECT,           /*a: wifi_err_reason_t, b: retries*/
+  BINLOG_TIMESYNC_FAILURE,          /*a: servers resolved, b: retry (s)*/
+  NUM_OF_BINLOG_EVENTS
+}BINLOG_EVENT_ENUM;
+
+// entry point of the log: GET downloads the records kept (format in BinLog_prv.h)
+#define BINLOG_URI                  "/binlog"
+
+#endif
@@ -0,0 +1,120 @@
+
+/**
+ *  @file       BinLog_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef BINLOG_PRV_H
+    #define BINLOG_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include <BinLog_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// records kept, the oldest ones are overwritten
+#define BINLOG_RECORDS              CONFIG_BINLOG_RECORDS
+// records formatted on the console by the log task
+#define BINLOG_CONSOLE              CONFIG_BINLOG_CONSOLE
+
+#if ((BINLOG_RECORDS & (BINLOG_RECORDS - 1)) != 0)
+#error "BinLog: the number of records must be a power of 2"
+#endif
+
+/*
+ * Event descriptor: the format takes the two arguments as unsigned (%u, %x)
+ * or signed (%d) 32 bits values. At most burst records of the event are
+ * kept in each interval, the others are only counted and the count is
+ * attached to the next record kept.
+ */
+typedef struct
+{
+  esp_log_level_t level;
+  const char *tag;
+  const char *format;
+  uint16_t interval_ms;
+  uint8_t burst;
+}BINLOG_DESC_TYPE;
+
+// parsed by tools/binlog_decode.py: one entry per line, format as a single string
+static const BINLOG_DESC_TYPE BINLOG_Desc[NUM_OF_BINLOG_EVENTS] =
+{
+  [BINLOG_HOLTEK_SPI_FAULT]     = {ESP_LOG_WARN,  "Holtek",       "SPI step %u failed, fault %u",         1000,  1},
+  [BINLOG_HOLTEK_SPI_ESCALATE]  = {ESP_LOG_ERROR, "Holtek",       "SPI escalation to step %u, reset %u",  10000, 3},
+  [BINLOG_SPIBUS_DEADLINE_MISS] = {ESP_LOG_WARN,  "SpiBus",       "client %u granted after %u us",        1000,  1},
+  [BINLOG_WIFI_DISCONNECT]      = {ESP_LOG_INFO,  "wifi station", "disconnected, reason %u, retry %u",    1000,  5},
+  [BINLOG_TIMESYNC_FAILURE]     = {ESP_LOG_WARN,  "TimeSync",     "no valid reply from %u servers, retry in %u s", 60000, 1},
+};
+
+/*
+ * Record, 16 bytes little endian:
+ *
+ *   offset  size  field
+ *   0       6     time (us since boot)
+ *   6       1     event (BINLOG_EVENT_ENUM)
+ *   7       1     records of the event suppressed before this one (255: 255 or more)
+ *   8       4     argument a
+ *   12      4     argument b
+ */
+typedef struct __attribute__((packed))
+{
+  uint32_t time_lo;
+  uint16_t time_hi;
+  uint8_t event;
+  uint8_t suppressed;
+  uint32_t a;
+  uint32_t b;
+}BINLOG_RECORD_TYPE;
+
+/*
+ * Download on /binlog: header, suppressed records of each event since boot
+ * (u32 each), then the records kept from the oldest one.
+ *
+ *   offset  size  field
+ *   0       4     magic "BLG1"
+ *   4       2     version
+ *   6       2     events (NUM_OF_BINLOG_EVENTS)
+ *   8       4     records following the counters
+ *   12      4     records overwritten before being formatted
+ *   16      8     time of the download (us since boot)
+ */
+#define BINLOG_MAGIC                0x31474C42
+#define BINLOG_VERSION              1
+
+typedef struct __attribute__((packed))
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t events;
+  uint32_t records;
+  uint32_t lost;
+  int64_t now_us;
+}BINLOG_HEADER_TYPE;
+
+typedef struct
+{
+  int64_t window_us;                // start of the rate limit interval
+  uint32_t suppressed_total;
+  uint8_t kept;                     // records kept in the interval
+  uint8_t suppressed;               // since the last record kept
+}BINLOG_SITE_TYPE;
+
+// the log task formats the new records when notified, it sleeps while none is pending
+#define BINLOG_TASK_STACK           (1024 * 3)
+#define BINLOG_TASK_PRIO            1
+
+// longest line formatted on the console
+#define BINLOG_LINE_BYTES           96
+
+#endif
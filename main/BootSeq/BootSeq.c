@@ -0,0 +1,349 @@
+
+/**
+ *  @file       BootSeq.c
+ *
+ *  @brief      Boot sequencer and profiler: runs the init steps as a
+ *              dependency graph, independent steps concurrently, and prints
+ *              the timeline of the boot from reset.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_private/esp_clk.h"
+
+#include <BootSeq.h>
+#include <BootSeq_prv.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static BOOTSEQ_GRAPH_TYPE x_BootSeq_Graph;
+static StaticEventGroup_t x_BootSeq_Done_Buffer;
+static StaticSemaphore_t x_BootSeq_Workers_Done_Buffer;
+
+static TaskHandle_t px_BootSeq_Worker[BOOTSEQ_WORKERS];
+
+SYSMON_TASK_POOL(x_BootSeq_Worker_1, BOOTSEQ_WORKER_STACK)
+SYSMON_TASK_POOL(x_BootSeq_Worker_2, BOOTSEQ_WORKER_STACK)
+
+// time from reset to the start of the application (ROM and bootloader), 0 if unknown
+static int64_t s64_BootSeq_Pre_App_Us;
+
+static int64_t ps64_BootSeq_Mark_Us[NUM_OF_BOOTSEQ_MARKS];
+
+// timeline printed, later marks are printed as they come
+static bool b_BootSeq_Completed;
+
+static portMUX_TYPE x_BootSeq_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *TAG = "BootSeq";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static void BootSeqWorkerTask(void *pv_args);
+static void BootSeqWorker(uint8_t u8_worker);
+static int8_t BootSeqTake(uint32_t u32_done, bool *pb_all_started);
+static void BootSeqPrintTimeline(void);
+static void BootSeqPrintMark(BOOTSEQ_MARK_ENUM e_mark);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Runs the init steps and returns when all of them are completed.
+ *          The steps are run by the caller and by BOOTSEQ_WORKERS tasks with
+ *          the same priority, a step is taken as soon as its dependencies
+ *          are completed, in table order. The workers are deleted before
+ *          returning, their memory is back to the heap unless
+ *          CONFIG_APP_STATIC_ALLOCATION, which keeps their stacks static.
+ *
+ * @param px_steps      steps, a step may only depend on the steps before it
+ * @param u8_steps_num  number of steps, up to BOOTSEQ_MAX_STEPS
+ */
+void BootSeq__Run(const BOOTSEQ_STEP_TYPE *px_steps, uint8_t u8_steps_num)
+{
+  uint8_t u8_idx;
+
+  // the RTC counter starts at power-on, on other resets it keeps counting from a previous boot
+  if (esp_reset_reason() == ESP_RST_POWERON)
+  {
+    s64_BootSeq_Pre_App_Us = (int64_t)esp_clk_rtc_time() - esp_timer_get_time();
+  }
+
+  configASSERT(u8_steps_num <= BOOTSEQ_MAX_STEPS);
+  for (u8_idx = 0; u8_idx < u8_steps_num; ++u8_idx)
+  {
+    // table order is a topological order, no cycle can block the workers
+    configASSERT(px_steps[u8_idx].deps < BOOTSEQ_DEP(u8_idx));
+  }
+
+  memset(&x_BootSeq_Graph, 0x00, sizeof(x_BootSeq_Graph));
+  x_BootSeq_Graph.steps = px_steps;
+  x_BootSeq_Graph.steps_num = u8_steps_num;
+  x_BootSeq_Graph.done = xEventGroupCreateStatic(&x_BootSeq_Done_Buffer);
+  x_BootSeq_Graph.workers_done = xSemaphoreCreateCountingStatic(BOOTSEQ_WORKERS, 0, &x_BootSeq_Workers_Done_Buffer);
+
+  (void)SYSMON_TASK_CREATE(x_BootSeq_Worker_1, BootSeqWorkerTask, "BootSeq", BOOTSEQ_WORKER_STACK, (void *)1,
+                           uxTaskPriorityGet(NULL), &px_BootSeq_Worker[0], tskNO_AFFINITY);
+  (void)SYSMON_TASK_CREATE(x_BootSeq_Worker_2, BootSeqWorkerTask, "BootSeq", BOOTSEQ_WORKER_STACK, (void *)2,
+                           uxTaskPriorityGet(NULL), &px_BootSeq_Worker[1], tskNO_AFFINITY);
+  for (u8_idx = 0; u8_idx < BOOTSEQ_WORKERS; ++u8_idx)
+  {
+    if (px_BootSeq_Worker[u8_idx] == NULL)
+    {
+      // not created, the caller runs its steps
+      xSemaphoreGive(x_BootSeq_Graph.workers_done);
+    }
+  }
+
+  BootSeqWorker(0);
+
+  for (u8_idx = 0; u8_idx < BOOTSEQ_WORKERS; ++u8_idx)
+  {
+    xSemaphoreTake(x_BootSeq_Graph.workers_done, portMAX_DELAY);
+  }
+
+  for (u8_idx = 0; u8_idx < BOOTSEQ_WORKERS; ++u8_idx)
+  {
+    if (px_BootSeq_Worker[u8_idx] != NULL)
+    {
+      vTaskDelete(px_BootSeq_Worker[u8_idx]);
+      px_BootSeq_Worker[u8_idx] = NULL;
+    }
+  }
+
+  SysMon__Register_Module(TAG, sizeof(x_BootSeq_Graph) + sizeof(x_BootSeq_Done_Buffer) +
+                               sizeof(x_BootSeq_Workers_Done_Buffer) + sizeof(ps64_BootSeq_Mark_Us) +
+                               SYSMON_TASK_POOL_BYTES(x_BootSeq_Worker_1) + SYSMON_TASK_POOL_BYTES(x_BootSeq_Worker_2));
+
+  BootSeqPrintTimeline();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Records the first occurrence of a boot milestone. Can be called
+ *          from any task, marks after the end of the graph are printed
+ *          right away.
+ *
+ * @param e_mark milestone
+ */
+void BootSeq__Mark(BOOTSEQ_MARK_ENUM e_mark)
+{
+  bool b_print = false;
+
+  if (e_mark >= NUM_OF_BOOTSEQ_MARKS)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&x_BootSeq_Mux);
+  if (ps64_BootSeq_Mark_Us[e_mark] == 0)
+  {
+    ps64_BootSeq_Mark_Us[e_mark] = BootSeq__Get_Time_Us();
+    b_print = b_BootSeq_Completed;
+  }
+  portEXIT_CRITICAL(&x_BootSeq_Mux);
+
+  if (b_print == true)
+  {
+    BootSeqPrintMark(e_mark);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Returns the time since reset. ROM and bootloader time is known
+ *          only after a power-on reset, otherwise the time is counted from
+ *          the start of the application.
+ *
+ * @return time in us
+ */
+int64_t BootSeq__Get_Time_Us(void)
+{
+  return (s64_BootSeq_Pre_App_Us + esp_timer_get_time());
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Worker task: runs steps until all of them have been taken, then
+ *          waits to be deleted by BootSeq__Run().
+ *
+ * @param pv_args worker number, from 1
+ */
+static void BootSeqWorkerTask(void *pv_args)
+{
+  uint8_t u8_worker = (uint8_t)(uintptr_t)pv_args;
+
+  BootSeqWorker(u8_worker);
+
+  xSemaphoreGive(x_BootSeq_Graph.workers_done);
+  vTaskSuspend(NULL);
+}
+
+/**
+ * @brief   Takes and runs the steps whose dependencies are completed, waits
+ *          for a step to complete when none is ready.
+ *
+ * @param u8_worker worker number, 0 = caller of BootSeq__Run()
+ */
+static void BootSeqWorker(uint8_t u8_worker)
+{
+  BOOTSEQ_STEP_TIME_TYPE *px_time;
+  uint32_t u32_done;
+  bool b_all_started;
+  int8_t s8_step;
+
+  while (true)
+  {
+    u32_done = (uint32_t)xEventGroupGetBits(x_BootSeq_Graph.done) & BOOTSEQ_STEPS_MASK;
+
+    s8_step = BootSeqTake(u32_done, &b_all_started);
+    if (s8_step >= 0)
+    {
+      px_time = &x_BootSeq_Graph.time[s8_step];
+      px_time->worker = u8_worker;
+      px_time->start_us = BootSeq__Get_Time_Us();
+
+      x_BootSeq_Graph.steps[s8_step].fn();
+
+      px_time->end_us = BootSeq__Get_Time_Us();
+      xEventGroupSetBits(x_BootSeq_Graph.done, BOOTSEQ_DEP(s8_step));
+    }
+    else if (b_all_started == true)
+    {
+      return;
+    }
+    else
+    {
+      // returns as soon as one of the steps in progress completes
+      xEventGroupWaitBits(x_BootSeq_Graph.done,
+                          (((1UL << x_BootSeq_Graph.steps_num) - 1) & ~u32_done),
+                          pdFALSE, pdFALSE, portMAX_DELAY);
+    }
+  }
+}
+
+/**
+ * @brief   Takes the first step not started whose dependencies are completed.
+ *
+ * @param u32_done        bitmap of the completed steps
+ * @param pb_all_started  [out] true if every step has been taken
+ *
+ * @return step taken, -1 if none is ready
+ */
+static int8_t BootSeqTake(uint32_t u32_done, bool *pb_all_started)
+{
+  int8_t s8_step = -1;
+  uint8_t u8_idx;
+
+  portENTER_CRITICAL(&x_BootSeq_Mux);
+  for (u8_idx = 0; u8_idx < x_BootSeq_Graph.steps_num; ++u8_idx)
+  {
+    if (((x_BootSeq_Graph.started & BOOTSEQ_DEP(u8_idx)) == 0) &&
+        ((x_BootSeq_Graph.steps[u8_idx].deps & ~u32_done) == 0))
+    {
+      x_BootSeq_Graph.started |= BOOTSEQ_DEP(u8_idx);
+      s8_step = (int8_t)u8_idx;
+      break;
+    }
+  }
+  *pb_all_started = (x_BootSeq_Graph.started == ((1UL << x_BootSeq_Graph.steps_num) - 1));
+  portEXIT_CRITICAL(&x_BootSeq_Mux);
+
+  return s8_step;
+}
+
+/**
+ * @brief   Prints the time of the steps and of the marks already recorded,
+ *          from reset.
+ *
+ */
+static void BootSeqPrintTimeline(void)
+{
+  const BOOTSEQ_STEP_TIME_TYPE *px_time;
+  uint32_t u32_marks = 0;
+  uint8_t u8_idx;
+
+  if (s64_BootSeq_Pre_App_Us != 0)
+  {
+    ESP_LOGI(TAG, "%-16s %5d.%d ms", "app start",
+             (int)(s64_BootSeq_Pre_App_Us / 1000), (int)((s64_BootSeq_Pre_App_Us / 100) % 10));
+  }
+  else
+  {
+    ESP_LOGI(TAG, "not a power-on reset, times from app start");
+  }
+
+  for (u8_idx = 0; u8_idx < x_BootSeq_Graph.steps_num; ++u8_idx)
+  {
+    px_time = &x_BootSeq_Graph.time[u8_idx];
+
+    ESP_LOGI(TAG, "%-16s %5d.%d .. %5d.%d ms  worker %u",
+             x_BootSeq_Graph.steps[u8_idx].name,
+             (int)(px_time->start_us / 1000), (int)((px_time->start_us / 100) % 10),
+             (int)(px_time->end_us / 1000), (int)((px_time->end_us / 100) % 10),
+             px_time->worker);
+  }
+
+  // the marks recorded from now on are printed by BootSeq__Mark()
+  portENTER_CRITICAL(&x_BootSeq_Mux);
+  b_BootSeq_Completed = true;
+  for (u8_idx = 0; u8_idx < NUM_OF_BOOTSEQ_MARKS; ++u8_idx)
+  {
+    if (ps64_BootSeq_Mark_Us[u8_idx] != 0)
+    {
+      u32_marks |= (1UL << u8_idx);
+    }
+  }
+  portEXIT_CRITICAL(&x_BootSeq_Mux);
+
+  for (u8_idx = 0; u8_idx < NUM_OF_BOOTSEQ_MARKS; ++u8_idx)
+  {
+    if ((u32_marks & (1UL << u8_idx)) != 0)
+    {
+      BootSeqPrintMark(u8_idx);
+    }
+  }
+}
+
+/**
+ * @brief   Prints the time of a mark, the display one is checked against
+ *          BOOTSEQ_DISPLAY_TARGET_MS.
+ *
+ * @param e_mark mark to be printed
+ */
+static void BootSeqPrintMark(BOOTSEQ_MARK_ENUM e_mark)
+{
+  int64_t s64_us = ps64_BootSeq_Mark_Us[e_mark];
+
+  if ((e_mark == BOOTSEQ_MARK_DISPLAY_VISIBLE) && (s64_us > (BOOTSEQ_DISPLAY_TARGET_MS * 1000LL)))
+  {
+    ESP_LOGW(TAG, "%-16s %5d.%d ms  target %d ms", BOOTSEQ_Mark_Name[e_mark],
+             (int)(s64_us / 1000), (int)((s64_us / 100) % 10), BOOTSEQ_DISPLAY_TARGET_MS);
+  }
+  else
+  {
+    ESP_LOGI(TAG, "%-16s %5d.%d ms", BOOTSEQ_Mark_Name[e_mark], (int)(s64_us / 1000), (int)((s64_us / 100) % 10));
+  }
+}
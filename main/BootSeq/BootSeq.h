@@ -0,0 +1,55 @@
+
+/**
+ *  @file       BootSeq.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef BOOTSEQ_H
+    #define BOOTSEQ_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <BootSeq_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+// dependency bitmap of a step, bit n = step n of the graph
+#define BOOTSEQ_DEP(step)           (1UL << (step))
+
+/*
+ * Init step: it runs as soon as all the steps in deps are completed, steps
+ * without dependencies between them run concurrently. A step may block
+ * (i.e. waiting for the flash) without delaying the others.
+ */
+typedef struct
+{
+  const char *name;
+  void (*fn)(void);
+  uint32_t deps;
+}BOOTSEQ_STEP_TYPE;
+
+// timeline marks recorded outside the graph
+typedef enum
+{
+  BOOTSEQ_MARK_DISPLAY_VISIBLE = 0,   /*first frame written to the display*/
+  BOOTSEQ_MARK_NETWORK_UP,            /*IP address obtained*/
+  NUM_OF_BOOTSEQ_MARKS
+}BOOTSEQ_MARK_ENUM;
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void BootSeq__Run(const BOOTSEQ_STEP_TYPE *px_steps, uint8_t u8_steps_num);
+void BootSeq__Mark(BOOTSEQ_MARK_ENUM e_mark);
+int64_t BootSeq__Get_Time_Us(void);
+
+#endif
@@ -0,0 +1,32 @@
+
+/**
+ *  @file       BootSeq_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef BOOTSEQ_PRM_H
+    #define BOOTSEQ_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+// max number of init steps of the graph, one event group bit each
+#define BOOTSEQ_MAX_STEPS           24
+
+// tasks running the init steps together with the caller of BootSeq__Run()
+#define BOOTSEQ_WORKERS             2
+#define BOOTSEQ_WORKER_STACK        (1024 * 4)
+
+// the display must be visible within this time from reset
+#define BOOTSEQ_DISPLAY_TARGET_MS   300
+
+#endif
@@ -0,0 +1,62 @@
+
+/**
+ *  @file       BootSeq_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef BOOTSEQ_PRV_H
+    #define BOOTSEQ_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include <BootSeq_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// event group bits: steps completed
+#define BOOTSEQ_STEPS_MASK          ((1UL << BOOTSEQ_MAX_STEPS) - 1)
+
+#if (BOOTSEQ_MAX_STEPS > 24)
+#error "the event group has 24 bits"
+#endif
+
+#if (BOOTSEQ_WORKERS != 2)
+#error "BootSeq: one task pool per worker"
+#endif
+
+typedef struct
+{
+  int64_t start_us;
+  int64_t end_us;
+  uint8_t worker;                   // 0 = caller of BootSeq__Run()
+}BOOTSEQ_STEP_TIME_TYPE;
+
+typedef struct
+{
+  const BOOTSEQ_STEP_TYPE *steps;
+  uint8_t steps_num;
+  uint32_t started;                 // bitmap of the steps taken by a worker
+  BOOTSEQ_STEP_TIME_TYPE time[BOOTSEQ_MAX_STEPS];
+  EventGroupHandle_t done;
+  SemaphoreHandle_t workers_done;   // given once by each worker
+}BOOTSEQ_GRAPH_TYPE;
+
+static const char * const BOOTSEQ_Mark_Name[NUM_OF_BOOTSEQ_MARKS] =
+{
+  [BOOTSEQ_MARK_DISPLAY_VISIBLE] = "display visible",
+  [BOOTSEQ_MARK_NETWORK_UP]      = "network up",
+};
+
+#endif
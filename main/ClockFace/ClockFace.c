@@ -0,0 +1,471 @@
+
+/**
+ *  @file       ClockFace.c
+ *
+ *  @brief      Clock face on the bottom display layer: hours and minutes
+ *              (12/24 h, with or without leading zero), the date for a few
+ *              seconds of every minute and the seconds indicator.
+ *              The frame of the next change (next minute, date in, date out)
+ *              is laid out and encoded right after the previous one is
+ *              published, so at the boundary the only work left is the
+ *              buffer swap of Holtek__Frame_Commit(); the composer plays
+ *              the transition of the frame on the digits that change.
+ *              The seconds indicator
+ *              is the blink of the frame, run by the composer with the
+ *              phase set by the commit: no work at all on each second.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include <ClockFace.h>
+#include <ClockFace_prv.h>
+#include <Holtek.h>
+#include <TimeZone.h>
+#include <TickSync.h>
+#include <Settings.h>
+#include <HttpSrv.h>
+#include <Metrics.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static uint8_t u8_ClockFace_Format;
+
+// the back buffer of the layer holds the frame of the next boundary
+static bool b_ClockFace_Prepared;
+
+// boundary timer, and the one running the out of schedule updates in the same (esp_timer) task
+static esp_timer_handle_t x_ClockFace_Timer;
+static esp_timer_handle_t x_ClockFace_Refresh_Timer;
+
+static const CLOCKFACE_FORMAT_WORD_TYPE CLOCKFACE_Format_Words[] = CLOCKFACE_FORMAT_WORDS;
+
+static const char *TAG = "ClockFace";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static void ClockFaceTimerCallback(void *pv_arg);
+static void ClockFaceRefreshCallback(void *pv_arg);
+static bool ClockFaceNow(int64_t *ps64_now_us);
+static CLOCKFACE_VIEW_ENUM ClockFaceView(int64_t s64_utc_s, int64_t *ps64_next_s);
+static void ClockFacePrepare(int64_t s64_now_us);
+static void ClockFaceLayout(HOLTEK_FRAME_TYPE *px_frame, CLOCKFACE_VIEW_ENUM e_view, int64_t s64_utc_s);
+static void ClockFaceTwoDigits(HOLTEK_FRAME_TYPE *px_frame, DISPLAY_DIGIT_ENUM e_digit, int s32_value,
+                               bool b_leading_zero);
+static esp_err_t ClockFaceHttpGetHandler(httpd_req_t *px_req);
+static esp_err_t ClockFaceHttpPostHandler(httpd_req_t *px_req);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, restores the format and shows the
+ *          face as soon as the clock is set. To be called after the display,
+ *          the settings, the time zone and the HTTP server are started.
+ *
+ */
+void ClockFace__Initialize(void)
+{
+  const esp_timer_create_args_t x_timer_args =
+  {
+    .callback = ClockFaceTimerCallback,
+    .arg = NULL,
+    .name = "ClockFace"
+  };
+  const esp_timer_create_args_t x_refresh_timer_args =
+  {
+    .callback = ClockFaceRefreshCallback,
+    .arg = NULL,
+    .name = "ClockFaceRefresh"
+  };
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = CLOCKFACE_URI,
+    .method = HTTP_GET,
+    .handler = ClockFaceHttpGetHandler,
+    .user_ctx = NULL
+  };
+  const httpd_uri_t x_post_uri =
+  {
+    .uri = CLOCKFACE_URI,
+    .method = HTTP_POST,
+    .handler = ClockFaceHttpPostHandler,
+    .user_ctx = NULL
+  };
+
+  u8_ClockFace_Format = (uint8_t)Settings__Get_U32(SETTINGS_CLOCK_FORMAT);
+
+  ESP_ERROR_CHECK(esp_timer_create(&x_timer_args, &x_ClockFace_Timer));
+  ESP_ERROR_CHECK(esp_timer_create(&x_refresh_timer_args, &x_ClockFace_Refresh_Timer));
+
+  SysMon__Register_Module(TAG, sizeof(u8_ClockFace_Format) + sizeof(b_ClockFace_Prepared));
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+  (void)HttpSrv__Register_Uri(&x_post_uri);
+
+  ClockFace__Time_Changed();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Lays out the face again, to be called when the clock has been set
+ *          or has jumped, or when the time zone changed. The update runs in
+ *          the timer task, the only producer of the layer.
+ *
+ */
+void ClockFace__Time_Changed(void)
+{
+  if (x_ClockFace_Refresh_Timer == NULL)
+  {
+    return;
+  }
+
+  // already armed: the update pending covers this change too
+  (void)esp_timer_start_once(x_ClockFace_Refresh_Timer, 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Changes the format of the face and stores it in the settings.
+ *
+ * @param u8_format CLOCKFACE_FORMAT_* flags
+ */
+void ClockFace__Set_Format(uint8_t u8_format)
+{
+  u8_ClockFace_Format = u8_format;
+  (void)Settings__Set_U32(SETTINGS_CLOCK_FORMAT, u8_format);
+
+  ClockFace__Time_Changed();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Format of the face.
+ *
+ * @return CLOCKFACE_FORMAT_* flags
+ */
+uint8_t ClockFace__Get_Format(void)
+{
+  return u8_ClockFace_Format;
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Boundary of the face: the frame prepared for it is published and
+ *          the one of the next boundary is laid out.
+ *
+ * @param pv_arg not used
+ */
+static void ClockFaceTimerCallback(void *pv_arg)
+{
+  int64_t s64_now_us;
+
+  if (b_ClockFace_Prepared == false)
+  {
+    // waiting for the clock to be set
+    ClockFaceRefreshCallback(NULL);
+    return;
+  }
+
+  Holtek__Frame_Commit(HOLTEK_LAYER_CLOCK);
+  Metrics__Counter_Add(METRICS_CLOCKFACE_COMMITS, 1);
+
+  if (ClockFaceNow(&s64_now_us) == true)
+  {
+    ClockFacePrepare(s64_now_us);
+  }
+  else
+  {
+    ClockFaceRefreshCallback(NULL);
+  }
+}
+
+/**
+ * @brief   Out of schedule update (clock, zone or format changed): the face
+ *          of the current time is laid out and published at once, then the
+ *          next boundary is prepared. While the clock is not set the layer
+ *          is hidden and the clock is checked again later.
+ *
+ * @param pv_arg not used
+ */
+static void ClockFaceRefreshCallback(void *pv_arg)
+{
+  HOLTEK_FRAME_TYPE *px_frame;
+  int64_t s64_now_us;
+  int64_t s64_next_s;
+  CLOCKFACE_VIEW_ENUM e_view;
+
+  (void)esp_timer_stop(x_ClockFace_Timer);
+  b_ClockFace_Prepared = false;
+
+  if (ClockFaceNow(&s64_now_us) == false)
+  {
+    Holtek__Frame_Release(HOLTEK_LAYER_CLOCK);
+    (void)esp_timer_start_once(x_ClockFace_Timer, CLOCKFACE_WAIT_CLOCK_US);
+    return;
+  }
+
+  e_view = ClockFaceView(s64_now_us / 1000000, &s64_next_s);
+
+  px_frame = Holtek__Frame_Acquire(HOLTEK_LAYER_CLOCK);
+  ClockFaceLayout(px_frame, e_view, s64_now_us / 1000000);
+  px_frame->transition = ANIM_TRANSITION_NONE;
+  Holtek__Frame_Commit(HOLTEK_LAYER_CLOCK);
+  Metrics__Counter_Add(METRICS_CLOCKFACE_REFRESHES, 1);
+
+  ClockFacePrepare(s64_now_us);
+}
+
+/**
+ * @brief   Current UTC time, shared with the other clocks of the LAN when
+ *          the tick sync is on: the boundaries fall at the same time on all
+ *          of them.
+ *
+ * @param ps64_now_us [out] microseconds since the epoch
+ *
+ * @return false if the clock is not set yet
+ */
+static bool ClockFaceNow(int64_t *ps64_now_us)
+{
+  *ps64_now_us = TickSync__Get_Time_Us();
+
+  return ((*ps64_now_us / 1000000) >= CLOCKFACE_CLOCK_VALID_S);
+}
+
+/**
+ * @brief   Contents of the face at a given time and time of the next change.
+ *
+ * @param s64_utc_s   seconds since the epoch
+ * @param ps64_next_s [out] UTC second of the next change
+ *
+ * @return view shown
+ */
+static CLOCKFACE_VIEW_ENUM ClockFaceView(int64_t s64_utc_s, int64_t *ps64_next_s)
+{
+  int64_t s64_local_s = TimeZone__To_Local(s64_utc_s);
+  int64_t s64_second = s64_local_s % 60;
+  int64_t s64_minute_s = s64_utc_s - s64_second;
+
+  if (((u8_ClockFace_Format & CLOCKFACE_FORMAT_DATE) != 0) && (CLOCKFACE_DATE_DURATION_S > 0))
+  {
+    if (s64_second < CLOCKFACE_DATE_START_S)
+    {
+      *ps64_next_s = s64_minute_s + CLOCKFACE_DATE_START_S;
+      return CLOCKFACE_VIEW_TIME;
+    }
+    if (s64_second < (CLOCKFACE_DATE_START_S + CLOCKFACE_DATE_DURATION_S))
+    {
+      *ps64_next_s = s64_minute_s + CLOCKFACE_DATE_START_S + CLOCKFACE_DATE_DURATION_S;
+      return CLOCKFACE_VIEW_DATE;
+    }
+  }
+
+  *ps64_next_s = s64_minute_s + 60;
+  return CLOCKFACE_VIEW_TIME;
+}
+
+/**
+ * @brief   Lays out the frame of the next boundary in the back buffer of the
+ *          layer and arms the timer on it. The delay is taken from the wall
+ *          clock each time, so the boundaries follow its corrections.
+ *
+ * @param s64_now_us UTC microseconds
+ */
+static void ClockFacePrepare(int64_t s64_now_us)
+{
+  HOLTEK_FRAME_TYPE *px_frame;
+  int64_t s64_next_s;
+  int64_t s64_dummy_s;
+  CLOCKFACE_VIEW_ENUM e_view;
+
+  (void)ClockFaceView(s64_now_us / 1000000, &s64_next_s);
+  e_view = ClockFaceView(s64_next_s, &s64_dummy_s);
+
+  px_frame = Holtek__Frame_Acquire(HOLTEK_LAYER_CLOCK);
+  ClockFaceLayout(px_frame, e_view, s64_next_s);
+  px_frame->transition = CLOCKFACE_TRANSITION;
+  b_ClockFace_Prepared = true;
+
+  (void)esp_timer_start_once(x_ClockFace_Timer, (uint64_t)((s64_next_s * 1000000) - s64_now_us));
+}
+
+/**
+ * @brief   Encodes the face of a given time.
+ *
+ *          time:  H H : M M   (12 h: dp of the last digit in the afternoon)
+ *          date:  D D - M M
+ *
+ *          With the seconds indicator the separator, its dot and the time
+ *          dot icon blink at 1 Hz, lit in the first half of each second.
+ *          Only the dots wired on the glass are actually shown.
+ *
+ * @param px_frame  frame to be filled
+ * @param e_view    contents
+ * @param s64_utc_s seconds since the epoch
+ */
+static void ClockFaceLayout(HOLTEK_FRAME_TYPE *px_frame, CLOCKFACE_VIEW_ENUM e_view, int64_t s64_utc_s)
+{
+  time_t x_local = (time_t)TimeZone__To_Local(s64_utc_s);
+  bool b_leading_zero = ((u8_ClockFace_Format & CLOCKFACE_FORMAT_LEADING_ZERO) != 0);
+  struct tm x_tm;
+  int s32_hour;
+  uint8_t u8_byte;
+  uint8_t u8_bit;
+
+  gmtime_r(&x_local, &x_tm);
+
+  memset(px_frame->digit_mask, 0x00, sizeof(px_frame->digit_mask));
+  memset(px_frame->icons, 0x00, sizeof(px_frame->icons));
+  memset(px_frame->blink_icons, 0x00, sizeof(px_frame->blink_icons));
+  px_frame->blink_digits = 0;
+  px_frame->blink_on_ms = 0;
+  px_frame->blink_off_ms = 0;
+
+  if (e_view == CLOCKFACE_VIEW_DATE)
+  {
+    ClockFaceTwoDigits(px_frame, DIGIT_LEFT_2, x_tm.tm_mday, b_leading_zero);
+    px_frame->digit_mask[DIGIT_MIDDLE] = Holtek__Get_Glyph('-');
+    ClockFaceTwoDigits(px_frame, DIGIT_RIGHT_1, x_tm.tm_mon + 1, true);
+    return;
+  }
+
+  s32_hour = x_tm.tm_hour;
+  if ((u8_ClockFace_Format & CLOCKFACE_FORMAT_12H) != 0)
+  {
+    s32_hour = ((s32_hour % 12) == 0) ? 12 : (s32_hour % 12);
+    if (x_tm.tm_hour >= 12)
+    {
+      px_frame->digit_mask[DIGIT_RIGHT_2] |= DISPLAY_SEG_DP;
+    }
+  }
+
+  ClockFaceTwoDigits(px_frame, DIGIT_LEFT_2, s32_hour, b_leading_zero);
+  px_frame->digit_mask[DIGIT_MIDDLE] = Holtek__Get_Glyph(':');
+  ClockFaceTwoDigits(px_frame, DIGIT_RIGHT_1, x_tm.tm_min, true);
+
+  DISPLAY_ICON_GET_BYTE_BIT(ICON_TIME_DOT, u8_byte, u8_bit);
+  px_frame->icons[u8_byte] |= (uint8_t)(1u << u8_bit);
+
+  if ((u8_ClockFace_Format & CLOCKFACE_FORMAT_SECONDS) != 0)
+  {
+    px_frame->digit_mask[DIGIT_MIDDLE] |= DISPLAY_SEG_DP;
+    px_frame->blink_digits = (uint8_t)(1u << DIGIT_MIDDLE);
+    px_frame->blink_icons[u8_byte] |= (uint8_t)(1u << u8_bit);
+    px_frame->blink_on_ms = CLOCKFACE_BLINK_ON_MS;
+    px_frame->blink_off_ms = CLOCKFACE_BLINK_OFF_MS;
+  }
+}
+
+/**
+ * @brief   Writes a two digit number on a digit and the one at its right.
+ *
+ * @param px_frame       frame to be filled
+ * @param e_digit        digit of the tens
+ * @param s32_value      0..99
+ * @param b_leading_zero false to leave the tens blank when they are 0
+ */
+static void ClockFaceTwoDigits(HOLTEK_FRAME_TYPE *px_frame, DISPLAY_DIGIT_ENUM e_digit, int s32_value,
+                               bool b_leading_zero)
+{
+  if ((s32_value >= 10) || (b_leading_zero == true))
+  {
+    px_frame->digit_mask[e_digit] |= Holtek__Get_Glyph((uint8_t)('0' + (s32_value / 10)));
+  }
+  px_frame->digit_mask[e_digit + 1] |= Holtek__Get_Glyph((uint8_t)('0' + (s32_value % 10)));
+}
+
+/**
+ * @brief   Network command, format of the face, i.e. "24h zero date seconds".
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t ClockFaceHttpGetHandler(httpd_req_t *px_req)
+{
+  char pc_body[CLOCKFACE_HTTP_BODY_MAX + 1];
+  uint8_t u8_format = u8_ClockFace_Format;
+  size_t x_len = 0;
+  uint8_t u8_word;
+
+  pc_body[0] = '\0';
+  for (u8_word = 0; u8_word < (sizeof(CLOCKFACE_Format_Words) / sizeof(CLOCKFACE_Format_Words[0])); ++u8_word)
+  {
+    x_len += snprintf(&pc_body[x_len], sizeof(pc_body) - x_len, "%s%s", (u8_word == 0) ? "" : " ",
+                      ((u8_format & CLOCKFACE_Format_Words[u8_word].flag) != 0) ?
+                      CLOCKFACE_Format_Words[u8_word].set : CLOCKFACE_Format_Words[u8_word].clear);
+  }
+  (void)snprintf(&pc_body[x_len], sizeof(pc_body) - x_len, "\n");
+  httpd_resp_sendstr(px_req, pc_body);
+
+  return ESP_OK;
+}
+
+/**
+ * @brief   Network command, the body lists the format words to be changed,
+ *          the others are kept: i.e. "12h nozero" or "nodate".
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK if all the words are valid
+ */
+static esp_err_t ClockFaceHttpPostHandler(httpd_req_t *px_req)
+{
+  char pc_body[CLOCKFACE_HTTP_BODY_MAX + 1];
+  uint8_t u8_format = u8_ClockFace_Format;
+  char *pc_save = NULL;
+  char *pc_word;
+  int s32_len;
+  uint8_t u8_word;
+
+  s32_len = httpd_req_recv(px_req, pc_body, CLOCKFACE_HTTP_BODY_MAX);
+  pc_body[(s32_len > 0) ? s32_len : 0] = '\0';
+  pc_body[strcspn(pc_body, "\r\n")] = '\0';
+
+  for (pc_word = strtok_r(pc_body, " ,", &pc_save); pc_word != NULL; pc_word = strtok_r(NULL, " ,", &pc_save))
+  {
+    for (u8_word = 0; u8_word < (sizeof(CLOCKFACE_Format_Words) / sizeof(CLOCKFACE_Format_Words[0])); ++u8_word)
+    {
+      if (strcmp(pc_word, CLOCKFACE_Format_Words[u8_word].set) == 0)
+      {
+        u8_format |= CLOCKFACE_Format_Words[u8_word].flag;
+        break;
+      }
+      if (strcmp(pc_word, CLOCKFACE_Format_Words[u8_word].clear) == 0)
+      {
+        u8_format &= (uint8_t)~CLOCKFACE_Format_Words[u8_word].flag;
+        break;
+      }
+    }
+    if (u8_word >= (sizeof(CLOCKFACE_Format_Words) / sizeof(CLOCKFACE_Format_Words[0])))
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "expected 12h/24h, zero/nozero, date/nodate, seconds/noseconds");
+      return ESP_FAIL;
+    }
+  }
+
+  ClockFace__Set_Format(u8_format);
+  httpd_resp_sendstr(px_req, "OK\n");
+
+  return ESP_OK;
+}
@@ -0,0 +1,34 @@
+
+/**
+ *  @file       ClockFace.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef CLOCKFACE_H
+    #define CLOCKFACE_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <ClockFace_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void ClockFace__Initialize(void);
+void ClockFace__Time_Changed(void);
+void ClockFace__Set_Format(uint8_t u8_format);
+uint8_t ClockFace__Get_Format(void);
+
+#endif
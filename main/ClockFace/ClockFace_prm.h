@@ -0,0 +1,40 @@
+
+/**
+ *  @file       ClockFace_prm.h
+ *
+ *  @brief      Header containing the configuration parameters of the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef CLOCKFACE_PRM_H
+    #define CLOCKFACE_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+/*
+ * Format flags of the clock face, stored in SETTINGS_CLOCK_FORMAT:
+ *  - 12H: hours 1..12, the dp of the last digit is lit in the afternoon
+ *  - LEADING_ZERO: hours (and days) below 10 start with '0', blank otherwise
+ *  - DATE: the date is shown for a few seconds of every minute
+ *  - SECONDS: the separator blinks at 1 Hz, in phase with the seconds
+ */
+#define CLOCKFACE_FORMAT_12H            (1u << 0)
+#define CLOCKFACE_FORMAT_LEADING_ZERO   (1u << 1)
+#define CLOCKFACE_FORMAT_DATE           (1u << 2)
+#define CLOCKFACE_FORMAT_SECONDS        (1u << 3)
+
+#define CLOCKFACE_FORMAT_DEFAULT        (CLOCKFACE_FORMAT_LEADING_ZERO | CLOCKFACE_FORMAT_DATE | \
+                                         CLOCKFACE_FORMAT_SECONDS)
+
+// entry point of the network command: GET returns the format, POST changes it (i.e. "12h nozero")
+#define CLOCKFACE_URI                   "/clockface"
+
+#endif
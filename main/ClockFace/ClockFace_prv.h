@@ -0,0 +1,79 @@
+
+/**
+ *  @file       ClockFace_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef CLOCKFACE_PRV_H
+    #define CLOCKFACE_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// second of the minute where the date replaces the time, and for how long
+#define CLOCKFACE_DATE_START_S      CONFIG_CLOCKFACE_DATE_START_S
+#define CLOCKFACE_DATE_DURATION_S   CONFIG_CLOCKFACE_DATE_DURATION_S
+
+#if ((CLOCKFACE_DATE_START_S + CLOCKFACE_DATE_DURATION_S) > 60)
+#error "the date must be back to the time within the minute (CONFIG_CLOCKFACE_DATE_START_S + DURATION_S <= 60)"
+#endif
+
+// transition of the digits changed at the boundaries
+#if CONFIG_CLOCKFACE_TRANSITION_WIPE
+#define CLOCKFACE_TRANSITION        ANIM_TRANSITION_WIPE
+#elif CONFIG_CLOCKFACE_TRANSITION_MORPH
+#define CLOCKFACE_TRANSITION        ANIM_TRANSITION_MORPH
+#elif CONFIG_CLOCKFACE_TRANSITION_SLIDE
+#define CLOCKFACE_TRANSITION        ANIM_TRANSITION_SLIDE
+#else
+#define CLOCKFACE_TRANSITION        ANIM_TRANSITION_NONE
+#endif
+
+// the clock is considered set from 2022-01-01, before then the face is hidden and checked again
+#define CLOCKFACE_CLOCK_VALID_S     1640995200
+#define CLOCKFACE_WAIT_CLOCK_US     (10 * 1000000LL)
+
+// seconds indicator, phase aligned with the commit at the boundary of the second
+#define CLOCKFACE_BLINK_ON_MS       500
+#define CLOCKFACE_BLINK_OFF_MS      500
+
+// longest body of the network command
+#define CLOCKFACE_HTTP_BODY_MAX     48
+
+/*
+ * Contents of the face
+ */
+typedef enum
+{
+  CLOCKFACE_VIEW_TIME = 0,
+  CLOCKFACE_VIEW_DATE,
+  NUM_OF_CLOCKFACE_VIEWS
+}CLOCKFACE_VIEW_ENUM;
+
+// words of the network command, setting and clearing each format flag
+typedef struct
+{
+  const char *set;
+  const char *clear;
+  uint8_t flag;
+}CLOCKFACE_FORMAT_WORD_TYPE;
+
+#define CLOCKFACE_FORMAT_WORDS \
+{ \
+  {"12h",     "24h",       CLOCKFACE_FORMAT_12H}, \
+  {"zero",    "nozero",    CLOCKFACE_FORMAT_LEADING_ZERO}, \
+  {"date",    "nodate",    CLOCKFACE_FORMAT_DATE}, \
+  {"seconds", "noseconds", CLOCKFACE_FORMAT_SECONDS}, \
+}
+
+#endif
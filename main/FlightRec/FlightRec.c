@@ -0,0 +1,470 @@
+
+/**
+ *  @file       FlightRec.c
+ *
+ *  @brief      Flight recorder: a ring of key events (display SPI steps,
+ *              Wi-Fi events, heap low-water marks and refresh timing
+ *              changes) and the latest heap and refresh samples kept in RTC
+ *              slow memory, so that they survive panics, watchdog and
+ *              brownout resets. At boot the records of the previous boots
+ *              are copied aside and reported with the reset reason on the
+ *              console, on /flightrec and on the metrics.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include <FlightRec.h>
+#include <FlightRec_prv.h>
+#include <Holtek.h>
+#include <HttpSrv.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static RTC_NOINIT_ATTR FLIGHTREC_HEADER_TYPE x_FlightRec_Header;
+static RTC_NOINIT_ATTR FLIGHTREC_RECORD_TYPE px_FlightRec_Record[FLIGHTREC_RECORDS];
+
+// records of the previous boots found at boot, from the oldest one
+static FLIGHTREC_RECORD_TYPE px_FlightRec_Previous[FLIGHTREC_RECORDS];
+// latest samples of the previous boot
+static FLIGHTREC_RECORD_TYPE px_FlightRec_Previous_Sample[NUM_OF_FLIGHTREC_SAMPLES];
+
+static FLIGHTREC_BOOT_INFO_TYPE x_FlightRec_Info;
+
+// first record of this boot
+static uint32_t u32_FlightRec_First;
+
+// the ring is checked at boot, events recorded before are dropped
+static bool b_FlightRec_Ready;
+
+// last lowest free heap put in the ring, and deadlines missed in the last sample, used by the timer only
+static uint32_t u32_FlightRec_Heap_Min = UINT32_MAX;
+static bool b_FlightRec_Missed;
+
+static esp_timer_handle_t x_FlightRec_Timer;
+
+static portMUX_TYPE x_FlightRec_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *TAG = "FlightRec";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static bool FlightRecUnexpected(esp_reset_reason_t e_reason);
+static void FlightRecReport(void);
+static void FlightRecFormat(const FLIGHTREC_RECORD_TYPE *px_record, char *pc_line, uint8_t u8_len);
+static void FlightRecFill(FLIGHTREC_RECORD_TYPE *px_record, uint8_t u8_event, uint32_t u32_a, uint32_t u32_b,
+                          uint32_t u32_time_ms);
+static esp_err_t FlightRecSendRecord(httpd_req_t *px_req, const FLIGHTREC_RECORD_TYPE *px_record);
+static void FlightRecSampleCallback(void *pv_arg);
+static esp_err_t FlightRecHttpGetHandler(httpd_req_t *px_req);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method: checks the ring left by the
+ *          previous boots, copies their records aside and reports them with
+ *          the reset reason. To be called first in app_main(), before the
+ *          modules recording events are started.
+ *
+ */
+void FlightRec__Initialize(void)
+{
+  esp_reset_reason_t e_reason = esp_reset_reason();
+  uint32_t u32_idx;
+  uint8_t u8_reason;
+
+  if ((e_reason != ESP_RST_POWERON) &&
+      (x_FlightRec_Header.magic == FLIGHTREC_MAGIC) &&
+      (x_FlightRec_Header.version == FLIGHTREC_VERSION) &&
+      (x_FlightRec_Header.records == FLIGHTREC_RECORDS))
+  {
+    u32_idx = (x_FlightRec_Header.head > FLIGHTREC_RECORDS) ? (x_FlightRec_Header.head - FLIGHTREC_RECORDS) : 0;
+    for (; u32_idx != x_FlightRec_Header.head; ++u32_idx)
+    {
+      px_FlightRec_Previous[x_FlightRec_Info.previous_records++] = px_FlightRec_Record[u32_idx & (FLIGHTREC_RECORDS - 1)];
+    }
+    memcpy(px_FlightRec_Previous_Sample, x_FlightRec_Header.samples, sizeof(px_FlightRec_Previous_Sample));
+  }
+  else
+  {
+    // power-on, or a ring of another firmware
+    memset(&x_FlightRec_Header, 0x00, sizeof(x_FlightRec_Header));
+    x_FlightRec_Header.magic = FLIGHTREC_MAGIC;
+    x_FlightRec_Header.version = FLIGHTREC_VERSION;
+    x_FlightRec_Header.records = FLIGHTREC_RECORDS;
+  }
+
+  u8_reason = (uint8_t)MIN((uint32_t)e_reason, FLIGHTREC_RESET_REASONS - 1);
+  if (x_FlightRec_Header.boots < UINT16_MAX)
+  {
+    x_FlightRec_Header.boots++;
+  }
+  if (x_FlightRec_Header.resets[u8_reason] < UINT16_MAX)
+  {
+    x_FlightRec_Header.resets[u8_reason]++;
+  }
+
+  x_FlightRec_Info.reset_reason = u8_reason;
+  x_FlightRec_Info.unexpected = FlightRecUnexpected(e_reason);
+  x_FlightRec_Info.boots = x_FlightRec_Header.boots;
+  memcpy(x_FlightRec_Info.resets, x_FlightRec_Header.resets, sizeof(x_FlightRec_Info.resets));
+
+  u32_FlightRec_First = x_FlightRec_Header.head;
+  b_FlightRec_Ready = true;
+
+  FlightRec__Event(FLIGHTREC_BOOT, (uint32_t)e_reason, x_FlightRec_Header.boots);
+
+  SysMon__Register_Module(TAG, sizeof(px_FlightRec_Previous) + sizeof(px_FlightRec_Previous_Sample) +
+                               sizeof(x_FlightRec_Info));
+
+  FlightRecReport();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Starts the heap and refresh timing samples and registers the
+ *          endpoint, to be called after the HTTP server has been started.
+ *
+ */
+void FlightRec__Start(void)
+{
+  const esp_timer_create_args_t x_timer_args =
+  {
+    .callback = FlightRecSampleCallback,
+    .name = "flightrec",
+  };
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = FLIGHTREC_URI,
+    .method = HTTP_GET,
+    .handler = FlightRecHttpGetHandler,
+    .user_ctx = NULL
+  };
+
+  ESP_ERROR_CHECK(esp_timer_create(&x_timer_args, &x_FlightRec_Timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(x_FlightRec_Timer, FLIGHTREC_SAMPLE_MS * 1000ULL));
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Records an event in the RTC ring, a few stores in a critical
+ *          section: it can be called from the refresh loops, not from an
+ *          ISR. Events before FlightRec__Initialize() are dropped.
+ *
+ * @param e_event   event
+ * @param u32_a     first argument, see FLIGHTREC_EVENT_ENUM
+ * @param u32_b     second argument
+ */
+void FlightRec__Event(FLIGHTREC_EVENT_ENUM e_event, uint32_t u32_a, uint32_t u32_b)
+{
+  FLIGHTREC_RECORD_TYPE *px_record;
+  uint32_t u32_time_ms;
+
+  if ((b_FlightRec_Ready == false) || (e_event >= NUM_OF_FLIGHTREC_EVENTS))
+  {
+    return;
+  }
+  u32_time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+  portENTER_CRITICAL(&x_FlightRec_Mux);
+  px_record = &px_FlightRec_Record[x_FlightRec_Header.head & (FLIGHTREC_RECORDS - 1)];
+  FlightRecFill(px_record, (uint8_t)e_event, u32_a, u32_b, u32_time_ms);
+  // counted last: a reset before this line loses only this record
+  x_FlightRec_Header.head++;
+  portEXIT_CRITICAL(&x_FlightRec_Mux);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Gets the reset reason of this boot and the resets since power-on.
+ *
+ * @param px_info [out] reset history
+ */
+void FlightRec__Get_Boot_Info(FLIGHTREC_BOOT_INFO_TYPE *px_info)
+{
+  *px_info = x_FlightRec_Info;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Name of a reset reason, as used on the console and the metrics.
+ *
+ * @param u8_reason esp_reset_reason_t
+ *
+ * @return name
+ */
+const char *FlightRec__Reset_Name(uint8_t u8_reason)
+{
+  return FLIGHTREC_Reset_Names[MIN(u8_reason, FLIGHTREC_RESET_REASONS - 1)];
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Tells the resets not requested by the firmware or the user.
+ *
+ * @param e_reason  reset reason
+ *
+ * @return true for panic, watchdog, brownout and unknown resets
+ */
+static bool FlightRecUnexpected(esp_reset_reason_t e_reason)
+{
+  return ((e_reason == ESP_RST_UNKNOWN) || (e_reason == ESP_RST_PANIC) || (e_reason == ESP_RST_INT_WDT) ||
+          (e_reason == ESP_RST_TASK_WDT) || (e_reason == ESP_RST_WDT) || (e_reason == ESP_RST_BROWNOUT));
+}
+
+/**
+ * @brief   Logs the reset reason and, after an unexpected reset, the last
+ *          records before it: the boot is not slowed down by the whole ring,
+ *          which is on FLIGHTREC_URI.
+ *
+ */
+static void FlightRecReport(void)
+{
+  char pc_line[FLIGHTREC_LINE_BYTES];
+  uint16_t u16_idx;
+
+  if (x_FlightRec_Info.unexpected == false)
+  {
+    ESP_LOGI(TAG, "reset reason %s, boot %u, %u records of the previous boots",
+             FlightRec__Reset_Name(x_FlightRec_Info.reset_reason), x_FlightRec_Info.boots,
+             x_FlightRec_Info.previous_records);
+    return;
+  }
+
+  ESP_LOGW(TAG, "unexpected reset: %s, boot %u (panic %u, watchdog %u, brownout %u since power-on)",
+           FlightRec__Reset_Name(x_FlightRec_Info.reset_reason), x_FlightRec_Info.boots,
+           x_FlightRec_Info.resets[ESP_RST_PANIC],
+           x_FlightRec_Info.resets[ESP_RST_INT_WDT] + x_FlightRec_Info.resets[ESP_RST_TASK_WDT] +
+           x_FlightRec_Info.resets[ESP_RST_WDT],
+           x_FlightRec_Info.resets[ESP_RST_BROWNOUT]);
+
+  u16_idx = (x_FlightRec_Info.previous_records > FLIGHTREC_BOOT_LOG_RECORDS) ?
+            (x_FlightRec_Info.previous_records - FLIGHTREC_BOOT_LOG_RECORDS) : 0;
+  for (; u16_idx < x_FlightRec_Info.previous_records; ++u16_idx)
+  {
+    FlightRecFormat(&px_FlightRec_Previous[u16_idx], pc_line, sizeof(pc_line));
+    ESP_LOGW(TAG, "%s", pc_line);
+  }
+  for (u16_idx = 0; u16_idx < NUM_OF_FLIGHTREC_SAMPLES; ++u16_idx)
+  {
+    if (px_FlightRec_Previous_Sample[u16_idx].boot != 0)
+    {
+      FlightRecFormat(&px_FlightRec_Previous_Sample[u16_idx], pc_line, sizeof(pc_line));
+      ESP_LOGW(TAG, "last sample, %s", pc_line);
+    }
+  }
+}
+
+/**
+ * @brief   Decodes a record: boot relative to this one, time since that boot,
+ *          tag and arguments.
+ *
+ * @param px_record record
+ * @param pc_line   [out] text, without newline
+ * @param u8_len    size of pc_line
+ */
+static void FlightRecFormat(const FLIGHTREC_RECORD_TYPE *px_record, char *pc_line, uint8_t u8_len)
+{
+  const FLIGHTREC_DESC_TYPE *px_desc;
+  int i_len;
+
+  i_len = snprintf(pc_line, u8_len, "boot %d %u.%03u s ",
+                   -(int)(uint16_t)(x_FlightRec_Info.boots - px_record->boot),
+                   px_record->time_ms / 1000, px_record->time_ms % 1000);
+  if ((i_len < 0) || (i_len >= u8_len))
+  {
+    return;
+  }
+
+  if (px_record->event >= NUM_OF_FLIGHTREC_EVENTS)
+  {
+    // event of a newer firmware, before an update back
+    (void)snprintf(&pc_line[i_len], u8_len - i_len, "event %u: %u %u", px_record->event, px_record->a, px_record->b);
+    return;
+  }
+
+  px_desc = &FLIGHTREC_Desc[px_record->event];
+  i_len += snprintf(&pc_line[i_len], u8_len - i_len, "%s: ", px_desc->tag);
+  if (i_len < u8_len)
+  {
+    (void)snprintf(&pc_line[i_len], u8_len - i_len, px_desc->format, px_record->a, px_record->b);
+  }
+}
+
+/**
+ * @brief   Writes a record, in the critical section of the caller.
+ *
+ * @param px_record   [out] record
+ * @param u8_event    FLIGHTREC_EVENT_ENUM
+ * @param u32_a       first argument
+ * @param u32_b       second argument
+ * @param u32_time_ms time since boot
+ */
+static void FlightRecFill(FLIGHTREC_RECORD_TYPE *px_record, uint8_t u8_event, uint32_t u32_a, uint32_t u32_b,
+                          uint32_t u32_time_ms)
+{
+  px_record->time_ms = u32_time_ms;
+  px_record->a = u32_a;
+  px_record->b = u32_b;
+  px_record->boot = x_FlightRec_Header.boots;
+  px_record->event = u8_event;
+  px_record->spare = 0;
+}
+
+/**
+ * @brief   Samples the heap and the display refresh timing, runs in the
+ *          esp_timer task. The samples overwrite their slot in the header,
+ *          only the changes go in the ring: a low-water mark of the heap
+ *          lower by FLIGHTREC_HEAP_STEP_BYTES, and the refresh deadlines
+ *          starting or stopping to be missed.
+ *
+ * @param pv_arg not used
+ */
+static void FlightRecSampleCallback(void *pv_arg)
+{
+  HOLTEK_FRAME_STATS_TYPE x_frame_stats;
+  uint32_t u32_free = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+  uint32_t u32_min = (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+  uint32_t u32_time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+  Holtek__Get_Frame_Stats(&x_frame_stats);
+
+  portENTER_CRITICAL(&x_FlightRec_Mux);
+  FlightRecFill(&x_FlightRec_Header.samples[FLIGHTREC_SAMPLE_HEAP], FLIGHTREC_HEAP, u32_free, u32_min, u32_time_ms);
+  FlightRecFill(&x_FlightRec_Header.samples[FLIGHTREC_SAMPLE_REFRESH], FLIGHTREC_REFRESH,
+                x_frame_stats.missed, x_frame_stats.period_max_us, u32_time_ms);
+  portEXIT_CRITICAL(&x_FlightRec_Mux);
+
+  // the low-water mark never rises, the first sample is always recorded
+  if ((u32_FlightRec_Heap_Min - u32_min) >= FLIGHTREC_HEAP_STEP_BYTES)
+  {
+    u32_FlightRec_Heap_Min = u32_min;
+    FlightRec__Event(FLIGHTREC_HEAP, u32_free, u32_min);
+  }
+  if ((x_frame_stats.missed != 0) != b_FlightRec_Missed)
+  {
+    b_FlightRec_Missed = (x_frame_stats.missed != 0);
+    FlightRec__Event(FLIGHTREC_REFRESH, x_frame_stats.missed, x_frame_stats.period_max_us);
+  }
+}
+
+/**
+ * @brief   Sends a decoded record on its own line.
+ *
+ * @param px_req    request
+ * @param px_record record
+ *
+ * @return result of the chunk
+ */
+static esp_err_t FlightRecSendRecord(httpd_req_t *px_req, const FLIGHTREC_RECORD_TYPE *px_record)
+{
+  char pc_line[FLIGHTREC_LINE_BYTES + 1];
+
+  FlightRecFormat(px_record, pc_line, FLIGHTREC_LINE_BYTES);
+  strcat(pc_line, "\n");
+  return httpd_resp_send_chunk(px_req, pc_line, HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * @brief   GET on the recorder: reset history, records and last samples of
+ *          the previous boots copied at boot, then the records of this boot
+ *          still in the ring and its latest samples.
+ *
+ * @param px_req  request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t FlightRecHttpGetHandler(httpd_req_t *px_req)
+{
+  FLIGHTREC_RECORD_TYPE x_record;
+  FLIGHTREC_RECORD_TYPE px_sample[NUM_OF_FLIGHTREC_SAMPLES];
+  char pc_line[FLIGHTREC_LINE_BYTES + 1];
+  uint32_t u32_head;
+  uint32_t u32_idx;
+  uint8_t u8_reason;
+
+  httpd_resp_set_type(px_req, "text/plain");
+
+  (void)snprintf(pc_line, sizeof(pc_line), "reset_reason %s\nboots %u\nresets",
+                 FlightRec__Reset_Name(x_FlightRec_Info.reset_reason), x_FlightRec_Info.boots);
+  httpd_resp_send_chunk(px_req, pc_line, HTTPD_RESP_USE_STRLEN);
+  for (u8_reason = 0; u8_reason < FLIGHTREC_RESET_REASONS; ++u8_reason)
+  {
+    if (x_FlightRec_Info.resets[u8_reason] != 0)
+    {
+      (void)snprintf(pc_line, sizeof(pc_line), " %s:%u", FlightRec__Reset_Name(u8_reason), x_FlightRec_Info.resets[u8_reason]);
+      httpd_resp_send_chunk(px_req, pc_line, HTTPD_RESP_USE_STRLEN);
+    }
+  }
+  httpd_resp_send_chunk(px_req, "\n\n", HTTPD_RESP_USE_STRLEN);
+
+  for (u32_idx = 0; u32_idx < x_FlightRec_Info.previous_records; ++u32_idx)
+  {
+    if (FlightRecSendRecord(px_req, &px_FlightRec_Previous[u32_idx]) != ESP_OK)
+    {
+      return ESP_OK;
+    }
+  }
+  for (u32_idx = 0; u32_idx < NUM_OF_FLIGHTREC_SAMPLES; ++u32_idx)
+  {
+    if ((px_FlightRec_Previous_Sample[u32_idx].boot != 0) &&
+        (FlightRecSendRecord(px_req, &px_FlightRec_Previous_Sample[u32_idx]) != ESP_OK))
+    {
+      return ESP_OK;
+    }
+  }
+
+  portENTER_CRITICAL(&x_FlightRec_Mux);
+  u32_head = x_FlightRec_Header.head;
+  memcpy(px_sample, x_FlightRec_Header.samples, sizeof(px_sample));
+  portEXIT_CRITICAL(&x_FlightRec_Mux);
+
+  u32_idx = MAX(u32_FlightRec_First, (u32_head > FLIGHTREC_RECORDS) ? (u32_head - FLIGHTREC_RECORDS) : 0);
+  for (; u32_idx != u32_head; ++u32_idx)
+  {
+    portENTER_CRITICAL(&x_FlightRec_Mux);
+    x_record = px_FlightRec_Record[u32_idx & (FLIGHTREC_RECORDS - 1)];
+    portEXIT_CRITICAL(&x_FlightRec_Mux);
+
+    if (FlightRecSendRecord(px_req, &x_record) != ESP_OK)
+    {
+      return ESP_OK;
+    }
+  }
+  for (u32_idx = 0; u32_idx < NUM_OF_FLIGHTREC_SAMPLES; ++u32_idx)
+  {
+    if ((px_sample[u32_idx].boot == x_FlightRec_Info.boots) &&
+        (FlightRecSendRecord(px_req, &px_sample[u32_idx]) != ESP_OK))
+    {
+      return ESP_OK;
+    }
+  }
+
+  return httpd_resp_send_chunk(px_req, NULL, 0);
+}
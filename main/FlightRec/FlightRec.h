@@ -0,0 +1,35 @@
+
+/**
+ *  @file       FlightRec.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef FLIGHTREC_H
+    #define FLIGHTREC_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <FlightRec_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void FlightRec__Initialize(void);
+void FlightRec__Start(void);
+void FlightRec__Event(FLIGHTREC_EVENT_ENUM e_event, uint32_t u32_a, uint32_t u32_b);
+void FlightRec__Get_Boot_Info(FLIGHTREC_BOOT_INFO_TYPE *px_info);
+const char *FlightRec__Reset_Name(uint8_t u8_reason);
+
+#endif
@@ -0,0 +1,57 @@
+
+/**
+ *  @file       FlightRec_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef FLIGHTREC_PRM_H
+    #define FLIGHTREC_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+/*
+ * Define here the events recorded across the resets, with the meaning of
+ * their two arguments. New events are added at the end: the records of the
+ * previous firmware are decoded after an update.
+ */
+typedef enum
+{
+  FLIGHTREC_BOOT = 0,               /*a: esp_reset_reason(), b: boots since power-on*/
+  FLIGHTREC_HOLTEK_STATE,           /*a: SPI_HLTK_ENUM step entered, b: step left*/
+  FLIGHTREC_WIFI_DISCONNECT,        /*a: wifi_err_reason_t, b: retry*/
+  FLIGHTREC_WIFI_GOT_IP,            /*a: IPv4 address, network order, b: not used*/
+  FLIGHTREC_WIFI_RSSI_LOW,          /*a: RSSI dBm (signed), b: not used*/
+  FLIGHTREC_HEAP,                   /*a: free heap bytes, b: lowest free heap since boot*/
+  FLIGHTREC_REFRESH,                /*a: frame deadlines missed in the report window, b: longest frame period us*/
+  NUM_OF_FLIGHTREC_EVENTS
+}FLIGHTREC_EVENT_ENUM;
+
+// reset reasons counted, esp_reset_reason_t values above are counted in the last one
+#define FLIGHTREC_RESET_REASONS     12
+
+// reset history, kept until the next power-on
+typedef struct
+{
+  uint8_t reset_reason;             // esp_reset_reason_t of this boot
+  bool unexpected;                  // panic, watchdog, brownout or unknown
+  uint16_t boots;                   // boots since power-on, 1 after a power-on
+  uint16_t resets[FLIGHTREC_RESET_REASONS];  // resets since power-on by reason
+  uint16_t previous_records;        // records of the previous boots kept
+}FLIGHTREC_BOOT_INFO_TYPE;
+
+// reset history and records decoded, from the previous boots then of this boot
+#define FLIGHTREC_URI               "/flightrec"
+
+#endif
@@ -0,0 +1,103 @@
+
+/**
+ *  @file       FlightRec_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef FLIGHTREC_PRV_H
+    #define FLIGHTREC_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <FlightRec_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// records kept in RTC slow memory, the oldest ones are overwritten
+#define FLIGHTREC_RECORDS           CONFIG_FLIGHTREC_RECORDS
+// period of the heap and refresh timing samples
+#define FLIGHTREC_SAMPLE_MS         CONFIG_FLIGHTREC_SAMPLE_MS
+// the lowest free heap goes in the ring again once it has dropped by this much
+#define FLIGHTREC_HEAP_STEP_BYTES   4096
+
+#if ((FLIGHTREC_RECORDS & (FLIGHTREC_RECORDS - 1)) != 0)
+#error "FlightRec: the number of records must be a power of 2"
+#endif
+
+// records of the previous boots logged at boot after an unexpected reset, all of them are on FLIGHTREC_URI
+#define FLIGHTREC_BOOT_LOG_RECORDS  16
+
+/*
+ * Ring in RTC slow memory, not initialized at boot: it survives all the
+ * resets but the power-on one (and the deep sleep, not used). It is taken
+ * as valid if the header matches this firmware. A record is counted in head
+ * only once written, a reset while writing it loses only that record.
+ */
+#define FLIGHTREC_MAGIC             0x31524C46
+#define FLIGHTREC_VERSION           2
+
+typedef struct
+{
+  uint32_t time_ms;                 // since the boot of the record
+  uint32_t a;
+  uint32_t b;
+  uint16_t boot;                    // boots since power-on when recorded
+  uint8_t event;                    // FLIGHTREC_EVENT_ENUM
+  uint8_t spare;
+}FLIGHTREC_RECORD_TYPE;
+
+// latest samples, overwritten in place outside the ring so as not to push the events out
+typedef enum
+{
+  FLIGHTREC_SAMPLE_HEAP = 0,
+  FLIGHTREC_SAMPLE_REFRESH,
+  NUM_OF_FLIGHTREC_SAMPLES
+}FLIGHTREC_SAMPLE_ENUM;
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t records;                 // FLIGHTREC_RECORDS of the firmware writing the ring
+  uint32_t head;                    // records written, the next one goes to [head % FLIGHTREC_RECORDS]
+  uint16_t boots;
+  uint16_t resets[FLIGHTREC_RESET_REASONS];
+  FLIGHTREC_RECORD_TYPE samples[NUM_OF_FLIGHTREC_SAMPLES];
+}FLIGHTREC_HEADER_TYPE;
+
+// tag and format of the events, the format takes a then b (%d for signed)
+typedef struct
+{
+  const char *tag;
+  const char *format;
+}FLIGHTREC_DESC_TYPE;
+
+static const FLIGHTREC_DESC_TYPE FLIGHTREC_Desc[NUM_OF_FLIGHTREC_EVENTS] =
+{
+  [FLIGHTREC_BOOT]            = {"boot",    "reset reason %u, boot %u"},
+  [FLIGHTREC_HOLTEK_STATE]    = {"display", "SPI step %u (from %u)"},
+  [FLIGHTREC_WIFI_DISCONNECT] = {"wifi",    "disconnected, reason %u, retry %u"},
+  [FLIGHTREC_WIFI_GOT_IP]     = {"wifi",    "got ip %08x"},
+  [FLIGHTREC_WIFI_RSSI_LOW]   = {"wifi",    "RSSI %d dBm, low"},
+  [FLIGHTREC_HEAP]            = {"heap",    "free %u, min %u"},
+  [FLIGHTREC_REFRESH]         = {"refresh", "%u deadlines missed, longest period %u us"},
+};
+
+// names of esp_reset_reason_t
+static const char *FLIGHTREC_Reset_Names[FLIGHTREC_RESET_REASONS] =
+{
+  "unknown", "poweron", "ext", "sw", "panic", "int_wdt", "task_wdt", "wdt", "deepsleep", "brownout", "sdio", "other"
+};
+
+// longest decoded record
+#define FLIGHTREC_LINE_BYTES        96
+
+#endif
@@ -0,0 +1,771 @@
+
+/**
+ *  @file       FrameLog.c
+ *
+ *  @brief      Capture of the display frames for offline analysis: each frame
+ *              sent to the display that differs from the previous one is
+ *              appended to a delta encoded log with its time, in RAM or in
+ *              the "framelog" flash partition. The log is downloaded on
+ *              /framelog and decoded, replayed and compared with another
+ *              capture by tools/frame_replay.py.
+ *              The composer only encodes a few bytes in RAM, flash is
+ *              written by a low priority task.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+
+#include <FrameLog.h>
+#include <FrameLog_prv.h>
+#include <HttpSrv.h>
+#include <Metrics.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static uint8_t ppu8_FrameLog_Block[FRAMELOG_RAM_BLOCKS][FRAMELOG_BLOCK_BYTES];
+
+static FRAMELOG_STATE_TYPE x_FrameLog_State;
+
+static portMUX_TYPE x_FrameLog_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+#if FRAMELOG_FLASH
+static const esp_partition_t *px_FrameLog_Partition;
+static uint16_t u16_FrameLog_Sectors;
+
+// flash access: writer task, clear and download
+static SemaphoreHandle_t x_FrameLog_Flash_Mutex;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t x_FrameLog_Flash_Mutex_Buffer;
+#endif
+
+static TaskHandle_t x_FrameLog_Task_Hdl;
+
+// stack and TCB of the task, reserved at link time in static allocation mode
+SYSMON_TASK_POOL(x_FrameLog_Task, FRAMELOG_TASK_STACK)
+#endif
+
+static const char *TAG = "FrameLog";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static bool FrameLogOpen(const uint8_t *pu8_frame, int64_t s64_us);
+static uint8_t FrameLogFlips(const uint8_t *pu8_frame, uint8_t *pu8_flips);
+static void FrameLogAppend(uint8_t u8_tag, uint32_t u32_value, const uint8_t *pu8_data, uint8_t u8_len);
+static uint8_t FrameLogVarint(uint8_t *pu8_out, uint32_t u32_value);
+static esp_err_t FrameLogSendRam(httpd_req_t *px_req);
+static esp_err_t FrameLogHttpGetHandler(httpd_req_t *px_req);
+static esp_err_t FrameLogHttpPostHandler(httpd_req_t *px_req);
+#if FRAMELOG_FLASH
+static void FrameLogScan(void);
+static void FrameLogFlush(void);
+static esp_err_t FrameLogSendFlash(httpd_req_t *px_req);
+static void FrameLogTaskCallback(void *pv_args);
+#endif
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, finds the flash partition of the
+ *          log (flash mode) and registers the network command. To be called
+ *          after the HTTP server is started.
+ *
+ */
+void FrameLog__Initialize(void)
+{
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = FRAMELOG_URI,
+    .method = HTTP_GET,
+    .handler = FrameLogHttpGetHandler,
+    .user_ctx = NULL
+  };
+  const httpd_uri_t x_post_uri =
+  {
+    .uri = FRAMELOG_URI,
+    .method = HTTP_POST,
+    .handler = FrameLogHttpPostHandler,
+    .user_ctx = NULL
+  };
+
+#if FRAMELOG_FLASH
+  px_FrameLog_Partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, FRAMELOG_PARTITION_SUBTYPE,
+                                                   FRAMELOG_PARTITION_LABEL);
+  if (px_FrameLog_Partition == NULL)
+  {
+    ESP_LOGE(TAG, "partition %s not found, log kept in RAM", FRAMELOG_PARTITION_LABEL);
+  }
+  else
+  {
+#if CONFIG_APP_STATIC_ALLOCATION
+    x_FrameLog_Flash_Mutex = xSemaphoreCreateMutexStatic(&x_FrameLog_Flash_Mutex_Buffer);
+    SysMon__Register_Module(TAG, sizeof(x_FrameLog_Flash_Mutex_Buffer) + SYSMON_TASK_POOL_BYTES(x_FrameLog_Task));
+#else
+    x_FrameLog_Flash_Mutex = xSemaphoreCreateMutex();
+#endif
+    u16_FrameLog_Sectors = (uint16_t)(px_FrameLog_Partition->size / FRAMELOG_BLOCK_BYTES);
+    FrameLogScan();
+
+    SYSMON_TASK_CREATE(x_FrameLog_Task, FrameLogTaskCallback, "FrameLog", FRAMELOG_TASK_STACK, NULL,
+                       FRAMELOG_TASK_PRIO, &x_FrameLog_Task_Hdl, tskNO_AFFINITY);
+    SysMon__Register_Task(TAG, x_FrameLog_Task_Hdl, FRAMELOG_TASK_STACK);
+  }
+#endif
+
+  SysMon__Register_Module(TAG, sizeof(ppu8_FrameLog_Block) + sizeof(x_FrameLog_State));
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+  (void)HttpSrv__Register_Uri(&x_post_uri);
+
+#if FRAMELOG_AUTOSTART
+  FrameLog__Start();
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Starts a capture session, the first frame recorded is the next
+ *          one sent to the display.
+ *
+ */
+void FrameLog__Start(void)
+{
+  uint16_t u16_session;
+
+  portENTER_CRITICAL(&x_FrameLog_Mux);
+  if (x_FrameLog_State.active == true)
+  {
+    portEXIT_CRITICAL(&x_FrameLog_Mux);
+    return;
+  }
+  x_FrameLog_State.session++;
+  x_FrameLog_State.open = false;
+  x_FrameLog_State.lost = 0;
+  x_FrameLog_State.active = true;
+  u16_session = x_FrameLog_State.session;
+  portEXIT_CRITICAL(&x_FrameLog_Mux);
+
+#if FRAMELOG_FLASH
+  // the writer sleeps while there is no capture
+  if (x_FrameLog_Task_Hdl != NULL)
+  {
+    xTaskNotifyGive(x_FrameLog_Task_Hdl);
+  }
+#endif
+
+  ESP_LOGI(TAG, "capture started, session %u", u16_session);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Stops the capture, the block being filled is closed (and written
+ *          to flash in flash mode).
+ *
+ */
+void FrameLog__Stop(void)
+{
+  portENTER_CRITICAL(&x_FrameLog_Mux);
+  x_FrameLog_State.active = false;
+  x_FrameLog_State.open = false;
+  portEXIT_CRITICAL(&x_FrameLog_Mux);
+
+#if FRAMELOG_FLASH
+  if (x_FrameLog_Task_Hdl != NULL)
+  {
+    xTaskNotifyGive(x_FrameLog_Task_Hdl);
+  }
+#endif
+
+  ESP_LOGI(TAG, "capture stopped");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Tells if a capture is running.
+ *
+ * @return true while capturing
+ */
+bool FrameLog__Is_Active(void)
+{
+  return x_FrameLog_State.active;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Records a frame sent to the display, if it differs from the
+ *          previous one. Called by the composer: it never waits, when there
+ *          is no room the frame is counted as lost.
+ *
+ * @param pu8_frame Holtek RAM image, FRAMELOG_FRAME_BYTES long
+ * @param s64_us    time since boot the frame has been composed at
+ */
+void FrameLog__Record(const uint8_t *pu8_frame, int64_t s64_us)
+{
+  FRAMELOG_STATE_TYPE *px_state = &x_FrameLog_State;
+  uint8_t pu8_flips[FRAMELOG_FLIPS_MAX];
+  uint8_t u8_flips;
+  uint8_t u8_slot;
+  uint32_t u32_used_before = 0;
+  uint32_t u32_used_after = 0;
+  bool b_block = false;
+  bool b_lost = false;
+
+  if (px_state->active == false)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&x_FrameLog_Mux);
+  if ((px_state->active == false) ||
+      ((px_state->open == true) && (memcmp(px_state->last, pu8_frame, FRAMELOG_FRAME_BYTES) == 0)))
+  {
+    portEXIT_CRITICAL(&x_FrameLog_Mux);
+    return;
+  }
+
+  u8_slot = (uint8_t)((px_state->next_seq - 1) % FRAMELOG_RAM_BLOCKS);
+
+  if (px_state->paused == true)
+  {
+    px_state->lost++;
+    b_lost = true;
+  }
+  else if ((px_state->open == true) &&
+           ((px_state->used[u8_slot] + FRAMELOG_RECORD_MAX_BYTES) <= FRAMELOG_BLOCK_BYTES))
+  {
+    u32_used_before = px_state->used[u8_slot];
+
+    if (px_state->lost > 0)
+    {
+      FrameLogAppend(FRAMELOG_TAG_LOST, px_state->lost, NULL, 0);
+      px_state->lost = 0;
+    }
+
+    u8_flips = FrameLogFlips(pu8_frame, pu8_flips);
+    if (u8_flips <= FRAMELOG_FLIPS_MAX)
+    {
+      FrameLogAppend(FRAMELOG_TAG_FLIPS | u8_flips, (uint32_t)MIN(s64_us - px_state->last_us, UINT32_MAX),
+                     pu8_flips, u8_flips);
+    }
+    else
+    {
+      FrameLogAppend(FRAMELOG_TAG_KEY, (uint32_t)MIN(s64_us - px_state->last_us, UINT32_MAX),
+                     pu8_frame, FRAMELOG_FRAME_BYTES);
+    }
+    memcpy(px_state->last, pu8_frame, FRAMELOG_FRAME_BYTES);
+    px_state->last_us = s64_us;
+
+    u32_used_after = px_state->used[u8_slot];
+  }
+  else if (FrameLogOpen(pu8_frame, s64_us) == true)
+  {
+    b_block = true;
+    u32_used_after = px_state->used[(px_state->next_seq - 1) % FRAMELOG_RAM_BLOCKS];
+  }
+  else
+  {
+    px_state->lost++;
+    b_lost = true;
+  }
+  portEXIT_CRITICAL(&x_FrameLog_Mux);
+
+  if (b_lost == true)
+  {
+    Metrics__Counter_Add(METRICS_FRAMELOG_LOST, 1);
+    return;
+  }
+
+  Metrics__Counter_Add(METRICS_FRAMELOG_RECORDS, 1);
+  Metrics__Counter_Add(METRICS_FRAMELOG_BYTES, u32_used_after - u32_used_before);
+
+#if FRAMELOG_FLASH
+  // a block has been closed, the writer catches up without waiting its period
+  if ((b_block == true) && (x_FrameLog_Task_Hdl != NULL))
+  {
+    xTaskNotifyGive(x_FrameLog_Task_Hdl);
+  }
+#else
+  (void)b_block;
+#endif
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Starts a new block with its header and the whole frame. In flash
+ *          mode the RAM block is reused only once written. Called in the
+ *          critical section.
+ *
+ * @param pu8_frame frame to be recorded
+ * @param s64_us    time of the frame
+ *
+ * @return false if there is no free block
+ */
+static bool FrameLogOpen(const uint8_t *pu8_frame, int64_t s64_us)
+{
+  FRAMELOG_STATE_TYPE *px_state = &x_FrameLog_State;
+  FRAMELOG_BLOCK_HEADER_TYPE x_header;
+  uint8_t u8_slot = (uint8_t)(px_state->next_seq % FRAMELOG_RAM_BLOCKS);
+
+#if FRAMELOG_FLASH
+  if ((px_FrameLog_Partition != NULL) && ((px_state->next_seq - px_state->written_seq) >= FRAMELOG_RAM_BLOCKS))
+  {
+    return false;
+  }
+#endif
+
+  x_header.magic = FRAMELOG_MAGIC;
+  x_header.seq = px_state->next_seq;
+  x_header.session = px_state->session;
+  x_header.version = FRAMELOG_VERSION;
+  x_header.frame_bytes = FRAMELOG_FRAME_BYTES;
+  x_header.start_us = s64_us;
+
+  memcpy(ppu8_FrameLog_Block[u8_slot], &x_header, sizeof(x_header));
+  px_state->used[u8_slot] = sizeof(x_header);
+  px_state->next_seq++;
+  px_state->open = true;
+
+  if (px_state->lost > 0)
+  {
+    FrameLogAppend(FRAMELOG_TAG_LOST, px_state->lost, NULL, 0);
+    px_state->lost = 0;
+  }
+  FrameLogAppend(FRAMELOG_TAG_KEY, 0, pu8_frame, FRAMELOG_FRAME_BYTES);
+
+  memcpy(px_state->last, pu8_frame, FRAMELOG_FRAME_BYTES);
+  px_state->last_us = s64_us;
+
+  return true;
+}
+
+/**
+ * @brief   Lists the segment bits changed from the last frame recorded.
+ *
+ * @param pu8_frame new frame
+ * @param pu8_flips [out] RAM byte << 3 | bit of each change, FRAMELOG_FLIPS_MAX long
+ *
+ * @return number of changes, FRAMELOG_FLIPS_MAX + 1 if there are more
+ */
+static uint8_t FrameLogFlips(const uint8_t *pu8_frame, uint8_t *pu8_flips)
+{
+  uint8_t u8_count = 0;
+  uint8_t u8_byte;
+  uint8_t u8_diff;
+  uint8_t u8_bit;
+
+  for (u8_byte = 0; u8_byte < FRAMELOG_FRAME_BYTES; ++u8_byte)
+  {
+    u8_diff = x_FrameLog_State.last[u8_byte] ^ pu8_frame[u8_byte];
+    for (u8_bit = 0; u8_diff != 0; ++u8_bit, u8_diff >>= 1)
+    {
+      if ((u8_diff & 0x01) == 0)
+      {
+        continue;
+      }
+      if (u8_count >= FRAMELOG_FLIPS_MAX)
+      {
+        return (FRAMELOG_FLIPS_MAX + 1);
+      }
+      pu8_flips[u8_count++] = (uint8_t)((u8_byte << 3) | u8_bit);
+    }
+  }
+
+  return u8_count;
+}
+
+/**
+ * @brief   Appends a record to the block being filled, the room has been
+ *          checked by the caller. Called in the critical section.
+ *
+ * @param u8_tag    tag byte
+ * @param u32_value time from the previous record, count for FRAMELOG_TAG_LOST
+ * @param pu8_data  payload, NULL if none
+ * @param u8_len    payload bytes
+ */
+static void FrameLogAppend(uint8_t u8_tag, uint32_t u32_value, const uint8_t *pu8_data, uint8_t u8_len)
+{
+  uint8_t u8_slot = (uint8_t)((x_FrameLog_State.next_seq - 1) % FRAMELOG_RAM_BLOCKS);
+  uint8_t *pu8_out = &ppu8_FrameLog_Block[u8_slot][x_FrameLog_State.used[u8_slot]];
+  uint8_t u8_bytes = 0;
+
+  pu8_out[u8_bytes++] = u8_tag;
+  u8_bytes += FrameLogVarint(&pu8_out[u8_bytes], u32_value);
+  if (u8_len > 0)
+  {
+    memcpy(&pu8_out[u8_bytes], pu8_data, u8_len);
+    u8_bytes += u8_len;
+  }
+
+  x_FrameLog_State.used[u8_slot] += u8_bytes;
+}
+
+/**
+ * @brief   Unsigned LEB128 encoding.
+ *
+ * @param pu8_out   [out] encoded value, up to 5 bytes
+ * @param u32_value value
+ *
+ * @return bytes written
+ */
+static uint8_t FrameLogVarint(uint8_t *pu8_out, uint32_t u32_value)
+{
+  uint8_t u8_bytes = 0;
+
+  while (u32_value >= 0x80)
+  {
+    pu8_out[u8_bytes++] = (uint8_t)(u32_value | 0x80);
+    u32_value >>= 7;
+  }
+  pu8_out[u8_bytes++] = (uint8_t)u32_value;
+
+  return u8_bytes;
+}
+
+/**
+ * @brief   Sends the blocks kept in RAM, oldest first, each one padded to
+ *          FRAMELOG_BLOCK_BYTES. The capture is paused by the caller.
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK if the blocks have been sent
+ */
+static esp_err_t FrameLogSendRam(httpd_req_t *px_req)
+{
+  uint8_t pu8_pad[FRAMELOG_HTTP_CHUNK_BYTES];
+  uint32_t u32_seq;
+  uint32_t u32_first;
+  uint32_t u32_next;
+  uint16_t u16_used;
+  uint16_t u16_len;
+
+  portENTER_CRITICAL(&x_FrameLog_Mux);
+  u32_next = x_FrameLog_State.next_seq;
+  u32_first = MAX(x_FrameLog_State.first_seq,
+                  (u32_next >= FRAMELOG_RAM_BLOCKS) ? (u32_next - FRAMELOG_RAM_BLOCKS) : 0);
+  portEXIT_CRITICAL(&x_FrameLog_Mux);
+
+  memset(pu8_pad, FRAMELOG_TAG_END, sizeof(pu8_pad));
+
+  for (u32_seq = u32_first; u32_seq < u32_next; ++u32_seq)
+  {
+    u16_used = x_FrameLog_State.used[u32_seq % FRAMELOG_RAM_BLOCKS];
+
+    if (httpd_resp_send_chunk(px_req, (const char *)ppu8_FrameLog_Block[u32_seq % FRAMELOG_RAM_BLOCKS],
+                              u16_used) != ESP_OK)
+    {
+      return ESP_FAIL;
+    }
+    for (; u16_used < FRAMELOG_BLOCK_BYTES; u16_used += u16_len)
+    {
+      u16_len = MIN(FRAMELOG_BLOCK_BYTES - u16_used, sizeof(pu8_pad));
+      if (httpd_resp_send_chunk(px_req, (const char *)pu8_pad, u16_len) != ESP_OK)
+      {
+        return ESP_FAIL;
+      }
+    }
+  }
+
+  return ESP_OK;
+}
+
+/**
+ * @brief   Network command, downloads the log (application/octet-stream).
+ *          Frames sent to the display meanwhile are counted as lost.
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t FrameLogHttpGetHandler(httpd_req_t *px_req)
+{
+  esp_err_t x_err;
+
+  portENTER_CRITICAL(&x_FrameLog_Mux);
+  x_FrameLog_State.paused = true;
+  portEXIT_CRITICAL(&x_FrameLog_Mux);
+
+  httpd_resp_set_type(px_req, "application/octet-stream");
+
+#if FRAMELOG_FLASH
+  if (px_FrameLog_Partition != NULL)
+  {
+    x_err = FrameLogSendFlash(px_req);
+  }
+  else
+#endif
+  {
+    x_err = FrameLogSendRam(px_req);
+  }
+
+  portENTER_CRITICAL(&x_FrameLog_Mux);
+  x_FrameLog_State.paused = false;
+  portEXIT_CRITICAL(&x_FrameLog_Mux);
+
+  if (x_err == ESP_OK)
+  {
+    httpd_resp_send_chunk(px_req, NULL, 0);
+  }
+
+  return x_err;
+}
+
+/**
+ * @brief   Network command, body "start" or "stop" the capture, "clear"
+ *          removes the blocks recorded (capture stopped only).
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK if the command is valid
+ */
+static esp_err_t FrameLogHttpPostHandler(httpd_req_t *px_req)
+{
+  char pc_body[FRAMELOG_HTTP_BODY_MAX + 1];
+  int s32_len;
+
+  s32_len = httpd_req_recv(px_req, pc_body, FRAMELOG_HTTP_BODY_MAX);
+  pc_body[(s32_len > 0) ? s32_len : 0] = '\0';
+  pc_body[strcspn(pc_body, "\r\n")] = '\0';
+
+  if (strcmp(pc_body, "start") == 0)
+  {
+    FrameLog__Start();
+  }
+  else if (strcmp(pc_body, "stop") == 0)
+  {
+    FrameLog__Stop();
+  }
+  else if (strcmp(pc_body, "clear") == 0)
+  {
+    if (FrameLog__Is_Active() == true)
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "stop the capture first");
+      return ESP_FAIL;
+    }
+
+#if FRAMELOG_FLASH
+    if (px_FrameLog_Partition != NULL)
+    {
+      xSemaphoreTake(x_FrameLog_Flash_Mutex, portMAX_DELAY);
+      FrameLogFlush();
+      (void)esp_partition_erase_range(px_FrameLog_Partition, 0, (size_t)u16_FrameLog_Sectors * FRAMELOG_BLOCK_BYTES);
+      xSemaphoreGive(x_FrameLog_Flash_Mutex);
+    }
+#endif
+
+    portENTER_CRITICAL(&x_FrameLog_Mux);
+    x_FrameLog_State.first_seq = x_FrameLog_State.next_seq;
+    portEXIT_CRITICAL(&x_FrameLog_Mux);
+  }
+  else
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "expected start, stop or clear");
+    return ESP_FAIL;
+  }
+
+  httpd_resp_sendstr(px_req, "OK\n");
+
+  return ESP_OK;
+}
+
+#if FRAMELOG_FLASH
+/**
+ * @brief   Continues the block sequence and the session numbers of the log
+ *          found in flash, so that the blocks of successive boots are kept
+ *          in order.
+ *
+ */
+static void FrameLogScan(void)
+{
+  FRAMELOG_BLOCK_HEADER_TYPE x_header;
+  uint32_t u32_next_seq = 0;
+  uint16_t u16_session = 0;
+  uint16_t u16_sector;
+
+  for (u16_sector = 0; u16_sector < u16_FrameLog_Sectors; ++u16_sector)
+  {
+    if ((esp_partition_read(px_FrameLog_Partition, (size_t)u16_sector * FRAMELOG_BLOCK_BYTES,
+                            &x_header, sizeof(x_header)) == ESP_OK) &&
+        (x_header.magic == FRAMELOG_MAGIC))
+    {
+      u32_next_seq = MAX(u32_next_seq, x_header.seq + 1);
+      u16_session = MAX(u16_session, x_header.session);
+    }
+  }
+
+  x_FrameLog_State.next_seq = u32_next_seq;
+  x_FrameLog_State.first_seq = u32_next_seq;
+  x_FrameLog_State.written_seq = u32_next_seq;
+  x_FrameLog_State.session = u16_session;
+
+  ESP_LOGI(TAG, "%u sectors, next block %u", u16_FrameLog_Sectors, (unsigned)u32_next_seq);
+}
+
+/**
+ * @brief   Writes to flash the records not written yet: the closed blocks
+ *          and the part of the block being filled. Each block takes the
+ *          sector seq % sectors, erased when the block is started; flash
+ *          is only appended to. Called with the flash mutex taken.
+ *
+ */
+static void FrameLogFlush(void)
+{
+  FRAMELOG_STATE_TYPE *px_state = &x_FrameLog_State;
+  uint32_t u32_seq;
+  uint16_t u16_from;
+  uint16_t u16_to;
+  size_t x_offset;
+  uint8_t u8_slot;
+  bool b_closed;
+
+  while (true)
+  {
+    portENTER_CRITICAL(&x_FrameLog_Mux);
+    u32_seq = px_state->written_seq;
+    u16_from = px_state->written_bytes;
+    if (u32_seq >= px_state->next_seq)
+    {
+      portEXIT_CRITICAL(&x_FrameLog_Mux);
+      return;
+    }
+    u8_slot = (uint8_t)(u32_seq % FRAMELOG_RAM_BLOCKS);
+    u16_to = px_state->used[u8_slot];
+    b_closed = ((u32_seq != (px_state->next_seq - 1)) || (px_state->open == false));
+    portEXIT_CRITICAL(&x_FrameLog_Mux);
+
+    x_offset = (size_t)(u32_seq % u16_FrameLog_Sectors) * FRAMELOG_BLOCK_BYTES;
+
+    if ((u16_from == 0) &&
+        (esp_partition_erase_range(px_FrameLog_Partition, x_offset, FRAMELOG_BLOCK_BYTES) != ESP_OK))
+    {
+      ESP_LOGE(TAG, "erase of block %u failed", (unsigned)u32_seq);
+    }
+    if ((u16_to > u16_from) &&
+        (esp_partition_write(px_FrameLog_Partition, x_offset + u16_from, &ppu8_FrameLog_Block[u8_slot][u16_from],
+                             u16_to - u16_from) != ESP_OK))
+    {
+      ESP_LOGE(TAG, "write of block %u failed", (unsigned)u32_seq);
+    }
+
+    portENTER_CRITICAL(&x_FrameLog_Mux);
+    if (b_closed == true)
+    {
+      px_state->written_seq = u32_seq + 1;
+      px_state->written_bytes = 0;
+    }
+    else
+    {
+      px_state->written_bytes = u16_to;
+    }
+    portEXIT_CRITICAL(&x_FrameLog_Mux);
+
+    if (b_closed == false)
+    {
+      return;
+    }
+  }
+}
+
+/**
+ * @brief   Sends the blocks in flash, oldest first, after writing the
+ *          records still in RAM. The capture is paused by the caller.
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK if the blocks have been sent
+ */
+static esp_err_t FrameLogSendFlash(httpd_req_t *px_req)
+{
+  uint8_t pu8_chunk[FRAMELOG_HTTP_CHUNK_BYTES];
+  FRAMELOG_BLOCK_HEADER_TYPE x_header;
+  esp_err_t x_err = ESP_OK;
+  uint32_t u32_seq = UINT32_MAX;
+  uint32_t u32_min_seq;
+  uint16_t u16_sector;
+  uint16_t u16_next;
+  size_t x_offset;
+
+  xSemaphoreTake(x_FrameLog_Flash_Mutex, portMAX_DELAY);
+  FrameLogFlush();
+
+  // sectors in sequence order, the sequence of a sector is greater than the one sent before it
+  while (x_err == ESP_OK)
+  {
+    u32_min_seq = UINT32_MAX;
+    u16_next = u16_FrameLog_Sectors;
+    for (u16_sector = 0; u16_sector < u16_FrameLog_Sectors; ++u16_sector)
+    {
+      if ((esp_partition_read(px_FrameLog_Partition, (size_t)u16_sector * FRAMELOG_BLOCK_BYTES,
+                              &x_header, sizeof(x_header)) == ESP_OK) &&
+          (x_header.magic == FRAMELOG_MAGIC) &&
+          ((u32_seq == UINT32_MAX) || (x_header.seq > u32_seq)) &&
+          (x_header.seq < u32_min_seq))
+      {
+        u32_min_seq = x_header.seq;
+        u16_next = u16_sector;
+      }
+    }
+    if (u16_next >= u16_FrameLog_Sectors)
+    {
+      break;
+    }
+    u32_seq = u32_min_seq;
+
+    for (x_offset = 0; (x_offset < FRAMELOG_BLOCK_BYTES) && (x_err == ESP_OK); x_offset += sizeof(pu8_chunk))
+    {
+      x_err = esp_partition_read(px_FrameLog_Partition, ((size_t)u16_next * FRAMELOG_BLOCK_BYTES) + x_offset,
+                                 pu8_chunk, sizeof(pu8_chunk));
+      if (x_err == ESP_OK)
+      {
+        x_err = httpd_resp_send_chunk(px_req, (const char *)pu8_chunk, sizeof(pu8_chunk));
+      }
+    }
+  }
+
+  xSemaphoreGive(x_FrameLog_Flash_Mutex);
+
+  return x_err;
+}
+
+/**
+ * @brief   Writer task: writes the log to flash when a block is closed and,
+ *          while capturing, at least every FRAMELOG_FLUSH_MS. Without a
+ *          capture it sleeps until the next start.
+ *
+ * @param pv_args NULL
+ */
+static void FrameLogTaskCallback(void *pv_args)
+{
+  while (true)
+  {
+    (void)ulTaskNotifyTake(pdTRUE, (x_FrameLog_State.active == true) ? pdMS_TO_TICKS(FRAMELOG_FLUSH_MS)
+                                                                      : portMAX_DELAY);
+
+    xSemaphoreTake(x_FrameLog_Flash_Mutex, portMAX_DELAY);
+    FrameLogFlush();
+    xSemaphoreGive(x_FrameLog_Flash_Mutex);
+  }
+
+  vTaskDelete(NULL);
+}
+#endif
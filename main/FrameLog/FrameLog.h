@@ -0,0 +1,35 @@
+
+/**
+ *  @file       FrameLog.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef FRAMELOG_H
+    #define FRAMELOG_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <FrameLog_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void FrameLog__Initialize(void);
+void FrameLog__Start(void);
+void FrameLog__Stop(void);
+bool FrameLog__Is_Active(void);
+void FrameLog__Record(const uint8_t *pu8_frame, int64_t s64_us);
+
+#endif
@@ -0,0 +1,28 @@
+
+/**
+ *  @file       FrameLog_prm.h
+ *
+ *  @brief      Header containing the configuration parameters of the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef FRAMELOG_PRM_H
+    #define FRAMELOG_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+// frames recorded are Holtek RAM images
+#define FRAMELOG_FRAME_BYTES        16
+
+// entry point of the network command: GET downloads the log, POST "start" / "stop" / "clear" controls the capture
+#define FRAMELOG_URI                "/framelog"
+
+#endif
@@ -0,0 +1,121 @@
+
+/**
+ *  @file       FrameLog_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef FRAMELOG_PRV_H
+    #define FRAMELOG_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <FrameLog_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+/*
+ * Log format (tools/frame_replay.py)
+ *
+ * The log is a sequence of blocks of FRAMELOG_BLOCK_BYTES, each one can be
+ * decoded alone:
+ *
+ *   header   FRAMELOG_BLOCK_HEADER_TYPE, little endian
+ *   records  until the end of the block or a 0xFF tag (erased flash)
+ *
+ * Each record starts with a tag byte and the time from the previous record
+ * of the block (from start_us for the first one), in us, as unsigned LEB128:
+ *
+ *   00nnnnnn  FLIPS: n (1..FRAMELOG_FLIPS_MAX) segment bits changed from the
+ *             previous frame, one byte each: RAM byte << 3 | bit
+ *   01000000  KEY: the whole frame, FRAMELOG_FRAME_BYTES bytes. First record
+ *             of each block, or when too many bits changed
+ *   10000000  LOST: frames not recorded before this record (log full or
+ *             downloading), followed by their number as LEB128 (no time)
+ *   11111111  end of the block
+ *
+ * A frame equal to the previous one is not recorded: a minute change of the
+ * clock face costs 5..10 bytes, a single segment change 3..4 bytes.
+ */
+#define FRAMELOG_MAGIC              0x31474C46      // "FLG1"
+#define FRAMELOG_VERSION            1
+
+#define FRAMELOG_TAG_FLIPS          0x00
+#define FRAMELOG_TAG_KEY            0x40
+#define FRAMELOG_TAG_LOST           0x80
+#define FRAMELOG_TAG_END            0xFF
+#define FRAMELOG_TAG_TYPE_MASK      0xC0
+
+#define FRAMELOG_FLIPS_MAX          16
+
+typedef struct __attribute__((packed))
+{
+  uint32_t magic;
+  uint32_t seq;                     // increasing across the sessions
+  uint16_t session;                 // capture started, blocks of a session follow each other
+  uint8_t version;
+  uint8_t frame_bytes;
+  int64_t start_us;                 // time since boot of the first record
+}FRAMELOG_BLOCK_HEADER_TYPE;
+
+// a block is a flash sector
+#define FRAMELOG_BLOCK_BYTES        4096
+
+// longest record: LOST before it, tag, time and a whole frame
+#define FRAMELOG_RECORD_MAX_BYTES   ((1 + 5) + (1 + 5 + FRAMELOG_FRAME_BYTES))
+
+// blocks in RAM: the whole log in RAM mode, the blocks waiting to be written in flash mode
+#define FRAMELOG_RAM_BLOCKS         CONFIG_FRAMELOG_RAM_BLOCKS
+
+#if CONFIG_FRAMELOG_STORAGE_FLASH
+#define FRAMELOG_FLASH              1
+#else
+#define FRAMELOG_FLASH              0
+#endif
+
+// data partition of the log in flash mode (partitions.csv)
+#define FRAMELOG_PARTITION_LABEL    "framelog"
+#define FRAMELOG_PARTITION_SUBTYPE  0x40
+
+// the block being filled is written to flash at least with this period
+#define FRAMELOG_FLUSH_MS           1000
+
+#define FRAMELOG_TASK_STACK         (1024 * 3)
+#define FRAMELOG_TASK_PRIO          2
+
+// capture started at boot
+#define FRAMELOG_AUTOSTART          CONFIG_FRAMELOG_AUTOSTART
+
+// longest body of the network command and size of the chunks of the download
+#define FRAMELOG_HTTP_BODY_MAX      8
+#define FRAMELOG_HTTP_CHUNK_BYTES   512
+
+/*
+ * Capture state, written by the composer (records) and by the commands,
+ * read by the writer task and the download
+ */
+typedef struct
+{
+  bool active;
+  bool paused;                      // download running, frames are counted as lost
+  bool open;                        // block next_seq - 1 is being filled
+  uint16_t session;
+  uint32_t next_seq;
+  uint32_t first_seq;               // oldest block kept after a clear
+  uint16_t used[FRAMELOG_RAM_BLOCKS];
+  uint8_t last[FRAMELOG_FRAME_BYTES];
+  int64_t last_us;
+  uint32_t lost;
+  uint32_t written_seq;             // flash mode: block being written
+  uint16_t written_bytes;           // flash mode: bytes of it already written
+}FRAMELOG_STATE_TYPE;
+
+#endif
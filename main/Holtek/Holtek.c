@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_system.h"
@@ -26,6 +27,20 @@
 
 #include <Holtek.h>
 #include <Holtek_prv.h>
+#include <Animation.h>
+#include <SysMon.h>
+#include <Metrics.h>
+#include <Settings.h>
+#include <BootSeq.h>
+#include <SpiBus.h>
+#include <FrameLog.h>
+#include <BinLog.h>
+#include <FlightRec.h>
+
+// the frame log records the RAM image as it is
+#if (HMI_SPI_MEM_RAM_SIZE_BYTES != FRAMELOG_FRAME_BYTES)
+#error "FRAMELOG_FRAME_BYTES must be the size of the Holtek RAM image"
+#endif
 
 
 //-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
@@ -59,61 +74,200 @@ typedef enum
   SPI_HLTK_CFG_PWM_MODE,
   SPI_HLTK_CFG_BLINK_MODE,
   SPI_HLTK_CFG_LED_ON,
-  SPI_HLTK_CANCEL_CFG_PROTOCOL_FORMAT,
-  SPI_HLTK_SET_WRITE_PROTOCOL_FORMAT,
   SPI_HLTK_REFRESH,
   SPI_HLTK_PREPARE_REINIT,
   SPI_HLTK_WAIT_DRIVER_READY,
+  SPI_HLTK_CFG_LED_OFF,
   SPI_HLTK_CANCEL_CFG_OFF_MODE,
   SPI_HLTK_OFF_MODE,
+  SPI_HLTK_BUS_RESET,
+  SPI_HLTK_FULL_REINIT,
+  SPI_HLTK_SET_CLOCK,
 }SPI_HLTK_ENUM;
 
-static const char* pc_SPI_HLTK_ENUM[] =
-{
-    [SPI_HLTK_INIT_PERIPHERAL] = "SPI_HLTK_INIT_PERIPHERAL",
-    [SPI_HLTK_SET_CFG_PROTOCOL_FORMAT] = "SPI_HLTK_SET_CFG_PROTOCOL_FORMAT",
-    [SPI_HLTK_CFG_SYS_DIS] = "SPI_HLTK_CFG_SYS_DIS",
-    [SPI_HLTK_CFG_COM_OPTION] = "SPI_HLTK_CFG_COM_OPTION",
-    [SPI_HLTK_CFG_MASTER_MODE] = "SPI_HLTK_CFG_MASTER_MODE",
-    [SPI_HLTK_CFG_SYS_ON] = "SPI_HLTK_CFG_SYS_ON",
-    [SPI_HLTK_CFG_PWM_MODE] = "SPI_HLTK_CFG_PWM_MODE",
-    [SPI_HLTK_CFG_BLINK_MODE] = "SPI_HLTK_CFG_BLINK_MODE",
-    [SPI_HLTK_CFG_LED_ON] = "SPI_HLTK_CFG_LED_ON",
-    [SPI_HLTK_CANCEL_CFG_PROTOCOL_FORMAT] = "SPI_HLTK_CANCEL_CFG_PROTOCOL_FORMAT",
-    [SPI_HLTK_SET_WRITE_PROTOCOL_FORMAT] = "SPI_HLTK_SET_WRITE_PROTOCOL_FORMAT",
-    [SPI_HLTK_REFRESH] = "SPI_HLTK_REFRESH",
-    [SPI_HLTK_PREPARE_REINIT] = "SPI_HLTK_PREPARE_REINIT",
-    [SPI_HLTK_WAIT_DRIVER_READY] = "SPI_HLTK_WAIT_DRIVER_READY",
-    [SPI_HLTK_CANCEL_CFG_OFF_MODE] = "SPI_HLTK_CANCEL_CFG_OFF_MODE",
-    [SPI_HLTK_OFF_MODE] = "SPI_HLTK_OFF_MODE"
-};
-
 typedef struct
 {
   SPI_HLTK_ENUM state;
   SPI_HLTK_ENUM state_prev;
   SPI_HLTK_ENUM state_next;
-  spi_bus_config_t spi_bus_config;
   spi_device_handle_t spi_device_hdl;
-  spi_transaction_t spi_transaction;
+  spi_transaction_ext_t spi_transaction;   // configuration commands, 8 address bits
   spi_transaction_t *trans_desc;
-  spi_device_interface_config_t spi_device_interface_config[2];
+  spi_device_interface_config_t spi_device_interface_config;
   bool flag_startup_init;
+  bool flag_resume;                        // leaving the standby, the chip configuration is still valid
+  TaskHandle_t task_hdl;
+  uint32_t refresh_inflight;
+  uint8_t burst;                           // refresh transactions queued on the current grant of the bus
+  uint8_t burst_max;                       // refresh transactions allowed on the current grant
+  int64_t progress_us;                     // last refresh completion, or first queued frame when the bus was idle
+  uint32_t backoff_ms;                     // delay before retrying the failed step, 0 if the last step succeeded
+  uint8_t retries;                         // consecutive failures at the current escalation level
+  uint8_t resets;                          // bus resets since the display was last refreshed
+  uint32_t clock_hz;                       // clock of the pending frames, SPI_HLTK_SET_CLOCK attaches the device at it
 }SPI_HLTK_HANDLER_TYPE;
 
-#define SPI_HLTK_DEVICE_INT_CONFIG_ID   0
-#define SPI_HLTK_DEVICE_INT_REFRESH_ID   1
-
 static SPI_HLTK_HANDLER_TYPE x_Spi_Hltk_Handler;
 
-// buffer for data sent via SPI to Holtek
+// buffer where the composer builds the Holtek RAM image
 static uint8_t pu8_Hmi_SPI_Mem_Ram[HMI_SPI_MEM_RAM_SIZE_BYTES];
 
+/**
+ * Lock-free single producer (composer) / single consumer (transport) ring of
+ * frames. Each slot owns the transaction that sends it, the slot is released
+ * only when the transaction is completed.
+ *
+ *   [tail, send) -> queued in the SPI driver
+ *   [send, head) -> composed, not yet queued
+ */
+typedef struct
+{
+  uint8_t ram[HOLTEK_GRAY_SLOTS][HMI_SPI_MEM_RAM_SIZE_BYTES];  // Holtek RAM images of the sub-frames, used as tx buffer
+  spi_transaction_t trans;
+  int64_t compose_us;
+  uint8_t subframes;                        // 1 if all the segments are at full level
+}HOLTEK_FRAME_SLOT_TYPE;
+
+typedef struct
+{
+  HOLTEK_FRAME_SLOT_TYPE slot[HOLTEK_FRAME_RING_SIZE];
+  uint32_t head;      // written by the composer only
+  uint32_t tail;      // written by the transport only
+  uint32_t send;      // private to the transport
+  uint32_t dropped;   // frames not pushed because the ring was full
+  uint32_t skipped;   // frames superseded by a newer one before being sent
+}HOLTEK_FRAME_RING_TYPE;
+
+static HOLTEK_FRAME_RING_TYPE x_Holtek_Frame_Ring;
+
+/**
+ * Grayscale: the mask of each sub-frame clears the segments off in it, it is
+ * rebuilt only when a level changes. The transport takes the first sub-frame
+ * of a grayscale frame from the ring, then streams the copy kept here until
+ * a newer frame is taken at the end of a cycle.
+ */
+typedef struct
+{
+  uint8_t mask[HOLTEK_GRAY_SLOTS][HMI_SPI_MEM_RAM_SIZE_BYTES];
+  uint8_t dim[HMI_SPI_MEM_RAM_SIZE_BYTES];  // segments below HOLTEK_LEVEL_MAX
+}HOLTEK_GRAY_MASK_TYPE;
+
+typedef struct
+{
+  uint8_t ram[HOLTEK_GRAY_SLOTS][HMI_SPI_MEM_RAM_SIZE_BYTES];
+  spi_transaction_t trans[HOLTEK_SPI_BURST_MAX];
+  uint8_t next;                             // next sub-frame to send, 0 at the start of a cycle
+  bool active;
+  int64_t window_start_us;
+  uint32_t cycles;                          // cycles completed in the statistics window
+  HOLTEK_GRAY_STATS_TYPE report;
+}HOLTEK_GRAY_STREAM_TYPE;
+
+static HOLTEK_GRAY_MASK_TYPE x_Holtek_Gray_Mask;
+static HOLTEK_GRAY_STREAM_TYPE x_Holtek_Gray_Stream;
+
+static portMUX_TYPE x_Holtek_Gray_Mux = portMUX_INITIALIZER_UNLOCKED;
+
 static uint64_t u64_Holtek_Refresh_Period;
 
+// the brightness changed, the PWM duty is sent at the next refresh
+static volatile bool b_Holtek_Pwm_Update;
+
+// standby requested, and reached: display off, device detached, no refresh
+static volatile bool b_Holtek_Standby_Request;
+static volatile bool b_Holtek_Standby;
+// time of the resume request, until the first frame is sent
+static int64_t s64_Holtek_Resume_Us;
+
+// a composed frame has been transferred to the chip at least once
+static volatile bool b_Holtek_Frame_Sent;
+
+// time of the input event waiting for its display change, 0 if none
+static int64_t s64_Holtek_Input_Us;
+static uint32_t u32_Holtek_Input_Latency_Us;
+
+/**
+ * Data structures related to the frame clock, it wakes up the composer task
+ * on absolute deadlines so that processing time does not add to the period
+ */
+typedef struct
+{
+  esp_timer_handle_t timer_hdl;
+  TaskHandle_t task_hdl;
+  uint32_t period_us;
+  int64_t last_us;                    // last wake-up, 0 when the next period must not be measured
+  int64_t window_start_us;
+  uint32_t wake_requests;             // wake-ups requested out of the frame deadlines
+  int64_t align_epoch_us;             // esp_timer time of a deadline of the aligned clock
+  bool aligned;                       // deadlines on align_epoch_us, else anchored to the start
+  bool align_request;                 // the alignment changed, applied by the composer
+  bool aligning;                      // one-shot to the first aligned deadline armed
+  bool stopped;                       // stopped by the composer for the standby
+  uint64_t deviation_sum_us;
+  HOLTEK_FRAME_STATS_TYPE window;     // statistics of the window in progress
+  HOLTEK_FRAME_STATS_TYPE report;     // statistics of the last completed window
+}HOLTEK_FRAME_CLOCK_TYPE;
+
+static HOLTEK_FRAME_CLOCK_TYPE x_Holtek_Frame_Clock;
+
+/**
+ * Frame layers: each one is a lock-free triple buffer between its producer
+ * and the composer. The producer fills the back buffer and publishes it
+ * swapping it with the middle one, the composer swaps the middle buffer with
+ * the front one when a newer frame has been published.
+ */
+#define HOLTEK_LAYER_BUF_DIRTY  0x80
+
+typedef struct
+{
+  HOLTEK_FRAME_TYPE buf[3];
+  uint8_t back;       // private to the producer
+  uint8_t last;       // private to the producer, last published buffer
+  uint8_t middle;     // exchanged atomically, HOLTEK_LAYER_BUF_DIRTY until taken by the composer
+  uint8_t front;      // private to the composer
+}HOLTEK_LAYER_TYPE;
+
+static HOLTEK_LAYER_TYPE px_Holtek_Layer[NUM_OF_HOLTEK_LAYERS];
+
+// layer on top, NUM_OF_HOLTEK_LAYERS for the local digits: the running transitions belong to it
+static volatile uint8_t u8_Holtek_Top_Layer;
+
+static portMUX_TYPE x_Holtek_Frame_Stats_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *TAG = "Holtek";
+
+// stack and TCB of the tasks, reserved at link time in static allocation mode
+SYSMON_TASK_POOL(x_Holtek_Transport_Task, HOLTEK_TRANSPORT_TASK_STACK)
+SYSMON_TASK_POOL(x_Holtek_Composer_Task, HOLTEK_COMPOSER_TASK_STACK)
+
 //-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
 static void SpiDriverSetup(void);
 static void SpiTaskCallback(void *pv_args);
+static bool SpiConfigCommand(uint8_t u8_addr, SPI_HLTK_ENUM e_next);
+static void SpiFault(HOLTEK_SPI_FAULT_ENUM e_fault);
+static void SpiFaultClear(void);
+static bool SpiDeviceDetach(void);
+static void SpiTransportReap(void);
+static void SpiTransportSend(void);
+static bool SpiTransportSendNext(void);
+static bool SpiTransportQueue(spi_transaction_t *px_trans, const uint8_t *pu8_ram, void *pv_user);
+static void SpiTransportGrayNext(void);
+static void SpiTransportPostCallback(spi_transaction_t *px_trans);
+static void ComposerTaskCallback(void *pv_args);
+static void ComposerBuildFrame(uint8_t *pu8_ram);
+static const HOLTEK_FRAME_TYPE *ComposerTopLayer(int64_t s64_now_us);
+static void ComposerLayerTransition(const uint32_t *pu32_mask_old, const HOLTEK_FRAME_TYPE *px_frame, int64_t s64_now_us);
+static bool ComposerLayerMasks(const HOLTEK_FRAME_TYPE *px_frame, int64_t s64_now_us, DIGIT_SEG_TYPE *px_digit_status);
+static void ComposerWake(void);
+static void LayerPublish(HOLTEK_LAYER_ENUM e_layer, bool b_visible);
+static bool FrameRingPush(const uint8_t *pu8_ram);
+static uint8_t ComposerSubFrames(const uint8_t *pu8_ram, uint8_t ppu8_sub[][HMI_SPI_MEM_RAM_SIZE_BYTES]);
+static void GrayLevelSet(uint8_t u8_byte, uint8_t u8_bit, uint8_t u8_level);
+static void FrameClockCallback(void *pv_args);
+static void FrameClockWait(void);
+static void FrameClockStart(uint32_t u32_period_us);
+static void FrameClockStatsUpdate(int64_t s64_now_us, uint32_t u32_ticks);
+static void InputLatencyDone(void);
 
 //=====================================================================================================================
 //-------------------------------------- Public Functions -------------------------------------------------------------
@@ -126,8 +280,46 @@ static void SpiTaskCallback(void *pv_args);
  */
 void Holtek__Initialize(void)
 {
+  DISPLAY_DIGIT_ENUM e_digit;
+  DISPLAY_ICON_ENUM e_icon;
+  uint8_t u8_layer;
+
+  Animation__Initialize();
+
+  // no blink at startup, digits and icons are steady on
+  for (e_digit = 0; e_digit < NUM_OF_DIGITS; ++e_digit)
+  {
+    gpx_Display_Blink_Digits[e_digit].toggle = true;
+  }
+  for (e_icon = 0; e_icon < NUM_OF_ICONS; ++e_icon)
+  {
+    gpx_Display_Blink_Icons[e_icon].toggle = true;
+  }
+
+  // layers are hidden at startup
+  memset(px_Holtek_Layer, 0x00, sizeof(px_Holtek_Layer));
+  for (u8_layer = 0; u8_layer < NUM_OF_HOLTEK_LAYERS; ++u8_layer)
+  {
+    px_Holtek_Layer[u8_layer].back = 0;
+    px_Holtek_Layer[u8_layer].last = 1;
+    px_Holtek_Layer[u8_layer].middle = 1;
+    px_Holtek_Layer[u8_layer].front = 2;
+  }
+  u8_Holtek_Top_Layer = NUM_OF_HOLTEK_LAYERS;
+
+  // all the segments at full level
+  memset(x_Holtek_Gray_Mask.mask, 0xFF, sizeof(x_Holtek_Gray_Mask.mask));
+
   SpiDriverSetup();
 
+  SysMon__Register_Module(TAG, sizeof(x_Spi_Hltk_Handler) + sizeof(pu8_Hmi_SPI_Mem_Ram) +
+                               sizeof(x_Holtek_Frame_Ring) + sizeof(x_Holtek_Frame_Clock) +
+                               sizeof(x_Holtek_Gray_Mask) + sizeof(x_Holtek_Gray_Stream) +
+                               sizeof(gpx_Display_Digit) + sizeof(gpx_Display_Blink_Icons) +
+                               sizeof(gpx_Display_Blink_Digits) + sizeof(px_Holtek_Layer) +
+                               SYSMON_TASK_POOL_BYTES(x_Holtek_Transport_Task) +
+                               SYSMON_TASK_POOL_BYTES(x_Holtek_Composer_Task));
+
   gpx_Display_Digit[DIGIT_LEFT_2].ascii_char = '0';
   gpx_Display_Digit[DIGIT_LEFT_1].ascii_char = '1';
   gpx_Display_Digit[DIGIT_MIDDLE].ascii_char = '2';
@@ -135,6 +327,338 @@ void Holtek__Initialize(void)
   gpx_Display_Digit[DIGIT_RIGHT_2].ascii_char = '4';
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Sets the char shown by a digit, optionally with a segment-wise
+ *          transition from the char currently shown. While a layer is shown
+ *          the digit is hidden and changed without transition: the
+ *          transitions belong to the layer.
+ *
+ * @param e_digit       digit to be changed
+ * @param u8_ascii_char new char
+ * @param e_transition  transition to be played, ANIM_TRANSITION_NONE for an immediate change
+ */
+void Holtek__Set_Digit(DISPLAY_DIGIT_ENUM e_digit, uint8_t u8_ascii_char, ANIM_TRANSITION_ENUM e_transition)
+{
+  uint32_t u32_mask_old;
+  bool b_frame_clock_idle;
+
+  if (e_digit >= NUM_OF_DIGITS)
+  {
+    return;
+  }
+
+  if (__atomic_load_n(&u8_Holtek_Top_Layer, __ATOMIC_ACQUIRE) != NUM_OF_HOLTEK_LAYERS)
+  {
+    gpx_Display_Digit[e_digit].ascii_char = u8_ascii_char;
+    return;
+  }
+
+  // start from what is on the digit now, it may be in the middle of another transition
+  u32_mask_old = ASCII_8Digit_Table_Conversion[gpx_Display_Digit[e_digit].ascii_char];
+  (void)Animation__Get_Mask(e_digit, esp_timer_get_time(), &u32_mask_old);
+
+  b_frame_clock_idle = (Animation__Is_Active() == false);
+
+  Animation__Start(e_digit, u32_mask_old, ASCII_8Digit_Table_Conversion[u8_ascii_char], e_transition, 0);
+  gpx_Display_Digit[e_digit].ascii_char = u8_ascii_char;
+
+  // wake up the composer to show the change, or to switch the frame clock to the animation rate, without waiting the idle period
+  if (b_frame_clock_idle == true)
+  {
+    ComposerWake();
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Changes the brightness of the display. The level is saved in the
+ *          settings, a burst of changes (i.e. a key held down) is written
+ *          once.
+ *
+ * @param u8_level 0 .. HOLTEK_BRIGHTNESS_MAX
+ */
+void Holtek__Set_Brightness(uint8_t u8_level)
+{
+  if (u8_level > HOLTEK_BRIGHTNESS_MAX)
+  {
+    u8_level = HOLTEK_BRIGHTNESS_MAX;
+  }
+
+  (void)Settings__Set_U32(SETTINGS_BRIGHTNESS, u8_level);
+  b_Holtek_Pwm_Update = true;
+
+  if (x_Spi_Hltk_Handler.task_hdl != NULL)
+  {
+    xTaskNotifyGive(x_Spi_Hltk_Handler.task_hdl);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Applies the brightness stored in the settings, to be called when
+ *          they have been restored after the display was started.
+ *
+ */
+void Holtek__Apply_Settings(void)
+{
+  b_Holtek_Pwm_Update = true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Returns the brightness of the display.
+ *
+ * @return 0 .. HOLTEK_BRIGHTNESS_MAX
+ */
+uint8_t Holtek__Get_Brightness(void)
+{
+  return (uint8_t)MIN(Settings__Get_U32(SETTINGS_BRIGHTNESS), HOLTEK_BRIGHTNESS_MAX);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Returns the frame clock statistics of the last completed report window.
+ *
+ * @param px_stats [out] frame clock statistics
+ */
+void Holtek__Get_Frame_Stats(HOLTEK_FRAME_STATS_TYPE *px_stats)
+{
+  portENTER_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+  *px_stats = x_Holtek_Frame_Clock.report;
+  portEXIT_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Aligns the frame deadlines on a time shared by several clocks:
+ *          the deadlines fall on the multiples of the frame period from the
+ *          epoch. The composer restarts the frame clock at its next wake-up.
+ *
+ * @param b_enable      false to go back to deadlines anchored to the start
+ * @param s64_epoch_us  esp_timer time at which the shared time was 0
+ */
+void Holtek__Align_Frame_Clock(bool b_enable, int64_t s64_epoch_us)
+{
+  portENTER_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+  x_Holtek_Frame_Clock.align_epoch_us = s64_epoch_us;
+  x_Holtek_Frame_Clock.aligned = b_enable;
+  portEXIT_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+
+  __atomic_store_n(&x_Holtek_Frame_Clock.align_request, true, __ATOMIC_RELEASE);
+  ComposerWake();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Sets the intensity of some segments of a digit, relative to the
+ *          brightness. The level is kept by the position on the display,
+ *          whatever is shown on it (local digits or layers). While a
+ *          segment on is below HOLTEK_LEVEL_MAX the frames are streamed as
+ *          sub-frames, see Holtek__Get_Gray_Stats().
+ *
+ * @param e_digit       digit
+ * @param u32_seg_mask  segments, as in HOLTEK_FRAME_TYPE (DISPLAY_SEG_DP for the dot)
+ * @param u8_level      0 (off) .. HOLTEK_LEVEL_MAX (full)
+ */
+void Holtek__Set_Level(DISPLAY_DIGIT_ENUM e_digit, uint32_t u32_seg_mask, uint8_t u8_level)
+{
+  uint8_t u8_bit_idx;
+
+  if (e_digit >= NUM_OF_DIGITS)
+  {
+    return;
+  }
+
+  u8_level = MIN(u8_level, HOLTEK_LEVEL_MAX);
+
+  portENTER_CRITICAL(&x_Holtek_Gray_Mux);
+  for (u8_bit_idx = 0; u8_bit_idx < HMI_SPI_MEM_RAM_SIZE_BYTES; ++u8_bit_idx)
+  {
+    if (BIT_TEST(u32_seg_mask, u8_bit_idx) != 0)
+    {
+      GrayLevelSet(u8_bit_idx, (e_digit + 2), u8_level);
+    }
+  }
+
+  // only the dot of LEFT_1 is mounted, on the led of the "WIFI" icon
+  if ((e_digit == DIGIT_LEFT_1) && ((u32_seg_mask & DISPLAY_SEG_DP) != 0))
+  {
+    GrayLevelSet(1, 7, u8_level);
+  }
+  portEXIT_CRITICAL(&x_Holtek_Gray_Mux);
+
+  ComposerWake();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Returns the grayscale statistics: refresh rate reached by the
+ *          sub-frames and its margin over the flicker threshold
+ *          (CONFIG_HOLTEK_GRAY_FLICKER_HZ).
+ *
+ * @param px_stats [out] grayscale statistics
+ */
+void Holtek__Get_Gray_Stats(HOLTEK_GRAY_STATS_TYPE *px_stats)
+{
+  portENTER_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+  *px_stats = x_Holtek_Gray_Stream.report;
+  portEXIT_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Tells if the display is refreshed: the configuration of the driver
+ *          has been completed at least once and a composed frame has been
+ *          transferred. It does not wait for the frame statistics window.
+ *
+ * @return true if the display is running
+ */
+bool Holtek__Is_Running(void)
+{
+  return ((x_Spi_Hltk_Handler.flag_startup_init == false) && (b_Holtek_Frame_Sent == true));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Enters or leaves the standby. Entering, the frame clock is
+ *          stopped and the transport switches the chip off (LED OFF, SYS
+ *          DIS) and detaches it from the bus, then waits without any
+ *          periodic wake-up. Leaving, the device is attached again and only
+ *          SYS ON and the commands after it are sent: the chip keeps the
+ *          rest of its configuration while disabled. The frame clock is
+ *          stopped and restarted by the composer, as for
+ *          Holtek__Align_Frame_Clock().
+ *
+ * @param b_standby true to enter the standby
+ */
+void Holtek__Set_Standby(bool b_standby)
+{
+  if (b_standby == __atomic_load_n(&b_Holtek_Standby_Request, __ATOMIC_ACQUIRE))
+  {
+    return;
+  }
+
+  if (b_standby == false)
+  {
+    s64_Holtek_Resume_Us = esp_timer_get_time();
+  }
+
+  __atomic_store_n(&b_Holtek_Standby_Request, b_standby, __ATOMIC_RELEASE);
+
+  // leaving, the first frame is built right away, it is sent as soon as the chip is on
+  ComposerWake();
+  xTaskNotifyGive(x_Spi_Hltk_Handler.task_hdl);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Tells if the standby has been reached: the chip is off and
+ *          detached from the bus.
+ *
+ * @return true in standby
+ */
+bool Holtek__Is_Standby(void)
+{
+  return b_Holtek_Standby;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Measures the latency of an input event: the time from the event
+ *          to the end of the next transfer changing the display (a frame or
+ *          the brightness command) is added to the input latency histogram.
+ *          To be called after the change has been requested.
+ *
+ * @param s64_event_us time of the event, esp_timer_get_time()
+ */
+void Holtek__Trace_Input(int64_t s64_event_us)
+{
+  int64_t s64_none = 0;
+
+  // an event still waiting keeps its time, the change covers both
+  (void)__atomic_compare_exchange_n(&s64_Holtek_Input_Us, &s64_none, s64_event_us, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Last latency measured by Holtek__Trace_Input().
+ *
+ * @return microseconds, 0 if none has been measured yet
+ */
+uint32_t Holtek__Get_Input_Latency(void)
+{
+  return u32_Holtek_Input_Latency_Us;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Returns the segment mask of a char, as used in HOLTEK_FRAME_TYPE.
+ *
+ * @param u8_ascii_char char to be converted
+ *
+ * @return segment mask
+ */
+uint32_t Holtek__Get_Glyph(uint8_t u8_ascii_char)
+{
+  return ASCII_8Digit_Table_Conversion[u8_ascii_char];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Returns the buffer where the producer of a layer prepares the next
+ *          frame, initialized with the last frame it committed. Each layer
+ *          must have a single producer task.
+ *
+ * @param e_layer layer to be written
+ *
+ * @return frame to be filled, NULL if the layer does not exist
+ */
+HOLTEK_FRAME_TYPE *Holtek__Frame_Acquire(HOLTEK_LAYER_ENUM e_layer)
+{
+  HOLTEK_LAYER_TYPE *px_layer;
+
+  if (e_layer >= NUM_OF_HOLTEK_LAYERS)
+  {
+    return NULL;
+  }
+
+  px_layer = &px_Holtek_Layer[e_layer];
+
+  // the last published buffer is only read by the composer, it can be copied safely
+  memcpy(&px_layer->buf[px_layer->back], &px_layer->buf[px_layer->last], sizeof(HOLTEK_FRAME_TYPE));
+
+  return &px_layer->buf[px_layer->back];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Publishes the frame filled after Holtek__Frame_Acquire() and shows
+ *          the layer. The frame is sent to the display without waiting the
+ *          next frame deadline.
+ *
+ * @param e_layer layer to be published
+ */
+void Holtek__Frame_Commit(HOLTEK_LAYER_ENUM e_layer)
+{
+  LayerPublish(e_layer, true);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Hides a layer, the layers below it are shown again.
+ *
+ * @param e_layer layer to be hidden
+ */
+void Holtek__Frame_Release(HOLTEK_LAYER_ENUM e_layer)
+{
+  if (Holtek__Frame_Acquire(e_layer) != NULL)
+  {
+    LayerPublish(e_layer, false);
+  }
+}
+
 //=====================================================================================================================
 //-------------------------------------- Private Functions ------------------------------------------------------------
 //=====================================================================================================================
@@ -146,39 +670,22 @@ void Holtek__Initialize(void)
  */
 static void SpiDriverSetup(void)
 {
-  // setup bus HW configuration
-  x_Spi_Hltk_Handler.spi_bus_config.miso_io_num = -1;   // MISO not used
-  x_Spi_Hltk_Handler.spi_bus_config.mosi_io_num = HMI_SPI_MOSI_PIN;
-  x_Spi_Hltk_Handler.spi_bus_config.sclk_io_num = HMI_SPI_CLK_PIN;
-  x_Spi_Hltk_Handler.spi_bus_config.quadwp_io_num = -1;   // WP not used
-  x_Spi_Hltk_Handler.spi_bus_config.quadhd_io_num = -1;   // Hold not used
-  x_Spi_Hltk_Handler.spi_bus_config.max_transfer_sz = 0; // default
-
-  // setup BUS protocol for CONFIGURATION commands
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_CONFIG_ID].clock_speed_hz = HMI_SPI_CLK_SPEED_HZ;               //Clock out in Hz
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_CONFIG_ID].mode = 0;                                //SPI mode 0
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_CONFIG_ID].spics_io_num = HMI_SPI_LATCH_PIN;               //CS pin
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_CONFIG_ID].queue_size = 10;                          //We want to be able to queue 10 transactions at a time
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_CONFIG_ID].pre_cb = NULL;  //Specify pre-transfer callback to handle D/C line
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_CONFIG_ID].post_cb = NULL;  //Specify post-transfer callback to handle D/C line
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_CONFIG_ID].address_bits = 8;
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_CONFIG_ID].command_bits = 3;
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_CONFIG_ID].cs_ena_pretrans = 16;
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_CONFIG_ID].cs_ena_posttrans = 16;
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_CONFIG_ID].flags = SPI_DEVICE_HALFDUPLEX;
-
-  // setup BUS protocol for REFRESH commands
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_REFRESH_ID].clock_speed_hz = HMI_SPI_CLK_SPEED_HZ;               //Clock out in Hz
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_REFRESH_ID].mode = 0;                                //SPI mode 0
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_REFRESH_ID].spics_io_num = HMI_SPI_LATCH_PIN;               //CS pin
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_REFRESH_ID].queue_size = 10;                          //We want to be able to queue 10 transactions at a time
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_REFRESH_ID].pre_cb = NULL;  //Specify pre-transfer callback to handle D/C line
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_REFRESH_ID].post_cb = NULL;  //Specify post-transfer callback to handle D/C line
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_REFRESH_ID].address_bits = 7;
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_REFRESH_ID].command_bits = 3;
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_REFRESH_ID].cs_ena_pretrans = 16;
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_REFRESH_ID].cs_ena_posttrans = 16;
-  x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_REFRESH_ID].flags = SPI_DEVICE_HALFDUPLEX;
+  /*
+   * setup BUS protocol, the device is attached once with the REFRESH format
+   * (7 address bits), CONFIGURATION commands override it to 8 address bits
+   * per transaction, so the device is never removed and added again.
+   */
+  x_Spi_Hltk_Handler.spi_device_interface_config.clock_speed_hz = HMI_SPI_CLK_SPEED_HZ;               //Clock out in Hz
+  x_Spi_Hltk_Handler.spi_device_interface_config.mode = 0;                                //SPI mode 0
+  x_Spi_Hltk_Handler.spi_device_interface_config.spics_io_num = HMI_SPI_LATCH_PIN;               //CS pin
+  x_Spi_Hltk_Handler.spi_device_interface_config.queue_size = 10;                          //We want to be able to queue 10 transactions at a time
+  x_Spi_Hltk_Handler.spi_device_interface_config.pre_cb = NULL;  //Specify pre-transfer callback to handle D/C line
+  x_Spi_Hltk_Handler.spi_device_interface_config.post_cb = SpiTransportPostCallback;  //wake up the transport when a frame has been sent
+  x_Spi_Hltk_Handler.spi_device_interface_config.address_bits = 7;
+  x_Spi_Hltk_Handler.spi_device_interface_config.command_bits = 3;
+  x_Spi_Hltk_Handler.spi_device_interface_config.cs_ena_pretrans = 16;
+  x_Spi_Hltk_Handler.spi_device_interface_config.cs_ena_posttrans = 16;
+  x_Spi_Hltk_Handler.spi_device_interface_config.flags = SPI_DEVICE_HALFDUPLEX;
 
   /*
    * do not send packet, the first bytes are enough to drive the 2 shift registers.
@@ -186,12 +693,13 @@ static void SpiDriverSetup(void)
    * The trick is to use ADDRESS and COMMAND fields as shift registers data bytes.
    *
    */
-  x_Spi_Hltk_Handler.spi_transaction.flags = 0;
-  x_Spi_Hltk_Handler.spi_transaction.length = 0;
-  x_Spi_Hltk_Handler.spi_transaction.rxlength = 0;
-  x_Spi_Hltk_Handler.spi_transaction.rx_buffer = NULL;
-  x_Spi_Hltk_Handler.spi_transaction.tx_buffer = NULL;
-  x_Spi_Hltk_Handler.spi_transaction.user = NULL;
+  x_Spi_Hltk_Handler.spi_transaction.base.flags = SPI_TRANS_VARIABLE_ADDR;
+  x_Spi_Hltk_Handler.spi_transaction.address_bits = 8;
+  x_Spi_Hltk_Handler.spi_transaction.base.length = 0;
+  x_Spi_Hltk_Handler.spi_transaction.base.rxlength = 0;
+  x_Spi_Hltk_Handler.spi_transaction.base.rx_buffer = NULL;
+  x_Spi_Hltk_Handler.spi_transaction.base.tx_buffer = NULL;
+  x_Spi_Hltk_Handler.spi_transaction.base.user = NULL;
 
   // set flag for first initialization signal
   x_Spi_Hltk_Handler.flag_startup_init = true;
@@ -199,54 +707,77 @@ static void SpiDriverSetup(void)
 
   u64_Holtek_Refresh_Period = esp_timer_get_time();
 
-  // create task of key events handler
-  xTaskCreate(SpiTaskCallback, "SpiCallback", (1024 * 8), NULL, 15, NULL); //was *8
+  // create transport task, it owns the SPI device and sends the composed frames
+  SYSMON_TASK_CREATE(x_Holtek_Transport_Task, SpiTaskCallback, "SpiCallback", HOLTEK_TRANSPORT_TASK_STACK, NULL,
+                     HOLTEK_TRANSPORT_TASK_PRIO, &x_Spi_Hltk_Handler.task_hdl, HOLTEK_TASKS_CORE_ID);
+  SysMon__Register_Task(TAG, x_Spi_Hltk_Handler.task_hdl, HOLTEK_TRANSPORT_TASK_STACK);
+
+  // create composer task, it builds a frame at each frame clock deadline
+  SYSMON_TASK_CREATE(x_Holtek_Composer_Task, ComposerTaskCallback, "HoltekComposer", HOLTEK_COMPOSER_TASK_STACK, NULL,
+                     HOLTEK_COMPOSER_TASK_PRIO, &x_Holtek_Frame_Clock.task_hdl, HOLTEK_TASKS_CORE_ID);
+  SysMon__Register_Task(TAG, x_Holtek_Frame_Clock.task_hdl, HOLTEK_COMPOSER_TASK_STACK);
+
+  // start the frame clock at the idle rate, it is raised while animations are running
+  const esp_timer_create_args_t x_frame_timer_args =
+  {
+    .callback = &FrameClockCallback,
+    .arg = NULL,
+    .name = "HoltekFrame"
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&x_frame_timer_args, &x_Holtek_Frame_Clock.timer_hdl));
+
+  x_Holtek_Frame_Clock.window_start_us = esp_timer_get_time();
+  FrameClockStart(HOLTEK_FRAME_PERIOD_US(HOLTEK_FRAME_RATE_IDLE_HZ));
 }
 
 
 /**
  * @brief   This task handles the communication with HOLTEK driver.
- *          Sets initialization commands and periodic refresh
- *          of internal RAM.
+ *          Sets initialization commands and sends the frames
+ *          built by the composer to the internal RAM.
  *
  * @param pv_args NULL
  */
 static void SpiTaskCallback(void *pv_args)
 {
- spi_transaction_t x_trans;
- uint8_t u8_bit_idx;
- DIGIT_SEG_TYPE px_digit_status[NUM_OF_DIGITS];
- DISPLAY_DIGIT_ENUM e_digit;
+ SPI_HLTK_ENUM e_state_start;
 
  // task loop
  while (true)
  {
+   e_state_start = x_Spi_Hltk_Handler.state;
+
    switch (x_Spi_Hltk_Handler.state)
    {
 
      case SPI_HLTK_INIT_PERIPHERAL:
-       //Initialize the SPI bus, avoid usage of DMA (not needed)
-       if (spi_bus_initialize(HSPI_HOST, &x_Spi_Hltk_Handler.spi_bus_config, 0) == ESP_OK)
+       // the bus is initialized by SpiBus, here again only if its initialization failed
+       if ((SpiBus__Is_Ready() == true) || (SpiBus__Recover(SPIBUS_CLIENT_DISPLAY) == ESP_OK))
        {
+         SpiFaultClear();
          x_Spi_Hltk_Handler.state = SPI_HLTK_SET_CFG_PROTOCOL_FORMAT;
        }
        else
        {
-         ESP_LOGE("SpiTaskCallback", "%s", pc_SPI_HLTK_ENUM[x_Spi_Hltk_Handler.state]);
+         SpiFault(HOLTEK_SPI_FAULT_INIT);
        }
        break;
 
      case SPI_HLTK_SET_CFG_PROTOCOL_FORMAT:
-       //Attach the Holtek to the SPI bus with CONFIGURATION protocol format
-       if (spi_bus_add_device( HSPI_HOST,
-                               &x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_CONFIG_ID],
-                               &x_Spi_Hltk_Handler.spi_device_hdl) == ESP_OK)
+       //Attach the Holtek to the SPI bus, done once: the device stays attached across re-configurations
+       if (SpiBus__Attach(SPIBUS_CLIENT_DISPLAY,
+                          &x_Spi_Hltk_Handler.spi_device_interface_config,
+                          &x_Spi_Hltk_Handler.spi_device_hdl) == ESP_OK)
        {
-         x_Spi_Hltk_Handler.state = SPI_HLTK_CFG_SYS_DIS;
+         SpiFaultClear();
+
+         // out of the standby the chip is only enabled again
+         x_Spi_Hltk_Handler.state = (x_Spi_Hltk_Handler.flag_resume == true) ? SPI_HLTK_CFG_SYS_ON : SPI_HLTK_CFG_SYS_DIS;
+         x_Spi_Hltk_Handler.flag_resume = false;
        }
        else
        {
-         ESP_LOGE("SpiTaskCallback", "%s", pc_SPI_HLTK_ENUM[x_Spi_Hltk_Handler.state]);
+         SpiFault(HOLTEK_SPI_FAULT_INIT);
        }
        break;
 
@@ -254,18 +785,7 @@ static void SpiTaskCallback(void *pv_args)
        if (x_Spi_Hltk_Handler.flag_startup_init == true)
        {
          //! SYS DIS - 100 0000 0000
-         x_Spi_Hltk_Handler.spi_transaction.cmd = 4;
-         x_Spi_Hltk_Handler.spi_transaction.addr = 0x00;
-         x_Spi_Hltk_Handler.spi_transaction.length = 0;
-         x_Spi_Hltk_Handler.spi_transaction.tx_buffer = NULL;
-
-         if (spi_device_queue_trans( x_Spi_Hltk_Handler.spi_device_hdl,
-                                     &x_Spi_Hltk_Handler.spi_transaction,
-                                     portMAX_DELAY) == ESP_OK)
-         {
-           x_Spi_Hltk_Handler.state = SPI_HLTK_WAIT_DRIVER_READY;
-           x_Spi_Hltk_Handler.state_next = SPI_HLTK_CFG_COM_OPTION;
-         }
+         SpiConfigCommand(0x00, SPI_HLTK_CFG_COM_OPTION);
        }
        else
        {
@@ -276,251 +796,1277 @@ static void SpiTaskCallback(void *pv_args)
      case SPI_HLTK_CFG_COM_OPTION:
        //! COM OPTION - 100 0010 abXX
        // ab = 00 -> N-MOS open drain output and 8 COM option
-       x_Spi_Hltk_Handler.spi_transaction.cmd = 4;
-       x_Spi_Hltk_Handler.spi_transaction.addr = 0x20;
-       x_Spi_Hltk_Handler.spi_transaction.length = 0;
-       x_Spi_Hltk_Handler.spi_transaction.tx_buffer = NULL;
-
-       if (spi_device_queue_trans( x_Spi_Hltk_Handler.spi_device_hdl,
-                                   &x_Spi_Hltk_Handler.spi_transaction,
-                                   portMAX_DELAY) == ESP_OK)
-       {
-         x_Spi_Hltk_Handler.state = SPI_HLTK_WAIT_DRIVER_READY;
-         x_Spi_Hltk_Handler.state_next = SPI_HLTK_CFG_MASTER_MODE;
-       }
+       SpiConfigCommand(0x20, SPI_HLTK_CFG_MASTER_MODE);
        break;
 
      case SPI_HLTK_CFG_MASTER_MODE:
        //! MASTER MODE - 100 0001 10XX
-       x_Spi_Hltk_Handler.spi_transaction.cmd = 4;
-       x_Spi_Hltk_Handler.spi_transaction.addr = 0x18;
-       x_Spi_Hltk_Handler.spi_transaction.length = 0;
-       x_Spi_Hltk_Handler.spi_transaction.tx_buffer = NULL;
-
-       if (spi_device_queue_trans( x_Spi_Hltk_Handler.spi_device_hdl,
-                                   &x_Spi_Hltk_Handler.spi_transaction,
-                                   portMAX_DELAY) == ESP_OK)
-       {
-         x_Spi_Hltk_Handler.state = SPI_HLTK_WAIT_DRIVER_READY;
-         x_Spi_Hltk_Handler.state_next = SPI_HLTK_CFG_SYS_ON;
-       }
+       SpiConfigCommand(0x18, SPI_HLTK_CFG_SYS_ON);
        break;
 
      case SPI_HLTK_CFG_SYS_ON:
        //! SYS ON - 100 0000 0001
-       x_Spi_Hltk_Handler.spi_transaction.cmd = 4;
-       x_Spi_Hltk_Handler.spi_transaction.addr = 0x01;
-       x_Spi_Hltk_Handler.spi_transaction.length = 0;
-       x_Spi_Hltk_Handler.spi_transaction.tx_buffer = NULL;
-
-       if (spi_device_queue_trans( x_Spi_Hltk_Handler.spi_device_hdl,
-                                   &x_Spi_Hltk_Handler.spi_transaction,
-                                   portMAX_DELAY) == ESP_OK)
-       {
-         x_Spi_Hltk_Handler.state = SPI_HLTK_WAIT_DRIVER_READY;
-         x_Spi_Hltk_Handler.state_next = SPI_HLTK_CFG_PWM_MODE;
-       }
+       SpiConfigCommand(0x01, SPI_HLTK_CFG_PWM_MODE);
        break;
 
      case SPI_HLTK_CFG_PWM_MODE:
-       //! PWM DUTY - 100 101X 1111
-       x_Spi_Hltk_Handler.spi_transaction.cmd = 4;
-
-       x_Spi_Hltk_Handler.spi_transaction.addr = 0xAF;
-
-       x_Spi_Hltk_Handler.spi_transaction.length = 0;
-       x_Spi_Hltk_Handler.spi_transaction.tx_buffer = NULL;
-
-       if (spi_device_queue_trans( x_Spi_Hltk_Handler.spi_device_hdl,
-                                   &x_Spi_Hltk_Handler.spi_transaction,
-                                   portMAX_DELAY) == ESP_OK)
-       {
-         x_Spi_Hltk_Handler.state = SPI_HLTK_WAIT_DRIVER_READY;
-         x_Spi_Hltk_Handler.state_next = SPI_HLTK_CFG_BLINK_MODE;
-       }
+       //! PWM DUTY - 100 101X DDDD
+       SpiConfigCommand(0xA0 | Holtek__Get_Brightness(), SPI_HLTK_CFG_BLINK_MODE);
        break;
 
      case SPI_HLTK_CFG_BLINK_MODE:
        //! BLINK OFF - 100 0000 1000
-       x_Spi_Hltk_Handler.spi_transaction.cmd = 4;
-       x_Spi_Hltk_Handler.spi_transaction.addr = 0x08;
-       x_Spi_Hltk_Handler.spi_transaction.length = 0;
-       x_Spi_Hltk_Handler.spi_transaction.tx_buffer = NULL;
-
-       if (spi_device_queue_trans( x_Spi_Hltk_Handler.spi_device_hdl,
-                                   &x_Spi_Hltk_Handler.spi_transaction,
-                                   portMAX_DELAY) == ESP_OK)
-       {
-         x_Spi_Hltk_Handler.state = SPI_HLTK_WAIT_DRIVER_READY;
-         x_Spi_Hltk_Handler.state_next = SPI_HLTK_CFG_LED_ON;
-       }
+       SpiConfigCommand(0x08, SPI_HLTK_CFG_LED_ON);
        break;
 
      case SPI_HLTK_CFG_LED_ON:
        //! LED ON - 100 0000 0011
-       x_Spi_Hltk_Handler.spi_transaction.cmd = 4;
-       x_Spi_Hltk_Handler.spi_transaction.addr = 0x03;
-       x_Spi_Hltk_Handler.spi_transaction.length = 0;
-       x_Spi_Hltk_Handler.spi_transaction.tx_buffer = NULL;
-
-       if (spi_device_queue_trans( x_Spi_Hltk_Handler.spi_device_hdl,
-                                   &x_Spi_Hltk_Handler.spi_transaction,
-                                   portMAX_DELAY) == ESP_OK)
+       if (SpiConfigCommand(0x03, SPI_HLTK_REFRESH) == true)
        {
-         x_Spi_Hltk_Handler.state = SPI_HLTK_WAIT_DRIVER_READY;
-         x_Spi_Hltk_Handler.state_next = SPI_HLTK_CANCEL_CFG_PROTOCOL_FORMAT;
+         u64_Holtek_Refresh_Period = esp_timer_get_time();
        }
        break;
 
-     case SPI_HLTK_CANCEL_CFG_PROTOCOL_FORMAT:
-       // reset the protocol format for CONFIGURATION
-       if (spi_bus_remove_device(x_Spi_Hltk_Handler.spi_device_hdl) == ESP_OK)
+     case SPI_HLTK_REFRESH:
+
+       // clear flag, at least one config done since statup
+       x_Spi_Hltk_Handler.flag_startup_init = false;
+
+       // release the slots of the frames already sent
+       SpiTransportReap();
+
+       // a refresh transaction not completed in time: wait again, then reset the bus
+       if ((x_Spi_Hltk_Handler.refresh_inflight != 0) &&
+           ((esp_timer_get_time() - x_Spi_Hltk_Handler.progress_us) >= (int64_t)MSEC_TO_USEC(HOLTEK_SPI_TIMEOUT_MS)))
        {
-         x_Spi_Hltk_Handler.state = SPI_HLTK_SET_WRITE_PROTOCOL_FORMAT;
+         x_Spi_Hltk_Handler.progress_us = esp_timer_get_time();
+         SpiFault(HOLTEK_SPI_FAULT_TIMEOUT);
        }
-       else
+       else if (b_Holtek_Standby_Request == true)
        {
-         ESP_LOGE("SpiTaskCallback", "%s", pc_SPI_HLTK_ENUM[x_Spi_Hltk_Handler.state]);
+         // the frames in flight are completed first
+         if (x_Spi_Hltk_Handler.refresh_inflight == 0)
+         {
+           x_Spi_Hltk_Handler.state = SPI_HLTK_CFG_LED_OFF;
+         }
        }
-       break;
-
-     case SPI_HLTK_SET_WRITE_PROTOCOL_FORMAT:
-       //Attach the Holtek to the SPI bus with REFRESH protocol format
-       if (spi_bus_add_device( HSPI_HOST,
-                               &x_Spi_Hltk_Handler.spi_device_interface_config[SPI_HLTK_DEVICE_INT_REFRESH_ID],
-                               &x_Spi_Hltk_Handler.spi_device_hdl) == ESP_OK)
+       // check timeout for Holtek configuration refresh
+       else if ((esp_timer_get_time() - u64_Holtek_Refresh_Period) >= SEC_TO_USEC(5))
        {
-         u64_Holtek_Refresh_Period = esp_timer_get_time();
+         // configuration commands share the device queue, wait for the refresh in flight
+         if (x_Spi_Hltk_Handler.refresh_inflight == 0)
+         {
+           x_Spi_Hltk_Handler.state = SPI_HLTK_PREPARE_REINIT;
 
-         x_Spi_Hltk_Handler.state = SPI_HLTK_REFRESH;
+           u64_Holtek_Refresh_Period = esp_timer_get_time();
+         }
+       }
+       else if ((b_Holtek_Pwm_Update == true) && (x_Spi_Hltk_Handler.refresh_inflight == 0))
+       {
+         // only the PWM duty and the following commands, the display is not switched off
+         b_Holtek_Pwm_Update = false;
+         x_Spi_Hltk_Handler.state = SPI_HLTK_CFG_PWM_MODE;
+       }
+       else
+       {
+         // queue the frames built by the composer
+         SpiTransportSend();
        }
        break;
 
-     case SPI_HLTK_REFRESH:
+     case SPI_HLTK_PREPARE_REINIT:
+       Metrics__Counter_Add(METRICS_HOLTEK_REINIT, 1);
 
-       // clear flag, at least one config done since statup
-       x_Spi_Hltk_Handler.flag_startup_init = false;
+       // the device is still attached, restart from the configuration commands
+       x_Spi_Hltk_Handler.state = SPI_HLTK_CFG_SYS_DIS;
+       break;
 
-       // check timeout for Holtek configuration refresh
-       if ((esp_timer_get_time() - u64_Holtek_Refresh_Period) >= SEC_TO_USEC(5))
+     case SPI_HLTK_WAIT_DRIVER_READY:
+       if (spi_device_get_trans_result(x_Spi_Hltk_Handler.spi_device_hdl,
+                                       &x_Spi_Hltk_Handler.trans_desc,
+                                       pdMS_TO_TICKS(HOLTEK_SPI_TIMEOUT_MS)) == ESP_OK)
        {
-         x_Spi_Hltk_Handler.state = SPI_HLTK_PREPARE_REINIT;
+         Metrics__Counter_Add(METRICS_HOLTEK_SPI_TX_BYTES, HOLTEK_SPI_CFG_BYTES);
+         SpiBus__Release(SPIBUS_CLIENT_DISPLAY);
+         SpiFaultClear();
 
-         u64_Holtek_Refresh_Period = esp_timer_get_time();
+         x_Spi_Hltk_Handler.state = x_Spi_Hltk_Handler.state_next;
+
+         // end of the configuration sequence, i.e. the brightness change
+         if (x_Spi_Hltk_Handler.state == SPI_HLTK_REFRESH)
+         {
+           x_Spi_Hltk_Handler.resets = 0;
+           InputLatencyDone();
+         }
        }
        else
        {
+         SpiFault(HOLTEK_SPI_FAULT_TIMEOUT);
+       }
+       break;
 
-         // refresh periodically the Holtek RAM
-
-         // clear buffer
-         memset(pu8_Hmi_SPI_Mem_Ram, 0x00, HMI_SPI_MEM_RAM_SIZE_BYTES);    //ALL OFF
+     case SPI_HLTK_CFG_LED_OFF:
+       //! LED OFF - 100 0000 0010
+       SpiConfigCommand(0x02, SPI_HLTK_CANCEL_CFG_OFF_MODE);
+       break;
 
-         // loop to assign ASCII segments to physical leds in digits
-         for (e_digit = 0; e_digit < NUM_OF_DIGITS; ++e_digit)
-         {
-           // convert ascii char to digits bitmap
-           px_digit_status[e_digit].lword = (ASCII_8Digit_Table_Conversion[gpx_Display_Digit[e_digit].ascii_char] * gpx_Display_Blink_Digits[e_digit].toggle);
-           px_digit_status[e_digit].seg.dp = (gpx_Display_Digit[e_digit].dp * gpx_Display_Blink_Digits[e_digit].toggle);
-
-           // per each segment, set proper digit bit
-           for (u8_bit_idx = 0; u8_bit_idx < HMI_SPI_MEM_RAM_SIZE_BYTES; ++u8_bit_idx)
-           {
-             //
-             //step 1 - test the bit in the ASCII bitmap starting from Aa to N
-             //step 2 - use the segment index as index in the holtek memory with offset 2 (first 2 bits are linked to digits not mounted)
-             //
-             //NOTE: each BYTE in the holtek memory refers to a SEGMENT (i.e. Aa), each BIT (starting from bit 2) refers to a DIGIT starting from LEFT2 -> RIGHT2
-             //
-             if(BIT_TEST(px_digit_status[e_digit].lword, u8_bit_idx) != 0)
-             {
-               BIT_SET(pu8_Hmi_SPI_Mem_Ram[u8_bit_idx], e_digit+2);
-             }
-             else
-             {
-               BIT_CLR(pu8_Hmi_SPI_Mem_Ram[u8_bit_idx], e_digit+2);
-             }
-           }
-         }
+     case SPI_HLTK_CANCEL_CFG_OFF_MODE:
+       //! SYS DIS - 100 0000 0000, oscillator off: the chip keeps RAM and configuration
+       SpiConfigCommand(0x00, SPI_HLTK_OFF_MODE);
+       break;
 
-         /**
-           * Special management of the "WIFI" icon that is actually mapped on Holtek display
-           *
-           */
-         if ((px_digit_status[DIGIT_LEFT_1].seg.dp == 1) ||
-             ((gpx_Display_Blink_Icons[ICON_WIFI].state == true) && (gpx_Display_Blink_Icons[ICON_WIFI].toggle == true)))
+     case SPI_HLTK_OFF_MODE:
+       if (x_Spi_Hltk_Handler.spi_device_hdl != NULL)
+       {
+         // detach the device, the CS pin is left as input with pull-up so the chip stays deselected
+         if (SpiDeviceDetach() == true)
          {
-           BIT_SET(pu8_Hmi_SPI_Mem_Ram[1], 7);
+           SpiFaultClear();
+           b_Holtek_Standby = true;
+           ESP_LOGI(TAG, "standby");
          }
          else
          {
-           BIT_CLR(pu8_Hmi_SPI_Mem_Ram[1], 7);
+           SpiFault(HOLTEK_SPI_FAULT_DETACH);
          }
-
-
-         x_trans.flags = 0;
-         x_trans.length = 0;
-         x_trans.rxlength = 0;
-         x_trans.rx_buffer = NULL;
-         x_trans.tx_buffer = NULL;
-         x_trans.user = NULL;
-
-         x_trans.addr = 0;
-         x_trans.cmd = 5;
-         x_trans.length = (HMI_SPI_MEM_RAM_SIZE_BYTES * 8);
-         x_trans.tx_buffer = pu8_Hmi_SPI_Mem_Ram;
-
-         spi_device_queue_trans(x_Spi_Hltk_Handler.spi_device_hdl, &x_trans, portMAX_DELAY);
-
-         x_Spi_Hltk_Handler.state = SPI_HLTK_WAIT_DRIVER_READY;
-         x_Spi_Hltk_Handler.state_next = SPI_HLTK_REFRESH;
+       }
+       else if (b_Holtek_Standby_Request == false)
+       {
+         b_Holtek_Standby = false;
+         x_Spi_Hltk_Handler.flag_resume = true;
+         x_Spi_Hltk_Handler.state = SPI_HLTK_SET_CFG_PROTOCOL_FORMAT;
        }
        break;
 
-     case SPI_HLTK_PREPARE_REINIT:
-       // reset the protocol format for REFRESH
-       if (spi_bus_remove_device(x_Spi_Hltk_Handler.spi_device_hdl) == ESP_OK)
+     case SPI_HLTK_BUS_RESET:
+       // first escalation: the device is attached again, its driver queues are empty, and fully configured
+       if (SpiDeviceDetach() == true)
        {
+         Metrics__Counter_Add(METRICS_HOLTEK_SPI_BUS_RESETS, 1);
+         x_Spi_Hltk_Handler.flag_startup_init = true;
          x_Spi_Hltk_Handler.state = SPI_HLTK_SET_CFG_PROTOCOL_FORMAT;
        }
        else
        {
-         x_Spi_Hltk_Handler.state = SPI_HLTK_WAIT_DRIVER_READY;
-         x_Spi_Hltk_Handler.state_next = SPI_HLTK_PREPARE_REINIT;
-         ESP_LOGE("SpiTaskCallback", "%s", pc_SPI_HLTK_ENUM[x_Spi_Hltk_Handler.state]);
+         SpiFault(HOLTEK_SPI_FAULT_DETACH);
        }
        break;
 
-     case SPI_HLTK_WAIT_DRIVER_READY:
-       if (spi_device_get_trans_result(x_Spi_Hltk_Handler.spi_device_hdl,
-                                       &x_Spi_Hltk_Handler.trans_desc,
-                                       portMAX_DELAY) == ESP_OK)
+     case SPI_HLTK_FULL_REINIT:
+       // second escalation: the bus is freed and initialized again, only if the display is its only user
+       if (SpiDeviceDetach() == true)
        {
-         x_Spi_Hltk_Handler.state = x_Spi_Hltk_Handler.state_next;
+         if (SpiBus__Recover(SPIBUS_CLIENT_DISPLAY) == ESP_OK)
+         {
+           Metrics__Counter_Add(METRICS_HOLTEK_SPI_FULL_REINITS, 1);
+         }
+         x_Spi_Hltk_Handler.resets = 0;
+         x_Spi_Hltk_Handler.flag_startup_init = true;
+         x_Spi_Hltk_Handler.state = SPI_HLTK_INIT_PERIPHERAL;
+       }
+       else
+       {
+         SpiFault(HOLTEK_SPI_FAULT_DETACH);
        }
        break;
 
-     case SPI_HLTK_CANCEL_CFG_OFF_MODE:
-       // reset the protocol format for CONFIGURATION
-       if (spi_bus_remove_device(x_Spi_Hltk_Handler.spi_device_hdl) == ESP_OK)
+     case SPI_HLTK_SET_CLOCK:
+       // the device is attached again at the clock of the pending frame, the chip keeps its configuration
+       if (SpiDeviceDetach() == true)
        {
-         x_Spi_Hltk_Handler.state = SPI_HLTK_OFF_MODE;
+         x_Spi_Hltk_Handler.spi_device_interface_config.clock_speed_hz = x_Spi_Hltk_Handler.clock_hz;
+
+         if (SpiBus__Attach(SPIBUS_CLIENT_DISPLAY,
+                            &x_Spi_Hltk_Handler.spi_device_interface_config,
+                            &x_Spi_Hltk_Handler.spi_device_hdl) == ESP_OK)
+         {
+           SpiFaultClear();
+           x_Spi_Hltk_Handler.state = SPI_HLTK_REFRESH;
+         }
+         else
+         {
+           SpiFault(HOLTEK_SPI_FAULT_INIT);
+         }
        }
        else
        {
-         ESP_LOGE("SpiTaskCallback", "%s", pc_SPI_HLTK_ENUM[x_Spi_Hltk_Handler.state]);
+         SpiFault(HOLTEK_SPI_FAULT_DETACH);
        }
        break;
 
-     case SPI_HLTK_OFF_MODE:
-       break;
-
      default:
        break;
    }
 
-   vTaskDelay(100 / portTICK_RATE_MS);
+   if (x_Spi_Hltk_Handler.state != e_state_start)
+   {
+     // kept across a reset: the steps before a watchdog or a brownout
+     FlightRec__Event(FLIGHTREC_HOLTEK_STATE, x_Spi_Hltk_Handler.state, e_state_start);
+   }
+
+   if (x_Spi_Hltk_Handler.state == SPI_HLTK_REFRESH)
+   {
+     // sleep until a new frame is pushed or a refresh transaction is completed, at most until the transfer deadline
+     ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((x_Spi_Hltk_Handler.refresh_inflight != 0) ? HOLTEK_SPI_TIMEOUT_MS
+                                                                                        : HOLTEK_TRANSPORT_IDLE_MS));
+   }
+   else if ((x_Spi_Hltk_Handler.state == SPI_HLTK_OFF_MODE) && (x_Spi_Hltk_Handler.spi_device_hdl == NULL))
+   {
+     // standby, nothing to do until Holtek__Set_Standby(false)
+     ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+   }
+   else if ((x_Spi_Hltk_Handler.state != SPI_HLTK_WAIT_DRIVER_READY) && (x_Spi_Hltk_Handler.backoff_ms != 0) &&
+            (x_Spi_Hltk_Handler.state == e_state_start))
+   {
+     // the step failed, retry later
+     vTaskDelay(pdMS_TO_TICKS(x_Spi_Hltk_Handler.backoff_ms));
+   }
  }
 
  vTaskDelete(NULL);
 }
+
+
+/**
+ * @brief   Queues a configuration command, waiting at most
+ *          HOLTEK_SPI_TIMEOUT_MS for room in the driver queue, then waits
+ *          for its completion.
+ *
+ * @param u8_addr command, sent in the address field
+ * @param e_next  state after the completion
+ *
+ * @return true if the command has been queued
+ */
+static bool SpiConfigCommand(uint8_t u8_addr, SPI_HLTK_ENUM e_next)
+{
+  x_Spi_Hltk_Handler.spi_transaction.base.cmd = 4;
+  x_Spi_Hltk_Handler.spi_transaction.base.addr = u8_addr;
+  x_Spi_Hltk_Handler.spi_transaction.base.length = 0;
+  x_Spi_Hltk_Handler.spi_transaction.base.tx_buffer = NULL;
+
+  // the bus is released when the command is completed
+  if (SpiBus__Acquire(SPIBUS_CLIENT_DISPLAY, SpiBus__Hold_Us(SPIBUS_CLIENT_DISPLAY, HOLTEK_SPI_CFG_BYTES),
+                      pdMS_TO_TICKS(HOLTEK_SPI_TIMEOUT_MS)) == false)
+  {
+    // contention with the other clients, counted by the bus: the command is retried, the display is not reset
+    return false;
+  }
+
+  if (spi_device_queue_trans( x_Spi_Hltk_Handler.spi_device_hdl,
+                              &x_Spi_Hltk_Handler.spi_transaction.base,
+                              pdMS_TO_TICKS(HOLTEK_SPI_TIMEOUT_MS)) != ESP_OK)
+  {
+    SpiBus__Release(SPIBUS_CLIENT_DISPLAY);
+    SpiFault(HOLTEK_SPI_FAULT_QUEUE);
+    return false;
+  }
+
+  x_Spi_Hltk_Handler.state = SPI_HLTK_WAIT_DRIVER_READY;
+  x_Spi_Hltk_Handler.state_next = e_next;
+
+  return true;
+}
+
+
+/**
+ * @brief   Accounts a failed bus operation. The step is retried after a
+ *          backoff doubling at each failure, after HOLTEK_SPI_RETRIES
+ *          retries the bus is reset and, if the failures go on after
+ *          HOLTEK_SPI_RESETS_MAX resets, fully initialized again. Only the
+ *          first failure of a burst and the escalations are logged.
+ *
+ * @param e_fault failure class
+ */
+static void SpiFault(HOLTEK_SPI_FAULT_ENUM e_fault)
+{
+  static const METRICS_COUNTER_ENUM pe_counter[NUM_OF_HOLTEK_SPI_FAULTS] =
+  {
+    [HOLTEK_SPI_FAULT_INIT]    = METRICS_HOLTEK_SPI_INIT_ERRORS,
+    [HOLTEK_SPI_FAULT_QUEUE]   = METRICS_HOLTEK_SPI_QUEUE_ERRORS,
+    [HOLTEK_SPI_FAULT_TIMEOUT] = METRICS_HOLTEK_SPI_TIMEOUTS,
+    [HOLTEK_SPI_FAULT_DETACH]  = METRICS_HOLTEK_SPI_DETACH_ERRORS,
+  };
+
+  Metrics__Counter_Add(pe_counter[e_fault], 1);
+
+  // no formatting on the refresh path, a fault storm is rate limited by the log
+  BinLog__Event(BINLOG_HOLTEK_SPI_FAULT, x_Spi_Hltk_Handler.state, e_fault);
+
+  x_Spi_Hltk_Handler.backoff_ms = (x_Spi_Hltk_Handler.backoff_ms == 0) ? HOLTEK_SPI_BACKOFF_MIN_MS
+                                                                        : (x_Spi_Hltk_Handler.backoff_ms * 2);
+  if (x_Spi_Hltk_Handler.backoff_ms > HOLTEK_SPI_BACKOFF_MAX_MS)
+  {
+    x_Spi_Hltk_Handler.backoff_ms = HOLTEK_SPI_BACKOFF_MAX_MS;
+  }
+
+  if (x_Spi_Hltk_Handler.retries < HOLTEK_SPI_RETRIES)
+  {
+    x_Spi_Hltk_Handler.retries++;
+    Metrics__Counter_Add(METRICS_HOLTEK_SPI_RETRIES, 1);
+  }
+  else
+  {
+    x_Spi_Hltk_Handler.retries = 0;
+    x_Spi_Hltk_Handler.resets++;
+    x_Spi_Hltk_Handler.state = (x_Spi_Hltk_Handler.resets > HOLTEK_SPI_RESETS_MAX) ? SPI_HLTK_FULL_REINIT
+                                                                                   : SPI_HLTK_BUS_RESET;
+    BinLog__Event(BINLOG_HOLTEK_SPI_ESCALATE, x_Spi_Hltk_Handler.state, x_Spi_Hltk_Handler.resets);
+  }
+}
+
+
+/**
+ * @brief   A bus operation succeeded, the retries start again from the
+ *          shortest backoff. The escalation level is cleared only when the
+ *          display is refreshed again.
+ *
+ */
+static void SpiFaultClear(void)
+{
+  x_Spi_Hltk_Handler.retries = 0;
+  x_Spi_Hltk_Handler.backoff_ms = 0;
+}
+
+
+/**
+ * @brief   Detaches the device from the bus and releases it. The results
+ *          not collected yet are dropped, the driver refuses to detach a
+ *          device with results pending; it fails if a transaction is still
+ *          on the bus. The frames that were queued are given back to the
+ *          composer.
+ *
+ * @return true if the device is detached
+ */
+static bool SpiDeviceDetach(void)
+{
+  spi_transaction_t *px_trans;
+
+  if (x_Spi_Hltk_Handler.spi_device_hdl == NULL)
+  {
+    return true;
+  }
+
+  while (spi_device_get_trans_result(x_Spi_Hltk_Handler.spi_device_hdl, &px_trans, 0) == ESP_OK)
+  {
+  }
+
+  if (SpiBus__Detach(SPIBUS_CLIENT_DISPLAY, &x_Spi_Hltk_Handler.spi_device_hdl) != ESP_OK)
+  {
+    return false;
+  }
+
+  SpiBus__Release(SPIBUS_CLIENT_DISPLAY);
+  x_Spi_Hltk_Handler.refresh_inflight = 0;
+  x_Spi_Hltk_Handler.burst = 0;
+  __atomic_store_n(&x_Holtek_Frame_Ring.tail, x_Holtek_Frame_Ring.send, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+
+/**
+ * @brief   Collects the completed refresh transactions and releases their
+ *          slots to the composer, and the bus when none is left in flight.
+ *          Transactions complete in queue order.
+ *
+ */
+static void SpiTransportReap(void)
+{
+  spi_transaction_t *px_trans;
+
+  while ((x_Spi_Hltk_Handler.refresh_inflight != 0) &&
+         (spi_device_get_trans_result(x_Spi_Hltk_Handler.spi_device_hdl, &px_trans, 0) == ESP_OK))
+  {
+    x_Spi_Hltk_Handler.refresh_inflight--;
+    x_Spi_Hltk_Handler.progress_us = esp_timer_get_time();
+    x_Spi_Hltk_Handler.resets = 0;
+    SpiFaultClear();
+
+    if (x_Spi_Hltk_Handler.refresh_inflight == 0)
+    {
+      SpiBus__Release(SPIBUS_CLIENT_DISPLAY);
+      x_Spi_Hltk_Handler.burst = 0;
+    }
+
+    // sub-frame of the grayscale frame being streamed, its ring slot is already released
+    if (px_trans->user == NULL)
+    {
+      continue;
+    }
+
+    Metrics__Counter_Add(METRICS_HOLTEK_FRAMES_SENT, 1);
+    Metrics__Counter_Add(METRICS_HOLTEK_SPI_TX_BYTES, HOLTEK_SPI_FRAME_BYTES);
+    Metrics__Histogram_Observe(METRICS_HOLTEK_FRAME_LATENCY_US,
+                               (uint32_t)(esp_timer_get_time() - ((HOLTEK_FRAME_SLOT_TYPE *)px_trans->user)->compose_us));
+
+    __atomic_store_n(&x_Holtek_Frame_Ring.tail, (x_Holtek_Frame_Ring.tail + 1), __ATOMIC_RELEASE);
+
+    b_Holtek_Frame_Sent = true;
+    BootSeq__Mark(BOOTSEQ_MARK_DISPLAY_VISIBLE);
+    InputLatencyDone();
+
+    if (s64_Holtek_Resume_Us != 0)
+    {
+      ESP_LOGI(TAG, "resumed in %d us", (int)(esp_timer_get_time() - s64_Holtek_Resume_Us));
+      s64_Holtek_Resume_Us = 0;
+    }
+  }
+}
+
+
+/**
+ * @brief   Queues the pending frames to the SPI driver, in a burst of at most
+ *          HOLTEK_SPI_BURST_MAX transactions sent back to back on one grant
+ *          of the shared bus, released when the last one is completed: the
+ *          other clients wait at most one burst. The grant is cut to the max
+ *          hold of the display, so at the base clock a burst is one frame.
+ *
+ */
+static void SpiTransportSend(void)
+{
+  while (SpiTransportSendNext() == true)
+  {
+  }
+}
+
+
+/**
+ * @brief   Queues the next refresh transaction. When the bus is idle only the
+ *          newest pending frame is sent, older pending frames are superseded
+ *          by it. The sub-frames of a grayscale frame are sent one per call
+ *          and repeated until a newer frame is pending at the end of a cycle.
+ *
+ * @return true if a transaction has been queued
+ */
+static bool SpiTransportSendNext(void)
+{
+  HOLTEK_FRAME_RING_TYPE *px_ring = &x_Holtek_Frame_Ring;
+  HOLTEK_GRAY_STREAM_TYPE *px_gray = &x_Holtek_Gray_Stream;
+  HOLTEK_FRAME_SLOT_TYPE *px_slot;
+  uint32_t u32_head;
+
+  u32_head = __atomic_load_n(&px_ring->head, __ATOMIC_ACQUIRE);
+
+  // a cycle is completed before a newer frame is taken, so the levels are exact
+  if ((px_gray->active == true) && ((px_gray->next != 0) || (px_ring->send == u32_head)))
+  {
+    if (SpiTransportQueue(&px_gray->trans[x_Spi_Hltk_Handler.burst % HOLTEK_SPI_BURST_MAX],
+                          px_gray->ram[px_gray->next], NULL) == false)
+    {
+      return false;
+    }
+    SpiTransportGrayNext();
+    return true;
+  }
+
+  if (px_ring->send == u32_head)
+  {
+    return false;
+  }
+
+  // the slots in flight are still owned by the transport, they are skipped only on an idle bus
+  if ((x_Spi_Hltk_Handler.refresh_inflight == 0) && ((u32_head - px_ring->send) > 1))
+  {
+    px_ring->skipped += (u32_head - px_ring->send - 1);
+    Metrics__Counter_Add(METRICS_HOLTEK_FRAMES_SKIPPED, (u32_head - px_ring->send - 1));
+    px_ring->send = (u32_head - 1);
+    __atomic_store_n(&px_ring->tail, px_ring->send, __ATOMIC_RELEASE);
+  }
+
+  px_slot = &px_ring->slot[px_ring->send & HOLTEK_FRAME_RING_MASK];
+
+  // the sub-frames need the higher clock, the frame stays pending until the device is attached at it
+  x_Spi_Hltk_Handler.clock_hz = (px_slot->subframes > 1) ? HOLTEK_GRAY_SPI_CLK_HZ : HMI_SPI_CLK_SPEED_HZ;
+  if (x_Spi_Hltk_Handler.clock_hz != (uint32_t)x_Spi_Hltk_Handler.spi_device_interface_config.clock_speed_hz)
+  {
+    if (x_Spi_Hltk_Handler.refresh_inflight == 0)
+    {
+      x_Spi_Hltk_Handler.state = SPI_HLTK_SET_CLOCK;
+    }
+    return false;
+  }
+
+  // the copy of the sub-frames is overwritten below, it may still be on the bus
+  if ((px_slot->subframes > 1) && (px_gray->active == true) && (x_Spi_Hltk_Handler.refresh_inflight != 0))
+  {
+    return false;
+  }
+
+  if (SpiTransportQueue(&px_slot->trans, px_slot->ram[0], px_slot) == false)
+  {
+    return false;
+  }
+  px_ring->send++;
+
+  if (px_slot->subframes > 1)
+  {
+    // the slot is released when the first sub-frame is sent, the others are streamed from a copy
+    memcpy(px_gray->ram, px_slot->ram, sizeof(px_gray->ram));
+    if (px_gray->active == false)
+    {
+      px_gray->active = true;
+      px_gray->cycles = 0;
+      px_gray->window_start_us = esp_timer_get_time();
+    }
+    px_gray->next = 0;
+    SpiTransportGrayNext();
+  }
+  else if (px_gray->active == true)
+  {
+    px_gray->active = false;
+
+    portENTER_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+    memset(&px_gray->report, 0x00, sizeof(HOLTEK_GRAY_STATS_TYPE));
+    portEXIT_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+  }
+
+  return true;
+}
+
+
+/**
+ * @brief   Queues a refresh transaction. The first one of a burst waits for
+ *          a grant of the shared bus covering the whole burst, the wait is
+ *          bounded by the longest hold of the other clients, well within the
+ *          refresh deadline. The others are queued on the same grant.
+ *
+ * @param px_trans transaction to be queued
+ * @param pu8_ram  Holtek RAM image to be sent
+ * @param pv_user  ring slot of the frame, NULL for the streamed sub-frames
+ *
+ * @return true if the transaction has been queued
+ */
+static bool SpiTransportQueue(spi_transaction_t *px_trans, const uint8_t *pu8_ram, void *pv_user)
+{
+  uint32_t u32_hold_us;
+
+  if (x_Spi_Hltk_Handler.refresh_inflight == 0)
+  {
+    u32_hold_us = SpiBus__Hold_Us(SPIBUS_CLIENT_DISPLAY, HOLTEK_SPI_FRAME_BYTES);
+    x_Spi_Hltk_Handler.burst_max = (uint8_t)MIN(HOLTEK_SPI_BURST_MAX,
+                                                MAX(1, SpiBus__Max_Hold_Us(SPIBUS_CLIENT_DISPLAY) / u32_hold_us));
+    x_Spi_Hltk_Handler.burst = 0;
+
+    if (SpiBus__Acquire(SPIBUS_CLIENT_DISPLAY, (u32_hold_us * x_Spi_Hltk_Handler.burst_max),
+                        pdMS_TO_TICKS(HOLTEK_SPI_TIMEOUT_MS)) == false)
+    {
+      // contention with the other clients, counted by the bus: the frame stays pending, superseded by a newer one
+      return false;
+    }
+  }
+  else if (x_Spi_Hltk_Handler.burst >= x_Spi_Hltk_Handler.burst_max)
+  {
+    // the burst is complete, the next transaction waits for a new grant
+    return false;
+  }
+
+  memset(px_trans, 0x00, sizeof(spi_transaction_t));
+  px_trans->addr = 0;
+  px_trans->cmd = 5;
+  px_trans->length = (HMI_SPI_MEM_RAM_SIZE_BYTES * 8);
+  px_trans->tx_buffer = pu8_ram;
+  px_trans->user = pv_user;
+
+  // never waits: a burst is well within the driver queue, a refusal is a fault
+  if (spi_device_queue_trans(x_Spi_Hltk_Handler.spi_device_hdl, px_trans, 0) != ESP_OK)
+  {
+    if (x_Spi_Hltk_Handler.refresh_inflight == 0)
+    {
+      SpiBus__Release(SPIBUS_CLIENT_DISPLAY);
+    }
+    SpiFault(HOLTEK_SPI_FAULT_QUEUE);
+    return false;
+  }
+
+  if (x_Spi_Hltk_Handler.refresh_inflight == 0)
+  {
+    x_Spi_Hltk_Handler.progress_us = esp_timer_get_time();
+  }
+  x_Spi_Hltk_Handler.refresh_inflight++;
+  x_Spi_Hltk_Handler.burst++;
+
+  return true;
+}
+
+
+/**
+ * @brief   Moves to the next sub-frame of the grayscale frame. At the end of
+ *          each statistics window the refresh rate of the cycles and its
+ *          margin over the flicker threshold are published.
+ *
+ */
+static void SpiTransportGrayNext(void)
+{
+  HOLTEK_GRAY_STREAM_TYPE *px_gray = &x_Holtek_Gray_Stream;
+  HOLTEK_GRAY_STATS_TYPE x_report;
+  int64_t s64_now_us;
+  int64_t s64_elapsed_us;
+
+  Metrics__Counter_Add(METRICS_HOLTEK_GRAY_SUBFRAMES, 1);
+
+  px_gray->next = ((px_gray->next + 1) % HOLTEK_GRAY_SLOTS);
+  if (px_gray->next != 0)
+  {
+    return;
+  }
+
+  px_gray->cycles++;
+
+  s64_now_us = esp_timer_get_time();
+  s64_elapsed_us = (s64_now_us - px_gray->window_start_us);
+  if (s64_elapsed_us < HOLTEK_GRAY_STATS_WINDOW_US)
+  {
+    return;
+  }
+
+  x_report.active = true;
+  x_report.refresh_hz = (uint32_t)(((int64_t)px_gray->cycles * 1000000) / s64_elapsed_us);
+  x_report.subframe_us = (uint32_t)(s64_elapsed_us / ((int64_t)px_gray->cycles * HOLTEK_GRAY_SLOTS));
+  x_report.flicker_margin_pct = (int32_t)((x_report.refresh_hz * 100) / HOLTEK_GRAY_FLICKER_HZ) - 100;
+
+  portENTER_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+  px_gray->report = x_report;
+  portEXIT_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+
+  px_gray->cycles = 0;
+  px_gray->window_start_us = s64_now_us;
+}
+
+
+/**
+ * @brief   SPI post-transfer callback of the REFRESH device, runs in ISR
+ *          context and wakes up the transport task.
+ *
+ * @param px_trans completed transaction
+ */
+static void IRAM_ATTR SpiTransportPostCallback(spi_transaction_t *px_trans)
+{
+  BaseType_t x_higher_prio_woken = pdFALSE;
+
+  vTaskNotifyGiveFromISR(x_Spi_Hltk_Handler.task_hdl, &x_higher_prio_woken);
+
+  if (x_higher_prio_woken == pdTRUE)
+  {
+    portYIELD_FROM_ISR();
+  }
+}
+
+
+/**
+ * @brief   This task builds a frame at each frame clock deadline and
+ *          pushes it to the transport, it never waits for the bus.
+ *
+ * @param pv_args NULL
+ */
+static void ComposerTaskCallback(void *pv_args)
+{
+  while (true)
+  {
+    FrameClockWait();
+
+    // the frame clock is stopped in standby, wake-ups requested meanwhile are ignored
+    if (x_Holtek_Frame_Clock.stopped == true)
+    {
+      continue;
+    }
+
+    ComposerBuildFrame(pu8_Hmi_SPI_Mem_Ram);
+    Metrics__Counter_Add(METRICS_HOLTEK_FRAMES_COMPOSED, 1);
+
+    if (FrameRingPush(pu8_Hmi_SPI_Mem_Ram) == true)
+    {
+      xTaskNotifyGive(x_Spi_Hltk_Handler.task_hdl);
+      FrameLog__Record(pu8_Hmi_SPI_Mem_Ram, esp_timer_get_time());
+    }
+  }
+
+  vTaskDelete(NULL);
+}
+
+
+/**
+ * @brief   Builds the Holtek RAM image from the top visible layer or, when no
+ *          layer is visible, from local digits, transitions and icons.
+ *
+ * @param pu8_ram [out] Holtek RAM image, HMI_SPI_MEM_RAM_SIZE_BYTES long
+ */
+static void ComposerBuildFrame(uint8_t *pu8_ram)
+{
+  uint8_t u8_bit_idx;
+  DIGIT_SEG_TYPE px_digit_status[NUM_OF_DIGITS];
+  DISPLAY_DIGIT_ENUM e_digit;
+  const HOLTEK_FRAME_TYPE *px_frame;
+  uint32_t u32_glyph;
+  int64_t s64_frame_time_us;
+  bool b_icon_wifi;
+
+  // clear buffer
+  memset(pu8_ram, 0x00, HMI_SPI_MEM_RAM_SIZE_BYTES);    //ALL OFF
+
+  // all the transitions of this frame are sampled at the same time
+  s64_frame_time_us = esp_timer_get_time();
+
+  px_frame = ComposerTopLayer(s64_frame_time_us);
+
+  if (px_frame != NULL)
+  {
+    b_icon_wifi = ComposerLayerMasks(px_frame, s64_frame_time_us, px_digit_status);
+  }
+  else
+  {
+    for (e_digit = 0; e_digit < NUM_OF_DIGITS; ++e_digit)
+    {
+      // convert ascii char to digits bitmap, a running transition overrides the glyph
+      u32_glyph = ASCII_8Digit_Table_Conversion[gpx_Display_Digit[e_digit].ascii_char];
+      (void)Animation__Get_Mask(e_digit, s64_frame_time_us, &u32_glyph);
+
+      px_digit_status[e_digit].lword = (u32_glyph * gpx_Display_Blink_Digits[e_digit].toggle);
+      px_digit_status[e_digit].seg.dp = (gpx_Display_Digit[e_digit].dp * gpx_Display_Blink_Digits[e_digit].toggle);
+    }
+
+    b_icon_wifi = ((gpx_Display_Blink_Icons[ICON_WIFI].state == true) && (gpx_Display_Blink_Icons[ICON_WIFI].toggle == true));
+  }
+
+  // loop to assign segments to physical leds in digits
+  for (e_digit = 0; e_digit < NUM_OF_DIGITS; ++e_digit)
+  {
+    // per each segment, set proper digit bit
+    for (u8_bit_idx = 0; u8_bit_idx < HMI_SPI_MEM_RAM_SIZE_BYTES; ++u8_bit_idx)
+    {
+      //
+      //step 1 - test the bit in the ASCII bitmap starting from Aa to N
+      //step 2 - use the segment index as index in the holtek memory with offset 2 (first 2 bits are linked to digits not mounted)
+      //
+      //NOTE: each BYTE in the holtek memory refers to a SEGMENT (i.e. Aa), each BIT (starting from bit 2) refers to a DIGIT starting from LEFT2 -> RIGHT2
+      //
+      if(BIT_TEST(px_digit_status[e_digit].lword, u8_bit_idx) != 0)
+      {
+        BIT_SET(pu8_ram[u8_bit_idx], e_digit+2);
+      }
+      else
+      {
+        BIT_CLR(pu8_ram[u8_bit_idx], e_digit+2);
+      }
+    }
+  }
+
+  /**
+    * Special management of the "WIFI" icon that is actually mapped on Holtek display
+    *
+    */
+  if ((px_digit_status[DIGIT_LEFT_1].seg.dp == 1) || (b_icon_wifi == true))
+  {
+    BIT_SET(pu8_ram[1], 7);
+  }
+  else
+  {
+    BIT_CLR(pu8_ram[1], 7);
+  }
+}
+
+
+/**
+ * @brief   Takes the frames published since the previous call and returns the
+ *          frame of the top visible layer. When the top layer publishes a new
+ *          frame, the digits it changes play the transition of the frame.
+ *          When another layer (or the local digits) comes on top, the
+ *          running transitions are stopped.
+ *
+ * @param s64_now_us frame time
+ *
+ * @return frame to be shown, NULL if no layer is visible
+ */
+static const HOLTEK_FRAME_TYPE *ComposerTopLayer(int64_t s64_now_us)
+{
+  HOLTEK_LAYER_TYPE *px_layer;
+  const HOLTEK_FRAME_TYPE *px_top = NULL;
+  uint32_t pu32_mask_old[NUM_OF_DIGITS];
+  uint32_t pu32_top_old[NUM_OF_DIGITS];
+  uint8_t u8_top = NUM_OF_HOLTEK_LAYERS;
+  uint8_t u8_layer;
+  uint8_t u8_digit;
+  bool b_changed;
+  bool b_top_changed = false;
+
+  for (u8_layer = 0; u8_layer < NUM_OF_HOLTEK_LAYERS; ++u8_layer)
+  {
+    px_layer = &px_Holtek_Layer[u8_layer];
+    b_changed = false;
+
+    if ((__atomic_load_n(&px_layer->middle, __ATOMIC_ACQUIRE) & HOLTEK_LAYER_BUF_DIRTY) != 0)
+    {
+      // the front buffer goes back to the producer with the swap, what it shows is kept for the transition
+      memcpy(pu32_mask_old, px_layer->buf[px_layer->front].digit_mask, sizeof(pu32_mask_old));
+      b_changed = px_layer->buf[px_layer->front].visible;
+
+      px_layer->front = (__atomic_exchange_n(&px_layer->middle, px_layer->front, __ATOMIC_ACQ_REL) & ~HOLTEK_LAYER_BUF_DIRTY);
+    }
+
+    if (px_layer->buf[px_layer->front].visible == true)
+    {
+      px_top = &px_layer->buf[px_layer->front];
+      u8_top = u8_layer;
+      b_top_changed = b_changed;
+      if (b_changed == true)
+      {
+        memcpy(pu32_top_old, pu32_mask_old, sizeof(pu32_top_old));
+      }
+    }
+  }
+
+  if (u8_top != u8_Holtek_Top_Layer)
+  {
+    for (u8_digit = 0; u8_digit < NUM_OF_DIGITS; ++u8_digit)
+    {
+      Animation__Stop(u8_digit);
+    }
+    __atomic_store_n(&u8_Holtek_Top_Layer, u8_top, __ATOMIC_RELEASE);
+  }
+  else if (b_top_changed == true)
+  {
+    ComposerLayerTransition(pu32_top_old, px_top, s64_now_us);
+  }
+
+  return px_top;
+}
+
+
+/**
+ * @brief   Starts the transition of a new layer frame on the digits it
+ *          changes, from what they show now: a digit in the middle of a
+ *          transition starts from its current step. A frame without
+ *          transition stops the ones running on the digits it changes.
+ *
+ * @param pu32_mask_old masks of the previous frame of the layer
+ * @param px_frame      new frame of the layer
+ * @param s64_now_us    frame time
+ */
+static void ComposerLayerTransition(const uint32_t *pu32_mask_old, const HOLTEK_FRAME_TYPE *px_frame, int64_t s64_now_us)
+{
+  DISPLAY_DIGIT_ENUM e_digit;
+  uint32_t u32_mask_shown;
+
+  for (e_digit = 0; e_digit < NUM_OF_DIGITS; ++e_digit)
+  {
+    // the dot is not animated, it follows the frame
+    if (((pu32_mask_old[e_digit] ^ px_frame->digit_mask[e_digit]) & ~DISPLAY_SEG_DP) != 0)
+    {
+      u32_mask_shown = pu32_mask_old[e_digit];
+      (void)Animation__Get_Mask(e_digit, s64_now_us, &u32_mask_shown);
+
+      Animation__Start(e_digit, u32_mask_shown, px_frame->digit_mask[e_digit], px_frame->transition, 0);
+    }
+  }
+}
+
+
+/**
+ * @brief   Converts a layer frame to digit masks, applying its transitions
+ *          and its blink timing.
+ *
+ * @param px_frame          layer frame
+ * @param s64_now_us        frame time
+ * @param px_digit_status   [out] masks of the digits
+ *
+ * @return state of the "WIFI" icon
+ */
+static bool ComposerLayerMasks(const HOLTEK_FRAME_TYPE *px_frame, int64_t s64_now_us, DIGIT_SEG_TYPE *px_digit_status)
+{
+  DISPLAY_DIGIT_ENUM e_digit;
+  uint32_t u32_phase_ms;
+  uint32_t u32_glyph;
+  uint8_t u8_byte;
+  uint8_t u8_bit;
+  bool b_blink_off = false;
+
+  if ((px_frame->blink_on_ms != 0) && (px_frame->blink_off_ms != 0))
+  {
+    u32_phase_ms = (uint32_t)(((s64_now_us - px_frame->commit_us) / 1000) % (px_frame->blink_on_ms + px_frame->blink_off_ms));
+    b_blink_off = (u32_phase_ms >= px_frame->blink_on_ms);
+  }
+
+  for (e_digit = 0; e_digit < NUM_OF_DIGITS; ++e_digit)
+  {
+    px_digit_status[e_digit].lword = px_frame->digit_mask[e_digit];
+
+    // a running transition overrides the segments, the dot is kept
+    if (Animation__Get_Mask(e_digit, s64_now_us, &u32_glyph) == true)
+    {
+      px_digit_status[e_digit].lword = (u32_glyph | (px_frame->digit_mask[e_digit] & DISPLAY_SEG_DP));
+    }
+
+    if ((b_blink_off == true) && (BIT_TEST(px_frame->blink_digits, e_digit) != 0))
+    {
+      px_digit_status[e_digit].lword = 0;
+    }
+  }
+
+  DISPLAY_ICON_GET_BYTE_BIT(ICON_WIFI, u8_byte, u8_bit);
+
+  return ((BIT_TEST(px_frame->icons[u8_byte], u8_bit) != 0) &&
+          ((b_blink_off == false) || (BIT_TEST(px_frame->blink_icons[u8_byte], u8_bit) == 0)));
+}
+
+
+/**
+ * @brief   Wakes up the composer out of the frame deadlines, to show a
+ *          change as soon as possible.
+ *
+ */
+static void ComposerWake(void)
+{
+  if (x_Holtek_Frame_Clock.task_hdl != NULL)
+  {
+    __atomic_fetch_add(&x_Holtek_Frame_Clock.wake_requests, 1, __ATOMIC_ACQ_REL);
+    xTaskNotifyGive(x_Holtek_Frame_Clock.task_hdl);
+  }
+}
+
+
+/**
+ * @brief   Publishes the back buffer of a layer to the composer.
+ *
+ * @param e_layer   layer to be published
+ * @param b_visible visibility of the layer
+ */
+static void LayerPublish(HOLTEK_LAYER_ENUM e_layer, bool b_visible)
+{
+  HOLTEK_LAYER_TYPE *px_layer;
+  uint8_t u8_published;
+
+  if (e_layer >= NUM_OF_HOLTEK_LAYERS)
+  {
+    return;
+  }
+
+  px_layer = &px_Holtek_Layer[e_layer];
+  px_layer->buf[px_layer->back].visible = b_visible;
+  px_layer->buf[px_layer->back].commit_us = esp_timer_get_time();
+
+  u8_published = px_layer->back;
+  px_layer->back = (__atomic_exchange_n(&px_layer->middle, (u8_published | HOLTEK_LAYER_BUF_DIRTY), __ATOMIC_ACQ_REL) &
+                    ~HOLTEK_LAYER_BUF_DIRTY);
+  px_layer->last = u8_published;
+
+  ComposerWake();
+}
+
+
+/**
+ * @brief   Copies a frame in the first free slot of the ring. Never blocks:
+ *          when the transport is late the frame is dropped.
+ *
+ * @param pu8_ram Holtek RAM image
+ *
+ * @return true if the frame has been pushed
+ */
+static bool FrameRingPush(const uint8_t *pu8_ram)
+{
+  HOLTEK_FRAME_RING_TYPE *px_ring = &x_Holtek_Frame_Ring;
+  HOLTEK_FRAME_SLOT_TYPE *px_slot;
+  uint32_t u32_tail;
+
+  u32_tail = __atomic_load_n(&px_ring->tail, __ATOMIC_ACQUIRE);
+
+  if ((px_ring->head - u32_tail) >= HOLTEK_FRAME_RING_SIZE)
+  {
+    px_ring->dropped++;
+    Metrics__Counter_Add(METRICS_HOLTEK_FRAMES_DROPPED, 1);
+    return false;
+  }
+
+  px_slot = &px_ring->slot[px_ring->head & HOLTEK_FRAME_RING_MASK];
+  px_slot->subframes = ComposerSubFrames(pu8_ram, px_slot->ram);
+  px_slot->compose_us = esp_timer_get_time();
+
+  __atomic_store_n(&px_ring->head, (px_ring->head + 1), __ATOMIC_RELEASE);
+
+  return true;
+}
+
+
+/**
+ * @brief   Builds the sub-frames of a frame from the masks of the levels.
+ *
+ * @param pu8_ram   Holtek RAM image, segments at full level
+ * @param ppu8_sub  [out] RAM images of the sub-frames
+ *
+ * @return number of sub-frames, 1 if no segment on is below HOLTEK_LEVEL_MAX
+ */
+static uint8_t ComposerSubFrames(const uint8_t *pu8_ram, uint8_t ppu8_sub[][HMI_SPI_MEM_RAM_SIZE_BYTES])
+{
+  uint8_t u8_dim = 0;
+  uint8_t u8_slot;
+  uint8_t u8_idx;
+
+  portENTER_CRITICAL(&x_Holtek_Gray_Mux);
+
+  for (u8_idx = 0; u8_idx < HMI_SPI_MEM_RAM_SIZE_BYTES; ++u8_idx)
+  {
+    u8_dim |= (pu8_ram[u8_idx] & x_Holtek_Gray_Mask.dim[u8_idx]);
+  }
+
+  if (u8_dim == 0)
+  {
+    portEXIT_CRITICAL(&x_Holtek_Gray_Mux);
+    memcpy(ppu8_sub[0], pu8_ram, HMI_SPI_MEM_RAM_SIZE_BYTES);
+    return 1;
+  }
+
+  for (u8_slot = 0; u8_slot < HOLTEK_GRAY_SLOTS; ++u8_slot)
+  {
+    for (u8_idx = 0; u8_idx < HMI_SPI_MEM_RAM_SIZE_BYTES; ++u8_idx)
+    {
+      ppu8_sub[u8_slot][u8_idx] = (pu8_ram[u8_idx] & x_Holtek_Gray_Mask.mask[u8_slot][u8_idx]);
+    }
+  }
+
+  portEXIT_CRITICAL(&x_Holtek_Gray_Mux);
+
+  return HOLTEK_GRAY_SLOTS;
+}
+
+
+/**
+ * @brief   Sets the level of a led in the sub-frame masks, to be called in
+ *          the grayscale critical section.
+ *
+ * @param u8_byte  byte of the Holtek RAM (segment)
+ * @param u8_bit   bit of the byte (digit)
+ * @param u8_level 0 .. HOLTEK_LEVEL_MAX
+ */
+static void GrayLevelSet(uint8_t u8_byte, uint8_t u8_bit, uint8_t u8_level)
+{
+  static const uint8_t pu8_pattern[HOLTEK_LEVEL_MAX + 1] = HOLTEK_GRAY_PATTERNS;
+  uint8_t u8_slot;
+
+  for (u8_slot = 0; u8_slot < HOLTEK_GRAY_SLOTS; ++u8_slot)
+  {
+    if (BIT_TEST(pu8_pattern[u8_level], u8_slot) != 0)
+    {
+      BIT_SET(x_Holtek_Gray_Mask.mask[u8_slot][u8_byte], u8_bit);
+    }
+    else
+    {
+      BIT_CLR(x_Holtek_Gray_Mask.mask[u8_slot][u8_byte], u8_bit);
+    }
+  }
+
+  if (u8_level < HOLTEK_LEVEL_MAX)
+  {
+    BIT_SET(x_Holtek_Gray_Mask.dim[u8_byte], u8_bit);
+  }
+  else
+  {
+    BIT_CLR(x_Holtek_Gray_Mask.dim[u8_byte], u8_bit);
+  }
+}
+
+
+/**
+ * @brief   Frame clock periodic callback, runs in the esp_timer task and
+ *          wakes up the composer task at each frame deadline. The first
+ *          deadline of an aligned clock is a one-shot, the periodic timer
+ *          starts from it.
+ *
+ * @param pv_args NULL
+ */
+static void FrameClockCallback(void *pv_args)
+{
+  if (x_Holtek_Frame_Clock.aligning == true)
+  {
+    x_Holtek_Frame_Clock.aligning = false;
+    esp_timer_start_periodic(x_Holtek_Frame_Clock.timer_hdl, x_Holtek_Frame_Clock.period_us);
+  }
+
+  if (x_Holtek_Frame_Clock.task_hdl != NULL)
+  {
+    xTaskNotifyGive(x_Holtek_Frame_Clock.task_hdl);
+  }
+}
+
+
+/**
+ * @brief   Blocks the composer task until the next frame deadline, then updates the
+ *          frame statistics and selects the frame rate for the next period:
+ *          animation rate while a transition is running, idle rate otherwise.
+ *          A new alignment requested by Holtek__Align_Frame_Clock() restarts
+ *          the clock too. The clock is stopped in standby and restarted
+ *          when it is left, see Holtek__Set_Standby(): only this task
+ *          starts and stops the timer.
+ *
+ */
+static void FrameClockWait(void)
+{
+  uint32_t u32_ticks;
+  uint32_t u32_wakes;
+  uint32_t u32_period_us;
+  int64_t s64_now_us;
+  bool b_realign;
+  bool b_standby;
+
+  // ticks accumulated while the task was busy are deadlines already lost
+  u32_ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  s64_now_us = esp_timer_get_time();
+
+  // wake-ups requested by ComposerWake() are not frame deadlines
+  u32_wakes = __atomic_exchange_n(&x_Holtek_Frame_Clock.wake_requests, 0, __ATOMIC_ACQ_REL);
+  u32_ticks = (u32_ticks > u32_wakes) ? (u32_ticks - u32_wakes) : 0;
+
+  FrameClockStatsUpdate(s64_now_us, u32_ticks);
+
+  u32_period_us = (Animation__Is_Active() == true) ? HOLTEK_FRAME_PERIOD_US(HOLTEK_FRAME_RATE_ANIM_HZ)
+                                                   : HOLTEK_FRAME_PERIOD_US(HOLTEK_FRAME_RATE_IDLE_HZ);
+  b_realign = __atomic_exchange_n(&x_Holtek_Frame_Clock.align_request, false, __ATOMIC_ACQ_REL);
+  b_standby = __atomic_load_n(&b_Holtek_Standby_Request, __ATOMIC_ACQUIRE);
+
+  if (b_standby != x_Holtek_Frame_Clock.stopped)
+  {
+    x_Holtek_Frame_Clock.stopped = b_standby;
+    esp_timer_stop(x_Holtek_Frame_Clock.timer_hdl);
+
+    if (b_standby == false)
+    {
+      FrameClockStart(u32_period_us);
+    }
+  }
+  // in standby the clock stays stopped, the changes are applied when it is restarted
+  else if (((u32_period_us != x_Holtek_Frame_Clock.period_us) || (b_realign == true)) && (b_standby == false))
+  {
+    esp_timer_stop(x_Holtek_Frame_Clock.timer_hdl);
+    FrameClockStart(u32_period_us);
+  }
+}
+
+
+/**
+ * @brief   Starts the frame clock, the timer must be stopped. Free running, the deadlines are
+ *          anchored to the start time; aligned, the first deadline is the
+ *          next multiple of the period from the epoch, reached with a
+ *          one-shot, so that all the clocks aligned on the same epoch share
+ *          their deadlines whatever their start time.
+ *
+ * @param u32_period_us frame period
+ */
+static void FrameClockStart(uint32_t u32_period_us)
+{
+  int64_t s64_phase_us;
+  int64_t s64_epoch_us;
+  bool b_aligned;
+
+  portENTER_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+  s64_epoch_us = x_Holtek_Frame_Clock.align_epoch_us;
+  b_aligned = x_Holtek_Frame_Clock.aligned;
+  portEXIT_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+
+  x_Holtek_Frame_Clock.period_us = u32_period_us;
+  x_Holtek_Frame_Clock.last_us = 0;
+
+  if (b_aligned == false)
+  {
+    x_Holtek_Frame_Clock.aligning = false;
+    esp_timer_start_periodic(x_Holtek_Frame_Clock.timer_hdl, u32_period_us);
+    return;
+  }
+
+  s64_phase_us = (esp_timer_get_time() - s64_epoch_us) % (int64_t)u32_period_us;
+  if (s64_phase_us < 0)
+  {
+    s64_phase_us += u32_period_us;
+  }
+
+  x_Holtek_Frame_Clock.aligning = true;
+  esp_timer_start_once(x_Holtek_Frame_Clock.timer_hdl, (uint64_t)(u32_period_us - s64_phase_us));
+}
+
+
+/**
+ * @brief   Accumulates the measured frame period in the statistics window and
+ *          publishes/logs the window when it is over.
+ *
+ * @param s64_now_us  wake-up time of the composer task
+ * @param u32_ticks   number of frame deadlines elapsed since the previous wake-up
+ */
+static void FrameClockStatsUpdate(int64_t s64_now_us, uint32_t u32_ticks)
+{
+  HOLTEK_FRAME_STATS_TYPE *px_window = &x_Holtek_Frame_Clock.window;
+  int64_t s64_period_us;
+  int64_t s64_deviation_us;
+
+  // out of deadline wake-up, the period in progress is measured at the next deadline
+  if (u32_ticks == 0)
+  {
+    return;
+  }
+
+  if (x_Holtek_Frame_Clock.last_us != 0)
+  {
+    s64_period_us = (s64_now_us - x_Holtek_Frame_Clock.last_us);
+    s64_deviation_us = s64_period_us - ((int64_t)x_Holtek_Frame_Clock.period_us * u32_ticks);
+
+    if ((px_window->frames == 0) || (s64_period_us < px_window->period_min_us))
+    {
+      px_window->period_min_us = (uint32_t)s64_period_us;
+    }
+    if (s64_period_us > px_window->period_max_us)
+    {
+      px_window->period_max_us = (uint32_t)s64_period_us;
+    }
+
+    s64_deviation_us = ((s64_deviation_us < 0) ? -s64_deviation_us : s64_deviation_us);
+    x_Holtek_Frame_Clock.deviation_sum_us += (uint64_t)s64_deviation_us;
+    px_window->missed += (u32_ticks - 1);
+
+    Metrics__Histogram_Observe(METRICS_HOLTEK_FRAME_JITTER_US, (uint32_t)s64_deviation_us);
+    if (u32_ticks > 1)
+    {
+      Metrics__Counter_Add(METRICS_HOLTEK_FRAMES_MISSED, (u32_ticks - 1));
+    }
+    px_window->frames++;
+  }
+  x_Holtek_Frame_Clock.last_us = s64_now_us;
+
+  if ((HOLTEK_FRAME_STATS_PERIOD_S == 0) ||
+      ((s64_now_us - x_Holtek_Frame_Clock.window_start_us) < (int64_t)SEC_TO_USEC(HOLTEK_FRAME_STATS_PERIOD_S)))
+  {
+    return;
+  }
+
+  if (px_window->frames != 0)
+  {
+    px_window->jitter_avg_us = (uint32_t)(x_Holtek_Frame_Clock.deviation_sum_us / px_window->frames);
+  }
+  px_window->period_us = x_Holtek_Frame_Clock.period_us;
+  px_window->ring_dropped = x_Holtek_Frame_Ring.dropped;
+  px_window->ring_skipped = x_Holtek_Frame_Ring.skipped;
+
+  portENTER_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+  x_Holtek_Frame_Clock.report = *px_window;
+  portEXIT_CRITICAL(&x_Holtek_Frame_Stats_Mux);
+
+  ESP_LOGI(TAG, "frames:%u missed:%u period:%uus min:%uus max:%uus jitter:%uus dropped:%u skipped:%u",
+           px_window->frames, px_window->missed, px_window->period_us,
+           px_window->period_min_us, px_window->period_max_us, px_window->jitter_avg_us,
+           px_window->ring_dropped, px_window->ring_skipped);
+
+  memset(px_window, 0x00, sizeof(HOLTEK_FRAME_STATS_TYPE));
+  x_Holtek_Frame_Clock.deviation_sum_us = 0;
+  x_Holtek_Frame_Clock.window_start_us = s64_now_us;
+}
+
+
+/**
+ * @brief   Completes the measure started by Holtek__Trace_Input(), called
+ *          by the transport when a transfer changing the display is over.
+ *
+ */
+static void InputLatencyDone(void)
+{
+  int64_t s64_event_us = __atomic_exchange_n(&s64_Holtek_Input_Us, 0, __ATOMIC_ACQ_REL);
+
+  if (s64_event_us != 0)
+  {
+    u32_Holtek_Input_Latency_Us = (uint32_t)(esp_timer_get_time() - s64_event_us);
+    Metrics__Histogram_Observe(METRICS_HOLTEK_INPUT_LATENCY_US, u32_Holtek_Input_Latency_Us);
+  }
+}
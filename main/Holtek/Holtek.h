@@ -14,7 +14,10 @@
     #define HOLTEK_H
 
 //-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
 #include <Holtek_prm.h>
+#include <Animation_prm.h>
 
 
 //=====================================================================================================================
@@ -51,6 +54,50 @@ typedef struct
   uint8_t repeats;
 }BLINKING_TIMING_TYPE;
 
+// frame clock statistics, computed over the last report window
+typedef struct
+{
+  uint32_t frames;          // frames elapsed in the window
+  uint32_t missed;          // frame deadlines lost because the task was late
+  uint32_t period_us;       // nominal frame period
+  uint32_t period_min_us;   // shortest measured frame period
+  uint32_t period_max_us;   // longest measured frame period
+  uint32_t jitter_avg_us;   // mean absolute deviation from the nominal period
+  uint32_t ring_dropped;    // frames dropped because the transport was late, since boot
+  uint32_t ring_skipped;    // frames superseded before being sent, since boot
+}HOLTEK_FRAME_STATS_TYPE;
+
+// grayscale statistics, computed over the last second of sub-frames
+typedef struct
+{
+  bool active;                // segments with an intermediate level are shown, the sub-frames are streamed
+  uint32_t refresh_hz;        // complete cycles of sub-frames per second
+  uint32_t subframe_us;       // mean time a sub-frame is shown
+  int32_t flicker_margin_pct; // refresh rate above the flicker threshold, negative if below
+}HOLTEK_GRAY_STATS_TYPE;
+
+// segment mask bit of the decimal point, the other bits follow the glyph table (A1 = bit 0 ... N = bit 15)
+#define DISPLAY_SEG_DP                  (1UL << 31)
+
+/*
+ * Complete frame of a layer. Items listed in the blink bitmaps are shown for
+ * blink_on_ms and hidden for blink_off_ms, starting when the frame is committed.
+ * The digits changed from the previous frame of the layer play the transition,
+ * if the layer is on top.
+ */
+typedef struct
+{
+  uint32_t digit_mask[NUM_OF_DIGITS];                     // segments of each digit, DISPLAY_SEG_DP for the dot
+  uint8_t icons[DISPLAY_ICONS_BITMAP_BYTES_NUM];          // icons bitmap, see DISPLAY_ICON_GET_BYTE_BIT
+  uint8_t blink_digits;                                   // bitmap of the blinking digits
+  uint8_t blink_icons[DISPLAY_ICONS_BITMAP_BYTES_NUM];    // bitmap of the blinking icons
+  uint16_t blink_on_ms;                                   // 0 to disable the blink
+  uint16_t blink_off_ms;
+  ANIM_TRANSITION_ENUM transition;                        // ANIM_TRANSITION_NONE to change the digits at once
+  int64_t commit_us;                                      // set by Holtek__Frame_Commit
+  bool visible;                                           // set by Holtek__Frame_Commit/Holtek__Frame_Release
+}HOLTEK_FRAME_TYPE;
+
 // define macro to calculate offsets in icons bitmap
 #define DISPLAY_ICON_GET_BYTE_BIT(e_icon, out_u8_byte, out_u8_bit)  {out_u8_byte = (e_icon / 8); out_u8_bit = (e_icon % 8);}
 
@@ -71,5 +118,22 @@ void Holtek__Initialize(void);
 //=====================================================================================================================
 //-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
 //=====================================================================================================================
+void Holtek__Set_Digit(DISPLAY_DIGIT_ENUM e_digit, uint8_t u8_ascii_char, ANIM_TRANSITION_ENUM e_transition);
+void Holtek__Get_Frame_Stats(HOLTEK_FRAME_STATS_TYPE *px_stats);
+void Holtek__Align_Frame_Clock(bool b_enable, int64_t s64_epoch_us);
+void Holtek__Set_Level(DISPLAY_DIGIT_ENUM e_digit, uint32_t u32_seg_mask, uint8_t u8_level);
+void Holtek__Get_Gray_Stats(HOLTEK_GRAY_STATS_TYPE *px_stats);
+bool Holtek__Is_Running(void);
+void Holtek__Set_Standby(bool b_standby);
+bool Holtek__Is_Standby(void);
+void Holtek__Trace_Input(int64_t s64_event_us);
+uint32_t Holtek__Get_Input_Latency(void);
+void Holtek__Set_Brightness(uint8_t u8_level);
+uint8_t Holtek__Get_Brightness(void);
+void Holtek__Apply_Settings(void);
+uint32_t Holtek__Get_Glyph(uint8_t u8_ascii_char);
+HOLTEK_FRAME_TYPE *Holtek__Frame_Acquire(HOLTEK_LAYER_ENUM e_layer);
+void Holtek__Frame_Commit(HOLTEK_LAYER_ENUM e_layer);
+void Holtek__Frame_Release(HOLTEK_LAYER_ENUM e_layer);
 
 #endif
@@ -67,4 +67,26 @@ typedef enum
   NUM_OF_ICONS
 }DISPLAY_ICON_ENUM;
 
+/*
+ * Define here the frame layers. A visible layer shows a complete frame written
+ * by its producer and hides the layers below it (higher value = on top), the
+ * local digits and icons are shown when no layer is visible.
+ */
+typedef enum
+{
+  HOLTEK_LAYER_CLOCK = 0,   /*clock face, time and date*/
+  HOLTEK_LAYER_SCENE,       /*scripted scenes, loaded over the network or from flash*/
+  HOLTEK_LAYER_REMOTE,      /*frames pushed by the server over the network*/
+  HOLTEK_LAYER_NOTIFY,      /*transient notifications, until their TTL expires*/
+  HOLTEK_LAYER_OTA,         /*firmware update progress*/
+  HOLTEK_LAYER_TEST,        /*segment test patterns*/
+  NUM_OF_HOLTEK_LAYERS
+}HOLTEK_LAYER_ENUM;
+
+// brightness levels are the 16 PWM duty steps of the driver, 0 = 1/16
+#define HOLTEK_BRIGHTNESS_MAX   15
+
+// intensity levels of a segment, relative to the brightness: 0 = off, HOLTEK_LEVEL_MAX = full
+#define HOLTEK_LEVEL_MAX        8
+
 #endif
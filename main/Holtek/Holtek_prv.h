@@ -38,12 +38,92 @@
  *
  */
 #define HMI_SPI_LATCH_PIN GPIO_NUM_21
-#define HMI_SPI_MOSI_PIN GPIO_NUM_18
-#define HMI_SPI_CLK_PIN GPIO_NUM_19
 #define HMI_SPI_CLK_SPEED_HZ 50000
 
 #define HMI_SPI_MEM_RAM_SIZE_BYTES  16
 
+/**
+ *
+ * Frame clock parameters
+ *
+ */
+#define HOLTEK_FRAME_RATE_IDLE_HZ     CONFIG_HOLTEK_FRAME_RATE_IDLE_HZ
+#define HOLTEK_FRAME_RATE_ANIM_HZ     CONFIG_HOLTEK_FRAME_RATE_ANIM_HZ
+#define HOLTEK_FRAME_STATS_PERIOD_S   CONFIG_HOLTEK_FRAME_STATS_PERIOD_S
+
+#define HOLTEK_FRAME_PERIOD_US(hz)    (uint32_t)(1000000UL / (hz))
+
+/**
+ *
+ * Grayscale parameters: a frame with segments at an intermediate level is
+ * sent as HOLTEK_GRAY_SLOTS sub-frames, repeated until the next frame, each
+ * segment is on in as many sub-frames as its level. The device is attached
+ * at a higher clock while they are streamed.
+ *
+ */
+#define HOLTEK_GRAY_SLOTS             HOLTEK_LEVEL_MAX
+#define HOLTEK_GRAY_SPI_CLK_HZ        CONFIG_HOLTEK_GRAY_SPI_CLK_HZ
+#define HOLTEK_GRAY_FLICKER_HZ        CONFIG_HOLTEK_GRAY_FLICKER_HZ
+#define HOLTEK_GRAY_STATS_WINDOW_US   1000000
+
+/*
+ * Sub-frames where a segment is on, per level. They are taken in bit-reversed
+ * order (0, 4, 2, 6, 1, 5, 3, 7), the on times of a level are spread over the
+ * cycle so that its flicker frequency is as high as possible.
+ */
+#define HOLTEK_GRAY_PATTERNS          {0x00, 0x01, 0x11, 0x15, 0x55, 0x57, 0x77, 0x7F, 0xFF}
+
+/**
+ *
+ * Composer / transport tasks parameters
+ *
+ */
+// run the display tasks on the core not used by the Wi-Fi stack (only core 0 on single core builds)
+#if CONFIG_FREERTOS_UNICORE || CONFIG_ESP32_WIFI_TASK_PINNED_TO_CORE_1
+  #define HOLTEK_TASKS_CORE_ID        0
+#else
+  #define HOLTEK_TASKS_CORE_ID        1
+#endif
+
+#define HOLTEK_COMPOSER_TASK_STACK    (1024 * 4)
+#define HOLTEK_COMPOSER_TASK_PRIO     15
+#define HOLTEK_TRANSPORT_TASK_STACK   (1024 * 4)
+#define HOLTEK_TRANSPORT_TASK_PRIO    16
+
+// frames exchanged between composer and transport, must be a power of 2
+#define HOLTEK_FRAME_RING_SIZE        8
+#define HOLTEK_FRAME_RING_MASK        (HOLTEK_FRAME_RING_SIZE - 1)
+
+// transport pacing: wake-up period in REFRESH without frames
+#define HOLTEK_TRANSPORT_IDLE_MS      100
+
+/*
+ * Bus error recovery: every bus operation has a deadline, a failed step is
+ * retried with a doubling backoff, then the device is detached and attached
+ * again (bus reset) and, if it keeps failing, the bus is freed and
+ * initialized again (full re-init).
+ */
+#define HOLTEK_SPI_TIMEOUT_MS         50      // queue room and completion of a transaction, a frame takes about 3 ms
+#define HOLTEK_SPI_BURST_MAX          2       // refresh transactions queued on one grant of the bus, within its max hold
+#define HOLTEK_SPI_BACKOFF_MIN_MS     10
+#define HOLTEK_SPI_BACKOFF_MAX_MS     2000
+#define HOLTEK_SPI_RETRIES            3       // retries before a bus reset
+#define HOLTEK_SPI_RESETS_MAX         2       // bus resets before a full re-init
+
+typedef enum
+{
+  HOLTEK_SPI_FAULT_INIT = 0,    /*bus initialization or device attach*/
+  HOLTEK_SPI_FAULT_QUEUE,       /*transaction not queued in time*/
+  HOLTEK_SPI_FAULT_TIMEOUT,     /*transaction not completed in time*/
+  HOLTEK_SPI_FAULT_DETACH,      /*device not detached, a transaction is still on the bus*/
+  NUM_OF_HOLTEK_SPI_FAULTS
+}HOLTEK_SPI_FAULT_ENUM;
+
+// bytes clocked out per transaction (command + address + data bits), for the metrics
+#define HOLTEK_SPI_BITS_TO_BYTES(bits)  (((bits) + 7) / 8)
+#define HOLTEK_SPI_CFG_BYTES          HOLTEK_SPI_BITS_TO_BYTES(3 + 8)
+#define HOLTEK_SPI_FRAME_BYTES        HOLTEK_SPI_BITS_TO_BYTES(3 + 7 + (HMI_SPI_MEM_RAM_SIZE_BYTES * 8))
+
 // define digit segments bitmap structure
 
 /**
@@ -403,29 +483,7 @@ typedef union
 ///*0x70*/    0x000001C5, 0x0000018D, 0x00000140, 0x00000199, 0x000001D0, 0x000000DC, 0x00000058, 0x000000DC, 0x000001CC, 0x0000019C, 0x00000155, 0x000000D1, 0x00000188, 0x0000001D, 0x00000001, 0x00000000
 //};
 
-#ifdef APPLICATION_ALT_TEST
-  //! FOR ALT TEST
-  static const uint32_t ASCII_8Digit_Table_Conversion[] =
-{
-  C_NULL, C_ALL, C_ALL, C_ALL, C_ALL, C_ALL, C_ALL, C_ALL, C_ALL, C_ALL, C_ALL, C_ALL, C_ALL, C_ALL, C_ALL, C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_Space,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,      C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,  C_ALL,
-};
-
-#else
+// 0x11 (all the segments), 0x12 and 0x13 (checkerboard halves) are used by the test patterns (main/TestPattern)
 static const uint32_t ASCII_8Digit_Table_Conversion[] =
 {
   C_NULL, C_X01,  C_X02,  C_X03,  C_X04,  C_X05,  C_X06,      C_X07,  C_X08,  C_X09,  C_X0A,  C_X0B,  C_X0C,  C_X0D,  C_X0E,  C_X0F,
@@ -446,8 +504,6 @@ static const uint32_t ASCII_8Digit_Table_Conversion[] =
   C_XF0,  C_XF1,  C_XF2,  C_XF3,  C_XF4,  C_XF5,  C_XF6,      C_XF7,  C_XF8,  C_XF9,  C_XFA,  C_XFB,  C_XFC,  C_XFD,  C_XFE,  C_XFF
 };
 
-#endif
-
 // bit manipulation fast macros
 #define BIT_TEST(mem,bit)   ((mem)&(1ULL<<(bit)))
 #define BIT_SET(mem,bit)    ((mem)|=(1ULL<<(bit)))
@@ -0,0 +1,101 @@
+
+/**
+ *  @file       HttpSrv.c
+ *
+ *  @brief      Local HTTP server shared by the modules exposing an endpoint
+ *              (metrics, firmware update).
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include "esp_system.h"
+#include "esp_log.h"
+
+#include <HttpSrv.h>
+#include <HttpSrv_prv.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static httpd_handle_t x_HttpSrv_Handle;
+// handlers registered, checked against HTTPSRV_MAX_URI_HANDLERS
+static uint8_t u8_HttpSrv_Uri_Count;
+
+static const char *TAG = "HttpSrv";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, starts the server: to be called
+ *          when the network interface has been initialized.
+ *
+ */
+void HttpSrv__Initialize(void)
+{
+  httpd_config_t x_config = HTTPD_DEFAULT_CONFIG();
+
+  x_config.server_port = HTTPSRV_PORT;
+  x_config.task_priority = HTTPSRV_TASK_PRIO;
+  x_config.stack_size = HTTPSRV_TASK_STACK;
+  x_config.max_uri_handlers = HTTPSRV_MAX_URI_HANDLERS;
+  x_config.lru_purge_enable = true;
+
+  if (httpd_start(&x_HttpSrv_Handle, &x_config) != ESP_OK)
+  {
+    x_HttpSrv_Handle = NULL;
+    ESP_LOGE(TAG, "server not started");
+    return;
+  }
+
+  ESP_LOGI(TAG, "listening on port %d", HTTPSRV_PORT);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Registers the handler of an endpoint. A handler over
+ *          HTTPSRV_MAX_URI_HANDLERS is refused by the server: the count of
+ *          the module in HttpSrv_prm.h has to be raised with each new one.
+ *
+ * @param px_uri endpoint descriptor, copied by the server
+ *
+ * @return true if the handler has been registered
+ */
+bool HttpSrv__Register_Uri(const httpd_uri_t *px_uri)
+{
+  esp_err_t e_err;
+
+  if (x_HttpSrv_Handle == NULL)
+  {
+    ESP_LOGE(TAG, "%s not registered: server not started", px_uri->uri);
+    return false;
+  }
+
+  e_err = httpd_register_uri_handler(x_HttpSrv_Handle, px_uri);
+  if (e_err == ESP_ERR_HTTPD_HANDLERS_FULL)
+  {
+    ESP_LOGE(TAG, "%s not registered: %d handlers already, over HTTPSRV_URI_HANDLERS",
+             px_uri->uri, u8_HttpSrv_Uri_Count);
+    return false;
+  }
+  else if (e_err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s not registered: %s", px_uri->uri, esp_err_to_name(e_err));
+    return false;
+  }
+
+  ++u8_HttpSrv_Uri_Count;
+  return true;
+}
@@ -0,0 +1,32 @@
+
+/**
+ *  @file       HttpSrv.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022. 
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef HTTPSRV_H
+    #define HTTPSRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdbool.h>
+#include "esp_http_server.h"
+#include <HttpSrv_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void HttpSrv__Initialize(void);
+bool HttpSrv__Register_Uri(const httpd_uri_t *px_uri);
+
+#endif
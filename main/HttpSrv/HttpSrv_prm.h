@@ -0,0 +1,50 @@
+
+/**
+ *  @file       HttpSrv_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022. 
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef HTTPSRV_PRM_H
+    #define HTTPSRV_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+// URI handlers registered by each module, to be updated with its HttpSrv__Register_Uri() calls
+#define HTTPSRV_URIS_WIFICONN       2
+#define HTTPSRV_URIS_TIMESYNC       2
+#define HTTPSRV_URIS_METRICS        1
+#define HTTPSRV_URIS_OTA            1
+#define HTTPSRV_URIS_KEYS           2
+#define HTTPSRV_URIS_STANDBY        2
+#define HTTPSRV_URIS_CLOCKFACE      2
+#define HTTPSRV_URIS_FRAMELOG       2
+#define HTTPSRV_URIS_BINLOG         1
+#define HTTPSRV_URIS_TESTPATTERN    2
+#define HTTPSRV_URIS_NOTIFY         2
+#define HTTPSRV_URIS_FLIGHTREC      1
+#define HTTPSRV_URIS_SCENE          2
+#define HTTPSRV_URIS_TICKSYNC       2
+#define HTTPSRV_URIS_ALARM          2
+#define HTTPSRV_URIS_TIMEZONE       2
+
+#define HTTPSRV_URI_HANDLERS        (HTTPSRV_URIS_WIFICONN + HTTPSRV_URIS_TIMESYNC + HTTPSRV_URIS_METRICS + \
+                                     HTTPSRV_URIS_OTA + HTTPSRV_URIS_KEYS + HTTPSRV_URIS_STANDBY + \
+                                     HTTPSRV_URIS_CLOCKFACE + HTTPSRV_URIS_FRAMELOG + HTTPSRV_URIS_BINLOG + \
+                                     HTTPSRV_URIS_TESTPATTERN + HTTPSRV_URIS_NOTIFY + HTTPSRV_URIS_FLIGHTREC + \
+                                     HTTPSRV_URIS_SCENE + HTTPSRV_URIS_TICKSYNC + HTTPSRV_URIS_ALARM + \
+                                     HTTPSRV_URIS_TIMEZONE)
+
+// max number of URI handlers, each slot costs a pointer in the server
+#define HTTPSRV_MAX_URI_HANDLERS    HTTPSRV_URI_HANDLERS
+
+#endif
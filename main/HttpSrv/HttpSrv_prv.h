@@ -0,0 +1,28 @@
+
+/**
+ *  @file       HttpSrv_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef HTTPSRV_PRV_H
+    #define HTTPSRV_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+#define HTTPSRV_PORT                CONFIG_HTTP_SERVER_PORT
+
+// below the display tasks, a long request (i.e. firmware upload) must never delay a frame
+#define HTTPSRV_TASK_PRIO           5
+#define HTTPSRV_TASK_STACK          (1024 * 6)
+
+#endif
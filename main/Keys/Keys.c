@@ -0,0 +1,619 @@
+
+/**
+ *  @file       Keys.c
+ *
+ *  @brief      Key input: the GPIO interrupts start a debounce timer per key,
+ *              there is no polling. The debounced changes, the long presses,
+ *              the repeats and the chords are queued as events and run by the
+ *              keys task through the registered handlers. The edges can also
+ *              be injected (Keys__Inject_Edge(), POST /keys), following the
+ *              same path, to measure the time from the edge to the display
+ *              change without the hardware.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include <Keys.h>
+#include <Keys_prv.h>
+#include <Holtek.h>
+#include <HttpSrv.h>
+#include <Metrics.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static KEYS_KEY_TYPE px_Keys_Key[NUM_OF_KEYS];
+
+// debounced keys held, KEYS_MASK()
+static uint8_t u8_Keys_Held;
+
+static KEYS_HANDLER_FUNC px_Keys_Handler[KEYS_MAX_HANDLERS];
+static uint8_t u8_Keys_Handlers;
+
+static QueueHandle_t x_Keys_Queue;
+static TaskHandle_t x_Keys_Task_Hdl;
+
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticQueue_t x_Keys_Queue_Buffer;
+static uint8_t pu8_Keys_Queue_Storage[KEYS_QUEUE_LEN * sizeof(KEYS_EVENT_TYPE)];
+#endif
+
+static portMUX_TYPE x_Keys_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *pc_Keys_Name[NUM_OF_KEYS] =
+{
+  [KEYS_MODE] = "mode",
+  [KEYS_UP]   = "up",
+  [KEYS_DOWN] = "down",
+};
+
+static const char *TAG = "Keys";
+
+// stack and TCB of the task, reserved at link time in static allocation mode
+SYSMON_TASK_POOL(x_Keys_Task, KEYS_TASK_STACK)
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static void KeysIsr(void *pv_arg);
+static void KeysEdge(KEYS_ENUM e_key);
+static void KeysTimerCallback(void *pv_arg);
+static bool KeysLevel(const KEYS_KEY_TYPE *px_key);
+static bool KeysGpioLevel(const KEYS_KEY_TYPE *px_key);
+static void KeysArm(KEYS_KEY_TYPE *px_key);
+static void KeysQueue(const KEYS_EVENT_TYPE *px_event);
+static void KeysTaskCallback(void *pv_args);
+static bool KeysBrightness(const KEYS_EVENT_TYPE *px_event);
+static esp_err_t KeysHttpGetHandler(httpd_req_t *px_req);
+static esp_err_t KeysHttpPostHandler(httpd_req_t *px_req);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, configures the GPIO of the keys
+ *          and starts the keys task. To be called after the display and the
+ *          HTTP server are started.
+ *
+ */
+void Keys__Initialize(void)
+{
+  const KEYS_TIMING_TYPE px_timing[NUM_OF_KEYS] = KEYS_TIMING_DEFAULT;
+  const int8_t ps8_gpio[NUM_OF_KEYS] = {KEYS_GPIO_MODE, KEYS_GPIO_UP, KEYS_GPIO_DOWN};
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = KEYS_URI,
+    .method = HTTP_GET,
+    .handler = KeysHttpGetHandler,
+    .user_ctx = NULL
+  };
+  const httpd_uri_t x_post_uri =
+  {
+    .uri = KEYS_URI,
+    .method = HTTP_POST,
+    .handler = KeysHttpPostHandler,
+    .user_ctx = NULL
+  };
+  esp_timer_create_args_t x_timer_args =
+  {
+    .callback = KeysTimerCallback,
+    .arg = NULL,
+    .name = "keys",
+  };
+  gpio_config_t x_gpio =
+  {
+    .pin_bit_mask = 0,
+    .mode = GPIO_MODE_INPUT,
+    .pull_up_en = (KEYS_LEVEL_PRESSED == 0) ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+    .pull_down_en = (KEYS_LEVEL_PRESSED == 0) ? GPIO_PULLDOWN_DISABLE : GPIO_PULLDOWN_ENABLE,
+    .intr_type = GPIO_INTR_DISABLE,
+  };
+  esp_err_t x_err;
+  uint8_t u8_key;
+
+#if CONFIG_APP_STATIC_ALLOCATION
+  x_Keys_Queue = xQueueCreateStatic(KEYS_QUEUE_LEN, sizeof(KEYS_EVENT_TYPE), pu8_Keys_Queue_Storage, &x_Keys_Queue_Buffer);
+  SysMon__Register_Module(TAG, sizeof(x_Keys_Queue_Buffer) + sizeof(pu8_Keys_Queue_Storage) +
+                               SYSMON_TASK_POOL_BYTES(x_Keys_Task));
+#else
+  x_Keys_Queue = xQueueCreate(KEYS_QUEUE_LEN, sizeof(KEYS_EVENT_TYPE));
+#endif
+  SysMon__Register_Module(TAG, sizeof(px_Keys_Key) + sizeof(px_Keys_Handler));
+
+  for (u8_key = 0; u8_key < NUM_OF_KEYS; u8_key++)
+  {
+    px_Keys_Key[u8_key].timing = px_timing[u8_key];
+    px_Keys_Key[u8_key].gpio = ps8_gpio[u8_key];
+
+    x_timer_args.arg = (void *)(uintptr_t)u8_key;
+    ESP_ERROR_CHECK(esp_timer_create(&x_timer_args, &px_Keys_Key[u8_key].timer_hdl));
+
+    if (ps8_gpio[u8_key] >= 0)
+    {
+      x_gpio.pin_bit_mask |= (1ULL << ps8_gpio[u8_key]);
+    }
+  }
+
+  SYSMON_TASK_CREATE(x_Keys_Task, KeysTaskCallback, "Keys", KEYS_TASK_STACK, NULL,
+                     KEYS_TASK_PRIO, &x_Keys_Task_Hdl, tskNO_AFFINITY);
+  SysMon__Register_Task(TAG, x_Keys_Task_Hdl, KEYS_TASK_STACK);
+
+  if (x_gpio.pin_bit_mask != 0)
+  {
+    ESP_ERROR_CHECK(gpio_config(&x_gpio));
+
+    // the ISR service can be already installed by another module
+    x_err = gpio_install_isr_service(0);
+    if ((x_err == ESP_OK) || (x_err == ESP_ERR_INVALID_STATE))
+    {
+      for (u8_key = 0; u8_key < NUM_OF_KEYS; u8_key++)
+      {
+        if (px_Keys_Key[u8_key].gpio >= 0)
+        {
+          ESP_ERROR_CHECK(gpio_isr_handler_add(px_Keys_Key[u8_key].gpio, KeysIsr, (void *)(uintptr_t)u8_key));
+          KeysArm(&px_Keys_Key[u8_key]);
+        }
+      }
+    }
+    else
+    {
+      ESP_LOGE(TAG, "GPIO interrupts not available, keys disabled");
+    }
+  }
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+  (void)HttpSrv__Register_Uri(&x_post_uri);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Adds a handler of the key events, i.e. by the module owning a
+ *          function. Handlers run in registration order until one consumes
+ *          the event; the brightness (up / down keys) runs last.
+ *
+ * @param fn_handler handler, run in the keys task: it must not block
+ *
+ * @return false if there are already KEYS_MAX_HANDLERS handlers
+ */
+bool Keys__Register_Handler(KEYS_HANDLER_FUNC fn_handler)
+{
+  bool b_done = false;
+
+  portENTER_CRITICAL(&x_Keys_Mux);
+  if (u8_Keys_Handlers < KEYS_MAX_HANDLERS)
+  {
+    px_Keys_Handler[u8_Keys_Handlers++] = fn_handler;
+    b_done = true;
+  }
+  portEXIT_CRITICAL(&x_Keys_Mux);
+
+  return b_done;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Changes the timing of a key, from the next change of the key.
+ *
+ * @param e_key     key
+ * @param px_timing new timing, debounce_ms at least 1
+ */
+void Keys__Set_Timing(KEYS_ENUM e_key, const KEYS_TIMING_TYPE *px_timing)
+{
+  if ((e_key >= NUM_OF_KEYS) || (px_timing->debounce_ms == 0))
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&x_Keys_Mux);
+  px_Keys_Key[e_key].timing = *px_timing;
+  portEXIT_CRITICAL(&x_Keys_Mux);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Injects an edge of a key, as if the GPIO had changed: it goes
+ *          through the same debounce, so a press and a release closer than
+ *          debounce_ms are filtered. The GPIO of the key is ignored until
+ *          the injected level has been debounced to a release, to no change
+ *          or to the level of the GPIO.
+ *
+ * @param e_key     key
+ * @param b_pressed new level of the key
+ */
+void Keys__Inject_Edge(KEYS_ENUM e_key, bool b_pressed)
+{
+  if (e_key >= NUM_OF_KEYS)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&x_Keys_Mux);
+  px_Keys_Key[e_key].injected = true;
+  px_Keys_Key[e_key].injected_pressed = b_pressed;
+  portEXIT_CRITICAL(&x_Keys_Mux);
+
+  KeysEdge(e_key);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Keys held, debounced.
+ *
+ * @return KEYS_MASK() of the keys held
+ */
+uint8_t Keys__Get_Held(void)
+{
+  return u8_Keys_Held;
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   GPIO interrupt of a key, the level of the next change has been
+ *          reached.
+ *
+ * @param pv_arg key
+ */
+static void KeysIsr(void *pv_arg)
+{
+  KeysEdge((KEYS_ENUM)(uintptr_t)pv_arg);
+}
+
+/**
+ * @brief   First edge of a change: the interrupt is disabled until the
+ *          level is sampled, at the end of the debounce time. Runs in ISR
+ *          context or in the task injecting the edge.
+ *
+ * @param e_key key
+ */
+static void KeysEdge(KEYS_ENUM e_key)
+{
+  KEYS_KEY_TYPE *px_key = &px_Keys_Key[e_key];
+
+  portENTER_CRITICAL_SAFE(&x_Keys_Mux);
+  if (px_key->gpio >= 0)
+  {
+    (void)gpio_intr_disable(px_key->gpio);
+  }
+
+  if (px_key->debounce == false)
+  {
+    px_key->debounce = true;
+    px_key->edge_us = esp_timer_get_time();
+
+    // the long press or the repeats of the key are stopped, they restart at the next press
+    (void)esp_timer_stop(px_key->timer_hdl);
+    (void)esp_timer_start_once(px_key->timer_hdl, (uint64_t)px_key->timing.debounce_ms * 1000);
+  }
+  portEXIT_CRITICAL_SAFE(&x_Keys_Mux);
+}
+
+/**
+ * @brief   Timer of a key, runs in the esp_timer task: at the end of the
+ *          debounce it samples the level and arms the interrupt again,
+ *          otherwise the key is still held and it is a long press or a
+ *          repeat.
+ *
+ * @param pv_arg key
+ */
+static void KeysTimerCallback(void *pv_arg)
+{
+  KEYS_ENUM e_key = (KEYS_ENUM)(uintptr_t)pv_arg;
+  KEYS_KEY_TYPE *px_key = &px_Keys_Key[e_key];
+  KEYS_EVENT_TYPE x_event;
+  bool b_event = false;
+  bool b_changed;
+  uint8_t u8_key;
+
+  x_event.key = (uint8_t)e_key;
+  x_event.count = 0;
+
+  portENTER_CRITICAL(&x_Keys_Mux);
+  if (px_key->debounce == true)
+  {
+    px_key->debounce = false;
+
+    b_changed = (KeysLevel(px_key) != px_key->pressed);
+    if (b_changed == true)
+    {
+      px_key->pressed = !px_key->pressed;
+      px_key->count = 0;
+      x_event.edge_us = px_key->edge_us;
+      b_event = true;
+
+      if (px_key->pressed == true)
+      {
+        if (u8_Keys_Held != 0)
+        {
+          // the keys already held and this one are a chord, single key timing stops
+          for (u8_key = 0; u8_key < NUM_OF_KEYS; u8_key++)
+          {
+            if (((u8_Keys_Held & KEYS_MASK(u8_key)) != 0) && (px_Keys_Key[u8_key].debounce == false))
+            {
+              (void)esp_timer_stop(px_Keys_Key[u8_key].timer_hdl);
+              px_Keys_Key[u8_key].chord = true;
+            }
+          }
+          px_key->chord = true;
+          x_event.type = KEYS_EVENT_CHORD;
+        }
+        else
+        {
+          x_event.type = KEYS_EVENT_PRESS;
+          if (px_key->timing.long_press_ms != 0)
+          {
+            (void)esp_timer_start_once(px_key->timer_hdl, (uint64_t)px_key->timing.long_press_ms * 1000);
+          }
+        }
+        u8_Keys_Held |= KEYS_MASK(e_key);
+      }
+      else
+      {
+        x_event.type = KEYS_EVENT_RELEASE;
+        u8_Keys_Held &= ~KEYS_MASK(e_key);
+        px_key->chord = false;
+
+        // back to the GPIO
+        px_key->injected = false;
+      }
+    }
+
+    // an injected edge changing nothing, or leaving the level of the GPIO, gives the key back to the GPIO
+    if ((px_key->injected == true) && ((b_changed == false) || (KeysGpioLevel(px_key) == px_key->pressed)))
+    {
+      px_key->injected = false;
+    }
+
+    KeysArm(px_key);
+  }
+  else if ((px_key->pressed == true) && (px_key->chord == false))
+  {
+    x_event.edge_us = esp_timer_get_time();
+    x_event.type = (px_key->count == 0) ? KEYS_EVENT_LONG_PRESS : KEYS_EVENT_REPEAT;
+    x_event.count = px_key->count;
+    b_event = true;
+
+    if (px_key->count < UINT8_MAX)
+    {
+      px_key->count++;
+    }
+    if (px_key->timing.repeat_ms != 0)
+    {
+      (void)esp_timer_start_once(px_key->timer_hdl, (uint64_t)px_key->timing.repeat_ms * 1000);
+    }
+  }
+  x_event.mask = u8_Keys_Held;
+  portEXIT_CRITICAL(&x_Keys_Mux);
+
+  if (b_event == true)
+  {
+    KeysQueue(&x_event);
+  }
+}
+
+/**
+ * @brief   Current level of a key, injected or read from the GPIO.
+ *
+ * @param px_key key
+ *
+ * @return true if pressed
+ */
+static bool KeysLevel(const KEYS_KEY_TYPE *px_key)
+{
+  if (px_key->injected == true)
+  {
+    return px_key->injected_pressed;
+  }
+
+  return KeysGpioLevel(px_key);
+}
+
+/**
+ * @brief   Level of the GPIO of a key.
+ *
+ * @param px_key key
+ *
+ * @return true if pressed, false for a key without GPIO
+ */
+static bool KeysGpioLevel(const KEYS_KEY_TYPE *px_key)
+{
+  return ((px_key->gpio >= 0) && (gpio_get_level(px_key->gpio) == KEYS_LEVEL_PRESSED));
+}
+
+/**
+ * @brief   Enables the interrupt of a key on the level of its next change.
+ *          Level triggered, a change while the interrupt was disabled is
+ *          not lost. Not armed while the level is injected.
+ *
+ * @param px_key key
+ */
+static void KeysArm(KEYS_KEY_TYPE *px_key)
+{
+  int s32_level;
+
+  if ((px_key->gpio < 0) || (px_key->injected == true))
+  {
+    return;
+  }
+
+  // the pressed level while released, the other one while pressed
+  s32_level = (px_key->pressed == true) ? !KEYS_LEVEL_PRESSED : KEYS_LEVEL_PRESSED;
+  (void)gpio_set_intr_type(px_key->gpio, (s32_level == 1) ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+  (void)gpio_intr_enable(px_key->gpio);
+}
+
+/**
+ * @brief   Queues an event to the keys task, without waiting.
+ *
+ * @param px_event event
+ */
+static void KeysQueue(const KEYS_EVENT_TYPE *px_event)
+{
+  if (xQueueSend(x_Keys_Queue, px_event, 0) == pdTRUE)
+  {
+    Metrics__Counter_Add(METRICS_KEYS_EVENTS, 1);
+  }
+  else
+  {
+    Metrics__Counter_Add(METRICS_KEYS_EVENTS_DROPPED, 1);
+  }
+}
+
+/**
+ * @brief   This task runs the handlers of the queued events. When one of
+ *          them consumes the event, the time from the edge to the display
+ *          change is measured.
+ *
+ * @param pv_args NULL
+ */
+static void KeysTaskCallback(void *pv_args)
+{
+  KEYS_EVENT_TYPE x_event;
+  KEYS_HANDLER_FUNC fn_handler;
+  bool b_consumed;
+  uint8_t u8_handler;
+
+  while (true)
+  {
+    if (xQueueReceive(x_Keys_Queue, &x_event, portMAX_DELAY) != pdTRUE)
+    {
+      continue;
+    }
+
+    ESP_LOGD(TAG, "%s event %u mask 0x%02x", pc_Keys_Name[x_event.key], x_event.type, x_event.mask);
+
+    b_consumed = false;
+    for (u8_handler = 0; (u8_handler < u8_Keys_Handlers) && (b_consumed == false); u8_handler++)
+    {
+      fn_handler = px_Keys_Handler[u8_handler];
+      b_consumed = fn_handler(&x_event);
+    }
+
+    if (b_consumed == false)
+    {
+      b_consumed = KeysBrightness(&x_event);
+    }
+
+    if (b_consumed == true)
+    {
+      Holtek__Trace_Input(x_event.edge_us);
+    }
+  }
+
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief   Default handler: up / down change the brightness, one step at
+ *          the press and at each repeat.
+ *
+ * @param px_event event
+ *
+ * @return true if the brightness changed
+ */
+static bool KeysBrightness(const KEYS_EVENT_TYPE *px_event)
+{
+  uint8_t u8_level = Holtek__Get_Brightness();
+
+  if ((px_event->type != KEYS_EVENT_PRESS) && (px_event->type != KEYS_EVENT_REPEAT))
+  {
+    return false;
+  }
+
+  if ((px_event->key == KEYS_UP) && (u8_level < HOLTEK_BRIGHTNESS_MAX))
+  {
+    Holtek__Set_Brightness(u8_level + 1);
+    return true;
+  }
+
+  if ((px_event->key == KEYS_DOWN) && (u8_level > 0))
+  {
+    Holtek__Set_Brightness(u8_level - 1);
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief   Keys held and last latency from an edge to the display change.
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t KeysHttpGetHandler(httpd_req_t *px_req)
+{
+  char pc_resp[48];
+
+  snprintf(pc_resp, sizeof(pc_resp), "held 0x%02x latency_us %u\n",
+           Keys__Get_Held(), (unsigned)Holtek__Get_Input_Latency());
+  httpd_resp_sendstr(px_req, pc_resp);
+
+  return ESP_OK;
+}
+
+/**
+ * @brief   Edge injection, body "<key> <press|release>", i.e. "up press".
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK if the command is valid
+ */
+static esp_err_t KeysHttpPostHandler(httpd_req_t *px_req)
+{
+  char pc_body[KEYS_HTTP_BODY_MAX + 1];
+  char *pc_edge;
+  int s32_len;
+  uint8_t u8_key;
+
+  s32_len = httpd_req_recv(px_req, pc_body, KEYS_HTTP_BODY_MAX);
+  pc_body[(s32_len > 0) ? s32_len : 0] = '\0';
+  pc_body[strcspn(pc_body, "\r\n")] = '\0';
+
+  pc_edge = strchr(pc_body, ' ');
+  if (pc_edge != NULL)
+  {
+    *pc_edge++ = '\0';
+  }
+
+  for (u8_key = 0; u8_key < NUM_OF_KEYS; u8_key++)
+  {
+    if (strcmp(pc_body, pc_Keys_Name[u8_key]) == 0)
+    {
+      break;
+    }
+  }
+
+  if ((u8_key >= NUM_OF_KEYS) || (pc_edge == NULL) ||
+      ((strcmp(pc_edge, "press") != 0) && (strcmp(pc_edge, "release") != 0)))
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "expected <mode|up|down> <press|release>");
+    return ESP_FAIL;
+  }
+
+  Keys__Inject_Edge((KEYS_ENUM)u8_key, (strcmp(pc_edge, "press") == 0));
+  httpd_resp_sendstr(px_req, "OK\n");
+
+  return ESP_OK;
+}
@@ -0,0 +1,35 @@
+
+/**
+ *  @file       Keys.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef KEYS_H
+    #define KEYS_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <Keys_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void Keys__Initialize(void);
+bool Keys__Register_Handler(KEYS_HANDLER_FUNC fn_handler);
+void Keys__Set_Timing(KEYS_ENUM e_key, const KEYS_TIMING_TYPE *px_timing);
+void Keys__Inject_Edge(KEYS_ENUM e_key, bool b_pressed);
+uint8_t Keys__Get_Held(void);
+
+#endif
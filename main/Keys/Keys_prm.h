@@ -0,0 +1,75 @@
+
+/**
+ *  @file       Keys_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef KEYS_PRM_H
+    #define KEYS_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+/*
+ * Define here the keys, the GPIO of each one is set in the configuration
+ * (-1 if not mounted, it can still be injected)
+ */
+typedef enum
+{
+  KEYS_MODE = 0,
+  KEYS_UP,
+  KEYS_DOWN,
+  NUM_OF_KEYS
+}KEYS_ENUM;
+
+#define KEYS_MASK(key)              (1u << (key))
+
+typedef enum
+{
+  KEYS_EVENT_PRESS = 0,             /*key pressed (debounced)*/
+  KEYS_EVENT_LONG_PRESS,            /*key held for long_press_ms*/
+  KEYS_EVENT_REPEAT,                /*key still held, every repeat_ms after the long press*/
+  KEYS_EVENT_RELEASE,               /*key released (debounced)*/
+  KEYS_EVENT_CHORD,                 /*a key pressed while others are held, mask: all the keys held*/
+  NUM_OF_KEYS_EVENTS
+}KEYS_EVENT_ENUM;
+
+// timing of a key, in milliseconds
+typedef struct
+{
+  uint16_t debounce_ms;             // stable level after the first edge
+  uint16_t long_press_ms;           // press -> long press, 0 for none
+  uint16_t repeat_ms;               // long press -> repeat period, 0 for none
+}KEYS_TIMING_TYPE;
+
+typedef struct
+{
+  int64_t edge_us;                  // first edge of the change, esp_timer_get_time()
+  uint8_t type;                     // KEYS_EVENT_ENUM
+  uint8_t key;                      // KEYS_ENUM
+  uint8_t mask;                     // keys held after the event, KEYS_MASK()
+  uint8_t count;                    // repeats since the long press
+}KEYS_EVENT_TYPE;
+
+/*
+ * Handler of the key events, run in the keys task. It returns true if it
+ * consumed the event: the following handlers are not run and the time to the
+ * display change is measured.
+ */
+typedef bool (*KEYS_HANDLER_FUNC)(const KEYS_EVENT_TYPE *px_event);
+
+// entry point of the edge injection: GET returns the keys held and the last latency, POST "<key> <press|release>"
+#define KEYS_URI                    "/keys"
+
+#endif
@@ -0,0 +1,81 @@
+
+/**
+ *  @file       Keys_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef KEYS_PRV_H
+    #define KEYS_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include "esp_timer.h"
+#include <Keys_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// GPIO of the keys, -1 if not mounted
+#define KEYS_GPIO_MODE              CONFIG_KEYS_GPIO_MODE
+#define KEYS_GPIO_UP                CONFIG_KEYS_GPIO_UP
+#define KEYS_GPIO_DOWN              CONFIG_KEYS_GPIO_DOWN
+
+// level of a pressed key, the other one is pulled
+#if CONFIG_KEYS_ACTIVE_LOW
+#define KEYS_LEVEL_PRESSED          0
+#else
+#define KEYS_LEVEL_PRESSED          1
+#endif
+
+#define KEYS_DEBOUNCE_MS            CONFIG_KEYS_DEBOUNCE_MS
+#define KEYS_LONG_PRESS_MS          CONFIG_KEYS_LONG_PRESS_MS
+#define KEYS_REPEAT_MS              CONFIG_KEYS_REPEAT_MS
+
+// default timing of each key, changed at run time by Keys__Set_Timing()
+#define KEYS_TIMING_DEFAULT \
+{ \
+  [KEYS_MODE] = {KEYS_DEBOUNCE_MS, KEYS_LONG_PRESS_MS, 0}, \
+  [KEYS_UP]   = {KEYS_DEBOUNCE_MS, KEYS_LONG_PRESS_MS, KEYS_REPEAT_MS}, \
+  [KEYS_DOWN] = {KEYS_DEBOUNCE_MS, KEYS_LONG_PRESS_MS, KEYS_REPEAT_MS}, \
+}
+
+// events waiting for the keys task
+#define KEYS_QUEUE_LEN              16
+
+#define KEYS_MAX_HANDLERS           4
+
+#define KEYS_TASK_STACK             (1024 * 3)
+// above the network and the settings, below the display tasks
+#define KEYS_TASK_PRIO              10
+
+// longest body of the injection command
+#define KEYS_HTTP_BODY_MAX          16
+
+/*
+ * Debounce state of a key. The interrupt is level triggered on the level of
+ * the next change: at the first edge it is disabled and the one-shot timer
+ * is started, when it expires the level is sampled and the interrupt is
+ * armed again. The same timer then runs the long press and the repeats.
+ */
+typedef struct
+{
+  esp_timer_handle_t timer_hdl;
+  KEYS_TIMING_TYPE timing;
+  int64_t edge_us;                  // first edge of the change being debounced
+  int8_t gpio;                      // -1 if not mounted
+  bool debounce;                    // the timer is running the debounce
+  bool pressed;                     // debounced state
+  bool chord;                       // held as part of a chord: no long press and repeat
+  bool injected;                    // the level comes from Keys__Inject_Edge()
+  bool injected_pressed;
+  uint8_t count;                    // long press and repeats since the press
+}KEYS_KEY_TYPE;
+
+#endif
@@ -0,0 +1,450 @@
+
+/**
+ *  @file       Metrics.c
+ *
+ *  @brief      Runtime counters and histograms of display and network, exported
+ *              on a local HTTP endpoint in Prometheus text format.
+ *              Writers only do a relaxed atomic add on the data of their own
+ *              core: no lock is shared with the refresh path, the scrape sums
+ *              the per-core copies.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp_log.h"
+
+#include <Metrics.h>
+#include <Metrics_prv.h>
+#include <Holtek.h>
+#include <WiFiConn.h>
+#include <TimeSync.h>
+#include <FlightRec.h>
+#include <SysMon.h>
+#include <HttpSrv.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static METRICS_CORE_TYPE px_Metrics_Core[portNUM_PROCESSORS];
+
+// scrape side, used by the HTTP server task only
+static METRICS_ACCUMULATOR_TYPE px_Metrics_Counter_Total[NUM_OF_METRICS_COUNTERS];
+static METRICS_HISTOGRAM_TOTAL_TYPE px_Metrics_Histogram_Total[NUM_OF_METRICS_HISTOGRAMS];
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+static TaskStatus_t px_Metrics_Task_Status[METRICS_MAX_TASKS];
+static METRICS_TASK_RUN_TIME_TYPE px_Metrics_Task_Prev[METRICS_MAX_TASKS];
+static uint8_t u8_Metrics_Task_Prev_Num;
+static uint32_t u32_Metrics_Run_Time_Prev;
+#endif
+
+static char pc_Metrics_Chunk[METRICS_HTTP_CHUNK_BYTES];
+static uint32_t u32_Metrics_Chunk_Len;
+
+static const char *TAG = "Metrics";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static uint64_t MetricsAccumulate(METRICS_ACCUMULATOR_TYPE *px_acc, uint32_t u32_raw);
+static void MetricsOut(httpd_req_t *px_req, const char *pc_format, ...) __attribute__((format(printf, 2, 3)));
+static void MetricsFlush(httpd_req_t *px_req);
+static void MetricsWriteCounters(httpd_req_t *px_req);
+static void MetricsWriteHistograms(httpd_req_t *px_req);
+static void MetricsWriteGauges(httpd_req_t *px_req);
+static void MetricsWriteTasks(httpd_req_t *px_req);
+static esp_err_t MetricsHttpGetHandler(httpd_req_t *px_req);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, registers the endpoint: to be called
+ *          after the HTTP server has been started.
+ *
+ */
+void Metrics__Initialize(void)
+{
+  // not cleared here: the other init steps run concurrently and may already have counted
+  SysMon__Register_Module(TAG, sizeof(px_Metrics_Core) + sizeof(px_Metrics_Counter_Total) +
+                               sizeof(px_Metrics_Histogram_Total) + sizeof(pc_Metrics_Chunk));
+
+#if METRICS_HTTP_ENABLE
+  const httpd_uri_t x_metrics_uri =
+  {
+    .uri = METRICS_HTTP_URI,
+    .method = HTTP_GET,
+    .handler = MetricsHttpGetHandler,
+    .user_ctx = NULL
+  };
+  (void)HttpSrv__Register_Uri(&x_metrics_uri);
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Adds a value to a counter. Lock-free, can be called from any task
+ *          at any rate.
+ *
+ * @param e_counter counter to be incremented
+ * @param u32_value increment
+ */
+void Metrics__Counter_Add(METRICS_COUNTER_ENUM e_counter, uint32_t u32_value)
+{
+  if (e_counter >= NUM_OF_METRICS_COUNTERS)
+  {
+    return;
+  }
+
+  __atomic_fetch_add(&px_Metrics_Core[xPortGetCoreID()].counter[e_counter], u32_value, __ATOMIC_RELAXED);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Records a sample in a histogram. Lock-free, can be called from any
+ *          task at any rate.
+ *
+ * @param e_histogram histogram to be updated
+ * @param u32_value   sample
+ */
+void Metrics__Histogram_Observe(METRICS_HISTOGRAM_ENUM e_histogram, uint32_t u32_value)
+{
+  const METRICS_HISTOGRAM_DESC_TYPE *px_desc;
+  METRICS_HISTOGRAM_DATA_TYPE *px_data;
+  uint8_t u8_bucket;
+
+  if (e_histogram >= NUM_OF_METRICS_HISTOGRAMS)
+  {
+    return;
+  }
+
+  px_desc = &METRICS_Histogram_Desc[e_histogram];
+  px_data = &px_Metrics_Core[xPortGetCoreID()].histogram[e_histogram];
+
+  // values above the highest bound fall in the +Inf bucket (index num_of_buckets)
+  for (u8_bucket = 0; u8_bucket < px_desc->num_of_buckets; ++u8_bucket)
+  {
+    if (u32_value <= px_desc->bound[u8_bucket])
+    {
+      break;
+    }
+  }
+
+  __atomic_fetch_add(&px_data->bucket[u8_bucket], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&px_data->sum, u32_value, __ATOMIC_RELAXED);
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Extends a wrapping 32-bit counter to 64 bit.
+ *
+ * @param px_acc  accumulator of the counter
+ * @param u32_raw current raw value
+ *
+ * @return 64-bit value of the counter
+ */
+static uint64_t MetricsAccumulate(METRICS_ACCUMULATOR_TYPE *px_acc, uint32_t u32_raw)
+{
+  px_acc->total += (uint32_t)(u32_raw - px_acc->last);
+  px_acc->last = u32_raw;
+
+  return px_acc->total;
+}
+
+/**
+ * @brief   Appends a formatted line to the response, the chunk is sent when
+ *          the next line may not fit.
+ */
+static void MetricsOut(httpd_req_t *px_req, const char *pc_format, ...)
+{
+  va_list x_args;
+  int s32_len;
+
+  if ((u32_Metrics_Chunk_Len + METRICS_HTTP_LINE_MAX_BYTES) > METRICS_HTTP_CHUNK_BYTES)
+  {
+    MetricsFlush(px_req);
+  }
+
+  va_start(x_args, pc_format);
+  s32_len = vsnprintf(&pc_Metrics_Chunk[u32_Metrics_Chunk_Len], METRICS_HTTP_LINE_MAX_BYTES, pc_format, x_args);
+  va_end(x_args);
+
+  if (s32_len > 0)
+  {
+    // truncated lines are dropped, a partial line would break the parser
+    u32_Metrics_Chunk_Len += (s32_len < METRICS_HTTP_LINE_MAX_BYTES) ? (uint32_t)s32_len : 0;
+  }
+}
+
+/**
+ * @brief   Sends the pending part of the response.
+ */
+static void MetricsFlush(httpd_req_t *px_req)
+{
+  if (u32_Metrics_Chunk_Len != 0)
+  {
+    httpd_resp_send_chunk(px_req, pc_Metrics_Chunk, u32_Metrics_Chunk_Len);
+    u32_Metrics_Chunk_Len = 0;
+  }
+}
+
+/**
+ * @brief   Writes the counters, summing the copies of all cores.
+ */
+static void MetricsWriteCounters(httpd_req_t *px_req)
+{
+  uint32_t u32_raw;
+  uint8_t u8_core;
+  uint8_t u8_idx;
+
+  for (u8_idx = 0; u8_idx < NUM_OF_METRICS_COUNTERS; ++u8_idx)
+  {
+    u32_raw = 0;
+    for (u8_core = 0; u8_core < portNUM_PROCESSORS; ++u8_core)
+    {
+      u32_raw += __atomic_load_n(&px_Metrics_Core[u8_core].counter[u8_idx], __ATOMIC_RELAXED);
+    }
+
+    MetricsOut(px_req, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+               METRICS_Counter_Desc[u8_idx].name, METRICS_Counter_Desc[u8_idx].help,
+               METRICS_Counter_Desc[u8_idx].name,
+               METRICS_Counter_Desc[u8_idx].name,
+               MetricsAccumulate(&px_Metrics_Counter_Total[u8_idx], u32_raw));
+  }
+}
+
+/**
+ * @brief   Writes the histograms with cumulative buckets, as expected by Prometheus.
+ */
+static void MetricsWriteHistograms(httpd_req_t *px_req)
+{
+  const METRICS_HISTOGRAM_DESC_TYPE *px_desc;
+  METRICS_HISTOGRAM_TOTAL_TYPE *px_total;
+  uint32_t u32_raw;
+  uint64_t u64_cumulative;
+  uint8_t u8_core;
+  uint8_t u8_bucket;
+  uint8_t u8_idx;
+
+  for (u8_idx = 0; u8_idx < NUM_OF_METRICS_HISTOGRAMS; ++u8_idx)
+  {
+    px_desc = &METRICS_Histogram_Desc[u8_idx];
+    px_total = &px_Metrics_Histogram_Total[u8_idx];
+    u64_cumulative = 0;
+
+    MetricsOut(px_req, "# HELP %s %s\n# TYPE %s histogram\n", px_desc->name, px_desc->help, px_desc->name);
+
+    for (u8_bucket = 0; u8_bucket <= px_desc->num_of_buckets; ++u8_bucket)
+    {
+      u32_raw = 0;
+      for (u8_core = 0; u8_core < portNUM_PROCESSORS; ++u8_core)
+      {
+        u32_raw += __atomic_load_n(&px_Metrics_Core[u8_core].histogram[u8_idx].bucket[u8_bucket], __ATOMIC_RELAXED);
+      }
+      u64_cumulative += MetricsAccumulate(&px_total->bucket[u8_bucket], u32_raw);
+
+      if (u8_bucket < px_desc->num_of_buckets)
+      {
+        MetricsOut(px_req, "%s_bucket{le=\"%u\"} %llu\n", px_desc->name, px_desc->bound[u8_bucket], u64_cumulative);
+      }
+      else
+      {
+        MetricsOut(px_req, "%s_bucket{le=\"+Inf\"} %llu\n", px_desc->name, u64_cumulative);
+      }
+    }
+
+    u32_raw = 0;
+    for (u8_core = 0; u8_core < portNUM_PROCESSORS; ++u8_core)
+    {
+      u32_raw += __atomic_load_n(&px_Metrics_Core[u8_core].histogram[u8_idx].sum, __ATOMIC_RELAXED);
+    }
+
+    MetricsOut(px_req, "%s_sum %llu\n%s_count %llu\n",
+               px_desc->name, MetricsAccumulate(&px_total->sum, u32_raw),
+               px_desc->name, u64_cumulative);
+  }
+}
+
+/**
+ * @brief   Writes the values sampled at scrape time: frame clock, Wi-Fi, heap
+ *          and resets.
+ */
+static void MetricsWriteGauges(httpd_req_t *px_req)
+{
+  FLIGHTREC_BOOT_INFO_TYPE x_boot_info;
+  HOLTEK_FRAME_STATS_TYPE x_frame_stats;
+  HOLTEK_GRAY_STATS_TYPE x_gray_stats;
+  TIMESYNC_STATS_TYPE x_sync_stats;
+  wifi_ap_record_t x_ap_info;
+  uint8_t u8_reason;
+
+  Holtek__Get_Frame_Stats(&x_frame_stats);
+  Holtek__Get_Gray_Stats(&x_gray_stats);
+
+  MetricsOut(px_req, "# HELP clock_display_frame_period_us Nominal frame period of the display.\n"
+                     "# TYPE clock_display_frame_period_us gauge\n"
+                     "clock_display_frame_period_us %u\n", x_frame_stats.period_us);
+  MetricsOut(px_req, "# HELP clock_display_frame_jitter_avg_us Mean frame period deviation over the last report window.\n"
+                     "# TYPE clock_display_frame_jitter_avg_us gauge\n"
+                     "clock_display_frame_jitter_avg_us %u\n", x_frame_stats.jitter_avg_us);
+  MetricsOut(px_req, "# HELP clock_display_gray_refresh_hz Grayscale sub-frame cycles per second, 0 when not streamed.\n"
+                     "# TYPE clock_display_gray_refresh_hz gauge\n"
+                     "clock_display_gray_refresh_hz %u\n", x_gray_stats.refresh_hz);
+  MetricsOut(px_req, "# HELP clock_display_gray_flicker_margin_pct Grayscale refresh rate above the flicker threshold.\n"
+                     "# TYPE clock_display_gray_flicker_margin_pct gauge\n"
+                     "clock_display_gray_flicker_margin_pct %d\n", x_gray_stats.flicker_margin_pct);
+
+  MetricsOut(px_req, "# HELP clock_wifi_retry Connection retries since the last successful connection.\n"
+                     "# TYPE clock_wifi_retry gauge\n"
+                     "clock_wifi_retry %d\n", WiFiConn__Get_Retry_Num());
+
+  if (esp_wifi_sta_get_ap_info(&x_ap_info) == ESP_OK)
+  {
+    MetricsOut(px_req, "# HELP clock_wifi_rssi_dbm RSSI of the access point.\n"
+                       "# TYPE clock_wifi_rssi_dbm gauge\n"
+                       "clock_wifi_rssi_dbm %d\n", x_ap_info.rssi);
+  }
+
+  TimeSync__Get_Stats(&x_sync_stats);
+  MetricsOut(px_req, "# HELP clock_timesync_last_offset_us Clock offset measured by the last network time sync.\n"
+                     "# TYPE clock_timesync_last_offset_us gauge\n"
+                     "clock_timesync_last_offset_us %d\n", x_sync_stats.offset_us);
+  MetricsOut(px_req, "# HELP clock_timesync_jitter_us RMS deviation of the samples of the last network time sync.\n"
+                     "# TYPE clock_timesync_jitter_us gauge\n"
+                     "clock_timesync_jitter_us %u\n", x_sync_stats.jitter_us);
+  MetricsOut(px_req, "# HELP clock_timesync_drift_ppb Crystal drift compensated between the network time syncs.\n"
+                     "# TYPE clock_timesync_drift_ppb gauge\n"
+                     "clock_timesync_drift_ppb %d\n", x_sync_stats.drift_ppb);
+
+  MetricsOut(px_req, "# HELP clock_heap_free_bytes Free heap.\n"
+                     "# TYPE clock_heap_free_bytes gauge\n"
+                     "clock_heap_free_bytes %u\n", (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+  MetricsOut(px_req, "# HELP clock_heap_min_free_bytes Lowest free heap since boot.\n"
+                     "# TYPE clock_heap_min_free_bytes gauge\n"
+                     "clock_heap_min_free_bytes %u\n", (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT));
+  MetricsOut(px_req, "# HELP clock_heap_largest_free_block_bytes Largest free heap block.\n"
+                     "# TYPE clock_heap_largest_free_block_bytes gauge\n"
+                     "clock_heap_largest_free_block_bytes %u\n", (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+  MetricsOut(px_req, "# HELP clock_uptime_seconds Time since boot.\n"
+                     "# TYPE clock_uptime_seconds gauge\n"
+                     "clock_uptime_seconds %llu\n", (uint64_t)(esp_timer_get_time() / 1000000LL));
+
+  FlightRec__Get_Boot_Info(&x_boot_info);
+  MetricsOut(px_req, "# HELP clock_reset_reason Reason of the last reset.\n"
+                     "# TYPE clock_reset_reason gauge\n"
+                     "clock_reset_reason{reason=\"%s\"} 1\n", FlightRec__Reset_Name(x_boot_info.reset_reason));
+  MetricsOut(px_req, "# HELP clock_boots Boots since power-on.\n"
+                     "# TYPE clock_boots gauge\n"
+                     "clock_boots %u\n", x_boot_info.boots);
+  MetricsOut(px_req, "# HELP clock_resets_total Resets since power-on, by reason.\n"
+                     "# TYPE clock_resets_total counter\n");
+  for (u8_reason = 0; u8_reason < FLIGHTREC_RESET_REASONS; ++u8_reason)
+  {
+    if (x_boot_info.resets[u8_reason] != 0)
+    {
+      MetricsOut(px_req, "clock_resets_total{reason=\"%s\"} %u\n", FlightRec__Reset_Name(u8_reason),
+                 x_boot_info.resets[u8_reason]);
+    }
+  }
+}
+
+/**
+ * @brief   Writes the CPU usage of each task since the previous scrape and its
+ *          stack high-water mark. Needs the FreeRTOS run time statistics.
+ */
+static void MetricsWriteTasks(httpd_req_t *px_req)
+{
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  uint32_t u32_run_time;
+  uint32_t u32_elapsed;
+  uint32_t u32_task_prev;
+  UBaseType_t x_num;
+  UBaseType_t x_idx;
+  uint8_t u8_prev;
+
+  x_num = uxTaskGetSystemState(px_Metrics_Task_Status, METRICS_MAX_TASKS, &u32_run_time);
+  if (x_num == 0)
+  {
+    return;
+  }
+
+  // run time counters wrap, differences are computed modulo 2^32
+  u32_elapsed = (uint32_t)(u32_run_time - u32_Metrics_Run_Time_Prev) * portNUM_PROCESSORS;
+
+  MetricsOut(px_req, "# HELP clock_task_cpu_ratio CPU time used by the task since the previous scrape.\n"
+                     "# TYPE clock_task_cpu_ratio gauge\n");
+  for (x_idx = 0; x_idx < x_num; ++x_idx)
+  {
+    u32_task_prev = 0;
+    for (u8_prev = 0; u8_prev < u8_Metrics_Task_Prev_Num; ++u8_prev)
+    {
+      if (px_Metrics_Task_Prev[u8_prev].task_hdl == px_Metrics_Task_Status[x_idx].xHandle)
+      {
+        u32_task_prev = px_Metrics_Task_Prev[u8_prev].run_time;
+        break;
+      }
+    }
+
+    MetricsOut(px_req, "clock_task_cpu_ratio{task=\"%s\"} %.4f\n", px_Metrics_Task_Status[x_idx].pcTaskName,
+               (u32_elapsed != 0) ? ((double)(uint32_t)(px_Metrics_Task_Status[x_idx].ulRunTimeCounter - u32_task_prev) / u32_elapsed) : 0.0);
+  }
+
+  MetricsOut(px_req, "# HELP clock_task_stack_free_min_bytes Lowest free stack of the task since its creation.\n"
+                     "# TYPE clock_task_stack_free_min_bytes gauge\n");
+  for (x_idx = 0; x_idx < x_num; ++x_idx)
+  {
+    MetricsOut(px_req, "clock_task_stack_free_min_bytes{task=\"%s\"} %u\n", px_Metrics_Task_Status[x_idx].pcTaskName,
+               (uint32_t)px_Metrics_Task_Status[x_idx].usStackHighWaterMark);
+
+    px_Metrics_Task_Prev[x_idx].task_hdl = px_Metrics_Task_Status[x_idx].xHandle;
+    px_Metrics_Task_Prev[x_idx].run_time = px_Metrics_Task_Status[x_idx].ulRunTimeCounter;
+  }
+
+  u8_Metrics_Task_Prev_Num = (uint8_t)x_num;
+  u32_Metrics_Run_Time_Prev = u32_run_time;
+#endif
+}
+
+/**
+ * @brief   GET /metrics handler, runs in the HTTP server task.
+ *
+ * @param px_req HTTP request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t MetricsHttpGetHandler(httpd_req_t *px_req)
+{
+  httpd_resp_set_type(px_req, METRICS_HTTP_CONTENT_TYPE);
+
+  u32_Metrics_Chunk_Len = 0;
+
+  MetricsWriteCounters(px_req);
+  MetricsWriteHistograms(px_req);
+  MetricsWriteGauges(px_req);
+  MetricsWriteTasks(px_req);
+
+  MetricsFlush(px_req);
+  httpd_resp_send_chunk(px_req, NULL, 0);
+
+  return ESP_OK;
+}
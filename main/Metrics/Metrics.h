@@ -0,0 +1,32 @@
+
+/**
+ *  @file       Metrics.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022. 
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef METRICS_H
+    #define METRICS_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <Metrics_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void Metrics__Initialize(void);
+void Metrics__Counter_Add(METRICS_COUNTER_ENUM e_counter, uint32_t u32_value);
+void Metrics__Histogram_Observe(METRICS_HISTOGRAM_ENUM e_histogram, uint32_t u32_value);
+
+#endif
@@ -0,0 +1,112 @@
+
+/**
+ *  @file       Metrics_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022. 
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef METRICS_PRM_H
+    #define METRICS_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+/*
+ * Define here the monotonic counters, name and help of each one
+ * are in METRICS_Counter_Desc[]
+ */
+typedef enum
+{
+  METRICS_HOLTEK_FRAMES_COMPOSED = 0,
+  METRICS_HOLTEK_FRAMES_SENT,
+  METRICS_HOLTEK_GRAY_SUBFRAMES,
+  METRICS_HOLTEK_FRAMES_DROPPED,
+  METRICS_HOLTEK_FRAMES_SKIPPED,
+  METRICS_HOLTEK_FRAMES_MISSED,
+  METRICS_HOLTEK_SPI_TX_BYTES,
+  METRICS_HOLTEK_REINIT,
+  METRICS_HOLTEK_SPI_INIT_ERRORS,
+  METRICS_HOLTEK_SPI_QUEUE_ERRORS,
+  METRICS_HOLTEK_SPI_TIMEOUTS,
+  METRICS_HOLTEK_SPI_DETACH_ERRORS,
+  METRICS_HOLTEK_SPI_RETRIES,
+  METRICS_HOLTEK_SPI_BUS_RESETS,
+  METRICS_HOLTEK_SPI_FULL_REINITS,
+  METRICS_WIFI_DISCONNECT,
+  METRICS_REMOTE_RX,
+  METRICS_REMOTE_STALE,
+  METRICS_REMOTE_INVALID,
+  METRICS_SETTINGS_CHANGES,
+  METRICS_SETTINGS_WRITES,
+  METRICS_SETTINGS_WRITES_AVOIDED,
+  METRICS_SETTINGS_WRITE_ERRORS,
+  METRICS_ALARM_FIRED,
+  METRICS_ALARM_WAKEUPS,
+  METRICS_STANDBY_ENTRIES,
+  METRICS_STANDBY_SECONDS,
+  METRICS_KEYS_EVENTS,
+  METRICS_KEYS_EVENTS_DROPPED,
+  METRICS_SPIBUS_GRANTS,
+  METRICS_SPIBUS_CONTENDED,
+  METRICS_SPIBUS_TIMEOUTS,
+  METRICS_SPIBUS_DEADLINE_MISSES,
+  METRICS_CLOCKFACE_COMMITS,
+  METRICS_CLOCKFACE_REFRESHES,
+  METRICS_FRAMELOG_RECORDS,
+  METRICS_FRAMELOG_BYTES,
+  METRICS_FRAMELOG_LOST,
+  METRICS_WIFI_ROAMS,
+  METRICS_TIMESYNC_SYNCS,
+  METRICS_TIMESYNC_FAILURES,
+  METRICS_TIMESYNC_STEPS,
+  METRICS_BINLOG_RECORDS,
+  METRICS_BINLOG_SUPPRESSED,
+  METRICS_BINLOG_LOST,
+  METRICS_NOTIFY_POSTED,
+  METRICS_NOTIFY_MERGED,
+  METRICS_NOTIFY_EVICTED,
+  METRICS_NOTIFY_DROPPED,
+  METRICS_NOTIFY_EXPIRED,
+  METRICS_SCENE_LOADS,
+  METRICS_SCENE_REJECTED,
+  METRICS_SCENE_ABORTED,
+  METRICS_TICKSYNC_BEACONS,
+  METRICS_TICKSYNC_SAMPLES,
+  METRICS_TICKSYNC_DROPPED,
+  METRICS_TICKSYNC_MASTERS,
+  NUM_OF_METRICS_COUNTERS
+}METRICS_COUNTER_ENUM;
+
+/*
+ * Define here the histograms, buckets bounds of each one
+ * are in METRICS_Histogram_Desc[]
+ */
+typedef enum
+{
+  METRICS_HOLTEK_FRAME_LATENCY_US = 0,    /*composer push -> SPI transaction completed*/
+  METRICS_HOLTEK_FRAME_JITTER_US,         /*absolute deviation of the frame period from the nominal one*/
+  METRICS_HOLTEK_INPUT_LATENCY_US,        /*input event -> display change transferred*/
+  METRICS_SPIBUS_WAIT_US,                 /*shared SPI bus request -> grant, contended requests*/
+  METRICS_WIFI_RECONNECT_MS,              /*disconnection or roam -> IP address*/
+  METRICS_TIMESYNC_OFFSET_US,             /*absolute offset measured by a time sync*/
+  METRICS_SCENE_FRAME_US,                 /*interpreter time of a scene frame*/
+  METRICS_TICKSYNC_DELAY_US,              /*round trip of a time exchange with the master*/
+  METRICS_TICKSYNC_CORRECTION_US,         /*absolute change of the shared time of a follower*/
+  NUM_OF_METRICS_HISTOGRAMS
+}METRICS_HISTOGRAM_ENUM;
+
+// max number of buckets of a histogram, +Inf bucket excluded
+#define METRICS_HISTOGRAM_MAX_BUCKETS   8
+
+// max number of tasks reported in the CPU usage
+#define METRICS_MAX_TASKS               24
+
+#endif
@@ -0,0 +1,177 @@
+
+/**
+ *  @file       Metrics_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef METRICS_PRV_H
+    #define METRICS_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+#define METRICS_HTTP_ENABLE         CONFIG_METRICS_HTTP_ENABLE
+
+#define METRICS_HTTP_URI            "/metrics"
+#define METRICS_HTTP_CONTENT_TYPE   "text/plain; version=0.0.4"
+
+// response is sent in chunks of this size, a chunk is flushed before a record (HELP, TYPE and value) may not fit
+#define METRICS_HTTP_CHUNK_BYTES    1024
+#define METRICS_HTTP_LINE_MAX_BYTES 384
+
+typedef struct
+{
+  const char *name;
+  const char *help;
+}METRICS_DESC_TYPE;
+
+typedef struct
+{
+  const char *name;
+  const char *help;
+  uint8_t num_of_buckets;
+  uint32_t bound[METRICS_HISTOGRAM_MAX_BUCKETS];   // upper bounds (le), ascending
+}METRICS_HISTOGRAM_DESC_TYPE;
+
+/*
+ * Raw data of a histogram: the last bucket counts the values above
+ * the highest bound (+Inf)
+ */
+typedef struct
+{
+  uint32_t bucket[METRICS_HISTOGRAM_MAX_BUCKETS + 1];
+  uint32_t sum;
+}METRICS_HISTOGRAM_DATA_TYPE;
+
+/*
+ * Counters written by the tasks running on one core. Each core has its own
+ * copy, aligned on a cache line, so writers on different cores never share
+ * data and the increment is a single relaxed atomic add.
+ */
+typedef struct
+{
+  uint32_t counter[NUM_OF_METRICS_COUNTERS];
+  METRICS_HISTOGRAM_DATA_TYPE histogram[NUM_OF_METRICS_HISTOGRAMS];
+} __attribute__((aligned(32))) METRICS_CORE_TYPE;
+
+/*
+ * 32-bit raw counters wrap: at each scrape the difference from the previous
+ * scrape is accumulated in 64 bit, so the exported values never go back as
+ * long as the endpoint is scraped at least once per wrap period (hours).
+ */
+typedef struct
+{
+  uint32_t last;
+  uint64_t total;
+}METRICS_ACCUMULATOR_TYPE;
+
+typedef struct
+{
+  METRICS_ACCUMULATOR_TYPE bucket[METRICS_HISTOGRAM_MAX_BUCKETS + 1];
+  METRICS_ACCUMULATOR_TYPE sum;
+}METRICS_HISTOGRAM_TOTAL_TYPE;
+
+// run time counter of a task at the previous scrape, used to compute the CPU usage
+typedef struct
+{
+  TaskHandle_t task_hdl;
+  uint32_t run_time;
+}METRICS_TASK_RUN_TIME_TYPE;
+
+static const METRICS_DESC_TYPE METRICS_Counter_Desc[NUM_OF_METRICS_COUNTERS] =
+{
+  [METRICS_HOLTEK_FRAMES_COMPOSED] = {"clock_display_frames_composed_total", "Frames built by the display composer."},
+  [METRICS_HOLTEK_FRAMES_SENT]     = {"clock_display_frames_sent_total",     "Frames written to the Holtek RAM."},
+  [METRICS_HOLTEK_GRAY_SUBFRAMES]  = {"clock_display_gray_subframes_total",  "Grayscale sub-frames written to the Holtek RAM."},
+  [METRICS_HOLTEK_FRAMES_DROPPED]  = {"clock_display_frames_dropped_total",  "Frames dropped because the frame ring was full."},
+  [METRICS_HOLTEK_FRAMES_SKIPPED]  = {"clock_display_frames_skipped_total",  "Frames superseded by a newer one before being sent."},
+  [METRICS_HOLTEK_FRAMES_MISSED]   = {"clock_display_frames_missed_total",   "Frame clock deadlines lost because the composer was late."},
+  [METRICS_HOLTEK_SPI_TX_BYTES]    = {"clock_display_spi_tx_bytes_total",    "Bytes clocked out on the display SPI bus."},
+  [METRICS_HOLTEK_REINIT]          = {"clock_display_reinit_total",          "Periodic re-configurations of the Holtek driver."},
+  [METRICS_HOLTEK_SPI_INIT_ERRORS] = {"clock_display_spi_init_errors_total", "SPI bus initializations or device attaches failed."},
+  [METRICS_HOLTEK_SPI_QUEUE_ERRORS]= {"clock_display_spi_queue_errors_total", "SPI transactions not queued within the deadline."},
+  [METRICS_HOLTEK_SPI_TIMEOUTS]    = {"clock_display_spi_timeouts_total",    "SPI transactions not completed within the deadline."},
+  [METRICS_HOLTEK_SPI_DETACH_ERRORS]= {"clock_display_spi_detach_errors_total", "SPI device detaches refused, a transaction was still on the bus."},
+  [METRICS_HOLTEK_SPI_RETRIES]     = {"clock_display_spi_retries_total",     "Display bus steps retried after a failure."},
+  [METRICS_HOLTEK_SPI_BUS_RESETS]  = {"clock_display_spi_bus_resets_total",  "Display device detached and attached again after repeated failures."},
+  [METRICS_HOLTEK_SPI_FULL_REINITS]= {"clock_display_spi_full_reinits_total", "SPI bus freed and initialized again after repeated bus resets."},
+  [METRICS_WIFI_DISCONNECT]        = {"clock_wifi_disconnect_total",         "Wi-Fi station disconnections."},
+  [METRICS_REMOTE_RX]              = {"clock_remote_rx_total",               "Packets received on the remote display port."},
+  [METRICS_REMOTE_STALE]           = {"clock_remote_stale_total",            "Remote display packets dropped because of an old sequence number."},
+  [METRICS_REMOTE_INVALID]         = {"clock_remote_invalid_total",          "Remote display packets dropped because malformed."},
+  [METRICS_SETTINGS_CHANGES]       = {"clock_settings_changes_total",        "Settings changed."},
+  [METRICS_SETTINGS_WRITES]        = {"clock_settings_writes_total",         "Settings written to flash."},
+  [METRICS_SETTINGS_WRITES_AVOIDED]= {"clock_settings_writes_avoided_total", "Flash writes saved by coalescing changes and skipping unchanged values."},
+  [METRICS_SETTINGS_WRITE_ERRORS]  = {"clock_settings_write_errors_total",   "Settings writes failed, retried later."},
+  [METRICS_ALARM_FIRED]            = {"clock_alarm_fired_total",             "Alarm and schedule entries run."},
+  [METRICS_ALARM_WAKEUPS]          = {"clock_alarm_wakeups_total",           "Alarm timer expirations, at most one per distinct event time."},
+  [METRICS_STANDBY_ENTRIES]        = {"clock_standby_entries_total",         "Display standby entries."},
+  [METRICS_STANDBY_SECONDS]        = {"clock_standby_seconds_total",         "Seconds spent in display standby."},
+  [METRICS_KEYS_EVENTS]            = {"clock_keys_events_total",             "Key events queued (press, long press, repeat, release, chord)."},
+  [METRICS_KEYS_EVENTS_DROPPED]    = {"clock_keys_events_dropped_total",     "Key events lost because the queue was full."},
+  [METRICS_SPIBUS_GRANTS]          = {"clock_spibus_grants_total",           "Shared SPI bus grants to the clients."},
+  [METRICS_SPIBUS_CONTENDED]       = {"clock_spibus_contended_total",        "Shared SPI bus requests that waited for another client."},
+  [METRICS_SPIBUS_TIMEOUTS]        = {"clock_spibus_timeouts_total",         "Shared SPI bus requests not granted within their wait."},
+  [METRICS_SPIBUS_DEADLINE_MISSES] = {"clock_spibus_deadline_misses_total",  "Shared SPI bus grants later than the client deadline."},
+  [METRICS_CLOCKFACE_COMMITS]      = {"clock_face_commits_total",            "Clock face frames prepared in advance and published at their boundary."},
+  [METRICS_CLOCKFACE_REFRESHES]    = {"clock_face_refreshes_total",          "Clock face frames laid out out of schedule (clock, zone or format changed)."},
+  [METRICS_FRAMELOG_RECORDS]       = {"clock_framelog_records_total",        "Display frames recorded in the frame log."},
+  [METRICS_FRAMELOG_BYTES]         = {"clock_framelog_bytes_total",          "Bytes of the frame log records, headers excluded."},
+  [METRICS_FRAMELOG_LOST]          = {"clock_framelog_lost_total",           "Display frames not recorded (log full or being downloaded)."},
+  [METRICS_WIFI_ROAMS]             = {"clock_wifi_roams_total",              "Wi-Fi switches to a stronger AP of the known networks."},
+  [METRICS_TIMESYNC_SYNCS]         = {"clock_timesync_syncs_total",          "Successful network time syncs."},
+  [METRICS_TIMESYNC_FAILURES]      = {"clock_timesync_failures_total",       "Network time syncs without any valid reply."},
+  [METRICS_TIMESYNC_STEPS]         = {"clock_timesync_steps_total",          "Network time syncs that set the clock instead of slewing it."},
+  [METRICS_BINLOG_RECORDS]         = {"clock_binlog_records_total",          "Hot path events recorded in the binary log."},
+  [METRICS_BINLOG_SUPPRESSED]      = {"clock_binlog_suppressed_total",       "Hot path events over their rate limit, only counted."},
+  [METRICS_BINLOG_LOST]            = {"clock_binlog_lost_total",             "Binary log records overwritten before being formatted."},
+  [METRICS_NOTIFY_POSTED]          = {"clock_notify_posted_total",           "Notifications queued."},
+  [METRICS_NOTIFY_MERGED]          = {"clock_notify_merged_total",           "Notifications equal to a queued one, renewing it."},
+  [METRICS_NOTIFY_EVICTED]         = {"clock_notify_evicted_total",          "Notifications evicted by a higher priority, pool full."},
+  [METRICS_NOTIFY_DROPPED]         = {"clock_notify_dropped_total",          "Notifications refused, pool full of higher priorities."},
+  [METRICS_NOTIFY_EXPIRED]         = {"clock_notify_expired_total",          "Notifications removed at the end of their TTL."},
+  [METRICS_SCENE_LOADS]            = {"clock_scene_loads_total",             "Scene programs loaded, stops included."},
+  [METRICS_SCENE_REJECTED]         = {"clock_scene_rejected_total",          "Scene programs refused by the verifier."},
+  [METRICS_SCENE_ABORTED]          = {"clock_scene_aborted_total",           "Scene programs stopped for running without waits."},
+  [METRICS_TICKSYNC_BEACONS]       = {"clock_ticksync_beacons_total",        "Beacons received from the other clocks of the LAN."},
+  [METRICS_TICKSYNC_SAMPLES]       = {"clock_ticksync_samples_total",        "Time exchanges with the master used by the filter."},
+  [METRICS_TICKSYNC_DROPPED]       = {"clock_ticksync_dropped_total",        "Time exchanges lost, unmatched or too slow."},
+  [METRICS_TICKSYNC_MASTERS]       = {"clock_ticksync_masters_total",        "Masters elected, this clock included."},
+};
+
+static const METRICS_HISTOGRAM_DESC_TYPE METRICS_Histogram_Desc[NUM_OF_METRICS_HISTOGRAMS] =
+{
+  [METRICS_HOLTEK_FRAME_LATENCY_US] = {"clock_display_frame_latency_us", "Time from frame composition to the end of its SPI transfer.",
+                                       8, {1000, 2000, 3000, 4000, 6000, 10000, 20000, 50000}},
+  [METRICS_HOLTEK_FRAME_JITTER_US]  = {"clock_display_frame_jitter_us",  "Absolute deviation of the frame period from the nominal one.",
+                                       8, {50, 100, 250, 500, 1000, 2000, 5000, 10000}},
+  [METRICS_HOLTEK_INPUT_LATENCY_US] = {"clock_display_input_latency_us", "Time from an input event to the end of the transfer changing the display.",
+                                       8, {2000, 5000, 8000, 10000, 12000, 15000, 20000, 50000}},
+  [METRICS_SPIBUS_WAIT_US]          = {"clock_spibus_wait_us",           "Wait of the contended shared SPI bus requests.",
+                                       8, {100, 250, 500, 1000, 2000, 3000, 5000, 20000}},
+  [METRICS_WIFI_RECONNECT_MS]       = {"clock_wifi_reconnect_ms",        "Time from a Wi-Fi disconnection or roam to the IP address.",
+                                       8, {100, 200, 500, 1000, 2000, 5000, 10000, 30000}},
+  [METRICS_TIMESYNC_OFFSET_US]      = {"clock_timesync_offset_us",       "Absolute clock offset measured by the network time syncs.",
+                                       8, {100, 250, 500, 1000, 2000, 5000, 20000, 100000}},
+  [METRICS_SCENE_FRAME_US]          = {"clock_scene_frame_us",           "Interpreter time of the frames of the scenes.",
+                                       8, {20, 50, 100, 200, 500, 1000, 2000, 5000}},
+  [METRICS_TICKSYNC_DELAY_US]       = {"clock_ticksync_delay_us",        "Round trip of the time exchanges with the master of the LAN.",
+                                       8, {500, 1000, 2000, 5000, 10000, 20000, 30000, 50000}},
+  [METRICS_TICKSYNC_CORRECTION_US]  = {"clock_ticksync_correction_us",   "Absolute change of the shared time at each exchange of a follower.",
+                                       8, {20, 50, 100, 250, 500, 1000, 2000, 5000}},
+};
+
+#endif
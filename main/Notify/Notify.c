@@ -0,0 +1,826 @@
+
+/**
+ *  @file       Notify.c
+ *
+ *  @brief      Queue of the transient notifications (alarms, errors, network
+ *              events): the one with the highest priority is shown on its
+ *              display layer over the clock face until its TTL expires, then
+ *              the next one or the clock is shown again. The notifications
+ *              are kept in blocks of a static pool, so a burst of posts
+ *              cannot fragment the heap, and the expiries are sorted: a
+ *              single one-shot esp_timer is armed for the earliest one, as
+ *              for the alarms, nothing runs between two deadlines.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include <Notify.h>
+#include <Notify_prv.h>
+#include <Holtek.h>
+#include <Alarm.h>
+#include <HttpSrv.h>
+#include <Metrics.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static NOTIFY_NODE_TYPE px_Notify_Node[NOTIFY_POOL_BLOCKS];
+static NOTIFY_QUEUE_TYPE x_Notify_Queue;
+static NOTIFY_SHOWN_TYPE x_Notify_Shown;
+
+static esp_timer_handle_t x_Notify_Timer;
+
+static SemaphoreHandle_t x_Notify_Mutex;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t x_Notify_Mutex_Buffer;
+#endif
+
+static const char *TAG = "Notify";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static bool NotifyValid(const NOTIFY_MESSAGE_TYPE *px_msg);
+static bool NotifyBlinks(const BLINKING_TIMING_TYPE *px_blink);
+static uint8_t NotifyFind(uint16_t u16_id);
+static uint8_t NotifyFindEqual(const NOTIFY_MESSAGE_TYPE *px_msg);
+static void NotifyInsert(uint8_t u8_node);
+static void NotifyUnlink(uint8_t u8_node);
+static void NotifyFree(uint8_t u8_node);
+static void NotifyShow(int64_t s64_now_us);
+static void NotifyFill(HOLTEK_FRAME_TYPE *px_frame, const NOTIFY_MESSAGE_TYPE *px_msg, bool b_blink);
+static void NotifyArm(int64_t s64_now_us);
+static void NotifyTimerCallback(void *pv_arg);
+static void NotifyReminder(uint16_t u16_id, uint8_t u8_arg);
+static bool NotifyParseU32(const char *pc_text, uint32_t u32_max, uint32_t *pu32_value);
+static esp_err_t NotifyHttpGetHandler(httpd_req_t *px_req);
+static esp_err_t NotifyHttpPostHandler(httpd_req_t *px_req);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method: prepares the pool, registers the
+ *          reminder action and the network command. To be called after the
+ *          display, the alarms and the HTTP server are started.
+ *
+ */
+void Notify__Initialize(void)
+{
+  const esp_timer_create_args_t x_timer_args =
+  {
+    .callback = NotifyTimerCallback,
+    .name = "notify",
+  };
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = NOTIFY_URI,
+    .method = HTTP_GET,
+    .handler = NotifyHttpGetHandler,
+    .user_ctx = NULL
+  };
+  const httpd_uri_t x_post_uri =
+  {
+    .uri = NOTIFY_URI,
+    .method = HTTP_POST,
+    .handler = NotifyHttpPostHandler,
+    .user_ctx = NULL
+  };
+  uint8_t u8_node;
+
+  for (u8_node = 0; u8_node < NOTIFY_POOL_BLOCKS; ++u8_node)
+  {
+    px_Notify_Node[u8_node].next = ((u8_node + 1) < NOTIFY_POOL_BLOCKS) ? (u8_node + 1) : NOTIFY_NODE_NONE;
+    px_Notify_Node[u8_node].seq = 1;
+    px_Notify_Node[u8_node].used = false;
+  }
+  x_Notify_Queue.head = NOTIFY_NODE_NONE;
+  x_Notify_Queue.tail = NOTIFY_NODE_NONE;
+  x_Notify_Queue.dl_head = NOTIFY_NODE_NONE;
+  x_Notify_Queue.dl_tail = NOTIFY_NODE_NONE;
+  x_Notify_Queue.free = 0;
+  x_Notify_Queue.used = 0;
+  x_Notify_Shown.node = NOTIFY_NODE_NONE;
+
+#if CONFIG_APP_STATIC_ALLOCATION
+  x_Notify_Mutex = xSemaphoreCreateMutexStatic(&x_Notify_Mutex_Buffer);
+  SysMon__Register_Module(TAG, sizeof(x_Notify_Mutex_Buffer));
+#else
+  x_Notify_Mutex = xSemaphoreCreateMutex();
+#endif
+  ESP_ERROR_CHECK(esp_timer_create(&x_timer_args, &x_Notify_Timer));
+
+  SysMon__Register_Module(TAG, sizeof(px_Notify_Node) + sizeof(x_Notify_Queue) + sizeof(x_Notify_Shown));
+
+  Alarm__Register_Action(ALARM_ACTION_REMINDER, NotifyReminder);
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+  (void)HttpSrv__Register_Uri(&x_post_uri);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Queues a notification. A notification equal to a queued one is not
+ *          queued twice: the queued one is renewed, so a server repeating a
+ *          message takes a single block.
+ *          When the pool is full the notification with the lowest priority
+ *          is evicted, if lower than the new one. Not from an ISR.
+ *
+ * @param px_msg  notification, copied
+ *
+ * @return id of the notification, NOTIFY_ID_NONE if not valid or if the pool
+ *         is full of notifications with a higher or equal priority
+ */
+uint16_t Notify__Post(const NOTIFY_MESSAGE_TYPE *px_msg)
+{
+  NOTIFY_NODE_TYPE *px_node;
+  int64_t s64_now_us;
+  uint8_t u8_node;
+  uint16_t u16_id = NOTIFY_ID_NONE;
+
+  if (NotifyValid(px_msg) == false)
+  {
+    return NOTIFY_ID_NONE;
+  }
+
+  s64_now_us = esp_timer_get_time();
+
+  xSemaphoreTake(x_Notify_Mutex, portMAX_DELAY);
+
+  u8_node = NotifyFindEqual(px_msg);
+  if (u8_node != NOTIFY_NODE_NONE)
+  {
+    NotifyUnlink(u8_node);
+    Metrics__Counter_Add(METRICS_NOTIFY_MERGED, 1);
+  }
+  else
+  {
+    u8_node = x_Notify_Queue.tail;
+    if ((x_Notify_Queue.free == NOTIFY_NODE_NONE) && (px_Notify_Node[u8_node].msg.priority < px_msg->priority))
+    {
+      ESP_LOGD(TAG, "\"%s\" evicted", px_Notify_Node[u8_node].msg.text);
+      NotifyUnlink(u8_node);
+      NotifyFree(u8_node);
+      Metrics__Counter_Add(METRICS_NOTIFY_EVICTED, 1);
+    }
+
+    u8_node = x_Notify_Queue.free;
+    if (u8_node != NOTIFY_NODE_NONE)
+    {
+      x_Notify_Queue.free = px_Notify_Node[u8_node].next;
+      x_Notify_Queue.used++;
+      Metrics__Counter_Add(METRICS_NOTIFY_POSTED, 1);
+    }
+    else
+    {
+      Metrics__Counter_Add(METRICS_NOTIFY_DROPPED, 1);
+    }
+  }
+
+  if (u8_node != NOTIFY_NODE_NONE)
+  {
+    px_node = &px_Notify_Node[u8_node];
+    memcpy(&px_node->msg, px_msg, sizeof(px_node->msg));
+    px_node->expiry_us = s64_now_us + ((int64_t)px_msg->ttl_ms * 1000);
+    px_node->used = true;
+    NotifyInsert(u8_node);
+
+    NotifyShow(s64_now_us);
+    NotifyArm(s64_now_us);
+
+    u16_id = (uint16_t)((px_node->seq << 8) | u8_node);
+  }
+
+  xSemaphoreGive(x_Notify_Mutex);
+
+  return u16_id;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Removes a notification before its TTL expires.
+ *
+ * @param u16_id  id returned by Notify__Post()
+ *
+ * @return false if the notification is not queued, i.e. already expired
+ */
+bool Notify__Cancel(uint16_t u16_id)
+{
+  int64_t s64_now_us = esp_timer_get_time();
+  uint8_t u8_node;
+
+  xSemaphoreTake(x_Notify_Mutex, portMAX_DELAY);
+
+  u8_node = NotifyFind(u16_id);
+  if (u8_node != NOTIFY_NODE_NONE)
+  {
+    NotifyUnlink(u8_node);
+    NotifyFree(u8_node);
+    NotifyShow(s64_now_us);
+    NotifyArm(s64_now_us);
+  }
+
+  xSemaphoreGive(x_Notify_Mutex);
+
+  return (u8_node != NOTIFY_NODE_NONE);
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Checks the limits of a notification.
+ *
+ * @param px_msg  notification
+ *
+ * @return true if it can be queued
+ */
+static bool NotifyValid(const NOTIFY_MESSAGE_TYPE *px_msg)
+{
+  return ((px_msg != NULL) &&
+          (px_msg->text[0] != '\0') &&
+          (strnlen(px_msg->text, sizeof(px_msg->text)) <= NOTIFY_TEXT_MAX) &&
+          (px_msg->ttl_ms != 0) &&
+          (px_msg->ttl_ms <= NOTIFY_TTL_MAX_MS) &&
+          (px_msg->blink.duty_on <= UINT16_MAX) &&
+          (px_msg->blink.duty_off <= UINT16_MAX));
+}
+
+/**
+ * @brief   Tells if a blink timing makes the notification blink.
+ *
+ * @param px_blink  duty in ms, endless or the given number of cycles
+ *
+ * @return true if the notification blinks when shown
+ */
+static bool NotifyBlinks(const BLINKING_TIMING_TYPE *px_blink)
+{
+  return ((px_blink->duty_on != 0) && (px_blink->duty_off != 0) &&
+          ((px_blink->endless == true) || (px_blink->repeats != 0)));
+}
+
+/**
+ * @brief   Looks for a queued notification by id.
+ *
+ * @param u16_id  id
+ *
+ * @return block of the notification, NOTIFY_NODE_NONE if not queued
+ */
+static uint8_t NotifyFind(uint16_t u16_id)
+{
+  uint8_t u8_node = (uint8_t)(u16_id & 0xFF);
+
+  if ((u8_node < NOTIFY_POOL_BLOCKS) &&
+      (px_Notify_Node[u8_node].used == true) &&
+      (px_Notify_Node[u8_node].seq == (uint8_t)(u16_id >> 8)))
+  {
+    return u8_node;
+  }
+
+  return NOTIFY_NODE_NONE;
+}
+
+/**
+ * @brief   Looks for a queued notification with the same text, icons,
+ *          priority and blink.
+ *
+ * @param px_msg  notification
+ *
+ * @return block of the notification, NOTIFY_NODE_NONE if there is none
+ */
+static uint8_t NotifyFindEqual(const NOTIFY_MESSAGE_TYPE *px_msg)
+{
+  const NOTIFY_MESSAGE_TYPE *px_queued;
+  uint8_t u8_node;
+
+  for (u8_node = x_Notify_Queue.head; u8_node != NOTIFY_NODE_NONE; u8_node = px_Notify_Node[u8_node].next)
+  {
+    px_queued = &px_Notify_Node[u8_node].msg;
+    // the queue is sorted, the lower priorities follow
+    if (px_queued->priority < px_msg->priority)
+    {
+      break;
+    }
+    if ((px_queued->priority == px_msg->priority) &&
+        (px_queued->icons == px_msg->icons) &&
+        (px_queued->blink.duty_on == px_msg->blink.duty_on) &&
+        (px_queued->blink.duty_off == px_msg->blink.duty_off) &&
+        (px_queued->blink.endless == px_msg->blink.endless) &&
+        (px_queued->blink.repeats == px_msg->blink.repeats) &&
+        (strcmp(px_queued->text, px_msg->text) == 0))
+    {
+      return u8_node;
+    }
+  }
+
+  return NOTIFY_NODE_NONE;
+}
+
+/**
+ * @brief   Links a block in the queue, before the ones with a lower or equal
+ *          priority, and in the deadlines, after the ones expiring earlier or
+ *          at the same time. Both walks are bounded by the pool size and
+ *          happen only when a notification is posted.
+ *
+ * @param u8_node block, not linked
+ */
+static void NotifyInsert(uint8_t u8_node)
+{
+  NOTIFY_NODE_TYPE *px_node = &px_Notify_Node[u8_node];
+  uint8_t u8_next;
+
+  for (u8_next = x_Notify_Queue.head;
+       (u8_next != NOTIFY_NODE_NONE) && (px_Notify_Node[u8_next].msg.priority > px_node->msg.priority);
+       u8_next = px_Notify_Node[u8_next].next)
+  {
+  }
+  px_node->next = u8_next;
+  px_node->prev = (u8_next != NOTIFY_NODE_NONE) ? px_Notify_Node[u8_next].prev : x_Notify_Queue.tail;
+  if (px_node->prev != NOTIFY_NODE_NONE)
+  {
+    px_Notify_Node[px_node->prev].next = u8_node;
+  }
+  else
+  {
+    x_Notify_Queue.head = u8_node;
+  }
+  if (u8_next != NOTIFY_NODE_NONE)
+  {
+    px_Notify_Node[u8_next].prev = u8_node;
+  }
+  else
+  {
+    x_Notify_Queue.tail = u8_node;
+  }
+
+  for (u8_next = x_Notify_Queue.dl_head;
+       (u8_next != NOTIFY_NODE_NONE) && (px_Notify_Node[u8_next].expiry_us <= px_node->expiry_us);
+       u8_next = px_Notify_Node[u8_next].dl_next)
+  {
+  }
+  px_node->dl_next = u8_next;
+  px_node->dl_prev = (u8_next != NOTIFY_NODE_NONE) ? px_Notify_Node[u8_next].dl_prev : x_Notify_Queue.dl_tail;
+  if (px_node->dl_prev != NOTIFY_NODE_NONE)
+  {
+    px_Notify_Node[px_node->dl_prev].dl_next = u8_node;
+  }
+  else
+  {
+    x_Notify_Queue.dl_head = u8_node;
+  }
+  if (u8_next != NOTIFY_NODE_NONE)
+  {
+    px_Notify_Node[u8_next].dl_prev = u8_node;
+  }
+  else
+  {
+    x_Notify_Queue.dl_tail = u8_node;
+  }
+}
+
+/**
+ * @brief   Unlinks a block from the queue and from the deadlines.
+ *
+ * @param u8_node block, linked
+ */
+static void NotifyUnlink(uint8_t u8_node)
+{
+  NOTIFY_NODE_TYPE *px_node = &px_Notify_Node[u8_node];
+
+  if (px_node->prev != NOTIFY_NODE_NONE)
+  {
+    px_Notify_Node[px_node->prev].next = px_node->next;
+  }
+  else
+  {
+    x_Notify_Queue.head = px_node->next;
+  }
+  if (px_node->next != NOTIFY_NODE_NONE)
+  {
+    px_Notify_Node[px_node->next].prev = px_node->prev;
+  }
+  else
+  {
+    x_Notify_Queue.tail = px_node->prev;
+  }
+
+  if (px_node->dl_prev != NOTIFY_NODE_NONE)
+  {
+    px_Notify_Node[px_node->dl_prev].dl_next = px_node->dl_next;
+  }
+  else
+  {
+    x_Notify_Queue.dl_head = px_node->dl_next;
+  }
+  if (px_node->dl_next != NOTIFY_NODE_NONE)
+  {
+    px_Notify_Node[px_node->dl_next].dl_prev = px_node->dl_prev;
+  }
+  else
+  {
+    x_Notify_Queue.dl_tail = px_node->dl_prev;
+  }
+}
+
+/**
+ * @brief   Returns an unlinked block to the pool, its next id will differ.
+ *
+ * @param u8_node block
+ */
+static void NotifyFree(uint8_t u8_node)
+{
+  NOTIFY_NODE_TYPE *px_node = &px_Notify_Node[u8_node];
+
+  px_node->used = false;
+  px_node->seq = (px_node->seq == UINT8_MAX) ? 1 : (px_node->seq + 1);
+  px_node->next = x_Notify_Queue.free;
+  x_Notify_Queue.free = u8_node;
+  x_Notify_Queue.used--;
+}
+
+/**
+ * @brief   Updates the display layer: the frame is written only when the
+ *          notification on top of the queue changes or its blink cycles
+ *          end, the layer is released when the queue is empty. To be called
+ *          with the mutex taken, which also makes this the only producer of
+ *          the layer.
+ *
+ * @param s64_now_us  current time
+ */
+static void NotifyShow(int64_t s64_now_us)
+{
+  NOTIFY_NODE_TYPE *px_node;
+  const BLINKING_TIMING_TYPE *px_blink;
+  uint8_t u8_top = x_Notify_Queue.head;
+  bool b_blink;
+
+  if (u8_top == NOTIFY_NODE_NONE)
+  {
+    if (x_Notify_Shown.node != NOTIFY_NODE_NONE)
+    {
+      x_Notify_Shown.node = NOTIFY_NODE_NONE;
+      Holtek__Frame_Release(HOLTEK_LAYER_NOTIFY);
+    }
+    return;
+  }
+
+  px_node = &px_Notify_Node[u8_top];
+  px_blink = &px_node->msg.blink;
+
+  if ((x_Notify_Shown.node == u8_top) && (x_Notify_Shown.seq == px_node->seq))
+  {
+    // same notification, the frame changes only at the end of the blink cycles
+    if ((x_Notify_Shown.blink == false) || (x_Notify_Shown.blink_end_us == 0) ||
+        (s64_now_us < x_Notify_Shown.blink_end_us))
+    {
+      return;
+    }
+    b_blink = false;
+  }
+  else
+  {
+    // the blink starts again each time the notification is shown
+    b_blink = NotifyBlinks(px_blink);
+    x_Notify_Shown.node = u8_top;
+    x_Notify_Shown.seq = px_node->seq;
+    x_Notify_Shown.blink_end_us = 0;
+    if ((b_blink == true) && (px_blink->endless == false))
+    {
+      x_Notify_Shown.blink_end_us = s64_now_us +
+                                    ((int64_t)px_blink->repeats * (px_blink->duty_on + px_blink->duty_off) * 1000);
+    }
+  }
+  x_Notify_Shown.blink = b_blink;
+
+  NotifyFill(Holtek__Frame_Acquire(HOLTEK_LAYER_NOTIFY), &px_node->msg, b_blink);
+  Holtek__Frame_Commit(HOLTEK_LAYER_NOTIFY);
+}
+
+/**
+ * @brief   Writes a notification in a frame: the text from the leftmost
+ *          digit, the icons and, if blinking, all of them blink.
+ *
+ * @param px_frame  frame of the layer
+ * @param px_msg    notification
+ * @param b_blink   true to blink the text and the icons
+ */
+static void NotifyFill(HOLTEK_FRAME_TYPE *px_frame, const NOTIFY_MESSAGE_TYPE *px_msg, bool b_blink)
+{
+  const char *pc_char;
+  uint8_t u8_digit = 0;
+  uint8_t u8_icon;
+  uint8_t u8_byte;
+  uint8_t u8_bit;
+
+  memset(px_frame->digit_mask, 0x00, sizeof(px_frame->digit_mask));
+  memset(px_frame->icons, 0x00, sizeof(px_frame->icons));
+  memset(px_frame->blink_icons, 0x00, sizeof(px_frame->blink_icons));
+  px_frame->blink_digits = 0;
+  px_frame->blink_on_ms = 0;
+  px_frame->blink_off_ms = 0;
+
+  for (pc_char = px_msg->text; *pc_char != '\0'; ++pc_char)
+  {
+    if ((*pc_char == '.') && (u8_digit > 0))
+    {
+      px_frame->digit_mask[u8_digit - 1] |= DISPLAY_SEG_DP;
+    }
+    else if (u8_digit < NUM_OF_DIGITS)
+    {
+      px_frame->digit_mask[u8_digit++] = Holtek__Get_Glyph((uint8_t)*pc_char);
+    }
+  }
+
+  for (u8_icon = ICON_NONE + 1; u8_icon < NUM_OF_ICONS; ++u8_icon)
+  {
+    if ((px_msg->icons & NOTIFY_ICON_MASK(u8_icon)) != 0)
+    {
+      DISPLAY_ICON_GET_BYTE_BIT(u8_icon, u8_byte, u8_bit);
+      px_frame->icons[u8_byte] |= (uint8_t)(1u << u8_bit);
+    }
+  }
+
+  if (b_blink == true)
+  {
+    px_frame->blink_digits = (uint8_t)((1u << NUM_OF_DIGITS) - 1);
+    memcpy(px_frame->blink_icons, px_frame->icons, sizeof(px_frame->blink_icons));
+    px_frame->blink_on_ms = (uint16_t)px_msg->blink.duty_on;
+    px_frame->blink_off_ms = (uint16_t)px_msg->blink.duty_off;
+  }
+}
+
+/**
+ * @brief   Arms the timer for the next deadline: the earliest expiry or the
+ *          end of the blink cycles of the notification shown. To be called
+ *          with the mutex taken.
+ *
+ * @param s64_now_us  current time
+ */
+static void NotifyArm(int64_t s64_now_us)
+{
+  int64_t s64_next_us = INT64_MAX;
+
+  if (x_Notify_Queue.dl_head != NOTIFY_NODE_NONE)
+  {
+    s64_next_us = px_Notify_Node[x_Notify_Queue.dl_head].expiry_us;
+  }
+  if ((x_Notify_Shown.blink == true) && (x_Notify_Shown.blink_end_us != 0))
+  {
+    s64_next_us = MIN(s64_next_us, x_Notify_Shown.blink_end_us);
+  }
+
+  (void)esp_timer_stop(x_Notify_Timer);
+
+  if (s64_next_us != INT64_MAX)
+  {
+    (void)esp_timer_start_once(x_Notify_Timer, MAX(s64_next_us - s64_now_us, 0));
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Removes the notifications expired, from the head of the
+ *          deadlines, updates the display and arms the timer for the next
+ *          deadline. Runs in the esp_timer task.
+ *
+ * @param pv_arg not used
+ */
+static void NotifyTimerCallback(void *pv_arg)
+{
+  int64_t s64_now_us = esp_timer_get_time();
+  uint8_t u8_node;
+
+  xSemaphoreTake(x_Notify_Mutex, portMAX_DELAY);
+
+  while (((u8_node = x_Notify_Queue.dl_head) != NOTIFY_NODE_NONE) &&
+         (px_Notify_Node[u8_node].expiry_us <= s64_now_us))
+  {
+    NotifyUnlink(u8_node);
+    NotifyFree(u8_node);
+    Metrics__Counter_Add(METRICS_NOTIFY_EXPIRED, 1);
+  }
+
+  NotifyShow(s64_now_us);
+  NotifyArm(s64_now_us);
+
+  xSemaphoreGive(x_Notify_Mutex);
+}
+
+/**
+ * @brief   Alarm action of the reminders: shows "REMnn", blinking.
+ *
+ * @param u16_id  alarm entry
+ * @param u8_arg  reminder number
+ */
+static void NotifyReminder(uint16_t u16_id, uint8_t u8_arg)
+{
+  NOTIFY_MESSAGE_TYPE x_msg =
+  {
+    .icons = 0,
+    .priority = NOTIFY_REMINDER_PRIORITY,
+    .ttl_ms = NOTIFY_REMINDER_TTL_MS,
+    .blink = {.duty_on = NOTIFY_REMINDER_BLINK_MS, .duty_off = NOTIFY_REMINDER_BLINK_MS, .endless = true, .repeats = 0},
+  };
+
+  (void)snprintf(x_msg.text, sizeof(x_msg.text), "REM%02u", (unsigned int)(u8_arg % 100));
+
+  if (Notify__Post(&x_msg) == NOTIFY_ID_NONE)
+  {
+    ESP_LOGW(TAG, "reminder %u not shown, queue full", u8_arg);
+  }
+}
+
+/**
+ * @brief   Parses a decimal number.
+ *
+ * @param pc_text     number, NULL if missing
+ * @param u32_max     highest value accepted
+ * @param pu32_value  [out] value
+ *
+ * @return false if missing, not a number or too large
+ */
+static bool NotifyParseU32(const char *pc_text, uint32_t u32_max, uint32_t *pu32_value)
+{
+  char *pc_end;
+  unsigned long ul_value;
+
+  if ((pc_text == NULL) || (*pc_text < '0') || (*pc_text > '9'))
+  {
+    return false;
+  }
+
+  ul_value = strtoul(pc_text, &pc_end, 10);
+  if ((*pc_end != '\0') || (ul_value > u32_max))
+  {
+    return false;
+  }
+
+  *pu32_value = (uint32_t)ul_value;
+  return true;
+}
+
+/**
+ * @brief   GET on the queue: one line per notification, from the one shown,
+ *          with id, priority, ms left and text. Each line is taken with the
+ *          mutex and sent without it, a notification posted or expired
+ *          during the reply can be missed or listed twice.
+ *
+ * @param px_req  request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t NotifyHttpGetHandler(httpd_req_t *px_req)
+{
+  NOTIFY_NODE_TYPE *px_node;
+  char pc_line[64];
+  int64_t s64_now_us;
+  uint8_t u8_node;
+  uint8_t u8_pos;
+  uint8_t u8_idx;
+
+  xSemaphoreTake(x_Notify_Mutex, portMAX_DELAY);
+  (void)snprintf(pc_line, sizeof(pc_line), "blocks %u\nqueued %u\n",
+                 (unsigned int)NOTIFY_POOL_BLOCKS, x_Notify_Queue.used);
+  xSemaphoreGive(x_Notify_Mutex);
+
+  httpd_resp_set_type(px_req, "text/plain");
+  if (httpd_resp_send_chunk(px_req, pc_line, HTTPD_RESP_USE_STRLEN) != ESP_OK)
+  {
+    return ESP_OK;
+  }
+
+  for (u8_pos = 0; u8_pos < NOTIFY_POOL_BLOCKS; ++u8_pos)
+  {
+    s64_now_us = esp_timer_get_time();
+
+    xSemaphoreTake(x_Notify_Mutex, portMAX_DELAY);
+    u8_node = x_Notify_Queue.head;
+    for (u8_idx = 0; (u8_idx < u8_pos) && (u8_node != NOTIFY_NODE_NONE); ++u8_idx)
+    {
+      u8_node = px_Notify_Node[u8_node].next;
+    }
+    if (u8_node != NOTIFY_NODE_NONE)
+    {
+      px_node = &px_Notify_Node[u8_node];
+      (void)snprintf(pc_line, sizeof(pc_line), "%u %u %u %s\n",
+                     (unsigned int)((px_node->seq << 8) | u8_node), px_node->msg.priority,
+                     (uint32_t)(MAX(px_node->expiry_us - s64_now_us, 0) / 1000), px_node->msg.text);
+    }
+    xSemaphoreGive(x_Notify_Mutex);
+
+    if ((u8_node == NOTIFY_NODE_NONE) ||
+        (httpd_resp_send_chunk(px_req, pc_line, HTTPD_RESP_USE_STRLEN) != ESP_OK))
+    {
+      break;
+    }
+  }
+
+  return httpd_resp_send_chunk(px_req, NULL, 0);
+}
+
+/**
+ * @brief   POST on the queue: "<priority> <ttl_ms> <text> [<on_ms> <off_ms>
+ *          [<repeats>]]" queues a notification, '_' in the text is a blank
+ *          and the blink is endless without repeats, the reply is its id.
+ *          "cancel <id>" removes a notification.
+ *
+ * @param px_req  request
+ *
+ * @return ESP_OK, ESP_FAIL on a bad request
+ */
+static esp_err_t NotifyHttpPostHandler(httpd_req_t *px_req)
+{
+  NOTIFY_MESSAGE_TYPE x_msg;
+  char pc_body[NOTIFY_HTTP_BODY_MAX + 1];
+  char pc_reply[12];
+  char *pc_save = NULL;
+  char *pc_word;
+  char *pc_text;
+  uint32_t u32_value;
+  uint16_t u16_id;
+  int i_len;
+
+  i_len = httpd_req_recv(px_req, pc_body, MIN(px_req->content_len, NOTIFY_HTTP_BODY_MAX));
+  pc_body[(i_len > 0) ? i_len : 0] = '\0';
+  pc_body[strcspn(pc_body, "\r\n")] = '\0';
+
+  pc_word = strtok_r(pc_body, " ", &pc_save);
+  if ((pc_word != NULL) && (strcmp(pc_word, "cancel") == 0))
+  {
+    if ((NotifyParseU32(strtok_r(NULL, " ", &pc_save), UINT16_MAX, &u32_value) == false) ||
+        (Notify__Cancel((uint16_t)u32_value) == false))
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "notification not queued");
+      return ESP_FAIL;
+    }
+    return httpd_resp_sendstr(px_req, "OK\n");
+  }
+
+  memset(&x_msg, 0x00, sizeof(x_msg));
+  x_msg.blink.endless = true;
+
+  if ((NotifyParseU32(pc_word, UINT8_MAX, &u32_value) == false) ||
+      (NotifyParseU32(strtok_r(NULL, " ", &pc_save), NOTIFY_TTL_MAX_MS, &x_msg.ttl_ms) == false) ||
+      ((pc_text = strtok_r(NULL, " ", &pc_save)) == NULL) ||
+      (strlen(pc_text) > NOTIFY_TEXT_MAX))
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "expected <priority> <ttl_ms> <text> [<on_ms> <off_ms> [<repeats>]]");
+    return ESP_FAIL;
+  }
+  x_msg.priority = (uint8_t)u32_value;
+  for (i_len = 0; pc_text[i_len] != '\0'; ++i_len)
+  {
+    x_msg.text[i_len] = (pc_text[i_len] == '_') ? ' ' : pc_text[i_len];
+  }
+
+  pc_word = strtok_r(NULL, " ", &pc_save);
+  if (pc_word != NULL)
+  {
+    if ((NotifyParseU32(pc_word, UINT16_MAX, &x_msg.blink.duty_on) == false) ||
+        (NotifyParseU32(strtok_r(NULL, " ", &pc_save), UINT16_MAX, &x_msg.blink.duty_off) == false))
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "bad blink duty");
+      return ESP_FAIL;
+    }
+    pc_word = strtok_r(NULL, " ", &pc_save);
+    if (pc_word != NULL)
+    {
+      if ((NotifyParseU32(pc_word, UINT8_MAX, &u32_value) == false) || (u32_value == 0))
+      {
+        httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "bad blink repeats");
+        return ESP_FAIL;
+      }
+      x_msg.blink.endless = false;
+      x_msg.blink.repeats = (uint8_t)u32_value;
+    }
+  }
+
+  u16_id = Notify__Post(&x_msg);
+  if (u16_id == NOTIFY_ID_NONE)
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "not queued, higher priorities queued");
+    return ESP_FAIL;
+  }
+
+  (void)snprintf(pc_reply, sizeof(pc_reply), "%u\n", u16_id);
+  return httpd_resp_sendstr(px_req, pc_reply);
+}
@@ -0,0 +1,52 @@
+
+/**
+ *  @file       Notify_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef NOTIFY_PRM_H
+    #define NOTIFY_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <Holtek.h>
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+// longest text, a '.' after a character lights the dot of its digit
+#define NOTIFY_TEXT_MAX             (NUM_OF_DIGITS * 2)
+
+// id of no notification, returned when a notification is refused
+#define NOTIFY_ID_NONE              0
+
+// mask of an icon in the icons of a notification
+#define NOTIFY_ICON_MASK(icon)      (1UL << (icon))
+
+/*
+ * Notification: the text is shown from the leftmost digit until the TTL
+ * expires, unless one with a higher priority is queued. The blink (duty in
+ * ms, 0 for a steady text) applies to the text and the icons, it is
+ * restarted each time the notification is shown again.
+ */
+typedef struct
+{
+  char text[NOTIFY_TEXT_MAX + 1];
+  uint32_t icons;                   // NOTIFY_ICON_MASK() of the icons shown
+  uint8_t priority;                 // 0 lowest, among equal priorities the newest is shown
+  uint32_t ttl_ms;
+  BLINKING_TIMING_TYPE blink;
+}NOTIFY_MESSAGE_TYPE;
+
+// queue of notifications: GET lists it, POST "<priority> <ttl_ms> <text> [<on_ms> <off_ms> [<repeats>]]" adds one ('_' is a blank), "cancel <id>" removes one
+#define NOTIFY_URI                  "/notify"
+
+#endif
@@ -0,0 +1,82 @@
+
+/**
+ *  @file       Notify_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef NOTIFY_PRV_H
+    #define NOTIFY_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <Notify_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// blocks of the pool, i.e. notifications queued at most
+#define NOTIFY_POOL_BLOCKS          CONFIG_NOTIFY_POOL_BLOCKS
+
+#define NOTIFY_NODE_NONE            0xFF
+
+#if (NOTIFY_POOL_BLOCKS >= NOTIFY_NODE_NONE)
+#error "CONFIG_NOTIFY_POOL_BLOCKS too large"
+#endif
+
+// longest TTL, one day
+#define NOTIFY_TTL_MAX_MS           (24UL * 60 * 60 * 1000)
+
+// notification posted by a reminder alarm, "REMnn"
+#define NOTIFY_REMINDER_PRIORITY    CONFIG_NOTIFY_REMINDER_PRIORITY
+#define NOTIFY_REMINDER_TTL_MS      (CONFIG_NOTIFY_REMINDER_TTL_S * 1000UL)
+#define NOTIFY_REMINDER_BLINK_MS    500
+
+/*
+ * Block of the pool. A queued block is linked in two lists by index: the
+ * queue, by priority, and the deadlines, by expiry. The free blocks are
+ * chained on next. The id of a notification is the sequence of its block
+ * in the high byte and the block in the low byte, so the id of an expired
+ * notification is not taken by the next one using the block.
+ */
+typedef struct
+{
+  NOTIFY_MESSAGE_TYPE msg;
+  int64_t expiry_us;
+  uint8_t next;                     // queue, from the highest priority, or free list
+  uint8_t prev;
+  uint8_t dl_next;                  // deadlines, from the earliest
+  uint8_t dl_prev;
+  uint8_t seq;                      // never 0, so an id is never NOTIFY_ID_NONE
+  bool used;
+}NOTIFY_NODE_TYPE;
+
+typedef struct
+{
+  uint8_t head;                     // notification shown
+  uint8_t tail;                     // lowest priority, evicted first
+  uint8_t dl_head;                  // next expiry
+  uint8_t dl_tail;
+  uint8_t free;
+  uint8_t used;
+}NOTIFY_QUEUE_TYPE;
+
+// what the display layer shows
+typedef struct
+{
+  uint8_t node;                     // NOTIFY_NODE_NONE if the layer is released
+  uint8_t seq;
+  bool blink;
+  int64_t blink_end_us;             // end of the counted blink cycles, 0 if endless or none
+}NOTIFY_SHOWN_TYPE;
+
+// longest body of the network command
+#define NOTIFY_HTTP_BODY_MAX        64
+
+#endif
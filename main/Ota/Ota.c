@@ -0,0 +1,540 @@
+
+/**
+ *  @file       Ota.c
+ *
+ *  @brief      Firmware update over HTTP on the A/B application partitions.
+ *              The image is streamed to flash one sector at a time while its
+ *              hash is computed, so the memory used does not depend on the
+ *              image size. The progress is shown on the display and a new
+ *              image is rolled back if it is not healthy after the first boot.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/ecdsa.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <Ota.h>
+#include <Ota_prv.h>
+#include <Holtek.h>
+#include <WiFiConn.h>
+#include <HttpSrv.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static uint8_t pu8_Ota_Chunk[OTA_CHUNK_BYTES];
+
+static OTA_SESSION_TYPE x_Ota_Session;
+
+static char pc_Ota_Header[OTA_HDR_MAX_BYTES];
+
+static esp_timer_handle_t x_Ota_Restart_Timer;
+static esp_timer_handle_t x_Ota_Release_Timer;
+static esp_timer_handle_t x_Ota_Health_Timer;
+
+// the update layer is written by the HTTP task and released by the esp_timer task
+static SemaphoreHandle_t x_Ota_Layer_Mutex;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t x_Ota_Layer_Mutex_Buffer;
+#endif
+// the error of a failed update is on the layer, to be released by the timer
+static bool b_Ota_Error_Shown;
+
+static const char *TAG = "Ota";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static esp_err_t OtaHttpPostHandler(httpd_req_t *px_req);
+static const char *OtaReceive(httpd_req_t *px_req);
+static const char *OtaVerify(void);
+static bool OtaHeaderHexGet(httpd_req_t *px_req, const char *pc_field, uint8_t *pu8_out, uint8_t u8_max_len, uint8_t *pu8_len);
+static bool OtaHexDecode(const char *pc_hex, uint8_t *pu8_out, uint8_t u8_max_len, uint8_t *pu8_len);
+static void OtaShow(const char *pc_text, bool b_blink);
+static void OtaRestartCallback(void *pv_args);
+static void OtaReleaseCallback(void *pv_args);
+static void OtaHealthCallback(void *pv_args);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, registers the upload endpoint: to
+ *          be called after HttpSrv__Initialize(). When the running image has
+ *          just been installed, its health check is scheduled.
+ *
+ */
+void Ota__Initialize(void)
+{
+  const esp_partition_t *px_running = esp_ota_get_running_partition();
+  esp_ota_img_states_t e_state;
+
+  memset(&x_Ota_Session, 0x00, sizeof(x_Ota_Session));
+
+  SysMon__Register_Module(TAG, sizeof(pu8_Ota_Chunk) + sizeof(x_Ota_Session) + sizeof(pc_Ota_Header));
+
+  const esp_timer_create_args_t x_restart_timer_args =
+  {
+    .callback = &OtaRestartCallback,
+    .arg = NULL,
+    .name = "OtaRestart"
+  };
+  const esp_timer_create_args_t x_release_timer_args =
+  {
+    .callback = &OtaReleaseCallback,
+    .arg = NULL,
+    .name = "OtaRelease"
+  };
+  const esp_timer_create_args_t x_health_timer_args =
+  {
+    .callback = &OtaHealthCallback,
+    .arg = NULL,
+    .name = "OtaHealth"
+  };
+
+#if CONFIG_APP_STATIC_ALLOCATION
+  x_Ota_Layer_Mutex = xSemaphoreCreateMutexStatic(&x_Ota_Layer_Mutex_Buffer);
+  SysMon__Register_Module(TAG, sizeof(x_Ota_Layer_Mutex_Buffer));
+#else
+  x_Ota_Layer_Mutex = xSemaphoreCreateMutex();
+#endif
+  ESP_ERROR_CHECK(esp_timer_create(&x_restart_timer_args, &x_Ota_Restart_Timer));
+  ESP_ERROR_CHECK(esp_timer_create(&x_release_timer_args, &x_Ota_Release_Timer));
+  ESP_ERROR_CHECK(esp_timer_create(&x_health_timer_args, &x_Ota_Health_Timer));
+
+  if ((esp_ota_get_state_partition(px_running, &e_state) == ESP_OK) &&
+      (e_state == ESP_OTA_IMG_PENDING_VERIFY))
+  {
+    ESP_LOGW(TAG, "first boot of %s, health check in %d s", px_running->label, OTA_HEALTH_CHECK_S);
+    esp_timer_start_once(x_Ota_Health_Timer, (uint64_t)OTA_HEALTH_CHECK_S * 1000000ULL);
+  }
+
+#if OTA_ENABLE
+  const httpd_uri_t x_ota_uri =
+  {
+    .uri = OTA_URI,
+    .method = HTTP_POST,
+    .handler = OtaHttpPostHandler,
+    .user_ctx = NULL
+  };
+
+  (void)HttpSrv__Register_Uri(&x_ota_uri);
+#endif
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Upload handler, runs in the HTTP server task. Its priority is below
+ *          the display tasks and the flash is written one sector at a time,
+ *          so a frame is delayed at most by a single sector erase.
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK to keep the connection
+ */
+static esp_err_t OtaHttpPostHandler(httpd_req_t *px_req)
+{
+  const char *pc_error;
+
+#if !OTA_SIGNATURE_CHECK
+  // without a verification key anyone on the network could flash any image
+  ESP_LOGW(TAG, "update refused, no verification key");
+  httpd_resp_send_err(px_req, HTTPD_403_FORBIDDEN, "no verification key configured");
+  return ESP_FAIL;
+#endif
+
+  // an upload started right after a failed one takes the layer back
+  esp_timer_stop(x_Ota_Release_Timer);
+
+  x_Ota_Session.total = px_req->content_len;
+  x_Ota_Session.received = 0;
+  x_Ota_Session.percent = 0;
+  x_Ota_Session.partition = esp_ota_get_next_update_partition(NULL);
+
+  if (x_Ota_Session.partition == NULL)
+  {
+    pc_error = "no update partition";
+  }
+  else if ((x_Ota_Session.total == 0) || (x_Ota_Session.total > x_Ota_Session.partition->size))
+  {
+    pc_error = "invalid image size";
+  }
+  else if (OtaHeaderHexGet(px_req, OTA_HDR_SHA256, x_Ota_Session.sha256_expected, OTA_SHA256_BYTES, NULL) == false)
+  {
+    pc_error = "missing " OTA_HDR_SHA256;
+  }
+#if OTA_SIGNATURE_CHECK
+  else if (OtaHeaderHexGet(px_req, OTA_HDR_SIGNATURE, x_Ota_Session.signature, OTA_SIGNATURE_MAX_BYTES, &x_Ota_Session.signature_len) == false)
+  {
+    pc_error = "missing " OTA_HDR_SIGNATURE;
+  }
+#endif
+  // sequential writes erase each sector right before writing it, no long erase of the whole partition
+  else if (esp_ota_begin(x_Ota_Session.partition, OTA_WITH_SEQUENTIAL_WRITES, &x_Ota_Session.handle) != ESP_OK)
+  {
+    pc_error = "update not started";
+  }
+  else
+  {
+    ESP_LOGI(TAG, "writing %u bytes to %s", x_Ota_Session.total, x_Ota_Session.partition->label);
+    OtaShow("UP  0", false);
+
+    pc_error = OtaReceive(px_req);
+    if (pc_error == NULL)
+    {
+      pc_error = OtaVerify();
+    }
+
+    if (pc_error != NULL)
+    {
+      esp_ota_abort(x_Ota_Session.handle);
+    }
+    else if (esp_ota_end(x_Ota_Session.handle) != ESP_OK)
+    {
+      // image header, segments and appended hash are checked by esp_ota_end()
+      pc_error = "invalid image";
+    }
+    else if (esp_ota_set_boot_partition(x_Ota_Session.partition) != ESP_OK)
+    {
+      pc_error = "boot partition not set";
+    }
+  }
+
+  if (pc_error != NULL)
+  {
+    ESP_LOGE(TAG, "update failed: %s", pc_error);
+    OtaShow("UP Er", true);
+    esp_timer_start_once(x_Ota_Release_Timer, (uint64_t)OTA_ERROR_SHOW_MS * 1000ULL);
+
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, pc_error);
+    return ESP_FAIL;
+  }
+
+  ESP_LOGI(TAG, "update completed, restarting");
+  httpd_resp_sendstr(px_req, "OK\n");
+
+  // the response must leave before the restart
+  esp_timer_start_once(x_Ota_Restart_Timer, (uint64_t)OTA_RESTART_DELAY_MS * 1000ULL);
+
+  return ESP_OK;
+}
+
+/**
+ * @brief   Receives the image: each chunk is filled up to a flash sector,
+ *          added to the hash and written, then the buffer is reused.
+ *
+ * @param px_req request
+ *
+ * @return NULL on success, description of the error otherwise
+ */
+static const char *OtaReceive(httpd_req_t *px_req)
+{
+  uint32_t u32_fill = 0;
+  uint8_t u8_timeouts = 0;
+  uint8_t u8_percent;
+  char pc_text[NUM_OF_DIGITS + 1];
+  int s32_len;
+
+  mbedtls_sha256_init(&x_Ota_Session.sha256);
+  mbedtls_sha256_starts_ret(&x_Ota_Session.sha256, 0);
+
+  while (x_Ota_Session.received < x_Ota_Session.total)
+  {
+    s32_len = httpd_req_recv(px_req, (char *)&pu8_Ota_Chunk[u32_fill],
+                             MIN((OTA_CHUNK_BYTES - u32_fill), (x_Ota_Session.total - x_Ota_Session.received - u32_fill)));
+    if (s32_len == HTTPD_SOCK_ERR_TIMEOUT)
+    {
+      if (++u8_timeouts >= OTA_RECV_TIMEOUT_RETRIES)
+      {
+        return "receive timeout";
+      }
+      continue;
+    }
+    else if (s32_len <= 0)
+    {
+      return "connection closed";
+    }
+
+    u8_timeouts = 0;
+    u32_fill += (uint32_t)s32_len;
+
+    // write full sectors only, the last chunk is written when the image is complete
+    if ((u32_fill == OTA_CHUNK_BYTES) || ((x_Ota_Session.received + u32_fill) == x_Ota_Session.total))
+    {
+      mbedtls_sha256_update_ret(&x_Ota_Session.sha256, pu8_Ota_Chunk, u32_fill);
+
+      if (esp_ota_write(x_Ota_Session.handle, pu8_Ota_Chunk, u32_fill) != ESP_OK)
+      {
+        return "flash write failed";
+      }
+
+      x_Ota_Session.received += u32_fill;
+      u32_fill = 0;
+
+      u8_percent = (uint8_t)(((uint64_t)x_Ota_Session.received * 100) / x_Ota_Session.total);
+      if (u8_percent != x_Ota_Session.percent)
+      {
+        x_Ota_Session.percent = u8_percent;
+        snprintf(pc_text, sizeof(pc_text), "UP%3u", u8_percent);
+        OtaShow(pc_text, false);
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief   Compares the hash of the received image with the expected one and
+ *          verifies its signature with the public key of the build.
+ *
+ * @return NULL on success, description of the error otherwise
+ */
+static const char *OtaVerify(void)
+{
+  uint8_t pu8_sha256[OTA_SHA256_BYTES];
+
+  mbedtls_sha256_finish_ret(&x_Ota_Session.sha256, pu8_sha256);
+  mbedtls_sha256_free(&x_Ota_Session.sha256);
+
+  if (memcmp(pu8_sha256, x_Ota_Session.sha256_expected, OTA_SHA256_BYTES) != 0)
+  {
+    return "hash mismatch";
+  }
+
+#if OTA_SIGNATURE_CHECK
+  uint8_t pu8_key[OTA_PUBLIC_KEY_BYTES];
+  uint8_t u8_key_len;
+  mbedtls_ecdsa_context x_ecdsa;
+  int s32_ret;
+
+  if ((OtaHexDecode(OTA_PUBLIC_KEY, pu8_key, sizeof(pu8_key), &u8_key_len) == false) ||
+      (u8_key_len != OTA_PUBLIC_KEY_BYTES))
+  {
+    return "no public key in this build";
+  }
+
+  mbedtls_ecdsa_init(&x_ecdsa);
+
+  s32_ret = mbedtls_ecp_group_load(&x_ecdsa.grp, MBEDTLS_ECP_DP_SECP256R1);
+  if (s32_ret == 0)
+  {
+    s32_ret = mbedtls_ecp_point_read_binary(&x_ecdsa.grp, &x_ecdsa.Q, pu8_key, u8_key_len);
+  }
+  if (s32_ret == 0)
+  {
+    s32_ret = mbedtls_ecdsa_read_signature(&x_ecdsa, pu8_sha256, OTA_SHA256_BYTES,
+                                           x_Ota_Session.signature, x_Ota_Session.signature_len);
+  }
+
+  mbedtls_ecdsa_free(&x_ecdsa);
+
+  if (s32_ret != 0)
+  {
+    return "invalid signature";
+  }
+#endif
+
+  return NULL;
+}
+
+/**
+ * @brief   Reads a hex encoded request header.
+ *
+ * @param px_req      request
+ * @param pc_field    header name
+ * @param pu8_out     [out] decoded value
+ * @param u8_max_len  size of pu8_out
+ * @param pu8_len     [out] decoded length, NULL if the value must fill pu8_out
+ *
+ * @return true if the header is present and valid
+ */
+static bool OtaHeaderHexGet(httpd_req_t *px_req, const char *pc_field, uint8_t *pu8_out, uint8_t u8_max_len, uint8_t *pu8_len)
+{
+  uint8_t u8_len;
+
+  if (httpd_req_get_hdr_value_str(px_req, pc_field, pc_Ota_Header, sizeof(pc_Ota_Header)) != ESP_OK)
+  {
+    return false;
+  }
+
+  if (OtaHexDecode(pc_Ota_Header, pu8_out, u8_max_len, &u8_len) == false)
+  {
+    return false;
+  }
+
+  if (pu8_len != NULL)
+  {
+    *pu8_len = u8_len;
+    return (u8_len != 0);
+  }
+
+  return (u8_len == u8_max_len);
+}
+
+/**
+ * @brief   Decodes a hex string.
+ *
+ * @param pc_hex      string, upper or lower case
+ * @param pu8_out     [out] decoded bytes
+ * @param u8_max_len  size of pu8_out
+ * @param pu8_len     [out] decoded length
+ *
+ * @return true if the string is valid and fits pu8_out
+ */
+static bool OtaHexDecode(const char *pc_hex, uint8_t *pu8_out, uint8_t u8_max_len, uint8_t *pu8_len)
+{
+  uint8_t u8_nibble = 0;
+  uint32_t u32_idx;
+  char c_char;
+
+  for (u32_idx = 0; pc_hex[u32_idx] != '\0'; ++u32_idx)
+  {
+    c_char = pc_hex[u32_idx];
+
+    if ((c_char >= '0') && (c_char <= '9'))
+    {
+      u8_nibble = (uint8_t)(c_char - '0');
+    }
+    else if ((c_char >= 'a') && (c_char <= 'f'))
+    {
+      u8_nibble = (uint8_t)(c_char - 'a' + 10);
+    }
+    else if ((c_char >= 'A') && (c_char <= 'F'))
+    {
+      u8_nibble = (uint8_t)(c_char - 'A' + 10);
+    }
+    else
+    {
+      return false;
+    }
+
+    if ((u32_idx / 2) >= u8_max_len)
+    {
+      return false;
+    }
+
+    if ((u32_idx % 2) == 0)
+    {
+      pu8_out[u32_idx / 2] = (uint8_t)(u8_nibble << 4);
+    }
+    else
+    {
+      pu8_out[u32_idx / 2] |= u8_nibble;
+    }
+  }
+
+  if ((u32_idx % 2) != 0)
+  {
+    return false;
+  }
+
+  *pu8_len = (uint8_t)(u32_idx / 2);
+  return true;
+}
+
+/**
+ * @brief   Shows a text on the update layer, on top of any other content. The
+ *          layer has a single producer at a time: the writes and the release
+ *          of the timer are serialized by x_Ota_Layer_Mutex.
+ *
+ * @param pc_text text, one char per digit
+ * @param b_blink true to blink the whole text, for the error of a failed update
+ */
+static void OtaShow(const char *pc_text, bool b_blink)
+{
+  HOLTEK_FRAME_TYPE *px_frame;
+  uint8_t u8_idx;
+
+  xSemaphoreTake(x_Ota_Layer_Mutex, portMAX_DELAY);
+  px_frame = Holtek__Frame_Acquire(HOLTEK_LAYER_OTA);
+
+  memset(px_frame, 0x00, sizeof(HOLTEK_FRAME_TYPE));
+
+  for (u8_idx = 0; (u8_idx < NUM_OF_DIGITS) && (pc_text[u8_idx] != '\0'); ++u8_idx)
+  {
+    px_frame->digit_mask[u8_idx] = Holtek__Get_Glyph(pc_text[u8_idx]);
+  }
+
+  if (b_blink == true)
+  {
+    px_frame->blink_digits = (uint8_t)((1 << NUM_OF_DIGITS) - 1);
+    px_frame->blink_on_ms = 500;
+    px_frame->blink_off_ms = 500;
+  }
+
+  Holtek__Frame_Commit(HOLTEK_LAYER_OTA);
+  b_Ota_Error_Shown = b_blink;
+  xSemaphoreGive(x_Ota_Layer_Mutex);
+}
+
+/**
+ * @brief   Restarts on the new image, runs in the esp_timer task.
+ *
+ * @param pv_args NULL
+ */
+static void OtaRestartCallback(void *pv_args)
+{
+  esp_restart();
+}
+
+/**
+ * @brief   Hides the error of a failed update, runs in the esp_timer task. A
+ *          new upload that has already taken the layer back is left shown.
+ *
+ * @param pv_args NULL
+ */
+static void OtaReleaseCallback(void *pv_args)
+{
+  xSemaphoreTake(x_Ota_Layer_Mutex, portMAX_DELAY);
+  if (b_Ota_Error_Shown == true)
+  {
+    Holtek__Frame_Release(HOLTEK_LAYER_OTA);
+    b_Ota_Error_Shown = false;
+  }
+  xSemaphoreGive(x_Ota_Layer_Mutex);
+}
+
+/**
+ * @brief   Health check of a new image, runs in the esp_timer task. The image
+ *          is kept if the display is refreshed and the network is up,
+ *          otherwise the previous image is restored and booted.
+ *
+ * @param pv_args NULL
+ */
+static void OtaHealthCallback(void *pv_args)
+{
+  if ((Holtek__Is_Running() == true) && (WiFiConn__Is_Connected() == true))
+  {
+    ESP_LOGI(TAG, "health check passed, image confirmed");
+    esp_ota_mark_app_valid_cancel_rollback();
+  }
+  else
+  {
+    ESP_LOGE(TAG, "health check failed (display:%d network:%d), rolling back",
+             Holtek__Is_Running(), WiFiConn__Is_Connected());
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+  }
+}
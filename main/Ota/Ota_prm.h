@@ -0,0 +1,34 @@
+
+/**
+ *  @file       Ota_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef OTA_PRM_H
+    #define OTA_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+// the image is written in chunks of one flash sector, the only buffer of the download
+#define OTA_CHUNK_BYTES             4096
+
+// receive timeouts tolerated in a row before the download is aborted
+#define OTA_RECV_TIMEOUT_RETRIES    5
+
+// delay between the response to the upload and the restart on the new image
+#define OTA_RESTART_DELAY_MS        1000
+
+// time the error of a failed update is shown on the display
+#define OTA_ERROR_SHOW_MS           5000
+
+#endif
@@ -0,0 +1,72 @@
+
+/**
+ *  @file       Ota_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef OTA_PRV_H
+    #define OTA_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_ota_ops.h"
+#include "mbedtls/sha256.h"
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+#define OTA_ENABLE                  CONFIG_APP_OTA_ENABLE
+#define OTA_SIGNATURE_CHECK         CONFIG_APP_OTA_SIGNATURE_CHECK
+#define OTA_PUBLIC_KEY              CONFIG_APP_OTA_PUBLIC_KEY
+#define OTA_HEALTH_CHECK_S          CONFIG_APP_OTA_HEALTH_CHECK_S
+
+/**
+ * Upload: POST /ota, the body is the application image (build/<project>.bin).
+ *
+ *   X-Image-Sha256     SHA-256 of the image, hex
+ *   X-Image-Signature  ECDSA P-256 signature of the SHA-256, DER encoded, hex
+ *                      (required when OTA_SIGNATURE_CHECK is enabled)
+ *
+ * See tools/ota_sign.py.
+ */
+#define OTA_URI                     "/ota"
+#define OTA_HDR_SHA256              "X-Image-Sha256"
+#define OTA_HDR_SIGNATURE           "X-Image-Signature"
+
+#define OTA_SHA256_BYTES            32
+// DER encoded ECDSA P-256 signature: SEQUENCE of two INTEGERs up to 33 bytes each
+#define OTA_SIGNATURE_MAX_BYTES     72
+// uncompressed P-256 point: 0x04, X, Y
+#define OTA_PUBLIC_KEY_BYTES        65
+// longest header value (hex signature) plus terminator
+#define OTA_HDR_MAX_BYTES           ((OTA_SIGNATURE_MAX_BYTES * 2) + 1)
+
+#if OTA_SIGNATURE_CHECK
+// an image checked against a missing key would be refused: the update would never work
+_Static_assert(sizeof(OTA_PUBLIC_KEY) == ((OTA_PUBLIC_KEY_BYTES * 2) + 1),
+               "Ota: CONFIG_APP_OTA_PUBLIC_KEY must be the 130 hex digits printed by tools/ota_sign.py keygen");
+#endif
+
+// download in progress, one at a time: the server runs the handlers in its single task
+typedef struct
+{
+  esp_ota_handle_t handle;
+  const esp_partition_t *partition;
+  mbedtls_sha256_context sha256;
+  uint8_t sha256_expected[OTA_SHA256_BYTES];
+  uint8_t signature[OTA_SIGNATURE_MAX_BYTES];
+  uint8_t signature_len;
+  uint32_t received;
+  uint32_t total;
+  uint8_t percent;                  // progress shown on the display
+}OTA_SESSION_TYPE;
+
+#endif
@@ -0,0 +1,339 @@
+
+/**
+ *  @file       Remote.c
+ *
+ *  @brief      Receiver of the display frames pushed by a server over UDP.
+ *              Packets are validated and decoded in place from the lwIP pbuf,
+ *              in the lwIP thread, straight into the back frame of the remote
+ *              display layer: no copy of the packet and no heap is used.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <string.h>
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcpip.h"
+
+#include <Remote.h>
+#include <Remote_prv.h>
+#include <Holtek.h>
+#include <Metrics.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static struct udp_pcb *px_Remote_Pcb;
+
+static REMOTE_SENDER_TYPE x_Remote_Sender;
+
+static const char *TAG = "Remote";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static void RemoteUdpSetup(void *pv_args);
+static void RemoteUdpReceive(void *pv_args, struct udp_pcb *px_pcb, struct pbuf *px_pbuf, const ip_addr_t *px_addr, u16_t u16_port);
+static bool RemoteSequenceCheck(const ip_addr_t *px_addr, uint16_t u16_port, uint8_t u8_flags, uint32_t u32_seq);
+static bool RemoteDecode(const uint8_t *pu8_data, uint16_t u16_len, HOLTEK_FRAME_TYPE *px_frame);
+static uint16_t RemoteGetU16(const uint8_t *pu8_data);
+static uint32_t RemoteGetU32(const uint8_t *pu8_data);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, opens the UDP port: to be called
+ *          when the network interface has been initialized.
+ *
+ */
+void Remote__Initialize(void)
+{
+  memset(&x_Remote_Sender, 0x00, sizeof(x_Remote_Sender));
+
+  SysMon__Register_Module(TAG, sizeof(x_Remote_Sender));
+
+#if REMOTE_UDP_ENABLE
+  // raw API calls must run in the lwIP thread
+  if (tcpip_callback(RemoteUdpSetup, NULL) != ERR_OK)
+  {
+    ESP_LOGE(TAG, "UDP setup not scheduled");
+  }
+#endif
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Creates the UDP PCB and binds it to the protocol port, runs in the lwIP thread.
+ *
+ * @param pv_args NULL
+ */
+static void RemoteUdpSetup(void *pv_args)
+{
+  px_Remote_Pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+  if (px_Remote_Pcb == NULL)
+  {
+    ESP_LOGE(TAG, "UDP PCB not allocated");
+    return;
+  }
+
+  if (udp_bind(px_Remote_Pcb, IP_ANY_TYPE, REMOTE_UDP_PORT) != ERR_OK)
+  {
+    ESP_LOGE(TAG, "UDP port %d not available", REMOTE_UDP_PORT);
+    udp_remove(px_Remote_Pcb);
+    px_Remote_Pcb = NULL;
+    return;
+  }
+
+  udp_recv(px_Remote_Pcb, RemoteUdpReceive, NULL);
+
+  ESP_LOGI(TAG, "listening on UDP port %d", REMOTE_UDP_PORT);
+}
+
+/**
+ * @brief   UDP receive callback, runs in the lwIP thread. The packet is decoded
+ *          from the pbuf payload and the frame is committed right away.
+ *
+ * @param pv_args   NULL
+ * @param px_pcb    receiving PCB
+ * @param px_pbuf   packet, to be freed
+ * @param px_addr   sender address
+ * @param u16_port  sender port
+ */
+static void RemoteUdpReceive(void *pv_args, struct udp_pcb *px_pcb, struct pbuf *px_pbuf, const ip_addr_t *px_addr, u16_t u16_port)
+{
+  const uint8_t *pu8_data = (const uint8_t *)px_pbuf->payload;
+  HOLTEK_FRAME_TYPE *px_frame;
+  uint8_t u8_flags;
+
+  Metrics__Counter_Add(METRICS_REMOTE_RX, 1);
+
+  // packets are small, a chained pbuf is not expected and would need a copy
+  if ((px_pbuf->len != px_pbuf->tot_len) ||
+      (px_pbuf->len < REMOTE_HEADER_BYTES) ||
+      (pu8_data[0] != REMOTE_MAGIC_0) ||
+      (pu8_data[1] != REMOTE_MAGIC_1) ||
+      (pu8_data[2] != REMOTE_PROTOCOL_VERSION))
+  {
+    Metrics__Counter_Add(METRICS_REMOTE_INVALID, 1);
+    pbuf_free(px_pbuf);
+    return;
+  }
+
+  u8_flags = pu8_data[3];
+
+  if (RemoteSequenceCheck(px_addr, u16_port, u8_flags, RemoteGetU32(&pu8_data[4])) == false)
+  {
+    Metrics__Counter_Add(METRICS_REMOTE_STALE, 1);
+    pbuf_free(px_pbuf);
+    return;
+  }
+
+  if ((u8_flags & REMOTE_FLAG_RELEASE) != 0)
+  {
+    Holtek__Frame_Release(HOLTEK_LAYER_REMOTE);
+  }
+  else
+  {
+    px_frame = Holtek__Frame_Acquire(HOLTEK_LAYER_REMOTE);
+
+    // a frame left half decoded is overwritten by the next acquire
+    if (RemoteDecode(&pu8_data[REMOTE_HEADER_BYTES], (px_pbuf->len - REMOTE_HEADER_BYTES), px_frame) == true)
+    {
+      Holtek__Frame_Commit(HOLTEK_LAYER_REMOTE);
+    }
+    else
+    {
+      Metrics__Counter_Add(METRICS_REMOTE_INVALID, 1);
+    }
+  }
+
+  pbuf_free(px_pbuf);
+}
+
+/**
+ * @brief   Drops stale and duplicated packets. The sequence is compared with
+ *          serial number arithmetic, so it can wrap. It is restarted when the
+ *          sender asks for it, when the sender changes or when it has been
+ *          silent for REMOTE_SEQ_TIMEOUT_S.
+ *
+ * @return true if the packet is newer than the last accepted one
+ */
+static bool RemoteSequenceCheck(const ip_addr_t *px_addr, uint16_t u16_port, uint8_t u8_flags, uint32_t u32_seq)
+{
+  int64_t s64_now_us = esp_timer_get_time();
+  bool b_accept;
+
+  b_accept = ((x_Remote_Sender.valid == false) ||
+              ((u8_flags & REMOTE_FLAG_RESYNC) != 0) ||
+              (ip_addr_cmp(&x_Remote_Sender.addr, px_addr) == 0) ||
+              (x_Remote_Sender.port != u16_port) ||
+              ((s64_now_us - x_Remote_Sender.rx_us) >= (REMOTE_SEQ_TIMEOUT_S * 1000000LL)) ||
+              ((int32_t)(u32_seq - x_Remote_Sender.seq) > 0));
+
+  if (b_accept == true)
+  {
+    ip_addr_copy(x_Remote_Sender.addr, *px_addr);
+    x_Remote_Sender.port = u16_port;
+    x_Remote_Sender.seq = u32_seq;
+    x_Remote_Sender.rx_us = s64_now_us;
+    x_Remote_Sender.valid = true;
+  }
+
+  return b_accept;
+}
+
+/**
+ * @brief   Applies the records of a packet to a frame.
+ *
+ * @param pu8_data  first record
+ * @param u16_len   length of the records
+ * @param px_frame  [in/out] frame, holds the last frame received
+ *
+ * @return true if all records are valid
+ */
+static bool RemoteDecode(const uint8_t *pu8_data, uint16_t u16_len, HOLTEK_FRAME_TYPE *px_frame)
+{
+  const uint8_t *pu8_value;
+  uint32_t u32_bitmap;
+  uint8_t u8_tag;
+  uint8_t u8_len;
+  uint8_t u8_digit;
+  uint8_t u8_idx;
+
+  while (u16_len != 0)
+  {
+    if (u16_len < REMOTE_RECORD_HEADER_BYTES)
+    {
+      return false;
+    }
+
+    u8_tag = pu8_data[0];
+    u8_len = pu8_data[1];
+    pu8_value = &pu8_data[REMOTE_RECORD_HEADER_BYTES];
+
+    if ((REMOTE_RECORD_HEADER_BYTES + u8_len) > u16_len)
+    {
+      return false;
+    }
+
+    switch (u8_tag)
+    {
+      case REMOTE_TAG_CLEAR:
+        memset(px_frame->digit_mask, 0x00, sizeof(px_frame->digit_mask));
+        memset(px_frame->icons, 0x00, sizeof(px_frame->icons));
+        memset(px_frame->blink_icons, 0x00, sizeof(px_frame->blink_icons));
+        px_frame->blink_digits = 0;
+        px_frame->blink_on_ms = 0;
+        px_frame->blink_off_ms = 0;
+        break;
+
+      case REMOTE_TAG_TEXT:
+        if ((u8_len < 1) || (pu8_value[0] >= NUM_OF_DIGITS))
+        {
+          return false;
+        }
+
+        u8_digit = pu8_value[0];
+        for (u8_idx = 1; u8_idx < u8_len; ++u8_idx)
+        {
+          if ((pu8_value[u8_idx] == '.') && (u8_idx > 1))
+          {
+            px_frame->digit_mask[u8_digit - 1] |= DISPLAY_SEG_DP;
+          }
+          else if (u8_digit < NUM_OF_DIGITS)
+          {
+            px_frame->digit_mask[u8_digit++] = Holtek__Get_Glyph(pu8_value[u8_idx]);
+          }
+          else
+          {
+            return false;
+          }
+        }
+        break;
+
+      case REMOTE_TAG_SEGMENTS:
+        if ((u8_len < 1) || (((u8_len - 1) % 4) != 0) ||
+            ((pu8_value[0] + ((u8_len - 1) / 4)) > NUM_OF_DIGITS))
+        {
+          return false;
+        }
+
+        for (u8_idx = 0; u8_idx < ((u8_len - 1) / 4); ++u8_idx)
+        {
+          px_frame->digit_mask[pu8_value[0] + u8_idx] = RemoteGetU32(&pu8_value[1 + (u8_idx * 4)]);
+        }
+        break;
+
+      case REMOTE_TAG_ICONS:
+        if (u8_len != REMOTE_ICONS_WIRE_BYTES)
+        {
+          return false;
+        }
+
+        u32_bitmap = RemoteGetU32(pu8_value);
+        for (u8_idx = 0; u8_idx < DISPLAY_ICONS_BITMAP_BYTES_NUM; ++u8_idx)
+        {
+          px_frame->icons[u8_idx] = (uint8_t)(u32_bitmap >> (u8_idx * 8));
+        }
+        break;
+
+      case REMOTE_TAG_BLINK:
+        if (u8_len != REMOTE_BLINK_WIRE_BYTES)
+        {
+          return false;
+        }
+
+        px_frame->blink_on_ms = RemoteGetU16(&pu8_value[0]);
+        px_frame->blink_off_ms = RemoteGetU16(&pu8_value[2]);
+        px_frame->blink_digits = pu8_value[4];
+
+        u32_bitmap = RemoteGetU32(&pu8_value[5]);
+        for (u8_idx = 0; u8_idx < DISPLAY_ICONS_BITMAP_BYTES_NUM; ++u8_idx)
+        {
+          px_frame->blink_icons[u8_idx] = (uint8_t)(u32_bitmap >> (u8_idx * 8));
+        }
+        break;
+
+      default:
+        // unknown record, newer protocol revision
+        break;
+    }
+
+    pu8_data += (REMOTE_RECORD_HEADER_BYTES + u8_len);
+    u16_len -= (REMOTE_RECORD_HEADER_BYTES + u8_len);
+  }
+
+  return true;
+}
+
+/**
+ * @brief   Reads a little endian 16-bit value, the payload may be unaligned.
+ */
+static uint16_t RemoteGetU16(const uint8_t *pu8_data)
+{
+  return (uint16_t)(pu8_data[0] | (pu8_data[1] << 8));
+}
+
+/**
+ * @brief   Reads a little endian 32-bit value, the payload may be unaligned.
+ */
+static uint32_t RemoteGetU32(const uint8_t *pu8_data)
+{
+  return ((uint32_t)pu8_data[0] | ((uint32_t)pu8_data[1] << 8) | ((uint32_t)pu8_data[2] << 16) | ((uint32_t)pu8_data[3] << 24));
+}
@@ -0,0 +1,75 @@
+
+/**
+ *  @file       Remote_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef REMOTE_PRV_H
+    #define REMOTE_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/ip_addr.h"
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+#define REMOTE_UDP_ENABLE           CONFIG_REMOTE_UDP_ENABLE
+#define REMOTE_UDP_PORT             CONFIG_REMOTE_UDP_PORT
+#define REMOTE_SEQ_TIMEOUT_S        CONFIG_REMOTE_SEQ_TIMEOUT_S
+
+/**
+ * Wire format, all fields little endian:
+ *
+ *   offset  size  field
+ *   0       2     magic "CK"
+ *   2       1     version (REMOTE_PROTOCOL_VERSION)
+ *   3       1     flags (REMOTE_FLAG_*)
+ *   4       4     sequence number, increasing per sender
+ *   8       ...   records: tag (1), length (1), value (length)
+ *
+ * Records are applied in order to the last frame received, records with an
+ * unknown tag are skipped so that newer senders can talk to older clocks.
+ * A packet is applied only if all its records are valid.
+ */
+#define REMOTE_MAGIC_0              'C'
+#define REMOTE_MAGIC_1              'K'
+#define REMOTE_HEADER_BYTES         8
+#define REMOTE_RECORD_HEADER_BYTES  2
+
+// the sequence of the sender restarts, accept any sequence number
+#define REMOTE_FLAG_RESYNC          0x01
+// hand the display back to the local content, records are ignored
+#define REMOTE_FLAG_RELEASE         0x02
+
+typedef enum
+{
+  REMOTE_TAG_CLEAR = 0x01,      /*no value: all digits, icons and blink off*/
+  REMOTE_TAG_TEXT = 0x02,       /*first digit (1), chars: a '.' sets the dot of the previous char*/
+  REMOTE_TAG_SEGMENTS = 0x03,   /*first digit (1), segment masks (4 each), DISPLAY_SEG_DP for the dot*/
+  REMOTE_TAG_ICONS = 0x04,      /*icons bitmap (4), bit n = DISPLAY_ICON_ENUM n*/
+  REMOTE_TAG_BLINK = 0x05,      /*on ms (2), off ms (2), digits bitmap (1), icons bitmap (4)*/
+}REMOTE_TAG_ENUM;
+
+#define REMOTE_ICONS_WIRE_BYTES     4
+#define REMOTE_BLINK_WIRE_BYTES     9
+
+// last packet accepted, used to drop stale and duplicated packets
+typedef struct
+{
+  ip_addr_t addr;
+  uint16_t port;
+  uint32_t seq;
+  int64_t rx_us;
+  bool valid;
+}REMOTE_SENDER_TYPE;
+
+#endif
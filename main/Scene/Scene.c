@@ -0,0 +1,838 @@
+
+/**
+ *  @file       Scene.c
+ *
+ *  @brief      Interpreter of the display scenes: small bytecode programs
+ *              drawing text, glyph frames, icons, blink and the local time
+ *              on the scene layer, with waits and loops. A program is pushed
+ *              with the network command or restored from flash at boot, it
+ *              is verified once and then run by a task from static buffers,
+ *              with no heap. The interpreter time of each frame is measured.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include <Scene.h>
+#include <Scene_prv.h>
+#include <Holtek.h>
+#include <TimeZone.h>
+#include <TickSync.h>
+#include <Settings.h>
+#include <HttpSrv.h>
+#include <Metrics.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+// running program, written by Scene__Load() while the task waits
+static uint8_t pu8_Scene_Program[SCENE_PROGRAM_MAX];
+static uint16_t u16_Scene_Program_Len;
+// the task has to restart from the program
+static bool b_Scene_Pending;
+
+// program run at boot, copy of the one in flash
+static uint8_t pu8_Scene_Stored[SCENE_PROGRAM_MAX];
+static uint16_t u16_Scene_Stored_Len;
+
+// body of the network command, only used by the HTTP server task
+static uint8_t pu8_Scene_Rx[SCENE_PROGRAM_MAX];
+
+static SCENE_VM_TYPE x_Scene_Vm;
+static SCENE_STATS_TYPE x_Scene_Stats;
+
+static SemaphoreHandle_t x_Scene_Mutex;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t x_Scene_Mutex_Buffer;
+#endif
+
+static TaskHandle_t x_Scene_Task_Hdl;
+
+static const char *TAG = "Scene";
+
+// stack and TCB of the task, reserved at link time in static allocation mode
+SYSMON_TASK_POOL(x_Scene_Task, SCENE_TASK_STACK)
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static void SceneTaskCallback(void *pv_args);
+static void SceneRestart(void);
+static TickType_t SceneRun(void);
+static void SceneStop(SCENE_STATE_ENUM e_state);
+static HOLTEK_FRAME_TYPE *SceneFrame(void);
+static void SceneText(HOLTEK_FRAME_TYPE *px_frame, uint8_t u8_digit, const uint8_t *pu8_chars, uint8_t u8_len);
+static void SceneTime(HOLTEK_FRAME_TYPE *px_frame, uint8_t u8_digit, uint8_t u8_field);
+static TickType_t SceneTick(uint8_t u8_unit);
+static TickType_t SceneWait(void);
+static const char *SceneVerify(const uint8_t *pu8_program, uint16_t u16_len);
+static uint16_t SceneOpBytes(const uint8_t *pu8_op);
+static uint16_t SceneTableFill(void *pv_buffer, uint16_t u16_max_bytes);
+static uint16_t SceneGetU16(const uint8_t *pu8_data);
+static uint32_t SceneGetU32(const uint8_t *pu8_data);
+static esp_err_t SceneHttpGetHandler(httpd_req_t *px_req);
+static esp_err_t SceneHttpPostHandler(httpd_req_t *px_req);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method: restores the stored program, starts
+ *          the interpreter task and registers the network command. To be
+ *          called after the display, the settings, the time zone and the
+ *          HTTP server are started.
+ *
+ */
+void Scene__Initialize(void)
+{
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = SCENE_URI,
+    .method = HTTP_GET,
+    .handler = SceneHttpGetHandler,
+    .user_ctx = NULL
+  };
+  const httpd_uri_t x_post_uri =
+  {
+    .uri = SCENE_URI,
+    .method = HTTP_POST,
+    .handler = SceneHttpPostHandler,
+    .user_ctx = NULL
+  };
+  const char *pc_error;
+
+#if CONFIG_APP_STATIC_ALLOCATION
+  x_Scene_Mutex = xSemaphoreCreateMutexStatic(&x_Scene_Mutex_Buffer);
+  SysMon__Register_Module(TAG, sizeof(x_Scene_Mutex_Buffer));
+#else
+  x_Scene_Mutex = xSemaphoreCreateMutex();
+#endif
+
+  SysMon__Register_Module(TAG, sizeof(pu8_Scene_Program) + sizeof(pu8_Scene_Stored) + sizeof(pu8_Scene_Rx) +
+                               sizeof(x_Scene_Vm) + sizeof(x_Scene_Stats) + SYSMON_TASK_POOL_BYTES(x_Scene_Task));
+
+  u16_Scene_Stored_Len = Settings__Load_Table(SETTINGS_TABLE_SCENE, pu8_Scene_Stored, SCENE_PROGRAM_MAX,
+                                              SceneTableFill);
+  if (u16_Scene_Stored_Len != 0)
+  {
+    // written by an older firmware, or by a newer one before a downgrade
+    pc_error = SceneVerify(pu8_Scene_Stored, u16_Scene_Stored_Len);
+    if (pc_error != NULL)
+    {
+      ESP_LOGW(TAG, "stored program not run: %s", pc_error);
+      u16_Scene_Stored_Len = 0;
+    }
+    else
+    {
+      memcpy(pu8_Scene_Program, pu8_Scene_Stored, u16_Scene_Stored_Len);
+      u16_Scene_Program_Len = u16_Scene_Stored_Len;
+      b_Scene_Pending = true;
+    }
+  }
+
+  SYSMON_TASK_CREATE(x_Scene_Task, SceneTaskCallback, "Scene", SCENE_TASK_STACK, NULL,
+                     SCENE_TASK_PRIO, &x_Scene_Task_Hdl, tskNO_AFFINITY);
+  SysMon__Register_Task(TAG, x_Scene_Task_Hdl, SCENE_TASK_STACK);
+
+  if (b_Scene_Pending == true)
+  {
+    xTaskNotifyGive(x_Scene_Task_Hdl);
+  }
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+  (void)HttpSrv__Register_Uri(&x_post_uri);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Replaces the running program, the new one starts at once from an
+ *          empty frame. A program with SCENE_FLAG_STORE also replaces the
+ *          one run at boot: with no code, nothing is shown at boot.
+ *
+ * @param pu8_program program, header included, copied
+ * @param u16_len     length of the program, 0 stops the running one
+ * @param ppc_error   [out] reason of the refusal, can be NULL
+ *
+ * @return false if the program is not valid
+ */
+bool Scene__Load(const uint8_t *pu8_program, uint16_t u16_len, const char **ppc_error)
+{
+  const char *pc_error = NULL;
+  bool b_store = false;
+
+  if (x_Scene_Task_Hdl == NULL)
+  {
+    pc_error = "interpreter not started";
+  }
+  else if (u16_len > SCENE_PROGRAM_MAX)
+  {
+    pc_error = "program too large";
+  }
+  else if (u16_len != 0)
+  {
+    pc_error = SceneVerify(pu8_program, u16_len);
+  }
+
+  if (pc_error != NULL)
+  {
+    if (ppc_error != NULL)
+    {
+      *ppc_error = pc_error;
+    }
+    Metrics__Counter_Add(METRICS_SCENE_REJECTED, 1);
+    return false;
+  }
+
+  // the task holds the mutex while it runs the ops, the program is replaced during a wait
+  xSemaphoreTake(x_Scene_Mutex, portMAX_DELAY);
+  memcpy(pu8_Scene_Program, pu8_program, u16_len);
+  u16_Scene_Program_Len = u16_len;
+  b_Scene_Pending = true;
+  if ((u16_len != 0) && ((pu8_program[3] & SCENE_FLAG_STORE) != 0))
+  {
+    memcpy(pu8_Scene_Stored, pu8_program, u16_len);
+    u16_Scene_Stored_Len = u16_len;
+    b_store = true;
+  }
+  xSemaphoreGive(x_Scene_Mutex);
+
+  xTaskNotifyGive(x_Scene_Task_Hdl);
+
+  if (b_store == true)
+  {
+    Settings__Table_Changed(SETTINGS_TABLE_SCENE);
+  }
+
+  Metrics__Counter_Add(METRICS_SCENE_LOADS, 1);
+  ESP_LOGI(TAG, "program of %u bytes loaded%s", u16_len, ((b_store == true) ? ", stored" : ""));
+
+  return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Returns the state of the interpreter and the cost of the frames.
+ *
+ * @param px_stats [out] statistics
+ */
+void Scene__Get_Stats(SCENE_STATS_TYPE *px_stats)
+{
+  if (x_Scene_Mutex == NULL)
+  {
+    memset(px_stats, 0x00, sizeof(SCENE_STATS_TYPE));
+    return;
+  }
+
+  xSemaphoreTake(x_Scene_Mutex, portMAX_DELAY);
+  *px_stats = x_Scene_Stats;
+  px_stats->stored_bytes = u16_Scene_Stored_Len;
+  xSemaphoreGive(x_Scene_Mutex);
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Interpreter task: runs the ops up to the next wait with the mutex
+ *          taken, then sleeps until the end of the wait or a new program.
+ *
+ * @param pv_args NULL
+ */
+static void SceneTaskCallback(void *pv_args)
+{
+  TickType_t x_wait = portMAX_DELAY;
+
+  for (;;)
+  {
+    // only Scene__Load() notifies the task, always with a program pending
+    (void)ulTaskNotifyTake(pdTRUE, x_wait);
+
+    xSemaphoreTake(x_Scene_Mutex, portMAX_DELAY);
+    if (b_Scene_Pending == true)
+    {
+      b_Scene_Pending = false;
+      SceneRestart();
+    }
+
+    x_wait = (x_Scene_Stats.state == SCENE_STATE_RUNNING) ? SceneRun() : portMAX_DELAY;
+    xSemaphoreGive(x_Scene_Mutex);
+  }
+}
+
+/**
+ * @brief   Starts the program from its first op, or hides the layer if there
+ *          is none. The statistics restart with the program.
+ *
+ */
+static void SceneRestart(void)
+{
+  memset(&x_Scene_Vm, 0x00, sizeof(x_Scene_Vm));
+  memset(&x_Scene_Stats, 0x00, sizeof(x_Scene_Stats));
+
+  if (u16_Scene_Program_Len == 0)
+  {
+    SceneStop(SCENE_STATE_IDLE);
+    return;
+  }
+
+  x_Scene_Vm.code = &pu8_Scene_Program[SCENE_HEADER_BYTES];
+  x_Scene_Vm.len = SceneGetU16(&pu8_Scene_Program[4]);
+  x_Scene_Vm.blank = true;
+  x_Scene_Vm.deadline = xTaskGetTickCount();
+
+  x_Scene_Stats.state = SCENE_STATE_RUNNING;
+  x_Scene_Stats.program_bytes = u16_Scene_Program_Len;
+}
+
+/**
+ * @brief   Runs the ops up to the next wait or to the end of the program.
+ *          The program has been verified, operands and loops are not
+ *          checked again. The time from the start of the run, or from the
+ *          previous frame, to each frame shown is its cost.
+ *
+ * @return ticks to the end of the wait, portMAX_DELAY at the end of the program
+ */
+static TickType_t SceneRun(void)
+{
+  SCENE_VM_TYPE *px_vm = &x_Scene_Vm;
+  SCENE_LOOP_TYPE *px_loop;
+  HOLTEK_FRAME_TYPE *px_frame;
+  const uint8_t *pu8_op;
+  int64_t s64_start_us = esp_timer_get_time();
+  int64_t s64_now_us;
+  uint32_t u32_bitmap;
+  uint32_t u32_frame_us;
+  uint16_t u16_ops = 0;
+  uint8_t u8_idx;
+
+  while (px_vm->pc < px_vm->len)
+  {
+    if (++u16_ops > SCENE_OPS_PER_WAIT_MAX)
+    {
+      ESP_LOGE(TAG, "no wait in %u ops, stopped at %u", SCENE_OPS_PER_WAIT_MAX, px_vm->pc);
+      Metrics__Counter_Add(METRICS_SCENE_ABORTED, 1);
+      x_Scene_Stats.ops += (u16_ops - 1);
+      SceneStop(SCENE_STATE_ABORTED);
+      return portMAX_DELAY;
+    }
+
+    pu8_op = &px_vm->code[px_vm->pc];
+    px_vm->pc += (1 + SceneOpBytes(pu8_op));
+
+    switch (pu8_op[0])
+    {
+      case SCENE_OP_END:
+        px_vm->pc = px_vm->len;
+        break;
+
+      case SCENE_OP_CLEAR:
+        px_frame = SceneFrame();
+        memset(px_frame->digit_mask, 0x00, sizeof(px_frame->digit_mask));
+        memset(px_frame->icons, 0x00, sizeof(px_frame->icons));
+        memset(px_frame->blink_icons, 0x00, sizeof(px_frame->blink_icons));
+        px_frame->blink_digits = 0;
+        px_frame->blink_on_ms = 0;
+        px_frame->blink_off_ms = 0;
+        break;
+
+      case SCENE_OP_TEXT:
+        SceneText(SceneFrame(), pu8_op[1], &pu8_op[3], pu8_op[2]);
+        break;
+
+      case SCENE_OP_SEGS:
+        px_frame = SceneFrame();
+        for (u8_idx = 0; u8_idx < pu8_op[2]; ++u8_idx)
+        {
+          px_frame->digit_mask[pu8_op[1] + u8_idx] = SceneGetU32(&pu8_op[3 + (u8_idx * 4)]);
+        }
+        break;
+
+      case SCENE_OP_ICONS:
+        px_frame = SceneFrame();
+        u32_bitmap = SceneGetU32(&pu8_op[1]);
+        for (u8_idx = 0; u8_idx < DISPLAY_ICONS_BITMAP_BYTES_NUM; ++u8_idx)
+        {
+          px_frame->icons[u8_idx] = (uint8_t)(u32_bitmap >> (u8_idx * 8));
+        }
+        break;
+
+      case SCENE_OP_BLINK:
+        px_frame = SceneFrame();
+        px_frame->blink_on_ms = SceneGetU16(&pu8_op[1]);
+        px_frame->blink_off_ms = SceneGetU16(&pu8_op[3]);
+        px_frame->blink_digits = pu8_op[5];
+        u32_bitmap = SceneGetU32(&pu8_op[6]);
+        for (u8_idx = 0; u8_idx < DISPLAY_ICONS_BITMAP_BYTES_NUM; ++u8_idx)
+        {
+          px_frame->blink_icons[u8_idx] = (uint8_t)(u32_bitmap >> (u8_idx * 8));
+        }
+        break;
+
+      case SCENE_OP_SHOW:
+        (void)SceneFrame();
+        Holtek__Frame_Commit(HOLTEK_LAYER_SCENE);
+        px_vm->frame = NULL;
+
+        s64_now_us = esp_timer_get_time();
+        u32_frame_us = (uint32_t)(s64_now_us - s64_start_us);
+        s64_start_us = s64_now_us;
+        x_Scene_Stats.frames++;
+        x_Scene_Stats.frame_us_sum += u32_frame_us;
+        x_Scene_Stats.frame_us_max = MAX(x_Scene_Stats.frame_us_max, u32_frame_us);
+        Metrics__Histogram_Observe(METRICS_SCENE_FRAME_US, u32_frame_us);
+        break;
+
+      case SCENE_OP_WAIT:
+        px_vm->deadline += pdMS_TO_TICKS(SceneGetU16(&pu8_op[1]));
+        x_Scene_Stats.ops += u16_ops;
+        return SceneWait();
+
+      case SCENE_OP_LOOP:
+        px_loop = &px_vm->loop[px_vm->depth++];
+        px_loop->start = px_vm->pc;
+        px_loop->left = pu8_op[1];
+        break;
+
+      case SCENE_OP_NEXT:
+        px_loop = &px_vm->loop[px_vm->depth - 1];
+        if ((px_loop->left == 0) || (--px_loop->left != 0))
+        {
+          px_vm->pc = px_loop->start;
+        }
+        else
+        {
+          px_vm->depth--;
+        }
+        break;
+
+      case SCENE_OP_TIME:
+        SceneTime(SceneFrame(), pu8_op[1], pu8_op[2]);
+        break;
+
+      case SCENE_OP_TICK:
+        px_vm->deadline = xTaskGetTickCount() + SceneTick(pu8_op[1]);
+        x_Scene_Stats.ops += u16_ops;
+        return SceneWait();
+
+      default:
+        break;
+    }
+  }
+
+  x_Scene_Stats.ops += u16_ops;
+  SceneStop(SCENE_STATE_ENDED);
+
+  return portMAX_DELAY;
+}
+
+/**
+ * @brief   Hides the scene layer, the layers below it are shown again.
+ *
+ * @param e_state state of the interpreter from now on
+ */
+static void SceneStop(SCENE_STATE_ENUM e_state)
+{
+  x_Scene_Vm.frame = NULL;
+  x_Scene_Stats.state = e_state;
+
+  Holtek__Frame_Release(HOLTEK_LAYER_SCENE);
+}
+
+/**
+ * @brief   Returns the frame being drawn, acquired by the first drawing op
+ *          after a frame is shown.
+ *
+ * @return frame of the scene layer
+ */
+static HOLTEK_FRAME_TYPE *SceneFrame(void)
+{
+  if (x_Scene_Vm.frame == NULL)
+  {
+    x_Scene_Vm.frame = Holtek__Frame_Acquire(HOLTEK_LAYER_SCENE);
+
+    // the last frame of the previous program is not carried over
+    if (x_Scene_Vm.blank == true)
+    {
+      memset(x_Scene_Vm.frame, 0x00, sizeof(HOLTEK_FRAME_TYPE));
+      x_Scene_Vm.blank = false;
+    }
+  }
+
+  return x_Scene_Vm.frame;
+}
+
+/**
+ * @brief   Writes chars from a digit, a '.' lights the dot of the previous char.
+ *
+ * @param px_frame  frame
+ * @param u8_digit  first digit
+ * @param pu8_chars chars, verified to fit the digits
+ * @param u8_len    number of chars
+ */
+static void SceneText(HOLTEK_FRAME_TYPE *px_frame, uint8_t u8_digit, const uint8_t *pu8_chars, uint8_t u8_len)
+{
+  uint8_t u8_idx;
+
+  for (u8_idx = 0; u8_idx < u8_len; ++u8_idx)
+  {
+    if ((pu8_chars[u8_idx] == '.') && (u8_idx > 0))
+    {
+      px_frame->digit_mask[u8_digit - 1] |= DISPLAY_SEG_DP;
+    }
+    else
+    {
+      px_frame->digit_mask[u8_digit++] = Holtek__Get_Glyph(pu8_chars[u8_idx]);
+    }
+  }
+}
+
+/**
+ * @brief   Writes two digits of the local time, "--" until the clock is set.
+ *
+ * @param px_frame  frame
+ * @param u8_digit  first digit
+ * @param u8_field  SCENE_TIME_FIELD_ENUM, SCENE_TIME_NO_ZERO to blank the leading zero
+ */
+static void SceneTime(HOLTEK_FRAME_TYPE *px_frame, uint8_t u8_digit, uint8_t u8_field)
+{
+  int64_t s64_now_s = TickSync__Get_Time_Us() / 1000000;
+  struct tm x_tm;
+  time_t x_local;
+  int s32_value;
+
+  if (s64_now_s < SCENE_CLOCK_VALID_S)
+  {
+    px_frame->digit_mask[u8_digit] = Holtek__Get_Glyph('-');
+    px_frame->digit_mask[u8_digit + 1] = Holtek__Get_Glyph('-');
+    return;
+  }
+
+  x_local = (time_t)TimeZone__To_Local(s64_now_s);
+  gmtime_r(&x_local, &x_tm);
+
+  switch (u8_field & ~SCENE_TIME_NO_ZERO)
+  {
+    case SCENE_TIME_HOUR_12:
+      s32_value = (((x_tm.tm_hour % 12) == 0) ? 12 : (x_tm.tm_hour % 12));
+      break;
+    case SCENE_TIME_MINUTE:
+      s32_value = x_tm.tm_min;
+      break;
+    case SCENE_TIME_SECOND:
+      s32_value = x_tm.tm_sec;
+      break;
+    case SCENE_TIME_DAY:
+      s32_value = x_tm.tm_mday;
+      break;
+    case SCENE_TIME_MONTH:
+      s32_value = x_tm.tm_mon + 1;
+      break;
+    case SCENE_TIME_YEAR:
+      s32_value = x_tm.tm_year % 100;
+      break;
+    case SCENE_TIME_HOUR:
+    default:
+      s32_value = x_tm.tm_hour;
+      break;
+  }
+
+  px_frame->digit_mask[u8_digit] = (((s32_value >= 10) || ((u8_field & SCENE_TIME_NO_ZERO) == 0))
+                                    ? Holtek__Get_Glyph((uint8_t)('0' + (s32_value / 10))) : 0);
+  px_frame->digit_mask[u8_digit + 1] = Holtek__Get_Glyph((uint8_t)('0' + (s32_value % 10)));
+}
+
+/**
+ * @brief   Ticks to the first tick after the next second or minute of the
+ *          clock, shared with the LAN when the tick sync is on. Minutes are
+ *          the same in UTC and local time.
+ *
+ * @param u8_unit SCENE_TICK_ENUM
+ *
+ * @return ticks, at least one
+ */
+static TickType_t SceneTick(uint8_t u8_unit)
+{
+  uint32_t u32_unit_us = ((u8_unit == SCENE_TICK_MINUTE) ? 60000000UL : 1000000UL);
+  uint32_t u32_left_us;
+
+  u32_left_us = u32_unit_us - (uint32_t)(TickSync__Get_Time_Us() % u32_unit_us);
+
+  return (pdMS_TO_TICKS(u32_left_us / 1000) + 1);
+}
+
+/**
+ * @brief   Time left to the deadline of the wait. A late program keeps its
+ *          pace from now on, and a wait always gives up at least a tick.
+ *
+ * @return ticks to sleep
+ */
+static TickType_t SceneWait(void)
+{
+  TickType_t x_now = xTaskGetTickCount();
+
+  if ((int32_t)(x_Scene_Vm.deadline - x_now) <= 0)
+  {
+    x_Scene_Vm.deadline = x_now + 1;
+  }
+
+  return (x_Scene_Vm.deadline - x_now);
+}
+
+/**
+ * @brief   Checks a program before it is run: header, length, opcodes,
+ *          operands inside the code and the digits, balanced loops within
+ *          SCENE_LOOP_DEPTH. The interpreter relies on it.
+ *
+ * @param pu8_program program, header included
+ * @param u16_len     length of the program
+ *
+ * @return NULL if valid, otherwise the reason
+ */
+static const char *SceneVerify(const uint8_t *pu8_program, uint16_t u16_len)
+{
+  const uint8_t *pu8_code = &pu8_program[SCENE_HEADER_BYTES];
+  const uint8_t *pu8_op;
+  uint16_t u16_code_len;
+  uint16_t u16_pc = 0;
+  uint8_t u8_depth = 0;
+  uint8_t u8_digit;
+  uint8_t u8_idx;
+
+  if ((u16_len < SCENE_HEADER_BYTES) || (pu8_program[0] != SCENE_MAGIC_0) || (pu8_program[1] != SCENE_MAGIC_1))
+  {
+    return "not a scene";
+  }
+  if (pu8_program[2] != SCENE_FORMAT_VERSION)
+  {
+    return "unknown version";
+  }
+
+  u16_code_len = SceneGetU16(&pu8_program[4]);
+  if ((SCENE_HEADER_BYTES + u16_code_len) != u16_len)
+  {
+    return "length mismatch";
+  }
+
+  while (u16_pc < u16_code_len)
+  {
+    pu8_op = &pu8_code[u16_pc];
+
+    if (pu8_op[0] >= NUM_OF_SCENE_OPS)
+    {
+      return "unknown op";
+    }
+    // the count of the chars or masks is read only once the fixed operands are in the code
+    if (((u16_pc + 1 + SCENE_Op_Bytes[pu8_op[0]]) > u16_code_len) ||
+        ((u16_pc + 1 + SceneOpBytes(pu8_op)) > u16_code_len))
+    {
+      return "truncated op";
+    }
+
+    switch (pu8_op[0])
+    {
+      case SCENE_OP_TEXT:
+        u8_digit = pu8_op[1];
+        for (u8_idx = 0; u8_idx < pu8_op[2]; ++u8_idx)
+        {
+          if ((pu8_op[3 + u8_idx] == '.') && (u8_idx > 0))
+          {
+            continue;
+          }
+          if (u8_digit++ >= NUM_OF_DIGITS)
+          {
+            return "text out of the digits";
+          }
+        }
+        break;
+
+      case SCENE_OP_SEGS:
+        if ((pu8_op[1] + pu8_op[2]) > NUM_OF_DIGITS)
+        {
+          return "segments out of the digits";
+        }
+        break;
+
+      case SCENE_OP_TIME:
+        if (((pu8_op[1] + 2) > NUM_OF_DIGITS) || ((pu8_op[2] & ~SCENE_TIME_NO_ZERO) >= NUM_OF_SCENE_TIME_FIELDS))
+        {
+          return "bad time field";
+        }
+        break;
+
+      case SCENE_OP_TICK:
+        if (pu8_op[1] >= NUM_OF_SCENE_TICKS)
+        {
+          return "bad tick unit";
+        }
+        break;
+
+      case SCENE_OP_LOOP:
+        if (++u8_depth > SCENE_LOOP_DEPTH)
+        {
+          return "loops nested too deep";
+        }
+        break;
+
+      case SCENE_OP_NEXT:
+        if (u8_depth-- == 0)
+        {
+          return "next without loop";
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    u16_pc += (1 + SceneOpBytes(pu8_op));
+  }
+
+  if (u8_depth != 0)
+  {
+    return "loop without next";
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief   Bytes of the operands of an op.
+ *
+ * @param pu8_op op, with its fixed operands
+ *
+ * @return bytes after the opcode
+ */
+static uint16_t SceneOpBytes(const uint8_t *pu8_op)
+{
+  switch (pu8_op[0])
+  {
+    case SCENE_OP_TEXT:
+      return (SCENE_Op_Bytes[SCENE_OP_TEXT] + pu8_op[2]);
+    case SCENE_OP_SEGS:
+      return (SCENE_Op_Bytes[SCENE_OP_SEGS] + (pu8_op[2] * 4));
+    default:
+      return SCENE_Op_Bytes[pu8_op[0]];
+  }
+}
+
+/**
+ * @brief   Fills the table to be stored with the program run at boot,
+ *          called by the settings timer.
+ *
+ * @param pv_buffer     [out] program
+ * @param u16_max_bytes size of pv_buffer, SCENE_PROGRAM_MAX
+ *
+ * @return bytes used
+ */
+static uint16_t SceneTableFill(void *pv_buffer, uint16_t u16_max_bytes)
+{
+  uint16_t u16_len;
+
+  xSemaphoreTake(x_Scene_Mutex, portMAX_DELAY);
+  u16_len = MIN(u16_Scene_Stored_Len, u16_max_bytes);
+  memcpy(pv_buffer, pu8_Scene_Stored, u16_len);
+  xSemaphoreGive(x_Scene_Mutex);
+
+  return u16_len;
+}
+
+/**
+ * @brief   Reads a little endian 16-bit value, the code may be unaligned.
+ */
+static uint16_t SceneGetU16(const uint8_t *pu8_data)
+{
+  return (uint16_t)(pu8_data[0] | (pu8_data[1] << 8));
+}
+
+/**
+ * @brief   Reads a little endian 32-bit value, the code may be unaligned.
+ */
+static uint32_t SceneGetU32(const uint8_t *pu8_data)
+{
+  return ((uint32_t)pu8_data[0] | ((uint32_t)pu8_data[1] << 8) | ((uint32_t)pu8_data[2] << 16) | ((uint32_t)pu8_data[3] << 24));
+}
+
+/**
+ * @brief   GET on the scene: state of the interpreter and interpreter time
+ *          per frame of the running program.
+ *
+ * @param px_req  request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t SceneHttpGetHandler(httpd_req_t *px_req)
+{
+  SCENE_STATS_TYPE x_stats;
+  char pc_text[192];
+
+  Scene__Get_Stats(&x_stats);
+
+  (void)snprintf(pc_text, sizeof(pc_text),
+                 "state %s\nprogram %u\nstored %u\nframes %u\nops %u\nframe_us_avg %u\nframe_us_max %u\n",
+                 SCENE_State_Name[x_stats.state], x_stats.program_bytes, x_stats.stored_bytes,
+                 x_stats.frames, x_stats.ops,
+                 (uint32_t)((x_stats.frames != 0) ? (x_stats.frame_us_sum / x_stats.frames) : 0),
+                 x_stats.frame_us_max);
+
+  httpd_resp_set_type(px_req, "text/plain");
+  return httpd_resp_sendstr(px_req, pc_text);
+}
+
+/**
+ * @brief   POST on the scene: the body is a compiled program, it replaces
+ *          the running one. An empty body stops the scene.
+ *
+ * @param px_req  request
+ *
+ * @return ESP_OK, ESP_FAIL on a bad request
+ */
+static esp_err_t SceneHttpPostHandler(httpd_req_t *px_req)
+{
+  const char *pc_error = NULL;
+  uint16_t u16_len = 0;
+  int i_len;
+
+  if (px_req->content_len > SCENE_PROGRAM_MAX)
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "program too large");
+    return ESP_FAIL;
+  }
+
+  while (u16_len < px_req->content_len)
+  {
+    i_len = httpd_req_recv(px_req, (char *)&pu8_Scene_Rx[u16_len], (px_req->content_len - u16_len));
+    if (i_len <= 0)
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "program not received");
+      return ESP_FAIL;
+    }
+    u16_len += (uint16_t)i_len;
+  }
+
+  if (Scene__Load(pu8_Scene_Rx, u16_len, &pc_error) == false)
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, pc_error);
+    return ESP_FAIL;
+  }
+
+  return httpd_resp_sendstr(px_req, "OK\n");
+}
@@ -0,0 +1,111 @@
+
+/**
+ *  @file       Scene_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef SCENE_PRM_H
+    #define SCENE_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+// bytecode version run by the interpreter
+#define SCENE_FORMAT_VERSION        1
+
+// network command: GET for the state and the cost of the frames, POST of a program
+#define SCENE_URI                   "/scene"
+
+/**
+ * Program format, all fields little endian:
+ *
+ *   offset  size  field
+ *   0       2     magic "SC"
+ *   2       1     version (SCENE_FORMAT_VERSION)
+ *   3       1     flags (SCENE_FLAG_*)
+ *   4       2     length of the code
+ *   6       ...   code: opcode (1), operands
+ *
+ * The code draws on the frame of the scene layer, the frame is shown by
+ * SCENE_OP_SHOW only. Drawing ops start from the last frame shown, as the
+ * records of the remote protocol. A program is verified before it is run,
+ * the tools/scene_compile.py compiler reads the opcodes from this header.
+ */
+#define SCENE_MAGIC_0               'S'
+#define SCENE_MAGIC_1               'C'
+#define SCENE_HEADER_BYTES          6
+
+// the program is also stored in flash and run at boot, replacing the stored one
+#define SCENE_FLAG_STORE            0x01
+
+typedef enum
+{
+  SCENE_OP_END = 0x00,          /*end of the scene, the layer is hidden*/
+  SCENE_OP_CLEAR = 0x01,        /*all digits, icons and blink off*/
+  SCENE_OP_TEXT = 0x02,         /*first digit (1), length (1), chars: a '.' sets the dot of the previous char*/
+  SCENE_OP_SEGS = 0x03,         /*first digit (1), count (1), segment masks (4 each)*/
+  SCENE_OP_ICONS = 0x04,        /*icons bitmap (4), bit n = DISPLAY_ICON_ENUM n*/
+  SCENE_OP_BLINK = 0x05,        /*on ms (2), off ms (2), digits bitmap (1), icons bitmap (4)*/
+  SCENE_OP_SHOW = 0x06,         /*commits the frame*/
+  SCENE_OP_WAIT = 0x07,         /*ms (2), from the end of the previous wait*/
+  SCENE_OP_LOOP = 0x08,         /*iterations (1), 0 = forever: runs the ops up to the matching NEXT*/
+  SCENE_OP_NEXT = 0x09,         /*end of the innermost loop*/
+  SCENE_OP_TIME = 0x0A,         /*first digit (1), field (1): two digits of the local time*/
+  SCENE_OP_TICK = 0x0B,         /*unit (1): waits for the next second or minute of the clock*/
+  NUM_OF_SCENE_OPS
+}SCENE_OP_ENUM;
+
+typedef enum
+{
+  SCENE_TIME_HOUR = 0x00,       /*0..23*/
+  SCENE_TIME_HOUR_12 = 0x01,    /*1..12*/
+  SCENE_TIME_MINUTE = 0x02,
+  SCENE_TIME_SECOND = 0x03,
+  SCENE_TIME_DAY = 0x04,        /*day of the month*/
+  SCENE_TIME_MONTH = 0x05,      /*1..12*/
+  SCENE_TIME_YEAR = 0x06,       /*last two digits*/
+  NUM_OF_SCENE_TIME_FIELDS
+}SCENE_TIME_FIELD_ENUM;
+
+// or-ed to a field: the leading zero is blank
+#define SCENE_TIME_NO_ZERO          0x80
+
+typedef enum
+{
+  SCENE_TICK_SECOND = 0x00,
+  SCENE_TICK_MINUTE = 0x01,
+  NUM_OF_SCENE_TICKS
+}SCENE_TICK_ENUM;
+
+typedef enum
+{
+  SCENE_STATE_IDLE = 0,         /*no program*/
+  SCENE_STATE_RUNNING,
+  SCENE_STATE_ENDED,            /*the program reached its end*/
+  SCENE_STATE_ABORTED,          /*the program ran too many ops without waiting*/
+  NUM_OF_SCENE_STATES
+}SCENE_STATE_ENUM;
+
+// state of the interpreter and cost of the frames of the running program
+typedef struct
+{
+  SCENE_STATE_ENUM state;
+  uint16_t program_bytes;
+  uint16_t stored_bytes;            // program run at boot, header included, 0 if none
+  uint32_t frames;                  // frames shown since the program was loaded
+  uint32_t ops;                     // ops run since the program was loaded
+  uint32_t frame_us_max;            // interpreter time of a frame, from the previous frame or wait
+  uint64_t frame_us_sum;
+}SCENE_STATS_TYPE;
+
+#endif
@@ -0,0 +1,94 @@
+
+/**
+ *  @file       Scene_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef SCENE_PRV_H
+    #define SCENE_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include <Scene_prm.h>
+#include <Holtek.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// largest program, header included: the running, the stored and the received one are kept
+#define SCENE_PROGRAM_MAX           CONFIG_SCENE_PROGRAM_MAX
+
+#if (SCENE_PROGRAM_MAX > 0xFFFF)
+#error "CONFIG_SCENE_PROGRAM_MAX too large"
+#endif
+
+// nested loops
+#define SCENE_LOOP_DEPTH            4
+
+/*
+ * Ops run between two waits at most: a loop without a wait would keep the
+ * task busy, the program is stopped instead. A wait sleeps at least a tick.
+ */
+#define SCENE_OPS_PER_WAIT_MAX      1024
+
+// the clock is considered set from 2022-01-01, as for the clock face
+#define SCENE_CLOCK_VALID_S         1640995200
+
+// bytes of the operands of each op, TEXT and SEGS are followed by their count of chars or masks
+static const uint8_t SCENE_Op_Bytes[NUM_OF_SCENE_OPS] =
+{
+  [SCENE_OP_END]   = 0,
+  [SCENE_OP_CLEAR] = 0,
+  [SCENE_OP_TEXT]  = 2,
+  [SCENE_OP_SEGS]  = 2,
+  [SCENE_OP_ICONS] = 4,
+  [SCENE_OP_BLINK] = 9,
+  [SCENE_OP_SHOW]  = 0,
+  [SCENE_OP_WAIT]  = 2,
+  [SCENE_OP_LOOP]  = 1,
+  [SCENE_OP_NEXT]  = 0,
+  [SCENE_OP_TIME]  = 2,
+  [SCENE_OP_TICK]  = 1,
+};
+
+static const char * const SCENE_State_Name[NUM_OF_SCENE_STATES] =
+{
+  [SCENE_STATE_IDLE]    = "idle",
+  [SCENE_STATE_RUNNING] = "running",
+  [SCENE_STATE_ENDED]   = "ended",
+  [SCENE_STATE_ABORTED] = "aborted",
+};
+
+typedef struct
+{
+  uint16_t start;                   // first op of the body
+  uint8_t left;                     // iterations left, the current one included, 0 = forever
+}SCENE_LOOP_TYPE;
+
+// interpreter, only used by the scene task with the mutex taken
+typedef struct
+{
+  const uint8_t *code;
+  uint16_t len;
+  uint16_t pc;
+  uint8_t depth;
+  SCENE_LOOP_TYPE loop[SCENE_LOOP_DEPTH];
+  HOLTEK_FRAME_TYPE *frame;         // acquired and not shown yet, NULL if none
+  bool blank;                       // the first frame of the program starts empty
+  TickType_t deadline;              // end of the last wait, the next wait counts from it
+}SCENE_VM_TYPE;
+
+#define SCENE_TASK_STACK            (1024 * 3)
+// below the display tasks, as the test patterns
+#define SCENE_TASK_PRIO             8
+
+#endif
@@ -0,0 +1,594 @@
+
+/**
+ *  @file       Settings.c
+ *
+ *  @brief      Persistent settings: the values live in RAM and are written to
+ *              NVS as a single blob after a quiet period, so a burst of
+ *              changes (i.e. repeated key presses) costs a single flash write.
+ *              All the values are restored at boot with a single read.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "freertos/semphr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+#include <Settings.h>
+#include <Settings_prv.h>
+#include <Metrics.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+// values in use
+static SETTINGS_STORE_TYPE x_Settings_Store;
+// copy being written, the values can change meanwhile
+static SETTINGS_STORE_TYPE x_Settings_Commit;
+
+static uint16_t pu16_Settings_Offset[NUM_OF_SETTINGS];
+
+static nvs_handle_t x_Settings_Nvs;
+static bool b_Settings_Nvs_Open;
+
+// changes not written yet, and tick of the first one
+static bool b_Settings_Dirty;
+static TickType_t x_Settings_Dirty_Tick;
+static uint32_t u32_Settings_Pending;
+// what has to be written, SETTINGS_DIRTY_xxx
+static uint32_t u32_Settings_Dirty_Mask;
+
+// tables: owner callback filling the data to be written, and its max size
+static SETTINGS_TABLE_FILL_FUNC px_Settings_Table_Fill[NUM_OF_SETTINGS_TABLES];
+static uint16_t pu16_Settings_Table_Max[NUM_OF_SETTINGS_TABLES];
+// every table is written, or restored by Settings__Restore_Table(), in this buffer
+static uint8_t pu8_Settings_Table_Buffer[SETTINGS_TABLE_MAX_BYTES];
+static SemaphoreHandle_t x_Settings_Table_Mutex;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t x_Settings_Table_Mutex_Buffer;
+#endif
+
+static TimerHandle_t x_Settings_Timer;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticTimer_t x_Settings_Timer_Buffer;
+#endif
+
+// values restored, before then the defaults are returned
+static bool b_Settings_Ready;
+
+static portMUX_TYPE x_Settings_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *TAG = "Settings";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static void SettingsRestore(void);
+static void SettingsCommit(void);
+static bool SettingsMarkDirty(uint32_t u32_mask, TickType_t x_now);
+static bool SettingsTableRegister(SETTINGS_TABLE_ENUM e_table, uint16_t u16_max_bytes, SETTINGS_TABLE_FILL_FUNC fn_fill);
+static void SettingsTimerCallback(TimerHandle_t x_timer);
+static void SettingsShutdownHandler(void);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, restores the stored values: to be
+ *          called after nvs_flash_init() and before the modules using them.
+ *
+ */
+void Settings__Initialize(void)
+{
+  uint16_t u16_offset = 0;
+  uint8_t u8_id;
+
+  memset(&x_Settings_Store, 0x00, sizeof(x_Settings_Store));
+  b_Settings_Dirty = false;
+  u32_Settings_Pending = 0;
+  u32_Settings_Dirty_Mask = 0;
+
+  for (u8_id = 0; u8_id < NUM_OF_SETTINGS; ++u8_id)
+  {
+    pu16_Settings_Offset[u8_id] = u16_offset;
+
+    if (SETTINGS_Desc[u8_id].size <= sizeof(uint32_t))
+    {
+      // little endian: the low bytes of the default are the value
+      memcpy(&x_Settings_Store.data[u16_offset], &SETTINGS_Desc[u8_id].def, SETTINGS_Desc[u8_id].size);
+    }
+
+    u16_offset += SETTINGS_Desc[u8_id].size;
+  }
+
+  configASSERT(u16_offset <= SETTINGS_DATA_MAX_BYTES);
+
+  x_Settings_Store.version = SETTINGS_LAYOUT_VERSION;
+  x_Settings_Store.size = u16_offset;
+
+  SysMon__Register_Module(TAG, sizeof(x_Settings_Store) + sizeof(x_Settings_Commit) + sizeof(pu16_Settings_Offset) +
+                               sizeof(pu8_Settings_Table_Buffer));
+
+#if CONFIG_APP_STATIC_ALLOCATION
+  x_Settings_Table_Mutex = xSemaphoreCreateMutexStatic(&x_Settings_Table_Mutex_Buffer);
+  SysMon__Register_Module(TAG, sizeof(x_Settings_Table_Mutex_Buffer));
+#else
+  x_Settings_Table_Mutex = xSemaphoreCreateMutex();
+#endif
+
+#if CONFIG_APP_STATIC_ALLOCATION
+  x_Settings_Timer = xTimerCreateStatic("Settings", pdMS_TO_TICKS(SETTINGS_QUIET_MS), pdFALSE, NULL,
+                                        SettingsTimerCallback, &x_Settings_Timer_Buffer);
+  SysMon__Register_Module(TAG, sizeof(x_Settings_Timer_Buffer));
+#else
+  x_Settings_Timer = xTimerCreate("Settings", pdMS_TO_TICKS(SETTINGS_QUIET_MS), pdFALSE, NULL, SettingsTimerCallback);
+#endif
+
+  SettingsRestore();
+
+  portENTER_CRITICAL(&x_Settings_Mux);
+  b_Settings_Ready = true;
+  portEXIT_CRITICAL(&x_Settings_Mux);
+
+  // pending changes are written before a software restart (i.e. after a firmware update)
+  esp_register_shutdown_handler(SettingsShutdownHandler);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Reads a setting. Before Settings__Initialize() is completed
+ *          the default value is returned.
+ *
+ * @param e_id      setting
+ * @param pv_value  [out] value
+ * @param u16_size  size of the value, must match the size of the setting
+ *
+ * @return true if the setting exists and the size matches
+ */
+bool Settings__Get(SETTINGS_ID_ENUM e_id, void *pv_value, uint16_t u16_size)
+{
+  if ((e_id >= NUM_OF_SETTINGS) || (SETTINGS_Desc[e_id].size != u16_size))
+  {
+    return false;
+  }
+
+  portENTER_CRITICAL(&x_Settings_Mux);
+  if (b_Settings_Ready == true)
+  {
+    memcpy(pv_value, &x_Settings_Store.data[pu16_Settings_Offset[e_id]], u16_size);
+  }
+  else if (u16_size <= sizeof(uint32_t))
+  {
+    memcpy(pv_value, &SETTINGS_Desc[e_id].def, u16_size);
+  }
+  else
+  {
+    memset(pv_value, 0x00, u16_size);
+  }
+  portEXIT_CRITICAL(&x_Settings_Mux);
+
+  return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Changes a setting. The new value is used right away and written
+ *          to flash when no other change happened for SETTINGS_QUIET_MS, or
+ *          at the latest SETTINGS_MAX_DELAY_MS after the first change.
+ *          To be called from a task, not from an ISR.
+ *
+ * @param e_id      setting
+ * @param pv_value  new value
+ * @param u16_size  size of the value, must match the size of the setting
+ *
+ * @return true if the setting exists and the size matches, false before Settings__Initialize()
+ */
+bool Settings__Set(SETTINGS_ID_ENUM e_id, const void *pv_value, uint16_t u16_size)
+{
+  uint8_t *pu8_data;
+  TickType_t x_now = xTaskGetTickCount();
+  bool b_restart;
+
+  if ((b_Settings_Ready == false) || (e_id >= NUM_OF_SETTINGS) || (SETTINGS_Desc[e_id].size != u16_size))
+  {
+    return false;
+  }
+
+  pu8_data = &x_Settings_Store.data[pu16_Settings_Offset[e_id]];
+
+  portENTER_CRITICAL(&x_Settings_Mux);
+  if (memcmp(pu8_data, pv_value, u16_size) == 0)
+  {
+    portEXIT_CRITICAL(&x_Settings_Mux);
+
+    Metrics__Counter_Add(METRICS_SETTINGS_WRITES_AVOIDED, 1);
+    return true;
+  }
+
+  memcpy(pu8_data, pv_value, u16_size);
+  b_restart = SettingsMarkDirty(SETTINGS_DIRTY_VALUES, x_now);
+  portEXIT_CRITICAL(&x_Settings_Mux);
+
+  Metrics__Counter_Add(METRICS_SETTINGS_CHANGES, 1);
+
+  if (b_restart == true)
+  {
+    xTimerReset(x_Settings_Timer, 0);
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Reads a setting of up to 4 bytes.
+ *
+ * @param e_id setting
+ *
+ * @return value, 0 if the setting does not exist or is larger
+ */
+uint32_t Settings__Get_U32(SETTINGS_ID_ENUM e_id)
+{
+  uint32_t u32_value = 0;
+
+  if ((e_id < NUM_OF_SETTINGS) && (SETTINGS_Desc[e_id].size <= sizeof(uint32_t)))
+  {
+    (void)Settings__Get(e_id, &u32_value, SETTINGS_Desc[e_id].size);
+  }
+
+  return u32_value;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Changes a setting of up to 4 bytes, see Settings__Set().
+ *
+ * @param e_id      setting
+ * @param u32_value new value, truncated to the size of the setting
+ *
+ * @return true if the setting exists and is not larger than 4 bytes
+ */
+bool Settings__Set_U32(SETTINGS_ID_ENUM e_id, uint32_t u32_value)
+{
+  if ((e_id >= NUM_OF_SETTINGS) || (SETTINGS_Desc[e_id].size > sizeof(uint32_t)))
+  {
+    return false;
+  }
+
+  return Settings__Set(e_id, &u32_value, SETTINGS_Desc[e_id].size);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Reads a stored table and registers the callback providing its
+ *          content when it has to be written. To be called once by the
+ *          owner of the table, after Settings__Initialize().
+ *
+ * @param e_table       table
+ * @param pv_data       [out] stored content
+ * @param u16_max_bytes size of pv_data, the largest table that can be written
+ * @param fn_fill       fills the data to be written, called by the settings timer
+ *
+ * @return bytes read, 0 if nothing is stored or the stored table is not valid
+ */
+uint16_t Settings__Load_Table(SETTINGS_TABLE_ENUM e_table, void *pv_data, uint16_t u16_max_bytes,
+                              SETTINGS_TABLE_FILL_FUNC fn_fill)
+{
+  size_t x_len = u16_max_bytes;
+  esp_err_t x_err;
+
+  if ((SettingsTableRegister(e_table, u16_max_bytes, fn_fill) == false) || (b_Settings_Nvs_Open == false))
+  {
+    return 0;
+  }
+
+  x_err = nvs_get_blob(x_Settings_Nvs, SETTINGS_Table_Key[e_table], pv_data, &x_len);
+  if (x_err == ESP_ERR_NVS_NOT_FOUND)
+  {
+    return 0;
+  }
+  if (x_err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "table %s not valid (%d)", SETTINGS_Table_Key[e_table], x_err);
+    return 0;
+  }
+
+  return (uint16_t)x_len;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   As Settings__Load_Table(), for an owner that does not keep the
+ *          table as stored: it is read in the buffer of the writes and
+ *          handed to fn_restore, no buffer of the owner is needed.
+ *
+ * @param e_table       table
+ * @param u16_max_bytes largest table that can be written
+ * @param fn_fill       fills the data to be written, called by the settings timer
+ * @param fn_restore    takes the stored content, called before returning
+ */
+void Settings__Restore_Table(SETTINGS_TABLE_ENUM e_table, uint16_t u16_max_bytes, SETTINGS_TABLE_FILL_FUNC fn_fill,
+                             SETTINGS_TABLE_RESTORE_FUNC fn_restore)
+{
+  size_t x_len = u16_max_bytes;
+  esp_err_t x_err;
+
+  if ((SettingsTableRegister(e_table, u16_max_bytes, fn_fill) == false) || (b_Settings_Nvs_Open == false))
+  {
+    fn_restore(pu8_Settings_Table_Buffer, 0);
+    return;
+  }
+
+  // a write of another table can be running
+  xSemaphoreTake(x_Settings_Table_Mutex, portMAX_DELAY);
+
+  x_err = nvs_get_blob(x_Settings_Nvs, SETTINGS_Table_Key[e_table], pu8_Settings_Table_Buffer, &x_len);
+  if ((x_err != ESP_OK) && (x_err != ESP_ERR_NVS_NOT_FOUND))
+  {
+    ESP_LOGW(TAG, "table %s not valid (%d)", SETTINGS_Table_Key[e_table], x_err);
+  }
+
+  fn_restore(pu8_Settings_Table_Buffer, (x_err == ESP_OK) ? (uint16_t)x_len : 0);
+
+  xSemaphoreGive(x_Settings_Table_Mutex);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Notifies a change of a table: it is written together with the
+ *          settings, after the same quiet period (see Settings__Set()).
+ *
+ * @param e_table table, registered with Settings__Load_Table()
+ */
+void Settings__Table_Changed(SETTINGS_TABLE_ENUM e_table)
+{
+  bool b_restart;
+
+  if ((b_Settings_Ready == false) || (e_table >= NUM_OF_SETTINGS_TABLES))
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&x_Settings_Mux);
+  b_restart = SettingsMarkDirty(SETTINGS_DIRTY_TABLE(e_table), xTaskGetTickCount());
+  portEXIT_CRITICAL(&x_Settings_Mux);
+
+  Metrics__Counter_Add(METRICS_SETTINGS_CHANGES, 1);
+
+  if (b_restart == true)
+  {
+    xTimerReset(x_Settings_Timer, 0);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Writes the pending changes now, i.e. before a power down.
+ *
+ */
+void Settings__Flush(void)
+{
+  xTimerStop(x_Settings_Timer, 0);
+  SettingsCommit();
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Reads all the stored values with a single NVS access. Values
+ *          missing in the stored blob (older firmware) keep their default.
+ *
+ */
+static void SettingsRestore(void)
+{
+  int64_t s64_start_us = esp_timer_get_time();
+  size_t x_len = sizeof(x_Settings_Commit);
+  esp_err_t x_err;
+
+  if (nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READWRITE, &x_Settings_Nvs) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "NVS not available, defaults in use");
+    b_Settings_Nvs_Open = false;
+    return;
+  }
+  b_Settings_Nvs_Open = true;
+
+  x_err = nvs_get_blob(x_Settings_Nvs, SETTINGS_NVS_KEY, &x_Settings_Commit, &x_len);
+  if (x_err == ESP_ERR_NVS_NOT_FOUND)
+  {
+    ESP_LOGI(TAG, "nothing stored, defaults in use");
+    return;
+  }
+
+  if ((x_err != ESP_OK) ||
+      (x_len < SETTINGS_STORE_HEADER_BYTES) ||
+      (x_Settings_Commit.version != SETTINGS_LAYOUT_VERSION) ||
+      (x_Settings_Commit.size > (x_len - SETTINGS_STORE_HEADER_BYTES)))
+  {
+    ESP_LOGW(TAG, "stored values not valid (%d), defaults in use", x_err);
+    return;
+  }
+
+  // settings appended by a newer firmware are ignored, the ones it lacks keep the default
+  memcpy(x_Settings_Store.data, x_Settings_Commit.data, MIN(x_Settings_Commit.size, x_Settings_Store.size));
+
+  ESP_LOGI(TAG, "restored %u bytes in %d us", x_Settings_Commit.size, (int)(esp_timer_get_time() - s64_start_us));
+}
+
+/**
+ * @brief   Writes the pending changes as a single blob, plus the changed
+ *          tables, with a single commit. The values are copied first, so
+ *          the callers of Settings__Set() never wait for the flash.
+ *
+ */
+static void SettingsCommit(void)
+{
+  uint32_t u32_pending;
+  uint32_t u32_mask;
+  uint8_t u8_table;
+  uint16_t u16_len;
+  esp_err_t x_err = ESP_OK;
+
+  portENTER_CRITICAL(&x_Settings_Mux);
+  if (b_Settings_Dirty == false)
+  {
+    portEXIT_CRITICAL(&x_Settings_Mux);
+    return;
+  }
+
+  memcpy(&x_Settings_Commit, &x_Settings_Store, sizeof(x_Settings_Commit));
+  u32_pending = u32_Settings_Pending;
+  u32_mask = u32_Settings_Dirty_Mask;
+  b_Settings_Dirty = false;
+  u32_Settings_Pending = 0;
+  u32_Settings_Dirty_Mask = 0;
+  portEXIT_CRITICAL(&x_Settings_Mux);
+
+  if (b_Settings_Nvs_Open == false)
+  {
+    return;
+  }
+
+  if ((u32_mask & SETTINGS_DIRTY_VALUES) != 0)
+  {
+    x_err = nvs_set_blob(x_Settings_Nvs, SETTINGS_NVS_KEY, &x_Settings_Commit,
+                         SETTINGS_STORE_HEADER_BYTES + x_Settings_Commit.size);
+  }
+
+  // the flush before a restart can run while the timer is writing
+  xSemaphoreTake(x_Settings_Table_Mutex, portMAX_DELAY);
+  for (u8_table = 0; (u8_table < NUM_OF_SETTINGS_TABLES) && (x_err == ESP_OK); ++u8_table)
+  {
+    if (((u32_mask & SETTINGS_DIRTY_TABLE(u8_table)) == 0) || (px_Settings_Table_Fill[u8_table] == NULL))
+    {
+      continue;
+    }
+
+    u16_len = px_Settings_Table_Fill[u8_table](pu8_Settings_Table_Buffer, pu16_Settings_Table_Max[u8_table]);
+    x_err = nvs_set_blob(x_Settings_Nvs, SETTINGS_Table_Key[u8_table], pu8_Settings_Table_Buffer, u16_len);
+  }
+  xSemaphoreGive(x_Settings_Table_Mutex);
+
+  if (x_err == ESP_OK)
+  {
+    x_err = nvs_commit(x_Settings_Nvs);
+  }
+
+  if (x_err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "write failed (%d), retry after the quiet period", x_err);
+    Metrics__Counter_Add(METRICS_SETTINGS_WRITE_ERRORS, 1);
+
+    portENTER_CRITICAL(&x_Settings_Mux);
+    (void)SettingsMarkDirty(u32_mask, xTaskGetTickCount());
+    u32_Settings_Pending += (u32_pending - 1);
+    portEXIT_CRITICAL(&x_Settings_Mux);
+
+    xTimerReset(x_Settings_Timer, 0);
+    return;
+  }
+
+  // one write instead of one per change
+  Metrics__Counter_Add(METRICS_SETTINGS_WRITES, 1);
+  Metrics__Counter_Add(METRICS_SETTINGS_WRITES_AVOIDED, (u32_pending - 1));
+
+  ESP_LOGI(TAG, "%u changes written", u32_pending);
+}
+
+/**
+ * @brief   Registers the owner of a table. A table larger than the buffer of
+ *          the writes is refused: it is neither read nor written.
+ *
+ * @param e_table       table
+ * @param u16_max_bytes largest table that can be written
+ * @param fn_fill       fills the data to be written
+ *
+ * @return true if the table has been registered
+ */
+static bool SettingsTableRegister(SETTINGS_TABLE_ENUM e_table, uint16_t u16_max_bytes, SETTINGS_TABLE_FILL_FUNC fn_fill)
+{
+  if (e_table >= NUM_OF_SETTINGS_TABLES)
+  {
+    return false;
+  }
+
+  if (u16_max_bytes > SETTINGS_TABLE_MAX_BYTES)
+  {
+    ESP_LOGE(TAG, "table %s of %u bytes over SETTINGS_TABLE_MAX_BYTES (%u), not stored",
+             SETTINGS_Table_Key[e_table], u16_max_bytes, (unsigned)SETTINGS_TABLE_MAX_BYTES);
+    return false;
+  }
+
+  portENTER_CRITICAL(&x_Settings_Mux);
+  px_Settings_Table_Fill[e_table] = fn_fill;
+  pu16_Settings_Table_Max[e_table] = u16_max_bytes;
+  portEXIT_CRITICAL(&x_Settings_Mux);
+
+  return true;
+}
+
+/**
+ * @brief   Records a pending change, to be called in the critical section.
+ *
+ * @param u32_mask  what changed, SETTINGS_DIRTY_xxx
+ * @param x_now     current tick
+ *
+ * @return true if the quiet period has to be restarted
+ */
+static bool SettingsMarkDirty(uint32_t u32_mask, TickType_t x_now)
+{
+  bool b_restart;
+
+  if (b_Settings_Dirty == false)
+  {
+    b_Settings_Dirty = true;
+    x_Settings_Dirty_Tick = x_now;
+    b_restart = true;
+  }
+  else
+  {
+    // the quiet period restarts on each change, until the max delay is reached
+    b_restart = ((x_now - x_Settings_Dirty_Tick) < pdMS_TO_TICKS(SETTINGS_MAX_DELAY_MS - SETTINGS_QUIET_MS));
+  }
+  u32_Settings_Dirty_Mask |= u32_mask;
+  u32_Settings_Pending++;
+
+  return b_restart;
+}
+
+/**
+ * @brief   End of the quiet period, runs in the timer service task.
+ *
+ * @param x_timer settings timer
+ */
+static void SettingsTimerCallback(TimerHandle_t x_timer)
+{
+  SettingsCommit();
+}
+
+/**
+ * @brief   Restart hook, runs in the task calling esp_restart().
+ *
+ */
+static void SettingsShutdownHandler(void)
+{
+  Settings__Flush();
+}
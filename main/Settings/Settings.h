@@ -0,0 +1,46 @@
+
+/**
+ *  @file       Settings.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef SETTINGS_H
+    #define SETTINGS_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <Settings_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+// fills pv_buffer with the current content of a table, returns the bytes used
+typedef uint16_t (*SETTINGS_TABLE_FILL_FUNC)(void *pv_buffer, uint16_t u16_max_bytes);
+// takes the stored content of a table, u16_len is 0 if nothing valid is stored
+typedef void (*SETTINGS_TABLE_RESTORE_FUNC)(const void *pv_data, uint16_t u16_len);
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void Settings__Initialize(void);
+bool Settings__Get(SETTINGS_ID_ENUM e_id, void *pv_value, uint16_t u16_size);
+bool Settings__Set(SETTINGS_ID_ENUM e_id, const void *pv_value, uint16_t u16_size);
+uint32_t Settings__Get_U32(SETTINGS_ID_ENUM e_id);
+bool Settings__Set_U32(SETTINGS_ID_ENUM e_id, uint32_t u32_value);
+uint16_t Settings__Load_Table(SETTINGS_TABLE_ENUM e_table, void *pv_data, uint16_t u16_max_bytes,
+                              SETTINGS_TABLE_FILL_FUNC fn_fill);
+void Settings__Restore_Table(SETTINGS_TABLE_ENUM e_table, uint16_t u16_max_bytes, SETTINGS_TABLE_FILL_FUNC fn_fill,
+                             SETTINGS_TABLE_RESTORE_FUNC fn_restore);
+void Settings__Table_Changed(SETTINGS_TABLE_ENUM e_table);
+void Settings__Flush(void);
+
+#endif
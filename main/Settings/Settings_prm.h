@@ -0,0 +1,66 @@
+
+/**
+ *  @file       Settings_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef SETTINGS_PRM_H
+    #define SETTINGS_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+/*
+ * Define here the persistent settings, size and default value of each one
+ * are in SETTINGS_Desc[]. New settings must be appended: the stored values
+ * are laid out in this order.
+ */
+typedef enum
+{
+  SETTINGS_BRIGHTNESS = 0,        /*uint8_t, display PWM duty 0..15*/
+  SETTINGS_TIME_ZONE,             /*char[SETTINGS_TIME_ZONE_BYTES], IANA name, empty for the default one*/
+  SETTINGS_CLOCK_FORMAT,          /*uint8_t, CLOCKFACE_FORMAT_* flags*/
+  SETTINGS_TIME_DRIFT,            /*int32_t, crystal drift compensated by TimeSync, ppb*/
+  SETTINGS_TICK_SYNC,             /*uint8_t, 1 to align the display on the other clocks of the LAN*/
+  NUM_OF_SETTINGS
+}SETTINGS_ID_ENUM;
+
+#define SETTINGS_TIME_ZONE_BYTES    32
+
+/*
+ * Tables: variable size data owned by another module (i.e. the alarm list),
+ * each one stored as its own blob but written together with the settings.
+ */
+typedef enum
+{
+  SETTINGS_TABLE_ALARMS = 0,
+  SETTINGS_TABLE_WIFI,
+  SETTINGS_TABLE_SCENE,
+  NUM_OF_SETTINGS_TABLES
+}SETTINGS_TABLE_ENUM;
+
+/*
+ * Largest size of each table, checked by its owner at build time: the
+ * tables are written from a single buffer of the size of the largest one.
+ */
+#define SETTINGS_TABLE_ALARMS_BYTES (4 + (CONFIG_ALARM_MAX_ENTRIES * 12))
+#define SETTINGS_TABLE_WIFI_BYTES   (CONFIG_WIFICONN_MAX_CREDENTIALS * (33 + 65))
+#define SETTINGS_TABLE_SCENE_BYTES  CONFIG_SCENE_PROGRAM_MAX
+
+#define SETTINGS_TABLE_MAX_2(a, b)  (((a) > (b)) ? (a) : (b))
+#define SETTINGS_TABLE_MAX_BYTES    SETTINGS_TABLE_MAX_2(SETTINGS_TABLE_ALARMS_BYTES, \
+                                    SETTINGS_TABLE_MAX_2(SETTINGS_TABLE_WIFI_BYTES, SETTINGS_TABLE_SCENE_BYTES))
+
+// room for all the settings in the stored blob
+#define SETTINGS_DATA_MAX_BYTES     128
+
+#endif
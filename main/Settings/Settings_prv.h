@@ -0,0 +1,78 @@
+
+/**
+ *  @file       Settings_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef SETTINGS_PRV_H
+    #define SETTINGS_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <Settings_prm.h>
+#include <ClockFace_prm.h>
+#include <TickSync_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// a change is written after this time without further changes
+#define SETTINGS_QUIET_MS           CONFIG_SETTINGS_QUIET_MS
+// a change is written at the latest after this time, even if other changes keep coming
+#define SETTINGS_MAX_DELAY_MS       CONFIG_SETTINGS_MAX_DELAY_MS
+
+#if (SETTINGS_MAX_DELAY_MS < SETTINGS_QUIET_MS)
+#error "CONFIG_SETTINGS_MAX_DELAY_MS must not be shorter than CONFIG_SETTINGS_QUIET_MS"
+#endif
+
+#define SETTINGS_NVS_NAMESPACE      "settings"
+#define SETTINGS_NVS_KEY            "all"
+
+// pending changes: the values blob and each table
+#define SETTINGS_DIRTY_VALUES       (1u << 0)
+#define SETTINGS_DIRTY_TABLE(t)     (1u << (1 + (t)))
+
+// stored layout, to be increased when a setting changes size or meaning (appending one does not need it)
+#define SETTINGS_LAYOUT_VERSION     1
+
+// all the settings are stored in a single blob, read at boot with a single access
+typedef struct
+{
+  uint16_t version;
+  uint16_t size;                              // bytes of data in use
+  uint8_t data[SETTINGS_DATA_MAX_BYTES];
+}SETTINGS_STORE_TYPE;
+
+#define SETTINGS_STORE_HEADER_BYTES (sizeof(SETTINGS_STORE_TYPE) - SETTINGS_DATA_MAX_BYTES)
+
+typedef struct
+{
+  uint8_t size;                               // bytes of the value
+  uint32_t def;                               // default of values up to 4 bytes, larger ones default to zero
+}SETTINGS_DESC_TYPE;
+
+static const SETTINGS_DESC_TYPE SETTINGS_Desc[NUM_OF_SETTINGS] =
+{
+  [SETTINGS_BRIGHTNESS]   = {sizeof(uint8_t), 15},
+  [SETTINGS_TIME_ZONE]    = {SETTINGS_TIME_ZONE_BYTES, 0},
+  [SETTINGS_CLOCK_FORMAT] = {sizeof(uint8_t), CLOCKFACE_FORMAT_DEFAULT},
+  [SETTINGS_TIME_DRIFT]   = {sizeof(int32_t), 0},
+  [SETTINGS_TICK_SYNC]    = {sizeof(uint8_t), TICKSYNC_DEFAULT_ON},
+};
+
+// NVS key of each table
+static const char * const SETTINGS_Table_Key[NUM_OF_SETTINGS_TABLES] =
+{
+  [SETTINGS_TABLE_ALARMS] = "alarms",
+  [SETTINGS_TABLE_WIFI]   = "wifi",
+  [SETTINGS_TABLE_SCENE]  = "scene",
+};
+
+#endif
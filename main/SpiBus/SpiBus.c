@@ -0,0 +1,555 @@
+
+/**
+ *  @file       SpiBus.c
+ *
+ *  @brief      Arbitration of the SPI bus shared by the display and the
+ *              other peripherals. The bus is initialized once, each device
+ *              is attached once and then owns the bus between
+ *              SpiBus__Acquire() and SpiBus__Release(): the transactions of
+ *              the device are queued only while it owns the bus.
+ *              When the bus is released it is granted to the waiting client
+ *              with the highest priority among the ones within their
+ *              bandwidth share, then among the ones over it. A request can
+ *              not hold the bus longer than the client max hold, so the
+ *              wait of the display is bounded even during a bulk transfer.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include <SpiBus.h>
+#include <SpiBus_prv.h>
+#include <Metrics.h>
+#include <SysMon.h>
+#include <BinLog.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static const SPIBUS_CLIENT_DESC_TYPE px_SpiBus_Desc[NUM_OF_SPIBUS_CLIENTS] = SPIBUS_CLIENTS_DESC;
+
+static SPIBUS_CLIENT_TYPE px_SpiBus_Client[NUM_OF_SPIBUS_CLIENTS];
+
+// client owning the bus, SPIBUS_OWNER_NONE if free
+static uint8_t u8_SpiBus_Owner = SPIBUS_OWNER_NONE;
+
+static bool b_SpiBus_Ready;
+
+// arbitration state, held for a few instructions only
+static portMUX_TYPE x_SpiBus_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+// bus initialization, device attach and detach
+static SemaphoreHandle_t x_SpiBus_Mutex;
+
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t x_SpiBus_Mutex_Buffer;
+static StaticSemaphore_t px_SpiBus_Grant_Buffer[NUM_OF_SPIBUS_CLIENTS];
+#endif
+
+static const char *TAG = "SpiBus";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static esp_err_t SpiBusInit(void);
+static void SpiBusRefill(SPIBUS_CLIENT_ENUM e_client, int64_t s64_now_us);
+static bool SpiBusWaiting(void);
+static uint8_t SpiBusNext(void);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, initializes the bus. To be called
+ *          before the devices on the bus are started.
+ *
+ */
+void SpiBus__Initialize(void)
+{
+  int64_t s64_now_us;
+  uint8_t u8_client;
+
+#if CONFIG_APP_STATIC_ALLOCATION
+  x_SpiBus_Mutex = xSemaphoreCreateMutexStatic(&x_SpiBus_Mutex_Buffer);
+  SysMon__Register_Module(TAG, sizeof(x_SpiBus_Mutex_Buffer) + sizeof(px_SpiBus_Grant_Buffer));
+#else
+  x_SpiBus_Mutex = xSemaphoreCreateMutex();
+#endif
+  SysMon__Register_Module(TAG, sizeof(px_SpiBus_Client));
+
+  s64_now_us = esp_timer_get_time();
+  for (u8_client = 0; u8_client < NUM_OF_SPIBUS_CLIENTS; u8_client++)
+  {
+#if CONFIG_APP_STATIC_ALLOCATION
+    px_SpiBus_Client[u8_client].grant_sem = xSemaphoreCreateBinaryStatic(&px_SpiBus_Grant_Buffer[u8_client]);
+#else
+    px_SpiBus_Client[u8_client].grant_sem = xSemaphoreCreateBinary();
+#endif
+    // each client starts with its full share
+    px_SpiBus_Client[u8_client].tokens_us = ((int64_t)SPIBUS_WINDOW_US * px_SpiBus_Desc[u8_client].reserved) / 1000;
+    px_SpiBus_Client[u8_client].refill_us = s64_now_us;
+  }
+
+  xSemaphoreTake(x_SpiBus_Mutex, portMAX_DELAY);
+  if (SpiBusInit() != ESP_OK)
+  {
+    // the display retries through SpiBus__Recover()
+    ESP_LOGE(TAG, "bus not initialized");
+  }
+  xSemaphoreGive(x_SpiBus_Mutex);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Tells if the bus is initialized and the devices can be attached.
+ *
+ * @return  true if initialized
+ */
+bool SpiBus__Is_Ready(void)
+{
+  return b_SpiBus_Ready;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Frees and initializes the bus again, after a fault that a
+ *          device reset did not clear. Not done while another client is
+ *          attached, the bus is initialized only if it is not.
+ *
+ * @param   e_client - client asking the recovery, with its device detached
+ *
+ * @return  ESP_OK if the bus has been initialized again,
+ *          ESP_ERR_INVALID_STATE if it is used by another client
+ */
+esp_err_t SpiBus__Recover(SPIBUS_CLIENT_ENUM e_client)
+{
+  esp_err_t x_err = ESP_OK;
+  uint8_t u8_client;
+
+  xSemaphoreTake(x_SpiBus_Mutex, portMAX_DELAY);
+
+  for (u8_client = 0; u8_client < NUM_OF_SPIBUS_CLIENTS; u8_client++)
+  {
+    if ((u8_client != e_client) && (px_SpiBus_Client[u8_client].attached == true))
+    {
+      x_err = ESP_ERR_INVALID_STATE;
+    }
+  }
+
+  if ((x_err == ESP_OK) && (b_SpiBus_Ready == true))
+  {
+    x_err = spi_bus_free(SPIBUS_HOST);
+    if (x_err == ESP_OK)
+    {
+      b_SpiBus_Ready = false;
+    }
+  }
+
+  if (x_err == ESP_OK)
+  {
+    x_err = SpiBusInit();
+  }
+
+  xSemaphoreGive(x_SpiBus_Mutex);
+
+  return x_err;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Attaches the device of a client to the bus.
+ *
+ * @param   e_client - client of the device
+ * @param   px_config - device configuration, its clock is used for SpiBus__Hold_Us()
+ * @param   px_device_hdl - filled with the device handle
+ *
+ * @return  result of spi_bus_add_device(), ESP_ERR_INVALID_STATE if the bus is not initialized
+ */
+esp_err_t SpiBus__Attach(SPIBUS_CLIENT_ENUM e_client, const spi_device_interface_config_t *px_config,
+                         spi_device_handle_t *px_device_hdl)
+{
+  esp_err_t x_err = ESP_ERR_INVALID_STATE;
+
+  xSemaphoreTake(x_SpiBus_Mutex, portMAX_DELAY);
+
+  if (b_SpiBus_Ready == true)
+  {
+    x_err = spi_bus_add_device(SPIBUS_HOST, px_config, px_device_hdl);
+    if (x_err == ESP_OK)
+    {
+      px_SpiBus_Client[e_client].attached = true;
+      px_SpiBus_Client[e_client].clock_hz = (uint32_t)px_config->clock_speed_hz;
+    }
+  }
+
+  xSemaphoreGive(x_SpiBus_Mutex);
+
+  return x_err;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Detaches the device of a client from the bus, the transactions of
+ *          the device must be completed.
+ *
+ * @param   e_client - client of the device
+ * @param   px_device_hdl - device handle, set to NULL when detached
+ *
+ * @return  result of spi_bus_remove_device()
+ */
+esp_err_t SpiBus__Detach(SPIBUS_CLIENT_ENUM e_client, spi_device_handle_t *px_device_hdl)
+{
+  esp_err_t x_err = ESP_OK;
+
+  xSemaphoreTake(x_SpiBus_Mutex, portMAX_DELAY);
+
+  if (*px_device_hdl != NULL)
+  {
+    x_err = spi_bus_remove_device(*px_device_hdl);
+    if (x_err == ESP_OK)
+    {
+      *px_device_hdl = NULL;
+      px_SpiBus_Client[e_client].attached = false;
+    }
+  }
+
+  xSemaphoreGive(x_SpiBus_Mutex);
+
+  return x_err;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Bus time of a transfer of the client, at the clock of its device.
+ *
+ * @param   e_client - client
+ * @param   u32_bytes - bytes of the transfer
+ *
+ * @return  time to ask to SpiBus__Acquire(), in microseconds
+ */
+uint32_t SpiBus__Hold_Us(SPIBUS_CLIENT_ENUM e_client, uint32_t u32_bytes)
+{
+  uint32_t u32_clock_hz = px_SpiBus_Client[e_client].clock_hz;
+
+  if (u32_clock_hz == 0)
+  {
+    return SPIBUS_TRANS_OVERHEAD_US;
+  }
+
+  return (uint32_t)(((uint64_t)u32_bytes * 8 * 1000000) / u32_clock_hz) + SPIBUS_TRANS_OVERHEAD_US;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Longest hold of the bus granted to the client.
+ *
+ * @param   e_client - client
+ *
+ * @return  max time to ask to SpiBus__Acquire(), in microseconds
+ */
+uint32_t SpiBus__Max_Hold_Us(SPIBUS_CLIENT_ENUM e_client)
+{
+  return px_SpiBus_Desc[e_client].max_hold_us;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Waits for the bus. The request is refused if longer than the max
+ *          hold of the client: longer transfers must be split, releasing the
+ *          bus between the parts.
+ *
+ * @param   e_client - client asking the bus
+ * @param   u32_hold_us - time the bus will be held, SpiBus__Hold_Us()
+ * @param   x_wait - longest wait, in ticks
+ *
+ * @return  true if the bus is owned by the client, to be released by SpiBus__Release()
+ */
+bool SpiBus__Acquire(SPIBUS_CLIENT_ENUM e_client, uint32_t u32_hold_us, TickType_t x_wait)
+{
+  SPIBUS_CLIENT_TYPE *px_client = &px_SpiBus_Client[e_client];
+  uint32_t u32_deadline_us = px_SpiBus_Desc[e_client].deadline_us;
+  bool b_granted = false;
+  bool b_late = false;
+  uint32_t u32_wait_us;
+  int64_t s64_now_us;
+
+  if (u32_hold_us > px_SpiBus_Desc[e_client].max_hold_us)
+  {
+    portENTER_CRITICAL(&x_SpiBus_Mux);
+    px_client->stats.refused++;
+    portEXIT_CRITICAL(&x_SpiBus_Mux);
+    return false;
+  }
+
+  s64_now_us = esp_timer_get_time();
+
+  portENTER_CRITICAL(&x_SpiBus_Mux);
+  SpiBusRefill(e_client, s64_now_us);
+  if ((u8_SpiBus_Owner == SPIBUS_OWNER_NONE) && (SpiBusWaiting() == false))
+  {
+    u8_SpiBus_Owner = e_client;
+    px_client->grant_us = s64_now_us;
+    px_client->stats.grants++;
+    b_granted = true;
+  }
+  else
+  {
+    px_client->request_us = s64_now_us;
+    px_client->stats.contended++;
+  }
+  portEXIT_CRITICAL(&x_SpiBus_Mux);
+
+  if (b_granted == true)
+  {
+    Metrics__Counter_Add(METRICS_SPIBUS_GRANTS, 1);
+    return true;
+  }
+
+  Metrics__Counter_Add(METRICS_SPIBUS_CONTENDED, 1);
+
+  if (xSemaphoreTake(px_client->grant_sem, x_wait) != pdTRUE)
+  {
+    portENTER_CRITICAL(&x_SpiBus_Mux);
+    if (u8_SpiBus_Owner == e_client)
+    {
+      // granted after the timeout, the semaphore is being given
+      b_late = true;
+    }
+    else
+    {
+      px_client->request_us = 0;
+      px_client->stats.timeouts++;
+    }
+    portEXIT_CRITICAL(&x_SpiBus_Mux);
+
+    if (b_late == false)
+    {
+      Metrics__Counter_Add(METRICS_SPIBUS_TIMEOUTS, 1);
+      return false;
+    }
+
+    (void)xSemaphoreTake(px_client->grant_sem, portMAX_DELAY);
+  }
+
+  // granted by SpiBus__Release(), that set grant_us
+  portENTER_CRITICAL(&x_SpiBus_Mux);
+  u32_wait_us = (uint32_t)(px_client->grant_us - px_client->request_us);
+  px_client->request_us = 0;
+  px_client->stats.grants++;
+  px_client->wait_sum_us += u32_wait_us;
+  if (u32_wait_us > px_client->stats.wait_max_us)
+  {
+    px_client->stats.wait_max_us = u32_wait_us;
+  }
+  if ((u32_deadline_us != 0) && (u32_wait_us > u32_deadline_us))
+  {
+    px_client->stats.deadline_misses++;
+  }
+  portEXIT_CRITICAL(&x_SpiBus_Mux);
+
+  Metrics__Counter_Add(METRICS_SPIBUS_GRANTS, 1);
+  Metrics__Histogram_Observe(METRICS_SPIBUS_WAIT_US, u32_wait_us);
+  if ((u32_deadline_us != 0) && (u32_wait_us > u32_deadline_us))
+  {
+    Metrics__Counter_Add(METRICS_SPIBUS_DEADLINE_MISSES, 1);
+    BinLog__Event(BINLOG_SPIBUS_DEADLINE_MISS, e_client, u32_wait_us);
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Releases the bus, granting it to the next waiting client. Nothing
+ *          done if the bus is not owned by the client.
+ *
+ * @param   e_client - client owning the bus
+ */
+void SpiBus__Release(SPIBUS_CLIENT_ENUM e_client)
+{
+  SPIBUS_CLIENT_TYPE *px_client = &px_SpiBus_Client[e_client];
+  int64_t s64_now_us = esp_timer_get_time();
+  int64_t s64_busy_us;
+  uint8_t u8_next;
+
+  portENTER_CRITICAL(&x_SpiBus_Mux);
+  if (u8_SpiBus_Owner != e_client)
+  {
+    portEXIT_CRITICAL(&x_SpiBus_Mux);
+    return;
+  }
+
+  // the bus time is charged to the share of the client
+  s64_busy_us = s64_now_us - px_client->grant_us;
+  SpiBusRefill(e_client, s64_now_us);
+  px_client->tokens_us -= s64_busy_us;
+  px_client->stats.busy_us += (uint64_t)s64_busy_us;
+
+  u8_next = SpiBusNext();
+  u8_SpiBus_Owner = u8_next;
+  if (u8_next != SPIBUS_OWNER_NONE)
+  {
+    px_SpiBus_Client[u8_next].grant_us = s64_now_us;
+  }
+  portEXIT_CRITICAL(&x_SpiBus_Mux);
+
+  if (u8_next != SPIBUS_OWNER_NONE)
+  {
+    xSemaphoreGive(px_SpiBus_Client[u8_next].grant_sem);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Arbitration statistics of a client since boot.
+ *
+ * @param   e_client - client
+ * @param   px_stats - filled with the statistics
+ */
+void SpiBus__Get_Stats(SPIBUS_CLIENT_ENUM e_client, SPIBUS_STATS_TYPE *px_stats)
+{
+  SPIBUS_CLIENT_TYPE *px_client = &px_SpiBus_Client[e_client];
+
+  portENTER_CRITICAL(&x_SpiBus_Mux);
+  *px_stats = px_client->stats;
+  px_stats->wait_avg_us = (px_client->stats.contended > px_client->stats.timeouts) ?
+                          (uint32_t)(px_client->wait_sum_us / (px_client->stats.contended - px_client->stats.timeouts)) : 0;
+  portEXIT_CRITICAL(&x_SpiBus_Mux);
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Initializes the bus, without DMA (the transfers are short). To be
+ *          called with the mutex taken.
+ *
+ * @return  result of spi_bus_initialize()
+ */
+static esp_err_t SpiBusInit(void)
+{
+  const spi_bus_config_t x_bus_config =
+  {
+    .mosi_io_num = SPIBUS_MOSI_PIN,
+    .miso_io_num = SPIBUS_MISO_PIN,
+    .sclk_io_num = SPIBUS_CLK_PIN,
+    .quadwp_io_num = -1,     // WP not used
+    .quadhd_io_num = -1,     // Hold not used
+    .max_transfer_sz = 0,    // default
+  };
+  esp_err_t x_err;
+
+  x_err = spi_bus_initialize(SPIBUS_HOST, &x_bus_config, 0);
+  b_SpiBus_Ready = (x_err == ESP_OK);
+
+  return x_err;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Adds to the share of a client the bus time since the last refill,
+ *          up to one window of its share. To be called in the critical section.
+ *
+ * @param   e_client - client
+ * @param   s64_now_us - current time
+ */
+static void SpiBusRefill(SPIBUS_CLIENT_ENUM e_client, int64_t s64_now_us)
+{
+  SPIBUS_CLIENT_TYPE *px_client = &px_SpiBus_Client[e_client];
+  int64_t s64_max_us = ((int64_t)SPIBUS_WINDOW_US * px_SpiBus_Desc[e_client].reserved) / 1000;
+
+  px_client->tokens_us += ((s64_now_us - px_client->refill_us) * px_SpiBus_Desc[e_client].reserved) / 1000;
+  px_client->refill_us = s64_now_us;
+  if (px_client->tokens_us > s64_max_us)
+  {
+    px_client->tokens_us = s64_max_us;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Tells if a client is waiting for the bus. To be called in the
+ *          critical section.
+ *
+ * @return  true if a client is waiting
+ */
+static bool SpiBusWaiting(void)
+{
+  uint8_t u8_client;
+
+  for (u8_client = 0; u8_client < NUM_OF_SPIBUS_CLIENTS; u8_client++)
+  {
+    if ((px_SpiBus_Client[u8_client].request_us != 0) && (u8_client != u8_SpiBus_Owner))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Selects the waiting client getting the bus: the highest priority
+ *          among the ones within their share, then among the ones over it,
+ *          the first request at equal priority. To be called in the
+ *          critical section.
+ *
+ * @return  client, SPIBUS_OWNER_NONE if none is waiting
+ */
+static uint8_t SpiBusNext(void)
+{
+  const SPIBUS_CLIENT_TYPE *px_client;
+  const SPIBUS_CLIENT_TYPE *px_best;
+  uint8_t u8_best = SPIBUS_OWNER_NONE;
+  bool b_in_share;
+  bool b_best_in_share = false;
+  uint8_t u8_client;
+
+  for (u8_client = 0; u8_client < NUM_OF_SPIBUS_CLIENTS; u8_client++)
+  {
+    px_client = &px_SpiBus_Client[u8_client];
+    if ((px_client->request_us == 0) || (u8_client == u8_SpiBus_Owner))
+    {
+      continue;
+    }
+
+    SpiBusRefill((SPIBUS_CLIENT_ENUM)u8_client, esp_timer_get_time());
+    b_in_share = (px_client->tokens_us > 0);
+
+    if (u8_best == SPIBUS_OWNER_NONE)
+    {
+      u8_best = u8_client;
+      b_best_in_share = b_in_share;
+      continue;
+    }
+
+    px_best = &px_SpiBus_Client[u8_best];
+    if ((b_in_share != b_best_in_share) ? (b_in_share == true) :
+        (px_SpiBus_Desc[u8_client].priority != px_SpiBus_Desc[u8_best].priority) ?
+        (px_SpiBus_Desc[u8_client].priority > px_SpiBus_Desc[u8_best].priority) :
+        (px_client->request_us < px_best->request_us))
+    {
+      u8_best = u8_client;
+      b_best_in_share = b_in_share;
+    }
+  }
+
+  return u8_best;
+}
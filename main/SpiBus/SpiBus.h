@@ -0,0 +1,43 @@
+
+/**
+ *  @file       SpiBus.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef SPIBUS_H
+    #define SPIBUS_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "driver/spi_master.h"
+#include <SpiBus_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void SpiBus__Initialize(void);
+bool SpiBus__Is_Ready(void);
+esp_err_t SpiBus__Recover(SPIBUS_CLIENT_ENUM e_client);
+esp_err_t SpiBus__Attach(SPIBUS_CLIENT_ENUM e_client, const spi_device_interface_config_t *px_config,
+                         spi_device_handle_t *px_device_hdl);
+esp_err_t SpiBus__Detach(SPIBUS_CLIENT_ENUM e_client, spi_device_handle_t *px_device_hdl);
+uint32_t SpiBus__Hold_Us(SPIBUS_CLIENT_ENUM e_client, uint32_t u32_bytes);
+uint32_t SpiBus__Max_Hold_Us(SPIBUS_CLIENT_ENUM e_client);
+bool SpiBus__Acquire(SPIBUS_CLIENT_ENUM e_client, uint32_t u32_hold_us, TickType_t x_wait);
+void SpiBus__Release(SPIBUS_CLIENT_ENUM e_client);
+void SpiBus__Get_Stats(SPIBUS_CLIENT_ENUM e_client, SPIBUS_STATS_TYPE *px_stats);
+
+#endif
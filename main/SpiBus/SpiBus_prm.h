@@ -0,0 +1,48 @@
+
+/**
+ *  @file       SpiBus_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef SPIBUS_PRM_H
+    #define SPIBUS_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+/*
+ * Define here the devices sharing the bus, their priority, bandwidth share
+ * and longest hold are set in SPIBUS_CLIENTS_DESC (SpiBus_prv.h)
+ */
+typedef enum
+{
+  SPIBUS_CLIENT_DISPLAY = 0,        /*Holtek driver, refresh with a deadline*/
+  SPIBUS_CLIENT_LOGGER,             /*SPI flash logger, bulk transfers*/
+  SPIBUS_CLIENT_SENSOR,             /*sensor, short periodic reads*/
+  NUM_OF_SPIBUS_CLIENTS
+}SPIBUS_CLIENT_ENUM;
+
+// arbitration statistics of a client, since boot
+typedef struct
+{
+  uint32_t grants;                  // bus grants
+  uint32_t contended;               // requests that had to wait for another client
+  uint32_t timeouts;                // requests not granted in time
+  uint32_t refused;                 // requests longer than the client max hold
+  uint32_t deadline_misses;         // grants later than the client deadline
+  uint32_t wait_max_us;             // longest wait for a grant
+  uint32_t wait_avg_us;             // mean wait of the contended requests
+  uint64_t busy_us;                 // bus time used
+}SPIBUS_STATS_TYPE;
+
+#endif
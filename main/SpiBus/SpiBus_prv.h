@@ -0,0 +1,83 @@
+
+/**
+ *  @file       SpiBus_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef SPIBUS_PRV_H
+    #define SPIBUS_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "driver/spi_master.h"
+#include <SpiBus_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+#define SPIBUS_HOST                 HSPI_HOST
+
+// bus pins, the chip select of each device is set when it is attached
+#define SPIBUS_MOSI_PIN             GPIO_NUM_18
+#define SPIBUS_CLK_PIN              GPIO_NUM_19
+#define SPIBUS_MISO_PIN             CONFIG_SPIBUS_MISO_GPIO
+
+// time added to each transaction for the chip select and the driver, in the hold estimate
+#define SPIBUS_TRANS_OVERHEAD_US    20
+
+// period over which the bandwidth share of a client is measured
+#define SPIBUS_WINDOW_US            100000
+
+#define SPIBUS_OWNER_NONE           0xFF
+
+/*
+ * Arbitration parameters of a client:
+ *  - priority: among the clients within their bandwidth share, the highest
+ *    one waiting gets the bus when it is released (equal priority: first
+ *    request first). Clients over their share get it only when no client
+ *    within its share is waiting.
+ *  - reserved: bandwidth share, permille of the bus time
+ *  - max_hold_us: longest hold of a request, longer transfers must be split.
+ *    The wait of the display is bounded by the max_hold_us of the others.
+ *  - deadline_us: longest wait tolerated, later grants are counted as
+ *    misses (0 = no deadline)
+ */
+typedef struct
+{
+  const char *name;
+  uint8_t priority;
+  uint16_t reserved;
+  uint32_t max_hold_us;
+  uint32_t deadline_us;
+}SPIBUS_CLIENT_DESC_TYPE;
+
+#define SPIBUS_CLIENTS_DESC \
+{ \
+  [SPIBUS_CLIENT_DISPLAY] = {"display", 3, 300, 5000, 3000}, \
+  [SPIBUS_CLIENT_LOGGER]  = {"logger",  1, 500, 2000, 0}, \
+  [SPIBUS_CLIENT_SENSOR]  = {"sensor",  2, 100,  500, 20000}, \
+}
+
+typedef struct
+{
+  SemaphoreHandle_t grant_sem;      // given to the waiting client when it gets the bus
+  int64_t request_us;               // request waiting, 0 if none
+  int64_t grant_us;
+  int64_t tokens_us;                // bus time left in the bandwidth share, negative if over it
+  int64_t refill_us;
+  uint32_t clock_hz;                // clock of the device, for the hold estimate
+  bool attached;
+  uint64_t wait_sum_us;
+  SPIBUS_STATS_TYPE stats;
+}SPIBUS_CLIENT_TYPE;
+
+#endif
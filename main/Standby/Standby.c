@@ -0,0 +1,401 @@
+
+/**
+ *  @file       Standby.c
+ *
+ *  @brief      Standby mode: the display is switched off and detached, the
+ *              refresh is stopped, Wi-Fi listens only at the DTIM beacons
+ *              and the CPU goes in light sleep between the events.
+ *              It is entered and left by the schedule (DISPLAY_OFF /
+ *              DISPLAY_ON entries), by the network command or, leaving it,
+ *              by a button.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+#include "freertos/semphr.h"
+#include "driver/gpio.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include <Standby.h>
+#include <Standby_prv.h>
+#include <Holtek.h>
+#include <Alarm.h>
+#include <Keys.h>
+#include <TickSync.h>
+#include <HttpSrv.h>
+#include <Metrics.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static volatile bool b_Standby_Active;
+static int64_t s64_Standby_Start_Us;
+
+// the whole enter and exit sequences are serialized: display, radio and power management
+static SemaphoreHandle_t x_Standby_Mutex;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t x_Standby_Mutex_Buffer;
+#endif
+
+static const char *TAG = "Standby";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static void StandbyPowerConfig(bool b_standby);
+static void StandbyRadioConfig(void);
+static void StandbyAlarmOff(uint16_t u16_id, uint8_t u8_arg);
+static void StandbyAlarmOn(uint16_t u16_id, uint8_t u8_arg);
+static bool StandbyKey(const KEYS_EVENT_TYPE *px_event);
+static esp_err_t StandbyHttpGetHandler(httpd_req_t *px_req);
+static esp_err_t StandbyHttpPostHandler(httpd_req_t *px_req);
+#if (STANDBY_WAKE_GPIO >= 0)
+static void StandbyWakeIsr(void *pv_arg);
+static void StandbyWakeDeferred(void *pv_arg, uint32_t u32_arg);
+#endif
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, registers the schedule actions and
+ *          the network command and the keys. To be called after the
+ *          display, the alarms, the keys and the HTTP server are started.
+ *
+ */
+void Standby__Initialize(void)
+{
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = STANDBY_URI,
+    .method = HTTP_GET,
+    .handler = StandbyHttpGetHandler,
+    .user_ctx = NULL
+  };
+  const httpd_uri_t x_post_uri =
+  {
+    .uri = STANDBY_URI,
+    .method = HTTP_POST,
+    .handler = StandbyHttpPostHandler,
+    .user_ctx = NULL
+  };
+#if (STANDBY_WAKE_GPIO >= 0)
+  const gpio_config_t x_wake_gpio =
+  {
+    .pin_bit_mask = (1ULL << STANDBY_WAKE_GPIO),
+    .mode = GPIO_MODE_INPUT,
+    .pull_up_en = GPIO_PULLUP_ENABLE,
+    .pull_down_en = GPIO_PULLDOWN_DISABLE,
+    .intr_type = GPIO_INTR_DISABLE,
+  };
+  esp_err_t x_err;
+
+  // the interrupt is enabled only in standby
+  ESP_ERROR_CHECK(gpio_config(&x_wake_gpio));
+
+  // the ISR service can be already installed by another module
+  x_err = gpio_install_isr_service(0);
+  if ((x_err == ESP_OK) || (x_err == ESP_ERR_INVALID_STATE))
+  {
+    ESP_ERROR_CHECK(gpio_isr_handler_add(STANDBY_WAKE_GPIO, StandbyWakeIsr, NULL));
+  }
+#endif
+
+  SysMon__Register_Module(TAG, sizeof(b_Standby_Active) + sizeof(s64_Standby_Start_Us));
+
+#if CONFIG_APP_STATIC_ALLOCATION
+  x_Standby_Mutex = xSemaphoreCreateMutexStatic(&x_Standby_Mutex_Buffer);
+  SysMon__Register_Module(TAG, sizeof(x_Standby_Mutex_Buffer));
+#else
+  x_Standby_Mutex = xSemaphoreCreateMutex();
+#endif
+
+  Alarm__Register_Action(ALARM_ACTION_DISPLAY_OFF, StandbyAlarmOff);
+  Alarm__Register_Action(ALARM_ACTION_DISPLAY_ON, StandbyAlarmOn);
+
+  (void)Keys__Register_Handler(StandbyKey);
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+  (void)HttpSrv__Register_Uri(&x_post_uri);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Enters the standby. The timers still armed (i.e. the schedule)
+ *          wake the CPU up from light sleep when they expire. An exit
+ *          requested meanwhile (key, button, schedule, network) waits for
+ *          the end of the sequence.
+ *
+ */
+void Standby__Enter(void)
+{
+  xSemaphoreTake(x_Standby_Mutex, portMAX_DELAY);
+  if (b_Standby_Active == true)
+  {
+    xSemaphoreGive(x_Standby_Mutex);
+    return;
+  }
+  b_Standby_Active = true;
+  s64_Standby_Start_Us = esp_timer_get_time();
+
+  Metrics__Counter_Add(METRICS_STANDBY_ENTRIES, 1);
+  ESP_LOGI(TAG, "enter");
+
+  Holtek__Set_Standby(true);
+
+  // the station keeps the association, waking up at the DTIM beacons only
+  (void)esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+
+#if (STANDBY_WAKE_GPIO >= 0)
+  (void)gpio_wakeup_enable(STANDBY_WAKE_GPIO, GPIO_INTR_LOW_LEVEL);
+  (void)esp_sleep_enable_gpio_wakeup();
+  (void)gpio_intr_enable(STANDBY_WAKE_GPIO);
+#endif
+
+  StandbyPowerConfig(true);
+
+  xSemaphoreGive(x_Standby_Mutex);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Leaves the standby: the CPU goes back to full speed first, then
+ *          the display is switched on with its short resume sequence. An
+ *          enter requested meanwhile waits for the end of the sequence.
+ *
+ */
+void Standby__Exit(void)
+{
+  int64_t s64_duration_us;
+
+  xSemaphoreTake(x_Standby_Mutex, portMAX_DELAY);
+  if (b_Standby_Active == false)
+  {
+    xSemaphoreGive(x_Standby_Mutex);
+    return;
+  }
+  b_Standby_Active = false;
+  s64_duration_us = esp_timer_get_time() - s64_Standby_Start_Us;
+
+  StandbyPowerConfig(false);
+
+  Holtek__Set_Standby(false);
+
+  StandbyRadioConfig();
+
+#if (STANDBY_WAKE_GPIO >= 0)
+  (void)gpio_intr_disable(STANDBY_WAKE_GPIO);
+  (void)gpio_wakeup_disable(STANDBY_WAKE_GPIO);
+#endif
+
+  xSemaphoreGive(x_Standby_Mutex);
+
+  Metrics__Counter_Add(METRICS_STANDBY_SECONDS, (uint32_t)(s64_duration_us / 1000000));
+  ESP_LOGI(TAG, "exit after %d s", (int)(s64_duration_us / 1000000));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Applies a change of the radio power save out of standby (i.e.
+ *          the tick sync switched on or off). In standby it is applied by
+ *          Standby__Exit().
+ *
+ */
+void Standby__Radio_Changed(void)
+{
+  xSemaphoreTake(x_Standby_Mutex, portMAX_DELAY);
+  if (b_Standby_Active == false)
+  {
+    StandbyRadioConfig();
+  }
+  xSemaphoreGive(x_Standby_Mutex);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Tells if the standby has been requested.
+ *
+ * @return true in standby
+ */
+bool Standby__Is_Active(void)
+{
+  return b_Standby_Active;
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Enables the automatic light sleep and the frequency scaling in
+ *          standby, out of it the CPU is kept at full speed.
+ *
+ * @param b_standby true entering the standby
+ */
+static void StandbyPowerConfig(bool b_standby)
+{
+#if STANDBY_LIGHT_SLEEP
+  const esp_pm_config_esp32_t x_pm_config =
+  {
+    .max_freq_mhz = STANDBY_CPU_MAX_MHZ,
+    .min_freq_mhz = (b_standby == true) ? STANDBY_CPU_MIN_MHZ : STANDBY_CPU_MAX_MHZ,
+    .light_sleep_enable = b_standby,
+  };
+
+  if (esp_pm_configure(&x_pm_config) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "power management not configured");
+  }
+#endif
+}
+
+/**
+ * @brief   Radio power save out of standby: the tick sync keeps the radio
+ *          awake, the modem sleep delays its exchanges.
+ *
+ */
+static void StandbyRadioConfig(void)
+{
+  (void)esp_wifi_set_ps((TickSync__Is_Enabled() == true) ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM);
+}
+
+/**
+ * @brief   ALARM_ACTION_DISPLAY_OFF handler.
+ *
+ * @param u16_id  entry
+ * @param u8_arg  not used
+ */
+static void StandbyAlarmOff(uint16_t u16_id, uint8_t u8_arg)
+{
+  Standby__Enter();
+}
+
+/**
+ * @brief   ALARM_ACTION_DISPLAY_ON handler.
+ *
+ * @param u16_id  entry
+ * @param u8_arg  not used
+ */
+static void StandbyAlarmOn(uint16_t u16_id, uint8_t u8_arg)
+{
+  Standby__Exit();
+}
+
+/**
+ * @brief   Keys handler: in standby any key leaves it, the key is consumed.
+ *
+ * @param px_event key event
+ *
+ * @return true if the standby has been left
+ */
+static bool StandbyKey(const KEYS_EVENT_TYPE *px_event)
+{
+  if ((Standby__Is_Active() == false) ||
+      ((px_event->type != KEYS_EVENT_PRESS) && (px_event->type != KEYS_EVENT_CHORD)))
+  {
+    return false;
+  }
+
+  Standby__Exit();
+
+  return true;
+}
+
+/**
+ * @brief   Network command, state of the standby.
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t StandbyHttpGetHandler(httpd_req_t *px_req)
+{
+  httpd_resp_sendstr(px_req, (Standby__Is_Active() == true) ? "on\n" : "off\n");
+
+  return ESP_OK;
+}
+
+/**
+ * @brief   Network command, body "on" enters the standby and "off" leaves it.
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK if the command is valid
+ */
+static esp_err_t StandbyHttpPostHandler(httpd_req_t *px_req)
+{
+  char pc_body[STANDBY_HTTP_BODY_MAX + 1];
+  int s32_len;
+
+  s32_len = httpd_req_recv(px_req, pc_body, STANDBY_HTTP_BODY_MAX);
+  pc_body[(s32_len > 0) ? s32_len : 0] = '\0';
+  pc_body[strcspn(pc_body, "\r\n")] = '\0';
+
+  if (strcmp(pc_body, "on") == 0)
+  {
+    // the response leaves before Wi-Fi power save starts
+    httpd_resp_sendstr(px_req, "OK\n");
+    Standby__Enter();
+  }
+  else if (strcmp(pc_body, "off") == 0)
+  {
+    Standby__Exit();
+    httpd_resp_sendstr(px_req, "OK\n");
+  }
+  else
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "expected on or off");
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+#if (STANDBY_WAKE_GPIO >= 0)
+/**
+ * @brief   Wake-up button interrupt, the pin is low: the interrupt is
+ *          disabled (it is level triggered, as needed to wake up from light
+ *          sleep) and the exit is deferred to the timer service task.
+ *
+ * @param pv_arg not used
+ */
+static void StandbyWakeIsr(void *pv_arg)
+{
+  BaseType_t x_higher_prio_woken = pdFALSE;
+
+  (void)gpio_intr_disable(STANDBY_WAKE_GPIO);
+  (void)xTimerPendFunctionCallFromISR(StandbyWakeDeferred, NULL, 0, &x_higher_prio_woken);
+
+  if (x_higher_prio_woken == pdTRUE)
+  {
+    portYIELD_FROM_ISR();
+  }
+}
+
+/**
+ * @brief   Leaves the standby after the button, runs in the timer service task.
+ *
+ * @param pv_arg  not used
+ * @param u32_arg not used
+ */
+static void StandbyWakeDeferred(void *pv_arg, uint32_t u32_arg)
+{
+  Standby__Exit();
+}
+#endif
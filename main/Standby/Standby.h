@@ -0,0 +1,34 @@
+
+/**
+ *  @file       Standby.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef STANDBY_H
+    #define STANDBY_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdbool.h>
+#include <Standby_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void Standby__Initialize(void);
+void Standby__Enter(void);
+void Standby__Exit(void);
+void Standby__Radio_Changed(void);
+bool Standby__Is_Active(void);
+
+#endif
@@ -0,0 +1,40 @@
+
+/**
+ *  @file       Standby_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef STANDBY_PRV_H
+    #define STANDBY_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// button leaving the standby, active low, -1 if not used
+#define STANDBY_WAKE_GPIO           CONFIG_STANDBY_WAKE_GPIO
+
+// automatic light sleep while in standby, it needs the power management
+#if CONFIG_PM_ENABLE && CONFIG_STANDBY_LIGHT_SLEEP
+#define STANDBY_LIGHT_SLEEP         1
+#else
+#define STANDBY_LIGHT_SLEEP         0
+#endif
+
+// CPU clock out of the standby and, while in standby, when not sleeping
+#define STANDBY_CPU_MAX_MHZ         CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ
+#define STANDBY_CPU_MIN_MHZ         CONFIG_ESP32_XTAL_FREQ
+
+// longest body of the network command
+#define STANDBY_HTTP_BODY_MAX       8
+
+#endif
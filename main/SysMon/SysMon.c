@@ -0,0 +1,240 @@
+
+/**
+ *  @file       SysMon.c
+ *
+ *  @brief      Memory budget monitor: collects the static memory and the task
+ *              stacks reserved by each module and reports them together with
+ *              the stack high-water marks and the heap usage after boot.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include <SysMon.h>
+#include <SysMon_prv.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static SYSMON_MODULE_TYPE px_SysMon_Module[SYSMON_MAX_MODULES];
+static uint8_t u8_SysMon_Module_Num;
+
+static SYSMON_TASK_TYPE px_SysMon_Task[SYSMON_MAX_TASKS];
+static uint8_t u8_SysMon_Task_Num;
+
+// free heap when the boot sequence was completed, 0 until then
+static uint32_t u32_SysMon_Heap_Boot;
+
+static esp_timer_handle_t x_SysMon_Report_Timer;
+
+static portMUX_TYPE x_SysMon_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *TAG = "SysMon";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static SYSMON_MODULE_TYPE *SysMonModuleGet(const char *pc_module);
+static void SysMonReportCallback(void *pv_args);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, to be called before any other
+ *          module registers its budget.
+ *
+ */
+void SysMon__Initialize(void)
+{
+  memset(px_SysMon_Module, 0x00, sizeof(px_SysMon_Module));
+  memset(px_SysMon_Task, 0x00, sizeof(px_SysMon_Task));
+  u8_SysMon_Module_Num = 0;
+  u8_SysMon_Task_Num = 0;
+  u32_SysMon_Heap_Boot = 0;
+
+  SysMon__Register_Module(TAG, sizeof(px_SysMon_Module) + sizeof(px_SysMon_Task));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Adds static memory (RAM reserved at link time) to the budget of a module.
+ *
+ * @param pc_module        module name, must be a string literal
+ * @param u32_static_bytes bytes reserved by the module
+ */
+void SysMon__Register_Module(const char *pc_module, uint32_t u32_static_bytes)
+{
+  SYSMON_MODULE_TYPE *px_module;
+
+  portENTER_CRITICAL(&x_SysMon_Mux);
+  px_module = SysMonModuleGet(pc_module);
+  if (px_module != NULL)
+  {
+    px_module->static_bytes += u32_static_bytes;
+  }
+  portEXIT_CRITICAL(&x_SysMon_Mux);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Adds a task to the budget of a module, its stack high-water mark
+ *          is part of the report.
+ *
+ * @param pc_module       module name, must be a string literal
+ * @param x_task_hdl      task handle
+ * @param u32_stack_bytes stack size the task was created with
+ */
+void SysMon__Register_Task(const char *pc_module, TaskHandle_t x_task_hdl, uint32_t u32_stack_bytes)
+{
+  SYSMON_MODULE_TYPE *px_module;
+
+  if (x_task_hdl == NULL)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&x_SysMon_Mux);
+  px_module = SysMonModuleGet(pc_module);
+  if (px_module != NULL)
+  {
+    px_module->stack_bytes += u32_stack_bytes;
+  }
+
+  if (u8_SysMon_Task_Num < SYSMON_MAX_TASKS)
+  {
+    px_SysMon_Task[u8_SysMon_Task_Num].module = pc_module;
+    px_SysMon_Task[u8_SysMon_Task_Num].task_hdl = x_task_hdl;
+    px_SysMon_Task[u8_SysMon_Task_Num].stack_bytes = u32_stack_bytes;
+    u8_SysMon_Task_Num++;
+  }
+  portEXIT_CRITICAL(&x_SysMon_Mux);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Marks the end of the boot sequence: the free heap at this point is
+ *          the reference used to detect heap usage after boot. Prints the
+ *          first report and starts the periodic one.
+ *
+ */
+void SysMon__Boot_Completed(void)
+{
+  u32_SysMon_Heap_Boot = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+
+  SysMon__Report();
+
+  if (SYSMON_REPORT_PERIOD_S != 0)
+  {
+    const esp_timer_create_args_t x_report_timer_args =
+    {
+      .callback = &SysMonReportCallback,
+      .arg = NULL,
+      .name = "SysMonReport"
+    };
+
+    if (esp_timer_create(&x_report_timer_args, &x_SysMon_Report_Timer) == ESP_OK)
+    {
+      esp_timer_start_periodic(x_SysMon_Report_Timer, (uint64_t)SYSMON_REPORT_PERIOD_S * 1000000ULL);
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Prints the heap status and the per-module memory budget.
+ *
+ */
+void SysMon__Report(void)
+{
+  uint32_t u32_heap_free = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+  uint32_t u32_total_static = 0;
+  uint32_t u32_total_stack = 0;
+  uint8_t u8_idx;
+
+  ESP_LOGI(TAG, "heap free:%u min:%u largest:%u used after boot:%d",
+           u32_heap_free,
+           (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT),
+           (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT),
+           (u32_SysMon_Heap_Boot != 0) ? (int32_t)(u32_SysMon_Heap_Boot - u32_heap_free) : 0);
+
+  for (u8_idx = 0; u8_idx < u8_SysMon_Module_Num; ++u8_idx)
+  {
+    ESP_LOGI(TAG, "%-12s static:%6u B  stacks:%6u B",
+             px_SysMon_Module[u8_idx].name,
+             px_SysMon_Module[u8_idx].static_bytes,
+             px_SysMon_Module[u8_idx].stack_bytes);
+
+    u32_total_static += px_SysMon_Module[u8_idx].static_bytes;
+    u32_total_stack += px_SysMon_Module[u8_idx].stack_bytes;
+  }
+  ESP_LOGI(TAG, "%-12s static:%6u B  stacks:%6u B", "total", u32_total_static, u32_total_stack);
+
+  // high-water mark is the minimum free stack ever seen, in bytes
+  for (u8_idx = 0; u8_idx < u8_SysMon_Task_Num; ++u8_idx)
+  {
+    ESP_LOGI(TAG, "%-12s task %-16s stack:%5u B  free min:%5u B",
+             px_SysMon_Task[u8_idx].module,
+             pcTaskGetTaskName(px_SysMon_Task[u8_idx].task_hdl),
+             px_SysMon_Task[u8_idx].stack_bytes,
+             (uint32_t)uxTaskGetStackHighWaterMark(px_SysMon_Task[u8_idx].task_hdl));
+  }
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Looks for the budget entry of a module, creates it if missing.
+ *          To be called in critical section.
+ *
+ * @param pc_module module name
+ *
+ * @return entry of the module, NULL if the table is full
+ */
+static SYSMON_MODULE_TYPE *SysMonModuleGet(const char *pc_module)
+{
+  uint8_t u8_idx;
+
+  for (u8_idx = 0; u8_idx < u8_SysMon_Module_Num; ++u8_idx)
+  {
+    if (strcmp(px_SysMon_Module[u8_idx].name, pc_module) == 0)
+    {
+      return &px_SysMon_Module[u8_idx];
+    }
+  }
+
+  if (u8_SysMon_Module_Num >= SYSMON_MAX_MODULES)
+  {
+    return NULL;
+  }
+
+  px_SysMon_Module[u8_SysMon_Module_Num].name = pc_module;
+  return &px_SysMon_Module[u8_SysMon_Module_Num++];
+}
+
+/**
+ * @brief   Periodic report callback, runs in the esp_timer task.
+ *
+ * @param pv_args NULL
+ */
+static void SysMonReportCallback(void *pv_args)
+{
+  SysMon__Report();
+}
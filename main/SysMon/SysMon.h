@@ -0,0 +1,60 @@
+
+/**
+ *  @file       SysMon.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022. 
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef SYSMON_H
+    #define SYSMON_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <SysMon_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+/*
+ * Helpers to create a task either on the heap or, when CONFIG_APP_STATIC_ALLOCATION
+ * is set, on a stack/TCB pool reserved at link time. SYSMON_TASK_POOL() declares the
+ * pool next to the task, SYSMON_TASK_CREATE() creates the task and fills the handle.
+ */
+#if CONFIG_APP_STATIC_ALLOCATION
+  #define SYSMON_TASK_POOL(name, stack_size) \
+    static StackType_t name##_Stack[stack_size]; \
+    static StaticTask_t name##_Tcb;
+
+  #define SYSMON_TASK_POOL_BYTES(name)  (sizeof(name##_Stack) + sizeof(name##_Tcb))
+
+  #define SYSMON_TASK_CREATE(name, fn, pc_name, stack_size, pv_args, prio, px_hdl, core_id) \
+    (*(px_hdl) = xTaskCreateStaticPinnedToCore((fn), (pc_name), (stack_size), (pv_args), (prio), \
+                                               name##_Stack, &name##_Tcb, (core_id)))
+#else
+  #define SYSMON_TASK_POOL(name, stack_size)
+
+  #define SYSMON_TASK_POOL_BYTES(name)  0
+
+  #define SYSMON_TASK_CREATE(name, fn, pc_name, stack_size, pv_args, prio, px_hdl, core_id) \
+    xTaskCreatePinnedToCore((fn), (pc_name), (stack_size), (pv_args), (prio), (px_hdl), (core_id))
+#endif
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void SysMon__Initialize(void);
+void SysMon__Register_Module(const char *pc_module, uint32_t u32_static_bytes);
+void SysMon__Register_Task(const char *pc_module, TaskHandle_t x_task_hdl, uint32_t u32_stack_bytes);
+void SysMon__Boot_Completed(void);
+void SysMon__Report(void);
+
+#endif
@@ -0,0 +1,28 @@
+
+/**
+ *  @file       SysMon_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022. 
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef SYSMON_PRM_H
+    #define SYSMON_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+// max number of modules that can register a memory budget
+#define SYSMON_MAX_MODULES      24
+
+// max number of tasks whose stack is monitored
+#define SYSMON_MAX_TASKS        12
+
+#endif
@@ -0,0 +1,40 @@
+
+/**
+ *  @file       SysMon_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef SYSMON_PRV_H
+    #define SYSMON_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// period of the memory budget report, 0 to print it only at boot
+#define SYSMON_REPORT_PERIOD_S      CONFIG_APP_MEMORY_REPORT_PERIOD_S
+
+typedef struct
+{
+  const char *name;
+  uint32_t static_bytes;
+  uint32_t stack_bytes;
+}SYSMON_MODULE_TYPE;
+
+typedef struct
+{
+  const char *module;
+  TaskHandle_t task_hdl;
+  uint32_t stack_bytes;
+}SYSMON_TASK_TYPE;
+
+#endif
@@ -0,0 +1,525 @@
+
+/**
+ *  @file       TestPattern.c
+ *
+ *  @brief      Segment test patterns for the end of line test, in the normal
+ *              firmware: all on, walking segment, checkerboard and icon
+ *              sweep, shown on the top display layer one frame per step.
+ *              A run is started by the network command, by a "test" line
+ *              on the console UART or by holding all the keys together,
+ *              the whole sequence takes less than a second.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include <TestPattern.h>
+#include <TestPattern_prv.h>
+#include <Holtek.h>
+#include <Keys.h>
+#include <HttpSrv.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static TESTPATTERN_RESULT_TYPE x_TestPattern_Result;
+// patterns of the requested run, taken by the task
+static uint8_t u8_TestPattern_Request;
+
+static portMUX_TYPE x_TestPattern_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t x_TestPattern_Task_Hdl;
+
+static const char *TAG = "TestPattern";
+
+// stack and TCB of the tasks, reserved at link time in static allocation mode
+SYSMON_TASK_POOL(x_TestPattern_Task, TESTPATTERN_TASK_STACK)
+#if TESTPATTERN_UART
+SYSMON_TASK_POOL(x_TestPattern_Uart_Task, TESTPATTERN_UART_TASK_STACK)
+#endif
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static void TestPatternTaskCallback(void *pv_args);
+static void TestPatternSequence(uint8_t u8_patterns);
+static HOLTEK_FRAME_TYPE *TestPatternFrame(void);
+static void TestPatternShow(TickType_t *px_wake, uint16_t *pu16_steps);
+static bool TestPatternParse(char *pc_list, uint8_t *pu8_patterns);
+static bool TestPatternKey(const KEYS_EVENT_TYPE *px_event);
+static esp_err_t TestPatternHttpGetHandler(httpd_req_t *px_req);
+static esp_err_t TestPatternHttpPostHandler(httpd_req_t *px_req);
+#if TESTPATTERN_UART
+static void TestPatternUartTaskCallback(void *pv_args);
+#endif
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method: starts the test task and the
+ *          console reader, registers the keys handler and the network
+ *          command. To be called after the display, the keys and the HTTP
+ *          server are started.
+ *
+ */
+void TestPattern__Initialize(void)
+{
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = TESTPATTERN_URI,
+    .method = HTTP_GET,
+    .handler = TestPatternHttpGetHandler,
+    .user_ctx = NULL
+  };
+  const httpd_uri_t x_post_uri =
+  {
+    .uri = TESTPATTERN_URI,
+    .method = HTTP_POST,
+    .handler = TestPatternHttpPostHandler,
+    .user_ctx = NULL
+  };
+#if TESTPATTERN_UART
+  TaskHandle_t x_uart_task_hdl;
+#endif
+
+  SysMon__Register_Module(TAG, sizeof(x_TestPattern_Result) + SYSMON_TASK_POOL_BYTES(x_TestPattern_Task));
+
+  SYSMON_TASK_CREATE(x_TestPattern_Task, TestPatternTaskCallback, "TestPattern", TESTPATTERN_TASK_STACK, NULL,
+                     TESTPATTERN_TASK_PRIO, &x_TestPattern_Task_Hdl, tskNO_AFFINITY);
+  SysMon__Register_Task(TAG, x_TestPattern_Task_Hdl, TESTPATTERN_TASK_STACK);
+
+#if TESTPATTERN_UART
+  // the console keeps writing to the UART, the driver is needed to read it
+  if (uart_driver_install(TESTPATTERN_UART_NUM, TESTPATTERN_UART_RX_BYTES, 0, 0, NULL, 0) == ESP_OK)
+  {
+    SysMon__Register_Module(TAG, SYSMON_TASK_POOL_BYTES(x_TestPattern_Uart_Task));
+    SYSMON_TASK_CREATE(x_TestPattern_Uart_Task, TestPatternUartTaskCallback, "TestPatternUart",
+                       TESTPATTERN_UART_TASK_STACK, NULL, TESTPATTERN_UART_TASK_PRIO, &x_uart_task_hdl, tskNO_AFFINITY);
+    SysMon__Register_Task(TAG, x_uart_task_hdl, TESTPATTERN_UART_TASK_STACK);
+  }
+  else
+  {
+    ESP_LOGE(TAG, "UART %d not available, test commands only on %s", TESTPATTERN_UART_NUM, TESTPATTERN_URI);
+  }
+#endif
+
+  (void)Keys__Register_Handler(TestPatternKey);
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+  (void)HttpSrv__Register_Uri(&x_post_uri);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Starts a run of the test patterns, the normal display is shown
+ *          again at its end.
+ *
+ * @param u8_patterns TESTPATTERN_MASK() of the patterns, shown in enum order
+ *
+ * @return false if a run is in progress, the display is in standby or no
+ *         pattern is given
+ */
+bool TestPattern__Run(uint8_t u8_patterns)
+{
+  u8_patterns &= TESTPATTERN_MASK_ALL;
+
+  if ((u8_patterns == 0) || (x_TestPattern_Task_Hdl == NULL) || (Holtek__Is_Standby() == true))
+  {
+    return false;
+  }
+
+  portENTER_CRITICAL(&x_TestPattern_Mux);
+  if (x_TestPattern_Result.running == true)
+  {
+    portEXIT_CRITICAL(&x_TestPattern_Mux);
+    return false;
+  }
+  x_TestPattern_Result.running = true;
+  u8_TestPattern_Request = u8_patterns;
+  portEXIT_CRITICAL(&x_TestPattern_Mux);
+
+  xTaskNotifyGive(x_TestPattern_Task_Hdl);
+
+  return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Returns the result of the last run, or the run in progress.
+ *
+ * @param px_result [out] result
+ */
+void TestPattern__Get_Result(TESTPATTERN_RESULT_TYPE *px_result)
+{
+  portENTER_CRITICAL(&x_TestPattern_Mux);
+  *px_result = x_TestPattern_Result;
+  portEXIT_CRITICAL(&x_TestPattern_Mux);
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Test task: runs the sequence requested by TestPattern__Run().
+ *
+ * @param pv_args NULL
+ */
+static void TestPatternTaskCallback(void *pv_args)
+{
+  uint8_t u8_patterns;
+
+  for (;;)
+  {
+    (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    portENTER_CRITICAL(&x_TestPattern_Mux);
+    u8_patterns = u8_TestPattern_Request;
+    portEXIT_CRITICAL(&x_TestPattern_Mux);
+
+    TestPatternSequence(u8_patterns);
+  }
+}
+
+/**
+ * @brief   Shows the patterns, one frame every TESTPATTERN_STEP_MS on the
+ *          test layer, then hides it. The frames superseded in the display
+ *          ring meanwhile are counted: with a step much longer than a frame
+ *          on the bus there is none, otherwise a step may have been lost.
+ *
+ * @param u8_patterns TESTPATTERN_MASK() of the patterns
+ */
+static void TestPatternSequence(uint8_t u8_patterns)
+{
+  static const DISPLAY_ICON_ENUM pe_icons[] = TESTPATTERN_ICONS_MOUNTED;
+  HOLTEK_FRAME_STATS_TYPE x_stats;
+  HOLTEK_FRAME_TYPE *px_frame;
+  TickType_t x_wake;
+  int64_t s64_start_us;
+  uint32_t u32_superseded;
+  uint32_t u32_duration_ms;
+  uint16_t u16_steps = 0;
+  uint8_t u8_digit;
+  uint8_t u8_seg;
+  uint8_t u8_phase;
+  uint8_t u8_icon;
+  uint8_t u8_byte;
+  uint8_t u8_bit;
+
+  Holtek__Get_Frame_Stats(&x_stats);
+  u32_superseded = x_stats.ring_skipped + x_stats.ring_dropped;
+
+  ESP_LOGI(TAG, "start, patterns 0x%02x", u8_patterns);
+  s64_start_us = esp_timer_get_time();
+  x_wake = xTaskGetTickCount();
+
+  if ((u8_patterns & TESTPATTERN_MASK(TESTPATTERN_ALL_ON)) != 0)
+  {
+    px_frame = TestPatternFrame();
+    for (u8_digit = 0; u8_digit < NUM_OF_DIGITS; ++u8_digit)
+    {
+      px_frame->digit_mask[u8_digit] = Holtek__Get_Glyph(TESTPATTERN_GLYPH_ALL) |
+                                       (((TESTPATTERN_DP_DIGITS & (1u << u8_digit)) != 0) ? DISPLAY_SEG_DP : 0);
+    }
+    memset(px_frame->icons, 0xFF, sizeof(px_frame->icons));
+    TestPatternShow(&x_wake, &u16_steps);
+  }
+
+  if ((u8_patterns & TESTPATTERN_MASK(TESTPATTERN_WALK)) != 0)
+  {
+    for (u8_digit = 0; u8_digit < NUM_OF_DIGITS; ++u8_digit)
+    {
+      for (u8_seg = 0; u8_seg < TESTPATTERN_SEGMENTS; ++u8_seg)
+      {
+        px_frame = TestPatternFrame();
+        px_frame->digit_mask[u8_digit] = (1UL << u8_seg);
+        TestPatternShow(&x_wake, &u16_steps);
+      }
+      if ((TESTPATTERN_DP_DIGITS & (1u << u8_digit)) != 0)
+      {
+        px_frame = TestPatternFrame();
+        px_frame->digit_mask[u8_digit] = DISPLAY_SEG_DP;
+        TestPatternShow(&x_wake, &u16_steps);
+      }
+    }
+  }
+
+  if ((u8_patterns & TESTPATTERN_MASK(TESTPATTERN_CHECKER)) != 0)
+  {
+    // each segment is on in one of the two phases, next to segments off
+    for (u8_phase = 0; u8_phase < 2; ++u8_phase)
+    {
+      px_frame = TestPatternFrame();
+      for (u8_digit = 0; u8_digit < NUM_OF_DIGITS; ++u8_digit)
+      {
+        px_frame->digit_mask[u8_digit] = Holtek__Get_Glyph((((u8_digit + u8_phase) & 1) == 0) ? TESTPATTERN_GLYPH_HALF_1
+                                                                                                : TESTPATTERN_GLYPH_HALF_2);
+      }
+      TestPatternShow(&x_wake, &u16_steps);
+    }
+  }
+
+  if ((u8_patterns & TESTPATTERN_MASK(TESTPATTERN_ICONS)) != 0)
+  {
+    for (u8_icon = 0; u8_icon < (sizeof(pe_icons) / sizeof(pe_icons[0])); ++u8_icon)
+    {
+      px_frame = TestPatternFrame();
+      DISPLAY_ICON_GET_BYTE_BIT(pe_icons[u8_icon], u8_byte, u8_bit);
+      px_frame->icons[u8_byte] = (uint8_t)(1u << u8_bit);
+      TestPatternShow(&x_wake, &u16_steps);
+    }
+  }
+
+  Holtek__Frame_Release(HOLTEK_LAYER_TEST);
+
+  u32_duration_ms = (uint32_t)((esp_timer_get_time() - s64_start_us) / 1000);
+  Holtek__Get_Frame_Stats(&x_stats);
+  u32_superseded = (x_stats.ring_skipped + x_stats.ring_dropped) - u32_superseded;
+
+  portENTER_CRITICAL(&x_TestPattern_Mux);
+  x_TestPattern_Result.running = false;
+  x_TestPattern_Result.patterns = u8_patterns;
+  x_TestPattern_Result.steps = u16_steps;
+  x_TestPattern_Result.duration_ms = u32_duration_ms;
+  x_TestPattern_Result.superseded = u32_superseded;
+  portEXIT_CRITICAL(&x_TestPattern_Mux);
+
+  // the line read by the test fixture on the console
+  ESP_LOGI(TAG, "done: %u frames in %u ms, %u superseded", u16_steps, u32_duration_ms, u32_superseded);
+}
+
+/**
+ * @brief   Returns the cleared frame of the test layer.
+ *
+ * @return frame to be filled and shown by TestPatternShow()
+ */
+static HOLTEK_FRAME_TYPE *TestPatternFrame(void)
+{
+  HOLTEK_FRAME_TYPE *px_frame = Holtek__Frame_Acquire(HOLTEK_LAYER_TEST);
+
+  memset(px_frame, 0x00, sizeof(HOLTEK_FRAME_TYPE));
+
+  return px_frame;
+}
+
+/**
+ * @brief   Commits the frame of the test layer, it is sent at once, and
+ *          waits for the end of the step.
+ *
+ * @param px_wake     [in/out] end of the previous step, in ticks
+ * @param pu16_steps  [in/out] frames shown
+ */
+static void TestPatternShow(TickType_t *px_wake, uint16_t *pu16_steps)
+{
+  Holtek__Frame_Commit(HOLTEK_LAYER_TEST);
+  (*pu16_steps)++;
+
+  vTaskDelayUntil(px_wake, TESTPATTERN_STEP_TICKS);
+}
+
+/**
+ * @brief   Converts a list of pattern names, separated by spaces, to their
+ *          mask: "all" or an empty list select all of them.
+ *
+ * @param pc_list       list, modified
+ * @param pu8_patterns  [out] TESTPATTERN_MASK() of the patterns
+ *
+ * @return false if a name is unknown
+ */
+static bool TestPatternParse(char *pc_list, uint8_t *pu8_patterns)
+{
+  char *pc_save = NULL;
+  char *pc_name;
+  uint8_t u8_pattern;
+
+  *pu8_patterns = 0;
+
+  for (pc_name = strtok_r(pc_list, " ", &pc_save); pc_name != NULL; pc_name = strtok_r(NULL, " ", &pc_save))
+  {
+    if (strcmp(pc_name, "all") == 0)
+    {
+      *pu8_patterns = TESTPATTERN_MASK_ALL;
+      continue;
+    }
+
+    for (u8_pattern = 0; u8_pattern < NUM_OF_TESTPATTERNS; ++u8_pattern)
+    {
+      if (strcmp(pc_name, TESTPATTERN_Names[u8_pattern]) == 0)
+      {
+        break;
+      }
+    }
+    if (u8_pattern == NUM_OF_TESTPATTERNS)
+    {
+      return false;
+    }
+    *pu8_patterns |= TESTPATTERN_MASK(u8_pattern);
+  }
+
+  if (*pu8_patterns == 0)
+  {
+    *pu8_patterns = TESTPATTERN_MASK_ALL;
+  }
+
+  return true;
+}
+
+/**
+ * @brief   Keys handler: all the keys held together run the whole sequence.
+ *
+ * @param px_event key event
+ *
+ * @return true if the event is the test chord
+ */
+static bool TestPatternKey(const KEYS_EVENT_TYPE *px_event)
+{
+  if ((px_event->type != KEYS_EVENT_CHORD) || (px_event->mask != TESTPATTERN_CHORD))
+  {
+    return false;
+  }
+
+  (void)TestPattern__Run(TESTPATTERN_MASK_ALL);
+
+  return true;
+}
+
+/**
+ * @brief   GET on the test command: result of the last run.
+ *
+ * @param px_req  request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t TestPatternHttpGetHandler(httpd_req_t *px_req)
+{
+  TESTPATTERN_RESULT_TYPE x_result;
+  char pc_text[160];
+  int i_len = 0;
+  uint8_t u8_pattern;
+
+  TestPattern__Get_Result(&x_result);
+
+  i_len += snprintf(&pc_text[i_len], sizeof(pc_text) - i_len, "running %s\npatterns",
+                    (x_result.running == true) ? "yes" : "no");
+  for (u8_pattern = 0; u8_pattern < NUM_OF_TESTPATTERNS; ++u8_pattern)
+  {
+    if ((x_result.patterns & TESTPATTERN_MASK(u8_pattern)) != 0)
+    {
+      i_len += snprintf(&pc_text[i_len], sizeof(pc_text) - i_len, " %s", TESTPATTERN_Names[u8_pattern]);
+    }
+  }
+  snprintf(&pc_text[i_len], sizeof(pc_text) - i_len,
+           "\n"
+           "frames %u\n"
+           "duration_ms %u\n"
+           "superseded %u\n",
+           x_result.steps, x_result.duration_ms, x_result.superseded);
+
+  httpd_resp_set_type(px_req, "text/plain");
+  return httpd_resp_sendstr(px_req, pc_text);
+}
+
+/**
+ * @brief   POST on the test command: the body is the list of patterns to be
+ *          shown (on, walk, checker, icons), all of them if empty. The
+ *          result is read with a GET at the end of the run.
+ *
+ * @param px_req  request
+ *
+ * @return ESP_OK, ESP_FAIL on a bad request
+ */
+static esp_err_t TestPatternHttpPostHandler(httpd_req_t *px_req)
+{
+  char pc_body[TESTPATTERN_HTTP_BODY_MAX + 1];
+  uint8_t u8_patterns;
+  int i_len;
+
+  i_len = httpd_req_recv(px_req, pc_body, MIN(px_req->content_len, TESTPATTERN_HTTP_BODY_MAX));
+  pc_body[(i_len > 0) ? i_len : 0] = '\0';
+  pc_body[strcspn(pc_body, "\r\n")] = '\0';
+
+  if (TestPatternParse(pc_body, &u8_patterns) == false)
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "expected on, walk, checker, icons or all");
+    return ESP_FAIL;
+  }
+
+  if (TestPattern__Run(u8_patterns) == false)
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "test running or display in standby");
+    return ESP_FAIL;
+  }
+
+  httpd_resp_sendstr(px_req, "OK\n");
+
+  return ESP_OK;
+}
+
+#if TESTPATTERN_UART
+/**
+ * @brief   Console reader: a "test [patterns]" line runs the patterns, the
+ *          other lines are ignored. The result is logged at the end of the
+ *          run.
+ *
+ * @param pv_args NULL
+ */
+static void TestPatternUartTaskCallback(void *pv_args)
+{
+  char pc_line[TESTPATTERN_LINE_MAX + 1];
+  uint8_t u8_len = 0;
+  uint8_t u8_patterns;
+  char c_rx;
+
+  for (;;)
+  {
+    if (uart_read_bytes(TESTPATTERN_UART_NUM, &c_rx, 1, portMAX_DELAY) != 1)
+    {
+      continue;
+    }
+
+    if ((c_rx != '\r') && (c_rx != '\n'))
+    {
+      if (u8_len < TESTPATTERN_LINE_MAX)
+      {
+        pc_line[u8_len++] = c_rx;
+      }
+      continue;
+    }
+
+    pc_line[u8_len] = '\0';
+    u8_len = 0;
+
+    if ((strncmp(pc_line, "test", 4) != 0) || ((pc_line[4] != '\0') && (pc_line[4] != ' ')))
+    {
+      continue;
+    }
+
+    if (TestPatternParse(&pc_line[4], &u8_patterns) == false)
+    {
+      ESP_LOGW(TAG, "expected test [on] [walk] [checker] [icons] [all]");
+    }
+    else if (TestPattern__Run(u8_patterns) == false)
+    {
+      ESP_LOGW(TAG, "test running or display in standby");
+    }
+  }
+}
+#endif
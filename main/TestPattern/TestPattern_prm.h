@@ -0,0 +1,52 @@
+
+/**
+ *  @file       TestPattern_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TESTPATTERN_PRM_H
+    #define TESTPATTERN_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+/*
+ * Define here the patterns, they are shown in this order
+ */
+typedef enum
+{
+  TESTPATTERN_ALL_ON = 0,           /*all the segments and icons on*/
+  TESTPATTERN_WALK,                 /*one segment at a time, digit by digit*/
+  TESTPATTERN_CHECKER,              /*alternate halves of each digit, then the other halves*/
+  TESTPATTERN_ICONS,                /*one mounted icon at a time*/
+  NUM_OF_TESTPATTERNS
+}TESTPATTERN_ENUM;
+
+#define TESTPATTERN_MASK(pattern)   (1u << (pattern))
+#define TESTPATTERN_MASK_ALL        (TESTPATTERN_MASK(NUM_OF_TESTPATTERNS) - 1)
+
+// result of the last run
+typedef struct
+{
+  bool running;
+  uint8_t patterns;                 // TESTPATTERN_MASK() of the patterns shown
+  uint16_t steps;                   // frames shown
+  uint32_t duration_ms;             // from the first frame to the end of the last one
+  uint32_t superseded;              // display frames replaced before being sent, 0 if every step reached the display
+}TESTPATTERN_RESULT_TYPE;
+
+// entry point of the test: GET returns the last result, POST "<patterns>" (on walk checker icons, all if empty) runs it
+#define TESTPATTERN_URI             "/testpattern"
+
+#endif
@@ -0,0 +1,72 @@
+
+/**
+ *  @file       TestPattern_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TESTPATTERN_PRV_H
+    #define TESTPATTERN_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <TestPattern_prm.h>
+#include <Holtek.h>
+#include <Keys_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+/*
+ * Time each frame is shown, at least one tick: with the defaults the whole
+ * sequence is 85 frames, under a second at 10 ms. Each frame is committed on
+ * the top layer and sent right away, a frame takes about 3 ms on the bus.
+ */
+#define TESTPATTERN_STEP_MS         CONFIG_TESTPATTERN_STEP_MS
+#define TESTPATTERN_STEP_TICKS      ((pdMS_TO_TICKS(TESTPATTERN_STEP_MS) > 0) ? pdMS_TO_TICKS(TESTPATTERN_STEP_MS) : 1)
+
+// test commands read on the console UART, as "test <patterns>" lines
+#define TESTPATTERN_UART            CONFIG_TESTPATTERN_UART
+#define TESTPATTERN_UART_NUM        CONFIG_ESP_CONSOLE_UART_NUM
+#define TESTPATTERN_UART_RX_BYTES   256
+#define TESTPATTERN_LINE_MAX        40
+
+// keys held together to start the whole sequence
+#define TESTPATTERN_CHORD           (KEYS_MASK(KEYS_MODE) | KEYS_MASK(KEYS_UP) | KEYS_MASK(KEYS_DOWN))
+
+// segments of a digit: the glyph table has all of them at 0x11, the two checkerboard halves at 0x12 and 0x13
+#define TESTPATTERN_GLYPH_ALL       0x11
+#define TESTPATTERN_GLYPH_HALF_1    0x12
+#define TESTPATTERN_GLYPH_HALF_2    0x13
+#define TESTPATTERN_SEGMENTS        16
+
+// digits with a mounted decimal point (LEFT_1 drives the "WIFI" led)
+#define TESTPATTERN_DP_DIGITS       (1u << DIGIT_LEFT_1)
+
+// icons mounted on the panel, swept by TESTPATTERN_ICONS
+#define TESTPATTERN_ICONS_MOUNTED   {ICON_WIFI}
+
+static const char *TESTPATTERN_Names[NUM_OF_TESTPATTERNS] =
+{
+  [TESTPATTERN_ALL_ON]  = "on",
+  [TESTPATTERN_WALK]    = "walk",
+  [TESTPATTERN_CHECKER] = "checker",
+  [TESTPATTERN_ICONS]   = "icons",
+};
+
+#define TESTPATTERN_TASK_STACK      (1024 * 3)
+// below the display tasks, so that each frame is sent before the next one is committed
+#define TESTPATTERN_TASK_PRIO       10
+#define TESTPATTERN_UART_TASK_STACK (1024 * 2)
+#define TESTPATTERN_UART_TASK_PRIO  1
+
+// longest body of the network command
+#define TESTPATTERN_HTTP_BODY_MAX   40
+
+#endif
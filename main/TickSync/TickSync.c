@@ -0,0 +1,877 @@
+
+/**
+ *  @file       TickSync.c
+ *
+ *  @brief      Alignment of the clocks of the same LAN on a shared time. The
+ *              clocks send beacons to a multicast group and elect a master,
+ *              the others measure their offset from it with two-way time
+ *              exchanges and keep the exchange with the shortest round trip.
+ *              The frame clock of the display and the boundaries of the
+ *              clock face follow the shared time, so that the units change
+ *              their digits together. All the protocol runs in the lwIP
+ *              thread, on the raw API.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "lwip/udp.h"
+#include "lwip/igmp.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+
+#include <TickSync.h>
+#include <TickSync_prv.h>
+#include <Holtek.h>
+#include <ClockFace.h>
+#include <Standby.h>
+#include <TimeSync.h>
+#include <Alarm.h>
+#include <Settings.h>
+#include <HttpSrv.h>
+#include <Metrics.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static struct udp_pcb *px_TickSync_Pcb;
+static ip_addr_t x_TickSync_Group;
+static uint32_t u32_TickSync_Id;
+
+// requested by the settings or the network command, applied in the lwIP thread
+static volatile bool b_TickSync_Enabled;
+
+// private to the lwIP thread
+static bool b_TickSync_Running;
+static TICKSYNC_PEER_TYPE px_TickSync_Peers[TICKSYNC_MAX_PEERS];
+static TICKSYNC_FILTER_TYPE x_TickSync_Filter;
+static int64_t s64_TickSync_Epoch_Us;
+static bool b_TickSync_Aligned;
+
+// shared time of a follower: esp_timer time + offset, while locked
+static int64_t s64_TickSync_Offset_Us;
+static bool b_TickSync_Locked;
+static TICKSYNC_STATS_TYPE x_TickSync_Stats;
+
+static portMUX_TYPE x_TickSync_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *TAG = "TickSync";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static void TickSyncUdpSetup(void *pv_args);
+static void TickSyncApply(void *pv_args);
+static void TickSyncTimeout(void *pv_args);
+static void TickSyncUdpReceive(void *pv_args, struct udp_pcb *px_pcb, struct pbuf *px_pbuf, const ip_addr_t *px_addr, u16_t u16_port);
+static void TickSyncPeerUpdate(const uint8_t *pu8_data, const ip_addr_t *px_addr, uint16_t u16_port, int64_t s64_now_us);
+static const TICKSYNC_PEER_TYPE *TickSyncElect(int64_t s64_now_us);
+static bool TickSyncRanks(uint8_t u8_flags, uint8_t u8_priority, uint32_t u32_id, const TICKSYNC_PEER_TYPE *px_other);
+static void TickSyncSample(const uint8_t *pu8_data, int64_t s64_rx_us);
+static void TickSyncUnlock(uint32_t u32_master_id);
+static void TickSyncAlign(void);
+static void TickSyncSend(uint8_t u8_type, const ip_addr_t *px_addr, uint16_t u16_port, int64_t s64_t1_us, int64_t s64_t2_us);
+static uint8_t TickSyncFlags(void);
+static int64_t TickSyncWallUs(void);
+static void TickSyncPowerSave(void);
+static esp_err_t TickSyncHttpGetHandler(httpd_req_t *px_req);
+static esp_err_t TickSyncHttpPostHandler(httpd_req_t *px_req);
+static void TickSyncPutU32(uint8_t *pu8_data, uint32_t u32_value);
+static void TickSyncPutU64(uint8_t *pu8_data, uint64_t u64_value);
+static uint32_t TickSyncGetU32(const uint8_t *pu8_data);
+static uint64_t TickSyncGetU64(const uint8_t *pu8_data);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, restores the sync mode and opens
+ *          the UDP port. To be called after the network, the display, the
+ *          clock face, the standby and the HTTP server are started.
+ *
+ */
+void TickSync__Initialize(void)
+{
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = TICKSYNC_URI,
+    .method = HTTP_GET,
+    .handler = TickSyncHttpGetHandler,
+    .user_ctx = NULL
+  };
+  const httpd_uri_t x_post_uri =
+  {
+    .uri = TICKSYNC_URI,
+    .method = HTTP_POST,
+    .handler = TickSyncHttpPostHandler,
+    .user_ctx = NULL
+  };
+  uint8_t pu8_mac[6];
+
+  memset(px_TickSync_Peers, 0x00, sizeof(px_TickSync_Peers));
+  memset(&x_TickSync_Filter, 0x00, sizeof(x_TickSync_Filter));
+  memset(&x_TickSync_Stats, 0x00, sizeof(x_TickSync_Stats));
+
+  // the station MAC tells the clocks apart, its last 4 bytes are enough on a LAN
+  (void)esp_read_mac(pu8_mac, ESP_MAC_WIFI_STA);
+  u32_TickSync_Id = ((uint32_t)pu8_mac[2] << 24) | ((uint32_t)pu8_mac[3] << 16) | ((uint32_t)pu8_mac[4] << 8) | pu8_mac[5];
+  x_TickSync_Stats.id = u32_TickSync_Id;
+  x_TickSync_Stats.master_id = u32_TickSync_Id;
+  x_TickSync_Filter.master_id = u32_TickSync_Id;
+
+  b_TickSync_Enabled = (Settings__Get_U32(SETTINGS_TICK_SYNC) != 0);
+
+  SysMon__Register_Module(TAG, sizeof(px_TickSync_Peers) + sizeof(x_TickSync_Filter) + sizeof(x_TickSync_Stats));
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+  (void)HttpSrv__Register_Uri(&x_post_uri);
+
+  if ((ipaddr_aton(TICKSYNC_GROUP, &x_TickSync_Group) == 0) || (IP_IS_V4(&x_TickSync_Group) == 0) ||
+      (ip_addr_ismulticast(&x_TickSync_Group) == 0))
+  {
+    ESP_LOGE(TAG, "%s is not an IPv4 multicast group", TICKSYNC_GROUP);
+    return;
+  }
+
+  TickSyncPowerSave();
+
+  // raw API calls must run in the lwIP thread
+  if (tcpip_callback(TickSyncUdpSetup, NULL) != ERR_OK)
+  {
+    ESP_LOGE(TAG, "UDP setup not scheduled");
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Enables or disables the sync mode and stores it in the settings.
+ *          Disabled, the display goes back to its own clock at once.
+ *
+ * @param b_enabled true to align the clock on the others of the LAN
+ */
+void TickSync__Set_Enabled(bool b_enabled)
+{
+  b_TickSync_Enabled = b_enabled;
+  (void)Settings__Set_U32(SETTINGS_TICK_SYNC, (b_enabled == true) ? 1 : 0);
+
+  TickSyncPowerSave();
+
+  if (tcpip_callback(TickSyncApply, NULL) != ERR_OK)
+  {
+    ESP_LOGE(TAG, "sync mode change not scheduled");
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Tells if the sync mode is enabled, whether or not other clocks
+ *          are heard.
+ *
+ * @return true if enabled
+ */
+bool TickSync__Is_Enabled(void)
+{
+  return b_TickSync_Enabled;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Time the display is aligned on: the time of the master while
+ *          following one, the system clock otherwise. Safe from any task.
+ *
+ * @return microseconds since the epoch
+ */
+int64_t TickSync__Get_Time_Us(void)
+{
+  int64_t s64_offset_us;
+  bool b_locked;
+
+  portENTER_CRITICAL(&x_TickSync_Mux);
+  s64_offset_us = s64_TickSync_Offset_Us;
+  b_locked = b_TickSync_Locked;
+  portEXIT_CRITICAL(&x_TickSync_Mux);
+
+  // the esp_timer is not slewed by TimeSync, the offset only tracks the master
+  if (b_locked == true)
+  {
+    return (esp_timer_get_time() + s64_offset_us);
+  }
+
+  return TickSyncWallUs();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Returns the state of the sync and the offset measured from the master.
+ *
+ * @param px_stats [out] state and offset
+ */
+void TickSync__Get_Stats(TICKSYNC_STATS_TYPE *px_stats)
+{
+  portENTER_CRITICAL(&x_TickSync_Mux);
+  *px_stats = x_TickSync_Stats;
+  portEXIT_CRITICAL(&x_TickSync_Mux);
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Creates the UDP PCB and binds it to the protocol port, then
+ *          applies the sync mode. Runs in the lwIP thread.
+ *
+ * @param pv_args NULL
+ */
+static void TickSyncUdpSetup(void *pv_args)
+{
+  px_TickSync_Pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+  if (px_TickSync_Pcb == NULL)
+  {
+    ESP_LOGE(TAG, "UDP PCB not allocated");
+    return;
+  }
+
+  if (udp_bind(px_TickSync_Pcb, IP4_ADDR_ANY, TICKSYNC_PORT) != ERR_OK)
+  {
+    ESP_LOGE(TAG, "UDP port %d not available", TICKSYNC_PORT);
+    udp_remove(px_TickSync_Pcb);
+    px_TickSync_Pcb = NULL;
+    return;
+  }
+
+  // beacons must not leave the LAN
+  udp_set_multicast_ttl(px_TickSync_Pcb, 1);
+  udp_recv(px_TickSync_Pcb, TickSyncUdpReceive, NULL);
+
+  TickSyncApply(NULL);
+}
+
+/**
+ * @brief   Starts or stops the protocol as requested, runs in the lwIP
+ *          thread. Stopping, the peers and the samples are forgotten and the
+ *          frame clock runs free again.
+ *
+ * @param pv_args NULL
+ */
+static void TickSyncApply(void *pv_args)
+{
+  if ((px_TickSync_Pcb == NULL) || (b_TickSync_Enabled == b_TickSync_Running))
+  {
+    return;
+  }
+
+  if (b_TickSync_Enabled == true)
+  {
+    if (igmp_joingroup(IP4_ADDR_ANY4, ip_2_ip4(&x_TickSync_Group)) != ERR_OK)
+    {
+      ESP_LOGE(TAG, "group %s not joined", TICKSYNC_GROUP);
+      return;
+    }
+
+    b_TickSync_Running = true;
+    ESP_LOGI(TAG, "on, group %s port %d, id %08x", TICKSYNC_GROUP, TICKSYNC_PORT, (unsigned)u32_TickSync_Id);
+
+    // first beacon right away, the timeout rearms itself
+    TickSyncTimeout(NULL);
+  }
+  else
+  {
+    sys_untimeout(TickSyncTimeout, NULL);
+    (void)igmp_leavegroup(IP4_ADDR_ANY4, ip_2_ip4(&x_TickSync_Group));
+
+    b_TickSync_Running = false;
+    memset(px_TickSync_Peers, 0x00, sizeof(px_TickSync_Peers));
+    TickSyncUnlock(u32_TickSync_Id);
+
+    portENTER_CRITICAL(&x_TickSync_Mux);
+    x_TickSync_Stats.mode = TICKSYNC_MODE_OFF;
+    x_TickSync_Stats.peers = 0;
+    portEXIT_CRITICAL(&x_TickSync_Mux);
+
+    b_TickSync_Aligned = false;
+    Holtek__Align_Frame_Clock(false, 0);
+    ClockFace__Time_Changed();
+
+    ESP_LOGI(TAG, "off");
+  }
+}
+
+/**
+ * @brief   Period of the protocol, runs in the lwIP thread: forgets the
+ *          clocks no longer heard, elects the master, sends the beacon and,
+ *          on a follower, the time request to the master.
+ *
+ * @param pv_args NULL
+ */
+static void TickSyncTimeout(void *pv_args)
+{
+  const TICKSYNC_PEER_TYPE *px_master;
+  int64_t s64_now_us = esp_timer_get_time();
+  TICKSYNC_MODE_ENUM e_mode;
+  uint8_t u8_peers = 0;
+  uint8_t u8_idx;
+
+  sys_timeout(TICKSYNC_PERIOD_MS, TickSyncTimeout, NULL);
+
+  for (u8_idx = 0; u8_idx < TICKSYNC_MAX_PEERS; ++u8_idx)
+  {
+    if ((px_TickSync_Peers[u8_idx].rx_us != 0) &&
+        ((s64_now_us - px_TickSync_Peers[u8_idx].rx_us) >= ((int64_t)TICKSYNC_PEER_TIMEOUT_MS * 1000)))
+    {
+      px_TickSync_Peers[u8_idx].rx_us = 0;
+    }
+    u8_peers += (px_TickSync_Peers[u8_idx].rx_us != 0) ? 1 : 0;
+  }
+
+  px_master = TickSyncElect(s64_now_us);
+
+  if (px_master != NULL)
+  {
+    e_mode = TICKSYNC_MODE_FOLLOWER;
+  }
+  else
+  {
+    e_mode = (u8_peers == 0) ? TICKSYNC_MODE_ALONE : TICKSYNC_MODE_MASTER;
+  }
+
+  portENTER_CRITICAL(&x_TickSync_Mux);
+  x_TickSync_Stats.mode = e_mode;
+  x_TickSync_Stats.peers = u8_peers;
+  portEXIT_CRITICAL(&x_TickSync_Mux);
+
+  TickSyncSend(TICKSYNC_TYPE_BEACON, &x_TickSync_Group, TICKSYNC_PORT, 0, 0);
+
+  if (px_master != NULL)
+  {
+    // a request still pending is lost, its reply would be dropped
+    if (x_TickSync_Filter.request_us != 0)
+    {
+      Metrics__Counter_Add(METRICS_TICKSYNC_DROPPED, 1);
+    }
+
+    x_TickSync_Filter.request_us = esp_timer_get_time();
+    TickSyncSend(TICKSYNC_TYPE_REQUEST, &px_master->addr, px_master->port, x_TickSync_Filter.request_us, 0);
+  }
+
+  // the system clock of a master can be slewed or stepped at any time
+  TickSyncAlign();
+}
+
+/**
+ * @brief   UDP receive callback, runs in the lwIP thread.
+ *
+ * @param pv_args   NULL
+ * @param px_pcb    receiving PCB
+ * @param px_pbuf   packet, to be freed
+ * @param px_addr   sender address
+ * @param u16_port  sender port
+ */
+static void TickSyncUdpReceive(void *pv_args, struct udp_pcb *px_pcb, struct pbuf *px_pbuf, const ip_addr_t *px_addr, u16_t u16_port)
+{
+  const uint8_t *pu8_data = (const uint8_t *)px_pbuf->payload;
+  int64_t s64_rx_us = esp_timer_get_time();
+  int64_t s64_rx_shared_us = TickSync__Get_Time_Us();
+
+  // own beacons come back when the interface loops the multicast
+  if ((b_TickSync_Running == false) ||
+      (px_pbuf->len != px_pbuf->tot_len) ||
+      (px_pbuf->len < TICKSYNC_PACKET_BYTES) ||
+      (pu8_data[0] != TICKSYNC_MAGIC_0) ||
+      (pu8_data[1] != TICKSYNC_MAGIC_1) ||
+      (pu8_data[2] != TICKSYNC_PROTOCOL_VERSION) ||
+      (TickSyncGetU32(&pu8_data[4]) == u32_TickSync_Id))
+  {
+    pbuf_free(px_pbuf);
+    return;
+  }
+
+  switch (pu8_data[3])
+  {
+    case TICKSYNC_TYPE_BEACON:
+      Metrics__Counter_Add(METRICS_TICKSYNC_BEACONS, 1);
+      TickSyncPeerUpdate(pu8_data, px_addr, u16_port, s64_rx_us);
+      break;
+
+    case TICKSYNC_TYPE_REQUEST:
+      // answered whatever the role: the sender elected this clock from its beacons
+      TickSyncSend(TICKSYNC_TYPE_REPLY, px_addr, u16_port, (int64_t)TickSyncGetU64(&pu8_data[12]), s64_rx_shared_us);
+      break;
+
+    case TICKSYNC_TYPE_REPLY:
+      TickSyncSample(pu8_data, s64_rx_us);
+      break;
+
+    default:
+      break;
+  }
+
+  pbuf_free(px_pbuf);
+}
+
+/**
+ * @brief   Records the beacon of another clock. When the table is full the
+ *          beacon is ignored: the slots are freed by the peer timeout.
+ *
+ * @param pu8_data    beacon
+ * @param px_addr     sender address, requests go there
+ * @param u16_port    sender port
+ * @param s64_now_us  reception time
+ */
+static void TickSyncPeerUpdate(const uint8_t *pu8_data, const ip_addr_t *px_addr, uint16_t u16_port, int64_t s64_now_us)
+{
+  TICKSYNC_PEER_TYPE *px_peer = NULL;
+  uint32_t u32_id = TickSyncGetU32(&pu8_data[4]);
+  uint8_t u8_idx;
+
+  for (u8_idx = 0; u8_idx < TICKSYNC_MAX_PEERS; ++u8_idx)
+  {
+    if ((px_TickSync_Peers[u8_idx].rx_us != 0) && (px_TickSync_Peers[u8_idx].id == u32_id))
+    {
+      px_peer = &px_TickSync_Peers[u8_idx];
+      break;
+    }
+    if ((px_peer == NULL) && (px_TickSync_Peers[u8_idx].rx_us == 0))
+    {
+      px_peer = &px_TickSync_Peers[u8_idx];
+    }
+  }
+
+  if (px_peer == NULL)
+  {
+    return;
+  }
+
+  ip_addr_copy(px_peer->addr, *px_addr);
+  px_peer->port = u16_port;
+  px_peer->id = u32_id;
+  px_peer->flags = pu8_data[8];
+  px_peer->priority = pu8_data[9];
+  px_peer->rx_us = s64_now_us;
+}
+
+/**
+ * @brief   Elects the master among this clock and the peers. All the clocks
+ *          see the same beacons, so they agree without any negotiation. A
+ *          new master invalidates the samples of the previous one.
+ *
+ * @param s64_now_us current esp_timer time
+ *
+ * @return the master, NULL if it is this clock
+ */
+static const TICKSYNC_PEER_TYPE *TickSyncElect(int64_t s64_now_us)
+{
+  const TICKSYNC_PEER_TYPE *px_master = NULL;
+  uint8_t u8_flags = TickSyncFlags();
+  uint32_t u32_master_id;
+  uint8_t u8_idx;
+
+  for (u8_idx = 0; u8_idx < TICKSYNC_MAX_PEERS; ++u8_idx)
+  {
+    if ((px_TickSync_Peers[u8_idx].rx_us == 0) ||
+        (TickSyncRanks(u8_flags, TICKSYNC_PRIORITY, u32_TickSync_Id, &px_TickSync_Peers[u8_idx]) == true))
+    {
+      continue;
+    }
+
+    if ((px_master == NULL) ||
+        (TickSyncRanks(px_TickSync_Peers[u8_idx].flags, px_TickSync_Peers[u8_idx].priority,
+                       px_TickSync_Peers[u8_idx].id, px_master) == true))
+    {
+      px_master = &px_TickSync_Peers[u8_idx];
+    }
+  }
+
+  u32_master_id = (px_master != NULL) ? px_master->id : u32_TickSync_Id;
+  if (u32_master_id != x_TickSync_Filter.master_id)
+  {
+    ESP_LOGI(TAG, "master %08x%s", (unsigned)u32_master_id, (px_master == NULL) ? " (this clock)" : "");
+    Metrics__Counter_Add(METRICS_TICKSYNC_MASTERS, 1);
+    TickSyncUnlock(u32_master_id);
+  }
+
+  return px_master;
+}
+
+/**
+ * @brief   Order of the election: clock set first, then lower priority,
+ *          then lower identifier.
+ *
+ * @return true if the first clock ranks before the other one
+ */
+static bool TickSyncRanks(uint8_t u8_flags, uint8_t u8_priority, uint32_t u32_id, const TICKSYNC_PEER_TYPE *px_other)
+{
+  if ((u8_flags & TICKSYNC_FLAG_CLOCK_SET) != (px_other->flags & TICKSYNC_FLAG_CLOCK_SET))
+  {
+    return ((u8_flags & TICKSYNC_FLAG_CLOCK_SET) != 0);
+  }
+
+  if (u8_priority != px_other->priority)
+  {
+    return (u8_priority < px_other->priority);
+  }
+
+  return (u32_id < px_other->id);
+}
+
+/**
+ * @brief   Adds the reply of the master to the filter and publishes the new
+ *          offset. The offset error of an exchange is bounded by half its
+ *          round trip, the exchange with the shortest one in the window is
+ *          used. A sample whose bounds are disjoint from the ones of the
+ *          offset in use means the master clock has been stepped: the
+ *          window restarts from it.
+ *
+ * @param pu8_data  reply
+ * @param s64_rx_us reception time, t4
+ */
+static void TickSyncSample(const uint8_t *pu8_data, int64_t s64_rx_us)
+{
+  TICKSYNC_FILTER_TYPE *px_filter = &x_TickSync_Filter;
+  const TICKSYNC_SAMPLE_TYPE *px_best;
+  int64_t s64_t1_us = (int64_t)TickSyncGetU64(&pu8_data[12]);
+  int64_t s64_t2_us = (int64_t)TickSyncGetU64(&pu8_data[20]);
+  int64_t s64_t3_us = (int64_t)TickSyncGetU64(&pu8_data[28]);
+  int64_t s64_delay_us;
+  int64_t s64_offset_us;
+  int64_t s64_min_us;
+  int64_t s64_max_us;
+  int32_t s32_correction_us = 0;
+  bool b_was_locked;
+  uint8_t u8_idx;
+
+  // only the reply to the pending request, from the current master
+  if ((px_filter->request_us == 0) || (s64_t1_us != px_filter->request_us) ||
+      (TickSyncGetU32(&pu8_data[4]) != px_filter->master_id))
+  {
+    Metrics__Counter_Add(METRICS_TICKSYNC_DROPPED, 1);
+    return;
+  }
+  px_filter->request_us = 0;
+
+  s64_delay_us = (s64_rx_us - s64_t1_us) - (s64_t3_us - s64_t2_us);
+  s64_offset_us = ((s64_t2_us - s64_t1_us) + (s64_t3_us - s64_rx_us)) / 2;
+
+  if ((s64_delay_us < 0) || (s64_delay_us > TICKSYNC_DELAY_MAX_US))
+  {
+    Metrics__Counter_Add(METRICS_TICKSYNC_DROPPED, 1);
+    return;
+  }
+
+  Metrics__Counter_Add(METRICS_TICKSYNC_SAMPLES, 1);
+  Metrics__Histogram_Observe(METRICS_TICKSYNC_DELAY_US, (uint32_t)s64_delay_us);
+
+  if (px_filter->count != 0)
+  {
+    px_best = &px_filter->sample[0];
+    for (u8_idx = 1; u8_idx < px_filter->count; ++u8_idx)
+    {
+      if (px_filter->sample[u8_idx].delay_us < px_best->delay_us)
+      {
+        px_best = &px_filter->sample[u8_idx];
+      }
+    }
+
+    if (llabs(s64_offset_us - px_best->offset_us) >
+        (((s64_delay_us + px_best->delay_us) / 2) + TICKSYNC_STEP_MARGIN_US))
+    {
+      ESP_LOGW(TAG, "master clock stepped by %lld us", (long long)(s64_offset_us - px_best->offset_us));
+      px_filter->count = 0;
+      px_filter->next = 0;
+    }
+  }
+
+  px_filter->sample[px_filter->next].offset_us = s64_offset_us;
+  px_filter->sample[px_filter->next].delay_us = (uint32_t)s64_delay_us;
+  px_filter->next = (px_filter->next + 1) % TICKSYNC_WINDOW;
+  if (px_filter->count < TICKSYNC_WINDOW)
+  {
+    px_filter->count++;
+  }
+
+  px_best = &px_filter->sample[0];
+  s64_min_us = px_filter->sample[0].offset_us;
+  s64_max_us = px_filter->sample[0].offset_us;
+  for (u8_idx = 1; u8_idx < px_filter->count; ++u8_idx)
+  {
+    if (px_filter->sample[u8_idx].delay_us < px_best->delay_us)
+    {
+      px_best = &px_filter->sample[u8_idx];
+    }
+    s64_min_us = MIN(s64_min_us, px_filter->sample[u8_idx].offset_us);
+    s64_max_us = MAX(s64_max_us, px_filter->sample[u8_idx].offset_us);
+  }
+
+  portENTER_CRITICAL(&x_TickSync_Mux);
+  b_was_locked = b_TickSync_Locked;
+  if (b_was_locked == true)
+  {
+    s32_correction_us = (int32_t)(px_best->offset_us - s64_TickSync_Offset_Us);
+  }
+  s64_TickSync_Offset_Us = px_best->offset_us;
+  b_TickSync_Locked = true;
+
+  x_TickSync_Stats.samples = px_filter->count;
+  x_TickSync_Stats.delay_us = px_best->delay_us;
+  x_TickSync_Stats.jitter_us = (uint32_t)(s64_max_us - s64_min_us);
+  x_TickSync_Stats.correction_us = s32_correction_us;
+  portEXIT_CRITICAL(&x_TickSync_Mux);
+
+  if (b_was_locked == true)
+  {
+    Metrics__Histogram_Observe(METRICS_TICKSYNC_CORRECTION_US, (uint32_t)abs(s32_correction_us));
+  }
+
+  TickSyncAlign();
+}
+
+/**
+ * @brief   Forgets the samples, the shared time is the system clock until
+ *          the first reply of the new master.
+ *
+ * @param u32_master_id new master, this clock if none
+ */
+static void TickSyncUnlock(uint32_t u32_master_id)
+{
+  memset(&x_TickSync_Filter, 0x00, sizeof(x_TickSync_Filter));
+  x_TickSync_Filter.master_id = u32_master_id;
+
+  portENTER_CRITICAL(&x_TickSync_Mux);
+  b_TickSync_Locked = false;
+  s64_TickSync_Offset_Us = 0;
+  x_TickSync_Stats.master_id = u32_master_id;
+  x_TickSync_Stats.samples = 0;
+  x_TickSync_Stats.delay_us = 0;
+  x_TickSync_Stats.jitter_us = 0;
+  x_TickSync_Stats.correction_us = 0;
+  portEXIT_CRITICAL(&x_TickSync_Mux);
+}
+
+/**
+ * @brief   Moves the frame deadlines and the clock face boundaries on the
+ *          shared time, when it moved from the esp_timer by more than
+ *          TICKSYNC_REALIGN_US since the last alignment, and schedules the
+ *          alarms again when it moved by more than TICKSYNC_ALARM_STEP_US.
+ *          The offset of the clock from the shared time is published too.
+ *
+ */
+static void TickSyncAlign(void)
+{
+  int64_t s64_epoch_us;
+  int64_t s64_shared_us;
+  bool b_alarms;
+
+  s64_shared_us = TickSync__Get_Time_Us();
+  s64_epoch_us = esp_timer_get_time() - s64_shared_us;
+
+  portENTER_CRITICAL(&x_TickSync_Mux);
+  x_TickSync_Stats.offset_us = s64_shared_us - TickSyncWallUs();
+  portEXIT_CRITICAL(&x_TickSync_Mux);
+
+  if ((b_TickSync_Aligned == true) && (llabs(s64_epoch_us - s64_TickSync_Epoch_Us) <= TICKSYNC_REALIGN_US))
+  {
+    return;
+  }
+
+  b_alarms = ((b_TickSync_Aligned == false) || (llabs(s64_epoch_us - s64_TickSync_Epoch_Us) > TICKSYNC_ALARM_STEP_US));
+  b_TickSync_Aligned = true;
+  s64_TickSync_Epoch_Us = s64_epoch_us;
+
+  Holtek__Align_Frame_Clock(true, s64_epoch_us);
+  ClockFace__Time_Changed();
+  if (b_alarms == true)
+  {
+    Alarm__Time_Changed();
+  }
+}
+
+/**
+ * @brief   Builds a packet and sends it, runs in the lwIP thread. The
+ *          transmit time (t3) is taken last, right before the send.
+ *
+ * @param u8_type   TICKSYNC_TYPE_*
+ * @param px_addr   destination address
+ * @param u16_port  destination port
+ * @param s64_t1_us request time of the follower
+ * @param s64_t2_us request reception time, shared
+ */
+static void TickSyncSend(uint8_t u8_type, const ip_addr_t *px_addr, uint16_t u16_port, int64_t s64_t1_us, int64_t s64_t2_us)
+{
+  struct pbuf *px_pbuf;
+  uint8_t *pu8_data;
+
+  px_pbuf = pbuf_alloc(PBUF_TRANSPORT, TICKSYNC_PACKET_BYTES, PBUF_RAM);
+  if (px_pbuf == NULL)
+  {
+    return;
+  }
+
+  pu8_data = (uint8_t *)px_pbuf->payload;
+  memset(pu8_data, 0x00, TICKSYNC_PACKET_BYTES);
+
+  pu8_data[0] = TICKSYNC_MAGIC_0;
+  pu8_data[1] = TICKSYNC_MAGIC_1;
+  pu8_data[2] = TICKSYNC_PROTOCOL_VERSION;
+  pu8_data[3] = u8_type;
+  TickSyncPutU32(&pu8_data[4], u32_TickSync_Id);
+  pu8_data[8] = TickSyncFlags() | ((x_TickSync_Filter.master_id == u32_TickSync_Id) ? TICKSYNC_FLAG_MASTER : 0);
+  pu8_data[9] = TICKSYNC_PRIORITY;
+  TickSyncPutU64(&pu8_data[12], (uint64_t)s64_t1_us);
+  TickSyncPutU64(&pu8_data[20], (uint64_t)s64_t2_us);
+  TickSyncPutU64(&pu8_data[28], (uint64_t)TickSync__Get_Time_Us());
+
+  (void)udp_sendto(px_TickSync_Pcb, px_pbuf, px_addr, u16_port);
+  pbuf_free(px_pbuf);
+}
+
+/**
+ * @brief   Flags of this clock for the election: the clock is set once it
+ *          has been synced to network time, a wall clock that only looks
+ *          valid must not win the election.
+ *
+ * @return TICKSYNC_FLAG_CLOCK_SET or 0
+ */
+static uint8_t TickSyncFlags(void)
+{
+  return (TimeSync__Is_Synced() == true) ? TICKSYNC_FLAG_CLOCK_SET : 0;
+}
+
+/**
+ * @brief   Current system time.
+ *
+ * @return microseconds since the epoch
+ */
+static int64_t TickSyncWallUs(void)
+{
+  struct timeval x_tv;
+
+  gettimeofday(&x_tv, NULL);
+
+  return (((int64_t)x_tv.tv_sec * 1000000) + x_tv.tv_usec);
+}
+
+/**
+ * @brief   Keeps the radio awake while the sync mode is on: in modem sleep
+ *          the access point holds the frames up to the next DTIM beacon, the
+ *          round trips get long and asymmetric. The power save is set by
+ *          the standby, serialized with its sequences.
+ *
+ */
+static void TickSyncPowerSave(void)
+{
+  Standby__Radio_Changed();
+}
+
+/**
+ * @brief   Network command, reports the mode and the offset from the shared time.
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t TickSyncHttpGetHandler(httpd_req_t *px_req)
+{
+  TICKSYNC_STATS_TYPE x_stats;
+  char pc_text[256];
+
+  TickSync__Get_Stats(&x_stats);
+
+  (void)snprintf(pc_text, sizeof(pc_text),
+                 "mode %s\nid %08x\nmaster %08x\npeers %u\nsamples %u\n"
+                 "offset_us %lld\ndelay_us %u\njitter_us %u\ncorrection_us %d\n",
+                 TICKSYNC_Mode_Name[x_stats.mode], (unsigned)x_stats.id, (unsigned)x_stats.master_id, x_stats.peers,
+                 x_stats.samples, (long long)x_stats.offset_us, (unsigned)x_stats.delay_us, (unsigned)x_stats.jitter_us,
+                 (int)x_stats.correction_us);
+
+  httpd_resp_set_type(px_req, "text/plain");
+  return httpd_resp_sendstr(px_req, pc_text);
+}
+
+/**
+ * @brief   Network command, the body is "on" or "off".
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK if the body is valid
+ */
+static esp_err_t TickSyncHttpPostHandler(httpd_req_t *px_req)
+{
+  char pc_body[TICKSYNC_HTTP_BODY_MAX + 1];
+  int s32_len;
+
+  s32_len = httpd_req_recv(px_req, pc_body, TICKSYNC_HTTP_BODY_MAX);
+  pc_body[(s32_len > 0) ? s32_len : 0] = '\0';
+  pc_body[strcspn(pc_body, "\r\n")] = '\0';
+
+  if (strcmp(pc_body, "on") == 0)
+  {
+    TickSync__Set_Enabled(true);
+  }
+  else if (strcmp(pc_body, "off") == 0)
+  {
+    TickSync__Set_Enabled(false);
+  }
+  else
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "expected on or off");
+    return ESP_FAIL;
+  }
+
+  httpd_resp_sendstr(px_req, "OK\n");
+
+  return ESP_OK;
+}
+
+/**
+ * @brief   Writes a little endian 32-bit value, the payload may be unaligned.
+ */
+static void TickSyncPutU32(uint8_t *pu8_data, uint32_t u32_value)
+{
+  pu8_data[0] = (uint8_t)u32_value;
+  pu8_data[1] = (uint8_t)(u32_value >> 8);
+  pu8_data[2] = (uint8_t)(u32_value >> 16);
+  pu8_data[3] = (uint8_t)(u32_value >> 24);
+}
+
+/**
+ * @brief   Writes a little endian 64-bit value, the payload may be unaligned.
+ */
+static void TickSyncPutU64(uint8_t *pu8_data, uint64_t u64_value)
+{
+  TickSyncPutU32(&pu8_data[0], (uint32_t)u64_value);
+  TickSyncPutU32(&pu8_data[4], (uint32_t)(u64_value >> 32));
+}
+
+/**
+ * @brief   Reads a little endian 32-bit value, the payload may be unaligned.
+ */
+static uint32_t TickSyncGetU32(const uint8_t *pu8_data)
+{
+  return ((uint32_t)pu8_data[0] | ((uint32_t)pu8_data[1] << 8) | ((uint32_t)pu8_data[2] << 16) | ((uint32_t)pu8_data[3] << 24));
+}
+
+/**
+ * @brief   Reads a little endian 64-bit value, the payload may be unaligned.
+ */
+static uint64_t TickSyncGetU64(const uint8_t *pu8_data)
+{
+  return ((uint64_t)TickSyncGetU32(&pu8_data[0]) | ((uint64_t)TickSyncGetU32(&pu8_data[4]) << 32));
+}
@@ -0,0 +1,35 @@
+
+/**
+ *  @file       TickSync.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TICKSYNC_H
+    #define TICKSYNC_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <TickSync_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void TickSync__Initialize(void);
+void TickSync__Set_Enabled(bool b_enabled);
+bool TickSync__Is_Enabled(void);
+int64_t TickSync__Get_Time_Us(void);
+void TickSync__Get_Stats(TICKSYNC_STATS_TYPE *px_stats);
+
+#endif
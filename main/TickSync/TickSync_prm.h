@@ -0,0 +1,59 @@
+
+/**
+ *  @file       TickSync_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TICKSYNC_PRM_H
+    #define TICKSYNC_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+// protocol version of the beacons and of the time exchanges
+#define TICKSYNC_PROTOCOL_VERSION   1
+
+// network command: GET for the state and the measured offset, POST "on" or "off"
+#define TICKSYNC_URI                "/ticksync"
+
+// state of the sync mode until it is changed by the network command (SETTINGS_TICK_SYNC)
+#if CONFIG_TICKSYNC_DEFAULT
+#define TICKSYNC_DEFAULT_ON         1
+#else
+#define TICKSYNC_DEFAULT_ON         0
+#endif
+
+typedef enum
+{
+  TICKSYNC_MODE_OFF = 0,          /*sync mode disabled, local clock*/
+  TICKSYNC_MODE_ALONE,            /*no other clock heard, local clock*/
+  TICKSYNC_MODE_MASTER,           /*the others follow the local clock*/
+  TICKSYNC_MODE_FOLLOWER,         /*shared time taken from the master*/
+  NUM_OF_TICKSYNC_MODES
+}TICKSYNC_MODE_ENUM;
+
+// state of the sync and offset measured from the master
+typedef struct
+{
+  TICKSYNC_MODE_ENUM mode;
+  uint32_t id;                    // identifier of this clock
+  uint32_t master_id;             // identifier of the master, this clock if master or alone
+  uint8_t peers;                  // other clocks heard
+  uint8_t samples;                // exchanges in the filter window
+  int64_t offset_us;              // shared time - local clock
+  uint32_t delay_us;              // round trip of the exchange in use
+  uint32_t jitter_us;             // spread of the offsets in the window
+  int32_t correction_us;          // last change of the shared time of the follower
+}TICKSYNC_STATS_TYPE;
+
+#endif
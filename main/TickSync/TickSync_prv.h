@@ -0,0 +1,120 @@
+
+/**
+ *  @file       TickSync_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TICKSYNC_PRV_H
+    #define TICKSYNC_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/ip_addr.h"
+#include <TickSync_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+#define TICKSYNC_PORT               CONFIG_TICKSYNC_PORT
+#define TICKSYNC_GROUP              CONFIG_TICKSYNC_GROUP
+#define TICKSYNC_PRIORITY           CONFIG_TICKSYNC_PRIORITY
+
+// beacon period, a follower also exchanges its time with the master at each period
+#define TICKSYNC_PERIOD_MS          500
+// a clock not heard for this time is no longer a peer
+#define TICKSYNC_PEER_TIMEOUT_MS    (4 * TICKSYNC_PERIOD_MS)
+#define TICKSYNC_MAX_PEERS          8
+
+// exchanges kept by the filter, the one with the shortest round trip gives the offset
+#define TICKSYNC_WINDOW             8
+// exchanges with a longer round trip are dropped
+#define TICKSYNC_DELAY_MAX_US       50000
+// margin on the error bounds of two exchanges before the master clock is taken as stepped
+#define TICKSYNC_STEP_MARGIN_US     2000
+// the frame clock and the clock face are aligned again when the shared time moves by more than this
+#define TICKSYNC_REALIGN_US         250
+// the alarms, which run on the shared time too, are scheduled again when it moves by more than this
+#define TICKSYNC_ALARM_STEP_US      1000000
+
+#define TICKSYNC_HTTP_BODY_MAX      16
+
+// first time accepted as valid (2022-01-01)
+#define TICKSYNC_CLOCK_VALID_S      1640995200
+
+/**
+ * Packet, all fields little endian, 36 bytes:
+ *
+ *   offset  size  field
+ *   0       2     magic "TK"
+ *   2       1     version (TICKSYNC_PROTOCOL_VERSION)
+ *   3       1     type (TICKSYNC_TYPE_*)
+ *   4       4     identifier of the sender
+ *   8       1     flags of the sender (TICKSYNC_FLAG_*)
+ *   9       1     priority of the sender, lower wins
+ *   10      2     spare, 0
+ *   12      8     t1: request sent, local clock of the follower, echoed by the reply
+ *   20      8     t2: request received, shared time of the master
+ *   28      8     t3: reply (or beacon) sent, shared time of the sender
+ *
+ * Beacons go to the multicast group every TICKSYNC_PERIOD_MS, requests and
+ * replies are unicast to the address and port the packet came from. All the
+ * clocks hear the same beacons and elect the same master: clock set first,
+ * then lower priority, then lower identifier.
+ */
+#define TICKSYNC_MAGIC_0            'T'
+#define TICKSYNC_MAGIC_1            'K'
+#define TICKSYNC_PACKET_BYTES       36
+
+#define TICKSYNC_TYPE_BEACON        1
+#define TICKSYNC_TYPE_REQUEST       2
+#define TICKSYNC_TYPE_REPLY         3
+
+// the wall clock of the sender is set
+#define TICKSYNC_FLAG_CLOCK_SET     0x01
+// the sender is the master of the shared time
+#define TICKSYNC_FLAG_MASTER        0x02
+
+static const char * const TICKSYNC_Mode_Name[NUM_OF_TICKSYNC_MODES] =
+{
+  [TICKSYNC_MODE_OFF]      = "off",
+  [TICKSYNC_MODE_ALONE]    = "alone",
+  [TICKSYNC_MODE_MASTER]   = "master",
+  [TICKSYNC_MODE_FOLLOWER] = "follower",
+};
+
+// clock heard on the multicast group
+typedef struct
+{
+  ip_addr_t addr;
+  uint16_t port;
+  uint32_t id;
+  uint8_t flags;
+  uint8_t priority;
+  int64_t rx_us;                  // last beacon, 0 for a free slot
+}TICKSYNC_PEER_TYPE;
+
+// time exchange with the master
+typedef struct
+{
+  int64_t offset_us;              // shared time - esp_timer time
+  uint32_t delay_us;
+}TICKSYNC_SAMPLE_TYPE;
+
+typedef struct
+{
+  TICKSYNC_SAMPLE_TYPE sample[TICKSYNC_WINDOW];
+  uint8_t next;
+  uint8_t count;
+  uint32_t master_id;             // master the samples come from
+  int64_t request_us;             // t1 of the pending request, 0 if none
+}TICKSYNC_FILTER_TYPE;
+
+#endif
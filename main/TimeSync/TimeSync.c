@@ -0,0 +1,885 @@
+
+/**
+ *  @file       TimeSync.c
+ *
+ *  @brief      Network time: several NTP servers are sampled in a burst, the
+ *              samples are filtered by round trip delay and the resulting
+ *              offset is slewed in with adjtime(), the clock is stepped only
+ *              when it is not set or too far off. The drift of the crystal
+ *              is estimated across syncs, kept in the settings and slewed in
+ *              at each sync and in steps between them, so that the clock
+ *              keeps time offline and the sync interval can grow up to hours.
+ *              The task sleeps until the next sync, the next drift step or
+ *              the network coming up.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+
+#include <TimeSync.h>
+#include <TimeSync_prv.h>
+#include <WiFiConn.h>
+#include <Alarm.h>
+#include <ClockFace.h>
+#include <Settings.h>
+#include <HttpSrv.h>
+#include <Metrics.h>
+#include <SysMon.h>
+#include <BinLog.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static TIMESYNC_STATE_TYPE x_TimeSync_State;
+
+// servers of the next sync, replaced on /timesync (i.e. with a local test server)
+static char pc_TimeSync_Servers[TIMESYNC_SERVERS_BYTES] = TIMESYNC_SERVERS;
+
+static portMUX_TYPE x_TimeSync_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t x_TimeSync_Task_Hdl;
+
+static const char *TAG = "TimeSync";
+
+// stack and TCB of the task, reserved at link time in static allocation mode
+SYSMON_TASK_POOL(x_TimeSync_Task, TIMESYNC_TASK_STACK)
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static void TimeSyncTaskCallback(void *pv_args);
+static void TimeSyncNetworkUp(void *pv_arg, esp_event_base_t x_base, int32_t s32_id, void *pv_data);
+static int64_t TimeSyncDriftDue(void);
+static void TimeSyncRun(void);
+static uint8_t TimeSyncResolve(char *pc_list, struct sockaddr_in *px_addr, uint8_t u8_max);
+static bool TimeSyncSample(int i_sock, const struct sockaddr_in *px_addr, TIMESYNC_SAMPLE_TYPE *px_sample);
+static bool TimeSyncSelect(const TIMESYNC_SAMPLE_TYPE px_sample[][TIMESYNC_ROUNDS],
+                           const bool pb_valid[][TIMESYNC_ROUNDS], uint8_t u8_servers);
+static void TimeSyncApply(int64_t s64_offset_us);
+static void TimeSyncDriftCorrect(void);
+static void TimeSyncSlew(int64_t s64_delta_us, bool b_add);
+static uint32_t TimeSyncIsqrt(uint64_t u64_value);
+static int64_t TimeSyncNow(void);
+static uint64_t TimeSyncToNtp(int64_t s64_us);
+static int64_t TimeSyncFromNtp(uint64_t u64_ntp);
+static uint64_t TimeSyncGet64(const uint8_t *pu8_data);
+static void TimeSyncPut64(uint8_t *pu8_data, uint64_t u64_value);
+static esp_err_t TimeSyncHttpGetHandler(httpd_req_t *px_req);
+static esp_err_t TimeSyncHttpPostHandler(httpd_req_t *px_req);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method: restores the drift, starts the
+ *          task and registers the endpoint. The first sync runs as soon as
+ *          the network is up. To be called after the HTTP server has been
+ *          started and the alarm and clock face modules initialized.
+ *
+ */
+void TimeSync__Initialize(void)
+{
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = TIMESYNC_URI,
+    .method = HTTP_GET,
+    .handler = TimeSyncHttpGetHandler,
+    .user_ctx = NULL
+  };
+  const httpd_uri_t x_post_uri =
+  {
+    .uri = TIMESYNC_URI,
+    .method = HTTP_POST,
+    .handler = TimeSyncHttpPostHandler,
+    .user_ctx = NULL
+  };
+  int32_t s32_drift_ppb = 0;
+
+  memset(&x_TimeSync_State, 0x00, sizeof(x_TimeSync_State));
+
+  (void)Settings__Get(SETTINGS_TIME_DRIFT, &s32_drift_ppb, sizeof(s32_drift_ppb));
+  s32_drift_ppb = MAX(MIN(s32_drift_ppb, TIMESYNC_DRIFT_MAX_PPB), -TIMESYNC_DRIFT_MAX_PPB);
+  x_TimeSync_State.stats.drift_ppb = s32_drift_ppb;
+  x_TimeSync_State.drift_saved_ppb = s32_drift_ppb;
+  x_TimeSync_State.stats.interval_s = TIMESYNC_MIN_INTERVAL_S;
+  x_TimeSync_State.drift_us = esp_timer_get_time();
+
+  SysMon__Register_Module(TAG, sizeof(x_TimeSync_State) + sizeof(pc_TimeSync_Servers) +
+                               SYSMON_TASK_POOL_BYTES(x_TimeSync_Task));
+
+  SYSMON_TASK_CREATE(x_TimeSync_Task, TimeSyncTaskCallback, "TimeSync", TIMESYNC_TASK_STACK, NULL,
+                     TIMESYNC_TASK_PRIO, &x_TimeSync_Task_Hdl, tskNO_AFFINITY);
+  SysMon__Register_Task(TAG, x_TimeSync_Task_Hdl, TIMESYNC_TASK_STACK);
+
+  // the task does not poll the network, it is woken up when an address is obtained
+  ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, TimeSyncNetworkUp, NULL, NULL));
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+  (void)HttpSrv__Register_Uri(&x_post_uri);
+
+  ESP_LOGI(TAG, "servers %s, drift %d ppb", pc_TimeSync_Servers, s32_drift_ppb);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Runs a sync as soon as the network is up, regardless of the
+ *          interval.
+ *
+ */
+void TimeSync__Sync_Now(void)
+{
+  portENTER_CRITICAL(&x_TimeSync_Mux);
+  x_TimeSync_State.next_sync_us = 0;
+  portEXIT_CRITICAL(&x_TimeSync_Mux);
+
+  if (x_TimeSync_Task_Hdl != NULL)
+  {
+    xTaskNotifyGive(x_TimeSync_Task_Hdl);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Tells if the clock has been synced since the boot.
+ *
+ * @return true if synced
+ */
+bool TimeSync__Is_Synced(void)
+{
+  return x_TimeSync_State.synced;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Returns the statistics of the last syncs.
+ *
+ * @param px_stats  filled with the statistics
+ */
+void TimeSync__Get_Stats(TIMESYNC_STATS_TYPE *px_stats)
+{
+  portENTER_CRITICAL(&x_TimeSync_Mux);
+  *px_stats = x_TimeSync_State.stats;
+  portEXIT_CRITICAL(&x_TimeSync_Mux);
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+/**
+ * @brief   Time sync task: slews in the drift correction and runs the syncs
+ *          when they are due and the network is up. It sleeps until the
+ *          next sync (only while connected) or the next drift step, and it
+ *          is woken up by the network coming up and by TimeSync__Sync_Now().
+ *
+ * @param pv_args NULL
+ */
+static void TimeSyncTaskCallback(void *pv_args)
+{
+  TickType_t x_wait;
+  int64_t s64_next_us;
+  int64_t s64_due_us;
+  bool b_connected;
+
+  for (;;)
+  {
+    TimeSyncDriftCorrect();
+
+    portENTER_CRITICAL(&x_TimeSync_Mux);
+    s64_next_us = x_TimeSync_State.next_sync_us;
+    portEXIT_CRITICAL(&x_TimeSync_Mux);
+
+    b_connected = WiFiConn__Is_Connected();
+    if ((b_connected == true) && (esp_timer_get_time() >= s64_next_us))
+    {
+      TimeSyncRun();
+      continue;
+    }
+
+    s64_due_us = TimeSyncDriftDue();
+    if (b_connected == true)
+    {
+      s64_due_us = MIN(s64_due_us, s64_next_us);
+    }
+    // in 64 bits, a wait of days overflows pdMS_TO_TICKS()
+    x_wait = (s64_due_us == INT64_MAX) ? portMAX_DELAY :
+             (TickType_t)((MAX(s64_due_us - esp_timer_get_time(), 0) / 1000 / portTICK_PERIOD_MS) + 1);
+    (void)ulTaskNotifyTake(pdTRUE, x_wait);
+  }
+}
+
+/**
+ * @brief   IP_EVENT_STA_GOT_IP handler, wakes up the task for the sync.
+ *
+ */
+static void TimeSyncNetworkUp(void *pv_arg, esp_event_base_t x_base, int32_t s32_id, void *pv_data)
+{
+  if (x_TimeSync_Task_Hdl != NULL)
+  {
+    xTaskNotifyGive(x_TimeSync_Task_Hdl);
+  }
+}
+
+/**
+ * @brief   Time of the next drift step: when the correction accumulated since
+ *          the last one reaches TIMESYNC_DRIFT_STEP_US, not earlier than
+ *          TIMESYNC_DRIFT_MIN_PERIOD_S nor later than the max sync interval.
+ *
+ * @return esp_timer time, INT64_MAX if there is no drift to correct
+ */
+static int64_t TimeSyncDriftDue(void)
+{
+  int64_t s64_drift_ppb = llabs(x_TimeSync_State.stats.drift_ppb);
+  int64_t s64_period_us;
+
+  if ((s64_drift_ppb == 0) || (TimeSyncNow() < ((int64_t)TIMESYNC_CLOCK_VALID_S * 1000000)))
+  {
+    return INT64_MAX;
+  }
+
+  s64_period_us = ((int64_t)TIMESYNC_DRIFT_STEP_US * 1000000000LL) / s64_drift_ppb;
+  s64_period_us = MAX(s64_period_us, (int64_t)TIMESYNC_DRIFT_MIN_PERIOD_S * 1000000);
+  s64_period_us = MIN(s64_period_us, (int64_t)TIMESYNC_MAX_INTERVAL_S * 1000000);
+
+  return x_TimeSync_State.drift_us + s64_period_us;
+}
+
+/**
+ * @brief   One sync: a burst of TIMESYNC_ROUNDS requests to each server,
+ *          with the roaming held so that the samples are taken on the same
+ *          link, then the filtered offset is applied.
+ *
+ */
+static void TimeSyncRun(void)
+{
+  struct sockaddr_in px_addr[TIMESYNC_MAX_SERVERS];
+  TIMESYNC_SAMPLE_TYPE px_sample[TIMESYNC_MAX_SERVERS][TIMESYNC_ROUNDS];
+  bool pb_valid[TIMESYNC_MAX_SERVERS][TIMESYNC_ROUNDS];
+  char pc_servers[TIMESYNC_SERVERS_BYTES];
+  const struct timeval x_timeout =
+  {
+    .tv_sec = 0,
+    .tv_usec = TIMESYNC_REPLY_TIMEOUT_MS * 1000
+  };
+  uint8_t u8_servers;
+  uint8_t u8_server;
+  uint8_t u8_round;
+  int i_sock = -1;
+
+  memset(pb_valid, 0x00, sizeof(pb_valid));
+
+  portENTER_CRITICAL(&x_TimeSync_Mux);
+  memcpy(pc_servers, pc_TimeSync_Servers, sizeof(pc_servers));
+  portEXIT_CRITICAL(&x_TimeSync_Mux);
+
+  u8_servers = TimeSyncResolve(pc_servers, px_addr, TIMESYNC_MAX_SERVERS);
+  if (u8_servers > 0)
+  {
+    i_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  }
+  if ((i_sock >= 0) && (setsockopt(i_sock, SOL_SOCKET, SO_RCVTIMEO, &x_timeout, sizeof(x_timeout)) == 0))
+  {
+    WiFiConn__Hold_Roaming(true);
+    for (u8_round = 0; u8_round < TIMESYNC_ROUNDS; ++u8_round)
+    {
+      if (u8_round > 0)
+      {
+        vTaskDelay(pdMS_TO_TICKS(TIMESYNC_ROUND_GAP_MS));
+      }
+      for (u8_server = 0; u8_server < u8_servers; ++u8_server)
+      {
+        pb_valid[u8_server][u8_round] = TimeSyncSample(i_sock, &px_addr[u8_server], &px_sample[u8_server][u8_round]);
+      }
+    }
+    WiFiConn__Hold_Roaming(false);
+  }
+  if (i_sock >= 0)
+  {
+    close(i_sock);
+  }
+
+  if (TimeSyncSelect(px_sample, pb_valid, u8_servers) == false)
+  {
+    Metrics__Counter_Add(METRICS_TIMESYNC_FAILURES, 1);
+    portENTER_CRITICAL(&x_TimeSync_Mux);
+    x_TimeSync_State.stats.failures++;
+    x_TimeSync_State.next_sync_us = esp_timer_get_time() + ((int64_t)TIMESYNC_RETRY_S * 1000000);
+    portEXIT_CRITICAL(&x_TimeSync_Mux);
+    BinLog__Event(BINLOG_TIMESYNC_FAILURE, u8_servers, TIMESYNC_RETRY_S);
+  }
+}
+
+/**
+ * @brief   Resolves the "host[:port]" entries of a comma separated list,
+ *          the entries not resolved are skipped.
+ *
+ * @param pc_list   server list, modified
+ * @param px_addr   [out] addresses
+ * @param u8_max    size of px_addr
+ *
+ * @return number of addresses
+ */
+static uint8_t TimeSyncResolve(char *pc_list, struct sockaddr_in *px_addr, uint8_t u8_max)
+{
+  const struct addrinfo x_hints =
+  {
+    .ai_family = AF_INET,
+    .ai_socktype = SOCK_DGRAM
+  };
+  struct addrinfo *px_result;
+  char *pc_save = NULL;
+  char *pc_host;
+  char *pc_port;
+  uint16_t u16_port;
+  uint8_t u8_num = 0;
+
+  for (pc_host = strtok_r(pc_list, ", ", &pc_save); (pc_host != NULL) && (u8_num < u8_max);
+       pc_host = strtok_r(NULL, ", ", &pc_save))
+  {
+    u16_port = TIMESYNC_NTP_PORT;
+    pc_port = strchr(pc_host, ':');
+    if (pc_port != NULL)
+    {
+      *pc_port = '\0';
+      u16_port = (uint16_t)strtoul(&pc_port[1], NULL, 10);
+    }
+
+    if ((getaddrinfo(pc_host, NULL, &x_hints, &px_result) != 0) || (px_result == NULL))
+    {
+      ESP_LOGW(TAG, "server %s not resolved", pc_host);
+      continue;
+    }
+    memcpy(&px_addr[u8_num], px_result->ai_addr, sizeof(px_addr[u8_num]));
+    px_addr[u8_num].sin_port = htons(u16_port);
+    freeaddrinfo(px_result);
+    u8_num++;
+  }
+
+  return u8_num;
+}
+
+/**
+ * @brief   Sends a request and waits for its reply: late replies of the
+ *          previous requests are recognized by the origin timestamp and
+ *          dropped, as the replies of unsynchronized servers and the kiss
+ *          of death packets.
+ *
+ * @param i_sock      UDP socket, with the reply timeout
+ * @param px_addr     server
+ * @param px_sample   [out] offset and round trip delay
+ *
+ * @return true if the sample is valid
+ */
+static bool TimeSyncSample(int i_sock, const struct sockaddr_in *px_addr, TIMESYNC_SAMPLE_TYPE *px_sample)
+{
+  uint8_t pu8_packet[TIMESYNC_NTP_BYTES];
+  uint64_t u64_sent;
+  int64_t s64_t1;
+  int64_t s64_t2;
+  int64_t s64_t3;
+  int64_t s64_t4;
+  uint8_t u8_tries;
+  int i_len;
+
+  memset(pu8_packet, 0x00, sizeof(pu8_packet));
+  pu8_packet[0] = (TIMESYNC_NTP_VERSION << 3) | TIMESYNC_NTP_MODE_CLIENT;
+  s64_t1 = TimeSyncNow();
+  u64_sent = TimeSyncToNtp(s64_t1);
+  TimeSyncPut64(&pu8_packet[TIMESYNC_NTP_TRANSMIT], u64_sent);
+
+  if (sendto(i_sock, pu8_packet, sizeof(pu8_packet), 0, (const struct sockaddr *)px_addr, sizeof(*px_addr)) !=
+      sizeof(pu8_packet))
+  {
+    return false;
+  }
+
+  for (u8_tries = 0; u8_tries < 4; ++u8_tries)
+  {
+    i_len = recv(i_sock, pu8_packet, sizeof(pu8_packet), 0);
+    s64_t4 = TimeSyncNow();
+    if (i_len < 0)
+    {
+      // timeout
+      return false;
+    }
+    if ((i_len >= TIMESYNC_NTP_BYTES) && (TimeSyncGet64(&pu8_packet[TIMESYNC_NTP_ORIGIN]) == u64_sent))
+    {
+      break;
+    }
+  }
+  if ((u8_tries == 4) ||
+      ((pu8_packet[0] & 0x07) != TIMESYNC_NTP_MODE_SERVER) ||
+      ((pu8_packet[0] >> 6) == TIMESYNC_NTP_LEAP_UNSYNC) ||
+      (pu8_packet[1] == 0) || (pu8_packet[1] > 15))
+  {
+    return false;
+  }
+
+  s64_t2 = TimeSyncFromNtp(TimeSyncGet64(&pu8_packet[TIMESYNC_NTP_RECEIVE]));
+  s64_t3 = TimeSyncFromNtp(TimeSyncGet64(&pu8_packet[TIMESYNC_NTP_TRANSMIT]));
+  px_sample->offset_us = ((s64_t2 - s64_t1) + (s64_t3 - s64_t4)) / 2;
+  px_sample->delay_us = MAX((s64_t4 - s64_t1) - (s64_t3 - s64_t2), 0);
+
+  return true;
+}
+
+/**
+ * @brief   Filters the samples and applies the result: the fastest sample of
+ *          each server is kept (the delay bounds its error), the servers
+ *          slower than the fastest one by more than TIMESYNC_DELAY_MARGIN_US
+ *          are dropped and the median of the others is the offset. The
+ *          jitter is the RMS deviation from it of the samples of the servers
+ *          kept within the delay margin, each deviation clamped to
+ *          TIMESYNC_JITTER_MAX_US.
+ *
+ * @param px_sample   samples, by server and round
+ * @param pb_valid    valid samples
+ * @param u8_servers  servers sampled
+ *
+ * @return true if at least one sample is valid
+ */
+static bool TimeSyncSelect(const TIMESYNC_SAMPLE_TYPE px_sample[][TIMESYNC_ROUNDS],
+                           const bool pb_valid[][TIMESYNC_ROUNDS], uint8_t u8_servers)
+{
+  TIMESYNC_SAMPLE_TYPE px_best[TIMESYNC_MAX_SERVERS];
+  int64_t ps64_offset[TIMESYNC_MAX_SERVERS];
+  int64_t s64_min_delay = INT64_MAX;
+  int64_t s64_offset;
+  int64_t s64_tmp;
+  uint64_t u64_square = 0;
+  uint32_t u32_jitter_us;
+  uint8_t u8_replied = 0;
+  uint8_t u8_used = 0;
+  uint8_t u8_samples = 0;
+  uint8_t u8_server;
+  uint8_t u8_round;
+  uint8_t u8_idx;
+
+  for (u8_server = 0; u8_server < u8_servers; ++u8_server)
+  {
+    px_best[u8_server].delay_us = INT64_MAX;
+    for (u8_round = 0; u8_round < TIMESYNC_ROUNDS; ++u8_round)
+    {
+      if ((pb_valid[u8_server][u8_round] == true) && (px_sample[u8_server][u8_round].delay_us < px_best[u8_server].delay_us))
+      {
+        px_best[u8_server] = px_sample[u8_server][u8_round];
+      }
+    }
+    if (px_best[u8_server].delay_us != INT64_MAX)
+    {
+      u8_replied++;
+      s64_min_delay = MIN(s64_min_delay, px_best[u8_server].delay_us);
+    }
+  }
+  if (u8_replied == 0)
+  {
+    return false;
+  }
+
+  // insertion sort of the few offsets kept
+  for (u8_server = 0; u8_server < u8_servers; ++u8_server)
+  {
+    if (px_best[u8_server].delay_us > (s64_min_delay + TIMESYNC_DELAY_MARGIN_US))
+    {
+      continue;
+    }
+    for (u8_idx = u8_used; (u8_idx > 0) && (ps64_offset[u8_idx - 1] > px_best[u8_server].offset_us); --u8_idx)
+    {
+      ps64_offset[u8_idx] = ps64_offset[u8_idx - 1];
+    }
+    ps64_offset[u8_idx] = px_best[u8_server].offset_us;
+    u8_used++;
+  }
+  s64_offset = ((u8_used & 1) != 0) ? ps64_offset[u8_used / 2] :
+                                      ((ps64_offset[(u8_used / 2) - 1] + ps64_offset[u8_used / 2]) / 2);
+
+  for (u8_server = 0; u8_server < u8_servers; ++u8_server)
+  {
+    // only the servers kept for the median
+    if (px_best[u8_server].delay_us > (s64_min_delay + TIMESYNC_DELAY_MARGIN_US))
+    {
+      continue;
+    }
+    for (u8_round = 0; u8_round < TIMESYNC_ROUNDS; ++u8_round)
+    {
+      if ((pb_valid[u8_server][u8_round] == true) &&
+          (px_sample[u8_server][u8_round].delay_us <= (s64_min_delay + TIMESYNC_DELAY_MARGIN_US)))
+      {
+        s64_tmp = MIN(llabs(px_sample[u8_server][u8_round].offset_us - s64_offset), TIMESYNC_JITTER_MAX_US);
+        u64_square += (uint64_t)(s64_tmp * s64_tmp);
+        u8_samples++;
+      }
+    }
+  }
+  u32_jitter_us = TimeSyncIsqrt(u64_square / u8_samples);
+
+  portENTER_CRITICAL(&x_TimeSync_Mux);
+  x_TimeSync_State.stats.offset_us = (int32_t)MAX(MIN(s64_offset, INT32_MAX), INT32_MIN);
+  x_TimeSync_State.stats.delay_us = (uint32_t)MIN(s64_min_delay, UINT32_MAX);
+  x_TimeSync_State.stats.jitter_us = u32_jitter_us;
+  x_TimeSync_State.stats.servers = u8_replied;
+  portEXIT_CRITICAL(&x_TimeSync_Mux);
+
+  TimeSyncApply(s64_offset);
+
+  return true;
+}
+
+/**
+ * @brief   Applies an offset: stepped if the clock is not set or the offset
+ *          is above TIMESYNC_STEP_US, slewed otherwise. The offsets slewed
+ *          since the last drift estimate, less the correction still pending,
+ *          are the error left by the drift model: once they span
+ *          TIMESYNC_DRIFT_MIN_SPAN_S they update the drift. The interval to
+ *          the next sync follows the size of the offset.
+ *
+ * @param s64_offset_us   server - local time
+ */
+static void TimeSyncApply(int64_t s64_offset_us)
+{
+  struct timeval x_tv;
+  struct timeval x_pending;
+  int64_t s64_now_us = esp_timer_get_time();
+  int64_t s64_abs_us = llabs(s64_offset_us);
+  int64_t s64_span_us;
+  int64_t s64_time_us;
+  int32_t s32_drift_ppb;
+  uint32_t u32_interval_s;
+  bool b_step;
+
+  b_step = ((TimeSyncNow() < ((int64_t)TIMESYNC_CLOCK_VALID_S * 1000000)) || (s64_abs_us >= TIMESYNC_STEP_US));
+
+  portENTER_CRITICAL(&x_TimeSync_Mux);
+  s32_drift_ppb = x_TimeSync_State.stats.drift_ppb;
+  u32_interval_s = x_TimeSync_State.stats.interval_s;
+  portEXIT_CRITICAL(&x_TimeSync_Mux);
+
+  if (b_step == true)
+  {
+    TimeSyncSlew(0, false);
+    s64_time_us = TimeSyncNow() + s64_offset_us;
+    x_tv.tv_sec = s64_time_us / 1000000;
+    x_tv.tv_usec = s64_time_us % 1000000;
+    (void)settimeofday(&x_tv, NULL);
+
+    // the span of the drift estimate restarts
+    x_TimeSync_State.last_sync_us = 0;
+    x_TimeSync_State.drift_error_us = 0;
+    u32_interval_s = TIMESYNC_MIN_INTERVAL_S;
+    Metrics__Counter_Add(METRICS_TIMESYNC_STEPS, 1);
+    ESP_LOGI(TAG, "clock set, %lld ms off", s64_abs_us / 1000);
+
+    Alarm__Time_Changed();
+    ClockFace__Time_Changed();
+  }
+  else
+  {
+    (void)adjtime(NULL, &x_pending);
+    x_TimeSync_State.drift_error_us += s64_offset_us - (((int64_t)x_pending.tv_sec * 1000000) + x_pending.tv_usec);
+    TimeSyncSlew(s64_offset_us, false);
+
+    s64_span_us = s64_now_us - x_TimeSync_State.last_sync_us;
+    if (x_TimeSync_State.last_sync_us == 0)
+    {
+      x_TimeSync_State.last_sync_us = s64_now_us;
+      x_TimeSync_State.drift_error_us = 0;
+    }
+    else if (s64_span_us >= ((int64_t)TIMESYNC_DRIFT_MIN_SPAN_S * 1000000))
+    {
+      s32_drift_ppb += (int32_t)((x_TimeSync_State.drift_error_us * 1000000000LL / s64_span_us) / TIMESYNC_DRIFT_GAIN_DIV);
+      s32_drift_ppb = MAX(MIN(s32_drift_ppb, TIMESYNC_DRIFT_MAX_PPB), -TIMESYNC_DRIFT_MAX_PPB);
+      x_TimeSync_State.last_sync_us = s64_now_us;
+      x_TimeSync_State.drift_error_us = 0;
+    }
+
+    if (s64_abs_us < TIMESYNC_GOOD_OFFSET_US)
+    {
+      u32_interval_s = MIN(u32_interval_s * 2, TIMESYNC_MAX_INTERVAL_S);
+    }
+    else if (s64_abs_us > (4 * TIMESYNC_GOOD_OFFSET_US))
+    {
+      u32_interval_s = MAX(u32_interval_s / 2, TIMESYNC_MIN_INTERVAL_S);
+    }
+  }
+
+  if (abs(s32_drift_ppb - x_TimeSync_State.drift_saved_ppb) > TIMESYNC_DRIFT_SAVE_PPB)
+  {
+    (void)Settings__Set(SETTINGS_TIME_DRIFT, &s32_drift_ppb, sizeof(s32_drift_ppb));
+    x_TimeSync_State.drift_saved_ppb = s32_drift_ppb;
+  }
+
+  portENTER_CRITICAL(&x_TimeSync_Mux);
+  x_TimeSync_State.stats.syncs++;
+  x_TimeSync_State.stats.steps += (b_step == true) ? 1 : 0;
+  x_TimeSync_State.stats.drift_ppb = s32_drift_ppb;
+  x_TimeSync_State.stats.interval_s = u32_interval_s;
+  x_TimeSync_State.next_sync_us = s64_now_us + ((int64_t)u32_interval_s * 1000000);
+  x_TimeSync_State.synced = true;
+  portEXIT_CRITICAL(&x_TimeSync_Mux);
+
+  Metrics__Counter_Add(METRICS_TIMESYNC_SYNCS, 1);
+  Metrics__Histogram_Observe(METRICS_TIMESYNC_OFFSET_US, (uint32_t)MIN(s64_abs_us, UINT32_MAX));
+  ESP_LOGI(TAG, "offset %lld us, delay %u us, jitter %u us, %u servers, drift %d ppb, next in %u s",
+           s64_offset_us, x_TimeSync_State.stats.delay_us, x_TimeSync_State.stats.jitter_us,
+           x_TimeSync_State.stats.servers, s32_drift_ppb, u32_interval_s);
+}
+
+/**
+ * @brief   Slews in the drift correction for the time elapsed since the last
+ *          call, the fraction of microsecond is carried to the next one. Not
+ *          applied while the clock is not set.
+ *
+ */
+static void TimeSyncDriftCorrect(void)
+{
+  int64_t s64_now_us = esp_timer_get_time();
+  int64_t s64_correction_us;
+
+  x_TimeSync_State.drift_acc += (int64_t)x_TimeSync_State.stats.drift_ppb * (s64_now_us - x_TimeSync_State.drift_us);
+  x_TimeSync_State.drift_us = s64_now_us;
+
+  if (TimeSyncNow() < ((int64_t)TIMESYNC_CLOCK_VALID_S * 1000000))
+  {
+    x_TimeSync_State.drift_acc = 0;
+    return;
+  }
+
+  s64_correction_us = x_TimeSync_State.drift_acc / 1000000000LL;
+  if (s64_correction_us != 0)
+  {
+    x_TimeSync_State.drift_acc -= s64_correction_us * 1000000000LL;
+    TimeSyncSlew(s64_correction_us, true);
+  }
+}
+
+/**
+ * @brief   Sets the adjustment slewed in by the system clock.
+ *
+ * @param s64_delta_us  adjustment
+ * @param b_add         added to the adjustment still pending, otherwise it replaces it
+ */
+static void TimeSyncSlew(int64_t s64_delta_us, bool b_add)
+{
+  struct timeval x_delta;
+
+  if (b_add == true)
+  {
+    (void)adjtime(NULL, &x_delta);
+    s64_delta_us += ((int64_t)x_delta.tv_sec * 1000000) + x_delta.tv_usec;
+  }
+  x_delta.tv_sec = s64_delta_us / 1000000;
+  x_delta.tv_usec = s64_delta_us % 1000000;
+  (void)adjtime(&x_delta, NULL);
+}
+
+/**
+ * @brief   Integer square root, bit by bit.
+ *
+ * @param u64_value   radicand
+ *
+ * @return floor of the square root
+ */
+static uint32_t TimeSyncIsqrt(uint64_t u64_value)
+{
+  uint64_t u64_root = 0;
+  uint64_t u64_bit = 1ULL << 62;
+
+  while (u64_bit > u64_value)
+  {
+    u64_bit >>= 2;
+  }
+  while (u64_bit != 0)
+  {
+    if (u64_value >= (u64_root + u64_bit))
+    {
+      u64_value -= u64_root + u64_bit;
+      u64_root = (u64_root >> 1) + u64_bit;
+    }
+    else
+    {
+      u64_root >>= 1;
+    }
+    u64_bit >>= 2;
+  }
+  return (uint32_t)u64_root;
+}
+
+/**
+ * @brief   Returns the system time.
+ *
+ * @return microseconds since 1970
+ */
+static int64_t TimeSyncNow(void)
+{
+  struct timeval x_tv;
+
+  (void)gettimeofday(&x_tv, NULL);
+  return ((int64_t)x_tv.tv_sec * 1000000) + x_tv.tv_usec;
+}
+
+/**
+ * @brief   Converts a time to an NTP timestamp.
+ *
+ * @param s64_us  microseconds since 1970
+ *
+ * @return seconds since 1900 (high 32 bits, modulo 2^32) and fraction
+ */
+static uint64_t TimeSyncToNtp(int64_t s64_us)
+{
+  uint64_t u64_s = (uint64_t)(s64_us / 1000000) + TIMESYNC_NTP_UNIX_OFFSET_S;
+  uint64_t u64_frac = ((uint64_t)(s64_us % 1000000) << 32) / 1000000;
+
+  return ((u64_s & 0xFFFFFFFF) << 32) | u64_frac;
+}
+
+/**
+ * @brief   Converts an NTP timestamp to a time. Seconds below 2^31 are taken
+ *          from the era starting in 2036.
+ *
+ * @param u64_ntp   timestamp
+ *
+ * @return microseconds since 1970
+ */
+static int64_t TimeSyncFromNtp(uint64_t u64_ntp)
+{
+  int64_t s64_s = (int64_t)(u64_ntp >> 32);
+
+  if (s64_s < 0x80000000LL)
+  {
+    s64_s += 0x100000000LL;
+  }
+  return ((s64_s - (int64_t)TIMESYNC_NTP_UNIX_OFFSET_S) * 1000000) + (int64_t)(((u64_ntp & 0xFFFFFFFF) * 1000000) >> 32);
+}
+
+/**
+ * @brief   Reads a big endian 64 bits field of a packet.
+ */
+static uint64_t TimeSyncGet64(const uint8_t *pu8_data)
+{
+  uint64_t u64_value = 0;
+  uint8_t u8_idx;
+
+  for (u8_idx = 0; u8_idx < 8; ++u8_idx)
+  {
+    u64_value = (u64_value << 8) | pu8_data[u8_idx];
+  }
+  return u64_value;
+}
+
+/**
+ * @brief   Writes a big endian 64 bits field of a packet.
+ */
+static void TimeSyncPut64(uint8_t *pu8_data, uint64_t u64_value)
+{
+  uint8_t u8_idx;
+
+  for (u8_idx = 8; u8_idx > 0; --u8_idx)
+  {
+    pu8_data[u8_idx - 1] = (uint8_t)u64_value;
+    u64_value >>= 8;
+  }
+}
+
+/**
+ * @brief   GET on the time sync command: servers and statistics.
+ *
+ * @param px_req  request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t TimeSyncHttpGetHandler(httpd_req_t *px_req)
+{
+  TIMESYNC_STATS_TYPE x_stats;
+  char pc_text[TIMESYNC_SERVERS_BYTES + 320];
+  int64_t s64_next_s;
+
+  portENTER_CRITICAL(&x_TimeSync_Mux);
+  x_stats = x_TimeSync_State.stats;
+  s64_next_s = (x_TimeSync_State.next_sync_us - esp_timer_get_time()) / 1000000;
+  portEXIT_CRITICAL(&x_TimeSync_Mux);
+
+  snprintf(pc_text, sizeof(pc_text),
+           "servers %s\n"
+           "synced %s\n"
+           "offset_us %d\n"
+           "jitter_us %u\n"
+           "delay_us %u\n"
+           "drift_ppb %d\n"
+           "replies %u\n"
+           "syncs %u\n"
+           "failures %u\n"
+           "steps %u\n"
+           "interval_s %u\n"
+           "next_s %lld\n",
+           pc_TimeSync_Servers, (x_TimeSync_State.synced == true) ? "yes" : "no", x_stats.offset_us,
+           x_stats.jitter_us, x_stats.delay_us, x_stats.drift_ppb, x_stats.servers, x_stats.syncs,
+           x_stats.failures, x_stats.steps, x_stats.interval_s, MAX(s64_next_s, 0));
+
+  httpd_resp_set_type(px_req, "text/plain");
+  return httpd_resp_sendstr(px_req, pc_text);
+}
+
+/**
+ * @brief   POST on the time sync command: "sync" syncs now, "servers <list>"
+ *          replaces the servers until the next reset and syncs with them.
+ *
+ * @param px_req  request
+ *
+ * @return ESP_OK, ESP_FAIL on a bad request
+ */
+static esp_err_t TimeSyncHttpPostHandler(httpd_req_t *px_req)
+{
+  char pc_body[TIMESYNC_HTTP_BODY_MAX + 1];
+  int i_len;
+
+  i_len = httpd_req_recv(px_req, pc_body, MIN(px_req->content_len, TIMESYNC_HTTP_BODY_MAX));
+  if (i_len <= 0)
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "empty request");
+    return ESP_FAIL;
+  }
+  pc_body[i_len] = '\0';
+  pc_body[strcspn(pc_body, "\r\n")] = '\0';
+
+  if (strncmp(pc_body, "servers ", 8) == 0)
+  {
+    if ((pc_body[8] == '\0') || (strlen(&pc_body[8]) >= sizeof(pc_TimeSync_Servers)))
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "bad server list");
+      return ESP_FAIL;
+    }
+    portENTER_CRITICAL(&x_TimeSync_Mux);
+    strcpy(pc_TimeSync_Servers, &pc_body[8]);
+    portEXIT_CRITICAL(&x_TimeSync_Mux);
+    ESP_LOGI(TAG, "servers %s", pc_TimeSync_Servers);
+  }
+  else if (strcmp(pc_body, "sync") != 0)
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "unknown command");
+    return ESP_FAIL;
+  }
+
+  TimeSync__Sync_Now();
+  return httpd_resp_sendstr(px_req, "OK\n");
+}
@@ -0,0 +1,34 @@
+
+/**
+ *  @file       TimeSync.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TIMESYNC_H
+    #define TIMESYNC_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <TimeSync_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void TimeSync__Initialize(void);
+void TimeSync__Sync_Now(void);
+bool TimeSync__Is_Synced(void);
+void TimeSync__Get_Stats(TIMESYNC_STATS_TYPE *px_stats);
+
+#endif
@@ -0,0 +1,40 @@
+
+/**
+ *  @file       TimeSync_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TIMESYNC_PRM_H
+    #define TIMESYNC_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+// entry point of the time sync command: GET reports the statistics,
+// POST "sync" syncs now, "servers <host[:port]>,..." replaces the servers until the reset
+#define TIMESYNC_URI                "/timesync"
+
+typedef struct
+{
+  uint32_t syncs;                   // successful syncs
+  uint32_t failures;                // syncs without any valid reply
+  uint32_t steps;                   // syncs that set the clock instead of slewing it
+  int32_t offset_us;                // last offset, server - local
+  uint32_t jitter_us;               // RMS deviation of the last samples from the offset
+  uint32_t delay_us;                // round trip of the best sample
+  int32_t drift_ppb;                // drift compensated between syncs, + if the local clock is slow
+  uint32_t interval_s;              // time to the next sync
+  uint8_t servers;                  // servers that replied to the last sync
+}TIMESYNC_STATS_TYPE;
+
+#endif
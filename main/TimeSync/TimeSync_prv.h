@@ -0,0 +1,114 @@
+
+/**
+ *  @file       TimeSync_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TIMESYNC_PRV_H
+    #define TIMESYNC_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <TimeSync_prm.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// comma separated "host[:port]" list
+#define TIMESYNC_SERVERS            CONFIG_TIMESYNC_SERVERS
+#define TIMESYNC_SERVERS_BYTES      128
+#define TIMESYNC_MAX_SERVERS        4
+
+// each server is sampled once per round, the rounds are spaced as the NTP burst mode
+#define TIMESYNC_ROUNDS             CONFIG_TIMESYNC_SAMPLES
+#define TIMESYNC_ROUND_GAP_MS       2000
+#define TIMESYNC_REPLY_TIMEOUT_MS   500
+
+// sync interval: doubled while the offsets are small, halved when they grow
+#define TIMESYNC_MIN_INTERVAL_S     CONFIG_TIMESYNC_MIN_INTERVAL_S
+#define TIMESYNC_MAX_INTERVAL_S     CONFIG_TIMESYNC_MAX_INTERVAL_S
+#define TIMESYNC_RETRY_S            30
+#define TIMESYNC_GOOD_OFFSET_US     2000
+
+// larger offsets (and any offset while the clock is not set) step the clock
+#define TIMESYNC_STEP_US            ((int64_t)CONFIG_TIMESYNC_STEP_MS * 1000)
+
+// samples slower than the best one by more than this are not used
+#define TIMESYNC_DELAY_MARGIN_US    2000
+// deviations are clamped to this in the jitter, a falseticker cannot overflow the sum of squares
+#define TIMESYNC_JITTER_MAX_US      1000000LL
+
+// between syncs the drift correction is slewed in once it reaches this, at most once per period
+#define TIMESYNC_DRIFT_STEP_US      2000
+#define TIMESYNC_DRIFT_MIN_PERIOD_S 60
+// the drift is estimated over spans of at least this time, with this gain
+#define TIMESYNC_DRIFT_MIN_SPAN_S   600
+#define TIMESYNC_DRIFT_GAIN_DIV     2
+#define TIMESYNC_DRIFT_MAX_PPB      500000
+// a new estimate is written to the settings only if it moved by more than this
+#define TIMESYNC_DRIFT_SAVE_PPB     100
+
+#if (TIMESYNC_MIN_INTERVAL_S > TIMESYNC_MAX_INTERVAL_S)
+#error "TimeSync: min interval longer than the max one"
+#endif
+
+// first time accepted as valid (2022-01-01)
+#define TIMESYNC_CLOCK_VALID_S      1640995200
+
+/**
+ * NTP packet (RFC 5905), all fields big endian, 48 bytes without extensions:
+ *
+ *   offset  size  field
+ *   0       1     leap (2 bits), version (3 bits), mode (3 bits)
+ *   1       1     stratum
+ *   24      8     origin timestamp: transmit timestamp of the request
+ *   32      8     receive timestamp
+ *   40      8     transmit timestamp
+ *
+ * Timestamps are seconds since 1900 (32 bits) and fraction (32 bits).
+ */
+#define TIMESYNC_NTP_PORT           123
+#define TIMESYNC_NTP_BYTES          48
+#define TIMESYNC_NTP_VERSION        4
+#define TIMESYNC_NTP_MODE_CLIENT    3
+#define TIMESYNC_NTP_MODE_SERVER    4
+#define TIMESYNC_NTP_LEAP_UNSYNC    3
+#define TIMESYNC_NTP_ORIGIN         24
+#define TIMESYNC_NTP_RECEIVE        32
+#define TIMESYNC_NTP_TRANSMIT       40
+// 1970 - 1900 in seconds
+#define TIMESYNC_NTP_UNIX_OFFSET_S  2208988800ULL
+
+typedef struct
+{
+  int64_t offset_us;
+  int64_t delay_us;
+}TIMESYNC_SAMPLE_TYPE;
+
+typedef struct
+{
+  int64_t next_sync_us;             // esp_timer time of the next sync
+  int64_t last_sync_us;             // esp_timer time of the last drift estimate, 0 after a step
+  int64_t drift_error_us;           // offsets slewed since then, less the pending correction
+  int64_t drift_us;                 // esp_timer time of the last drift correction
+  int64_t drift_acc;                // correction not applied yet, ppb * us
+  int32_t drift_saved_ppb;
+  bool synced;                      // synced since the boot
+  TIMESYNC_STATS_TYPE stats;
+}TIMESYNC_STATE_TYPE;
+
+#define TIMESYNC_TASK_STACK         (1024 * 4)
+#define TIMESYNC_TASK_PRIO          3
+
+// longest body of the time sync command
+#define TIMESYNC_HTTP_BODY_MAX      (8 + TIMESYNC_SERVERS_BYTES)
+
+#endif
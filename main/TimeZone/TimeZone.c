@@ -0,0 +1,340 @@
+
+/**
+ *  @file       TimeZone.c
+ *
+ *  @brief      Local time from UTC, using the transition table generated
+ *              offline (TimeZone_tbl.h) instead of parsing POSIX TZ rules at
+ *              run time. The offset found is kept together with the interval
+ *              where it is valid, so the conversion done every second is a
+ *              compare and an add; the table is searched again only when a
+ *              transition is crossed or the zone changes.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+
+#include <TimeZone.h>
+#include <TimeZone_prv.h>
+#include <Settings.h>
+#include <ClockFace.h>
+#include <Alarm.h>
+#include <HttpSrv.h>
+#include <SysMon.h>
+
+
+//-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
+
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+
+static uint8_t u8_TimeZone_Zone;
+
+// last offset found, empty interval until the first conversion
+static TIMEZONE_CACHE_TYPE x_TimeZone_Cache = {1, 0, 0};
+
+static portMUX_TYPE x_TimeZone_Mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *TAG = "TimeZone";
+
+//-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
+static uint8_t TimeZoneFind(const char *pc_name);
+static void TimeZoneLookup(uint8_t u8_zone, int64_t s64_utc_s, TIMEZONE_CACHE_TYPE *px_entry);
+static esp_err_t TimeZoneHttpGetHandler(httpd_req_t *px_req);
+static esp_err_t TimeZoneHttpPostHandler(httpd_req_t *px_req);
+
+//=====================================================================================================================
+//-------------------------------------- Public Functions -------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Module initialization method, selects the zone stored in the
+ *          settings or, if none is stored, TIMEZONE_DEFAULT, and registers
+ *          the zone command. To be called after Settings__Initialize() and
+ *          the HTTP server.
+ *
+ */
+void TimeZone__Initialize(void)
+{
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = TIMEZONE_URI,
+    .method = HTTP_GET,
+    .handler = TimeZoneHttpGetHandler,
+    .user_ctx = NULL
+  };
+  const httpd_uri_t x_post_uri =
+  {
+    .uri = TIMEZONE_URI,
+    .method = HTTP_POST,
+    .handler = TimeZoneHttpPostHandler,
+    .user_ctx = NULL
+  };
+  char pc_name[SETTINGS_TIME_ZONE_BYTES];
+  uint8_t u8_zone;
+
+  SysMon__Register_Module(TAG, sizeof(x_TimeZone_Cache) + sizeof(u8_TimeZone_Zone));
+
+  (void)Settings__Get(SETTINGS_TIME_ZONE, pc_name, sizeof(pc_name));
+  pc_name[sizeof(pc_name) - 1] = '\0';
+  if (pc_name[0] == '\0')
+  {
+    strlcpy(pc_name, TIMEZONE_DEFAULT, sizeof(pc_name));
+  }
+
+  u8_zone = TimeZoneFind(pc_name);
+  if (u8_zone >= NUM_OF_TIMEZONES)
+  {
+    ESP_LOGW(TAG, "zone %s unknown, using %s", pc_name, TIMEZONE_Zones[0].name);
+    u8_zone = 0;
+  }
+
+  portENTER_CRITICAL(&x_TimeZone_Mux);
+  u8_TimeZone_Zone = u8_zone;
+  x_TimeZone_Cache.from_s = 1;
+  x_TimeZone_Cache.until_s = 0;
+  portEXIT_CRITICAL(&x_TimeZone_Mux);
+
+  ESP_LOGI(TAG, "zone %s (table %d..%d)", TIMEZONE_Zones[u8_zone].name,
+           TIMEZONE_TABLE_FIRST_YEAR, TIMEZONE_TABLE_LAST_YEAR);
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+  (void)HttpSrv__Register_Uri(&x_post_uri);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Selects the zone and stores it in the settings, the clock face
+ *          and the alarms follow the new local time.
+ *
+ * @param pc_name IANA name, i.e. "Europe/Rome", must be one of TimeZone_tbl.h
+ *
+ * @return true if the zone is in the table
+ */
+bool TimeZone__Set_Zone(const char *pc_name)
+{
+  char pc_stored[SETTINGS_TIME_ZONE_BYTES];
+  uint8_t u8_zone = TimeZoneFind(pc_name);
+
+  if (u8_zone >= NUM_OF_TIMEZONES)
+  {
+    return false;
+  }
+
+  portENTER_CRITICAL(&x_TimeZone_Mux);
+  u8_TimeZone_Zone = u8_zone;
+  x_TimeZone_Cache.from_s = 1;
+  x_TimeZone_Cache.until_s = 0;
+  portEXIT_CRITICAL(&x_TimeZone_Mux);
+
+  memset(pc_stored, 0x00, sizeof(pc_stored));
+  strlcpy(pc_stored, TIMEZONE_Zones[u8_zone].name, sizeof(pc_stored));
+  (void)Settings__Set(SETTINGS_TIME_ZONE, pc_stored, sizeof(pc_stored));
+
+  ESP_LOGI(TAG, "zone %s", TIMEZONE_Zones[u8_zone].name);
+
+  ClockFace__Time_Changed();
+  Alarm__Time_Changed();
+
+  return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Name of the zone in use.
+ *
+ * @return IANA name
+ */
+const char *TimeZone__Get_Zone(void)
+{
+  return TIMEZONE_Zones[u8_TimeZone_Zone].name;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Offset of the local time at the given UTC time. After
+ *          TIMEZONE_TABLE_LAST_YEAR the offset of the last transition is kept.
+ *
+ * @param s64_utc_s UTC time, seconds since the epoch
+ *
+ * @return offset in seconds, to be added to the UTC time
+ */
+int32_t TimeZone__Get_Offset(int64_t s64_utc_s)
+{
+  TIMEZONE_CACHE_TYPE x_entry;
+  uint8_t u8_zone;
+  int32_t s32_offset;
+
+  portENTER_CRITICAL(&x_TimeZone_Mux);
+  if ((s64_utc_s >= x_TimeZone_Cache.from_s) && (s64_utc_s < x_TimeZone_Cache.until_s))
+  {
+    s32_offset = x_TimeZone_Cache.offset_s;
+    portEXIT_CRITICAL(&x_TimeZone_Mux);
+
+    return s32_offset;
+  }
+  u8_zone = u8_TimeZone_Zone;
+  portEXIT_CRITICAL(&x_TimeZone_Mux);
+
+  // the search is done outside the critical section, it is short but not constant
+  TimeZoneLookup(u8_zone, s64_utc_s, &x_entry);
+
+  portENTER_CRITICAL(&x_TimeZone_Mux);
+  // not cached if the zone changed meanwhile
+  if (u8_zone == u8_TimeZone_Zone)
+  {
+    x_TimeZone_Cache = x_entry;
+  }
+  portEXIT_CRITICAL(&x_TimeZone_Mux);
+
+  return x_entry.offset_s;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Converts UTC to local time.
+ *
+ * @param s64_utc_s UTC time, seconds since the epoch
+ *
+ * @return local time, seconds since the epoch (to be split with gmtime_r())
+ */
+int64_t TimeZone__To_Local(int64_t s64_utc_s)
+{
+  return s64_utc_s + TimeZone__Get_Offset(s64_utc_s);
+}
+
+//=====================================================================================================================
+//-------------------------------------- Private Functions ------------------------------------------------------------
+//=====================================================================================================================
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Finds a zone of the table by name.
+ *
+ * @param pc_name IANA name
+ *
+ * @return index of the zone, NUM_OF_TIMEZONES if missing
+ */
+static uint8_t TimeZoneFind(const char *pc_name)
+{
+  uint8_t u8_zone;
+
+  for (u8_zone = 0; u8_zone < NUM_OF_TIMEZONES; u8_zone++)
+  {
+    if (strcmp(TIMEZONE_Zones[u8_zone].name, pc_name) == 0)
+    {
+      break;
+    }
+  }
+
+  return u8_zone;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Finds the offset of a zone at the given time and the interval
+ *          between the surrounding transitions, with a binary search.
+ *
+ * @param u8_zone   zone
+ * @param s64_utc_s UTC time, seconds since the epoch
+ * @param px_entry  [out] offset and interval where it is valid
+ */
+static void TimeZoneLookup(uint8_t u8_zone, int64_t s64_utc_s, TIMEZONE_CACHE_TYPE *px_entry)
+{
+  const TIMEZONE_ZONE_TYPE *px_zone = &TIMEZONE_Zones[u8_zone];
+  const uint32_t *pu32_utc = &TIMEZONE_Transition_Utc[px_zone->first];
+  uint16_t u16_low = 0;
+  uint16_t u16_high = px_zone->num;
+  uint16_t u16_mid;
+
+  // u16_low ends up as the number of transitions not later than s64_utc_s
+  while (u16_low < u16_high)
+  {
+    u16_mid = (u16_low + u16_high) / 2;
+    if ((int64_t)pu32_utc[u16_mid] <= s64_utc_s)
+    {
+      u16_low = u16_mid + 1;
+    }
+    else
+    {
+      u16_high = u16_mid;
+    }
+  }
+
+  if (u16_low == 0)
+  {
+    px_entry->from_s = INT64_MIN;
+    px_entry->offset_s = px_zone->initial_offset_min * 60;
+  }
+  else
+  {
+    px_entry->from_s = pu32_utc[u16_low - 1];
+    px_entry->offset_s = TIMEZONE_Transition_Offset_Min[px_zone->first + u16_low - 1] * 60;
+  }
+
+  px_entry->until_s = (u16_low < px_zone->num) ? (int64_t)pu32_utc[u16_low] : INT64_MAX;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Network command, zone in use then the zones of the table.
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK
+ */
+static esp_err_t TimeZoneHttpGetHandler(httpd_req_t *px_req)
+{
+  uint8_t u8_zone;
+
+  httpd_resp_set_type(px_req, "text/plain");
+
+  httpd_resp_send_chunk(px_req, "zone ", HTTPD_RESP_USE_STRLEN);
+  httpd_resp_send_chunk(px_req, TimeZone__Get_Zone(), HTTPD_RESP_USE_STRLEN);
+  httpd_resp_send_chunk(px_req, "\n\n", HTTPD_RESP_USE_STRLEN);
+  for (u8_zone = 0; u8_zone < NUM_OF_TIMEZONES; u8_zone++)
+  {
+    httpd_resp_send_chunk(px_req, TIMEZONE_Zones[u8_zone].name, HTTPD_RESP_USE_STRLEN);
+    if (httpd_resp_send_chunk(px_req, "\n", HTTPD_RESP_USE_STRLEN) != ESP_OK)
+    {
+      return ESP_OK;
+    }
+  }
+
+  return httpd_resp_send_chunk(px_req, NULL, 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Network command, body the IANA name of a zone of the table.
+ *
+ * @param px_req request
+ *
+ * @return ESP_OK if the zone is selected
+ */
+static esp_err_t TimeZoneHttpPostHandler(httpd_req_t *px_req)
+{
+  char pc_body[TIMEZONE_HTTP_BODY_MAX + 1];
+  int s32_len;
+
+  s32_len = httpd_req_recv(px_req, pc_body, TIMEZONE_HTTP_BODY_MAX);
+  pc_body[(s32_len > 0) ? s32_len : 0] = '\0';
+  pc_body[strcspn(pc_body, "\r\n")] = '\0';
+
+  if (TimeZone__Set_Zone(pc_body) == false)
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "unknown zone, see GET " TIMEZONE_URI);
+    return ESP_FAIL;
+  }
+
+  httpd_resp_sendstr(px_req, "OK\n");
+  return ESP_OK;
+}
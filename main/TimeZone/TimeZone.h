@@ -0,0 +1,35 @@
+
+/**
+ *  @file       TimeZone.h
+ *
+ *  @brief      Header of the module, containing interfaces and global data definition.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TIMEZONE_H
+    #define TIMEZONE_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <TimeZone_prm.h>
+
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
+//=====================================================================================================================
+
+//=====================================================================================================================
+//-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
+//=====================================================================================================================
+void TimeZone__Initialize(void);
+bool TimeZone__Set_Zone(const char *pc_name);
+const char *TimeZone__Get_Zone(void);
+int32_t TimeZone__Get_Offset(int64_t s64_utc_s);
+int64_t TimeZone__To_Local(int64_t s64_utc_s);
+
+#endif
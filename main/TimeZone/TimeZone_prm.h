@@ -0,0 +1,27 @@
+
+/**
+ *  @file       TimeZone_prm.h
+ *
+ *  @brief      Header file containing configuration definitions for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TIMEZONE_PRM_H
+    #define TIMEZONE_PRM_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+
+//=====================================================================================================================
+//-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
+//=====================================================================================================================
+
+// the zones and the years covered are set in tools/gen_tz_table.py, see TimeZone_tbl.h
+
+// zone in use and zones of the table, the POST selects a zone by name
+#define TIMEZONE_URI                "/timezone"
+
+#endif
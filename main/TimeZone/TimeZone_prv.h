@@ -0,0 +1,47 @@
+
+/**
+ *  @file       TimeZone_prv.h
+ *
+ *  @brief      Header containing private data definition for the module.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TIMEZONE_PRV_H
+    #define TIMEZONE_PRV_H
+
+//-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+
+//=====================================================================================================================
+//-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
+//=====================================================================================================================
+
+// zone used when none is stored in the settings
+#define TIMEZONE_DEFAULT            CONFIG_TIMEZONE_DEFAULT
+
+// longest body of the zone command, an IANA name
+#define TIMEZONE_HTTP_BODY_MAX      SETTINGS_TIME_ZONE_BYTES
+
+typedef struct
+{
+  const char *name;                 // IANA name
+  int16_t initial_offset_min;       // offset before the first transition
+  uint16_t first;                   // first transition in TIMEZONE_Transition_Utc[]
+  uint16_t num;                     // transitions, 0 for a fixed offset
+}TIMEZONE_ZONE_TYPE;
+
+// offset in use and the UTC interval where it is valid
+typedef struct
+{
+  int64_t from_s;                   // first second of the interval
+  int64_t until_s;                  // first second after the interval
+  int32_t offset_s;
+}TIMEZONE_CACHE_TYPE;
+
+#include <TimeZone_tbl.h>
+
+#endif
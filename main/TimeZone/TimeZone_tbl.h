@@ -0,0 +1,209 @@
+
+/**
+ *  @file       TimeZone_tbl.h
+ *
+ *  @brief      Time zone transition table, generated by tools/gen_tz_table.py: do not edit.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TIMEZONE_TBL_H
+    #define TIMEZONE_TBL_H
+
+#define TIMEZONE_TABLE_FIRST_YEAR   2022
+#define TIMEZONE_TABLE_LAST_YEAR    2060
+#define NUM_OF_TIMEZONES            19
+
+// UTC time of each transition, zones one after the other
+static const uint32_t TIMEZONE_Transition_Utc[] =
+{
+  1648342800u, 1667091600u, 1679792400u, 1698541200u, 1711846800u, 1729990800u,
+  1743296400u, 1761440400u, 1774746000u, 1792890000u, 1806195600u, 1824944400u,
+  1837645200u, 1856394000u, 1869094800u, 1887843600u, 1901149200u, 1919293200u,
+  1932598800u, 1950742800u, 1964048400u, 1982797200u, 1995498000u, 2014246800u,
+  2026947600u, 2045696400u, 2058397200u, 2077146000u, 2090451600u, 2108595600u,
+  2121901200u, 2140045200u, 2153350800u, 2172099600u, 2184800400u, 2203549200u,
+  2216250000u, 2234998800u, 2248304400u, 2266448400u, 2279754000u, 2297898000u,
+  2311203600u, 2329347600u, 2342653200u, 2361402000u, 2374102800u, 2392851600u,
+  2405552400u, 2424301200u, 2437606800u, 2455750800u, 2469056400u, 2487200400u,
+  2500506000u, 2519254800u, 2531955600u, 2550704400u, 2563405200u, 2582154000u,
+  2595459600u, 2613603600u, 2626909200u, 2645053200u, 2658358800u, 2676502800u,
+  2689808400u, 2708557200u, 2721258000u, 2740006800u, 2752707600u, 2771456400u,
+  2784762000u, 2802906000u, 2816211600u, 2834355600u, 2847661200u, 2866410000u,
+  1648342800u, 1667091600u, 1679792400u, 1698541200u, 1711846800u, 1729990800u,
+  1743296400u, 1761440400u, 1774746000u, 1792890000u, 1806195600u, 1824944400u,
+  1837645200u, 1856394000u, 1869094800u, 1887843600u, 1901149200u, 1919293200u,
+  1932598800u, 1950742800u, 1964048400u, 1982797200u, 1995498000u, 2014246800u,
+  2026947600u, 2045696400u, 2058397200u, 2077146000u, 2090451600u, 2108595600u,
+  2121901200u, 2140045200u, 2153350800u, 2172099600u, 2184800400u, 2203549200u,
+  2216250000u, 2234998800u, 2248304400u, 2266448400u, 2279754000u, 2297898000u,
+  2311203600u, 2329347600u, 2342653200u, 2361402000u, 2374102800u, 2392851600u,
+  2405552400u, 2424301200u, 2437606800u, 2455750800u, 2469056400u, 2487200400u,
+  2500506000u, 2519254800u, 2531955600u, 2550704400u, 2563405200u, 2582154000u,
+  2595459600u, 2613603600u, 2626909200u, 2645053200u, 2658358800u, 2676502800u,
+  2689808400u, 2708557200u, 2721258000u, 2740006800u, 2752707600u, 2771456400u,
+  2784762000u, 2802906000u, 2816211600u, 2834355600u, 2847661200u, 2866410000u,
+  1648342800u, 1667091600u, 1679792400u, 1698541200u, 1711846800u, 1729990800u,
+  1743296400u, 1761440400u, 1774746000u, 1792890000u, 1806195600u, 1824944400u,
+  1837645200u, 1856394000u, 1869094800u, 1887843600u, 1901149200u, 1919293200u,
+  1932598800u, 1950742800u, 1964048400u, 1982797200u, 1995498000u, 2014246800u,
+  2026947600u, 2045696400u, 2058397200u, 2077146000u, 2090451600u, 2108595600u,
+  2121901200u, 2140045200u, 2153350800u, 2172099600u, 2184800400u, 2203549200u,
+  2216250000u, 2234998800u, 2248304400u, 2266448400u, 2279754000u, 2297898000u,
+  2311203600u, 2329347600u, 2342653200u, 2361402000u, 2374102800u, 2392851600u,
+  2405552400u, 2424301200u, 2437606800u, 2455750800u, 2469056400u, 2487200400u,
+  2500506000u, 2519254800u, 2531955600u, 2550704400u, 2563405200u, 2582154000u,
+  2595459600u, 2613603600u, 2626909200u, 2645053200u, 2658358800u, 2676502800u,
+  2689808400u, 2708557200u, 2721258000u, 2740006800u, 2752707600u, 2771456400u,
+  2784762000u, 2802906000u, 2816211600u, 2834355600u, 2847661200u, 2866410000u,
+  1647154800u, 1667714400u, 1678604400u, 1699164000u, 1710054000u, 1730613600u,
+  1741503600u, 1762063200u, 1772953200u, 1793512800u, 1805007600u, 1825567200u,
+  1836457200u, 1857016800u, 1867906800u, 1888466400u, 1899356400u, 1919916000u,
+  1930806000u, 1951365600u, 1962860400u, 1983420000u, 1994310000u, 2014869600u,
+  2025759600u, 2046319200u, 2057209200u, 2077768800u, 2088658800u, 2109218400u,
+  2120108400u, 2140668000u, 2152162800u, 2172722400u, 2183612400u, 2204172000u,
+  2215062000u, 2235621600u, 2246511600u, 2267071200u, 2277961200u, 2298520800u,
+  2309410800u, 2329970400u, 2341465200u, 2362024800u, 2372914800u, 2393474400u,
+  2404364400u, 2424924000u, 2435814000u, 2456373600u, 2467263600u, 2487823200u,
+  2499318000u, 2519877600u, 2530767600u, 2551327200u, 2562217200u, 2582776800u,
+  2593666800u, 2614226400u, 2625116400u, 2645676000u, 2656566000u, 2677125600u,
+  2688620400u, 2709180000u, 2720070000u, 2740629600u, 2751519600u, 2772079200u,
+  2782969200u, 2803528800u, 2814418800u, 2834978400u, 2846473200u, 2867032800u,
+  1647158400u, 1667718000u, 1678608000u, 1699167600u, 1710057600u, 1730617200u,
+  1741507200u, 1762066800u, 1772956800u, 1793516400u, 1805011200u, 1825570800u,
+  1836460800u, 1857020400u, 1867910400u, 1888470000u, 1899360000u, 1919919600u,
+  1930809600u, 1951369200u, 1962864000u, 1983423600u, 1994313600u, 2014873200u,
+  2025763200u, 2046322800u, 2057212800u, 2077772400u, 2088662400u, 2109222000u,
+  2120112000u, 2140671600u, 2152166400u, 2172726000u, 2183616000u, 2204175600u,
+  2215065600u, 2235625200u, 2246515200u, 2267074800u, 2277964800u, 2298524400u,
+  2309414400u, 2329974000u, 2341468800u, 2362028400u, 2372918400u, 2393478000u,
+  2404368000u, 2424927600u, 2435817600u, 2456377200u, 2467267200u, 2487826800u,
+  2499321600u, 2519881200u, 2530771200u, 2551330800u, 2562220800u, 2582780400u,
+  2593670400u, 2614230000u, 2625120000u, 2645679600u, 2656569600u, 2677129200u,
+  2688624000u, 2709183600u, 2720073600u, 2740633200u, 2751523200u, 2772082800u,
+  2782972800u, 2803532400u, 2814422400u, 2834982000u, 2846476800u, 2867036400u,
+  1647162000u, 1667721600u, 1678611600u, 1699171200u, 1710061200u, 1730620800u,
+  1741510800u, 1762070400u, 1772960400u, 1793520000u, 1805014800u, 1825574400u,
+  1836464400u, 1857024000u, 1867914000u, 1888473600u, 1899363600u, 1919923200u,
+  1930813200u, 1951372800u, 1962867600u, 1983427200u, 1994317200u, 2014876800u,
+  2025766800u, 2046326400u, 2057216400u, 2077776000u, 2088666000u, 2109225600u,
+  2120115600u, 2140675200u, 2152170000u, 2172729600u, 2183619600u, 2204179200u,
+  2215069200u, 2235628800u, 2246518800u, 2267078400u, 2277968400u, 2298528000u,
+  2309418000u, 2329977600u, 2341472400u, 2362032000u, 2372922000u, 2393481600u,
+  2404371600u, 2424931200u, 2435821200u, 2456380800u, 2467270800u, 2487830400u,
+  2499325200u, 2519884800u, 2530774800u, 2551334400u, 2562224400u, 2582784000u,
+  2593674000u, 2614233600u, 2625123600u, 2645683200u, 2656573200u, 2677132800u,
+  2688627600u, 2709187200u, 2720077200u, 2740636800u, 2751526800u, 2772086400u,
+  2782976400u, 2803536000u, 2814426000u, 2834985600u, 2846480400u, 2867040000u,
+  1647165600u, 1667725200u, 1678615200u, 1699174800u, 1710064800u, 1730624400u,
+  1741514400u, 1762074000u, 1772964000u, 1793523600u, 1805018400u, 1825578000u,
+  1836468000u, 1857027600u, 1867917600u, 1888477200u, 1899367200u, 1919926800u,
+  1930816800u, 1951376400u, 1962871200u, 1983430800u, 1994320800u, 2014880400u,
+  2025770400u, 2046330000u, 2057220000u, 2077779600u, 2088669600u, 2109229200u,
+  2120119200u, 2140678800u, 2152173600u, 2172733200u, 2183623200u, 2204182800u,
+  2215072800u, 2235632400u, 2246522400u, 2267082000u, 2277972000u, 2298531600u,
+  2309421600u, 2329981200u, 2341476000u, 2362035600u, 2372925600u, 2393485200u,
+  2404375200u, 2424934800u, 2435824800u, 2456384400u, 2467274400u, 2487834000u,
+  2499328800u, 2519888400u, 2530778400u, 2551338000u, 2562228000u, 2582787600u,
+  2593677600u, 2614237200u, 2625127200u, 2645686800u, 2656576800u, 2677136400u,
+  2688631200u, 2709190800u, 2720080800u, 2740640400u, 2751530400u, 2772090000u,
+  2782980000u, 2803539600u, 2814429600u, 2834989200u, 2846484000u, 2867043600u,
+  1648915200u, 1664640000u, 1680364800u, 1696089600u, 1712419200u, 1728144000u,
+  1743868800u, 1759593600u, 1775318400u, 1791043200u, 1806768000u, 1822492800u,
+  1838217600u, 1853942400u, 1869667200u, 1885996800u, 1901721600u, 1917446400u,
+  1933171200u, 1948896000u, 1964620800u, 1980345600u, 1996070400u, 2011795200u,
+  2027520000u, 2043244800u, 2058969600u, 2075299200u, 2091024000u, 2106748800u,
+  2122473600u, 2138198400u, 2153923200u, 2169648000u, 2185372800u, 2201097600u,
+  2216822400u, 2233152000u, 2248876800u, 2264601600u, 2280326400u, 2296051200u,
+  2311776000u, 2327500800u, 2343225600u, 2358950400u, 2374675200u, 2390400000u,
+  2406124800u, 2422454400u, 2438179200u, 2453904000u, 2469628800u, 2485353600u,
+  2501078400u, 2516803200u, 2532528000u, 2548252800u, 2563977600u, 2579702400u,
+  2596032000u, 2611756800u, 2627481600u, 2643206400u, 2658931200u, 2674656000u,
+  2690380800u, 2706105600u, 2721830400u, 2737555200u, 2753280000u, 2769609600u,
+  2785334400u, 2801059200u, 2816784000u, 2832508800u, 2848233600u, 2863958400u,
+};
+
+// UTC offset in minutes from each transition on
+static const int16_t TIMEZONE_Transition_Offset_Min[] =
+{
+  60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0,
+  60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0,
+  60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0,
+  60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0,
+  60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0,
+  60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0,
+  60, 0, 60, 0, 60, 0, 120, 60, 120, 60, 120, 60,
+  120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60,
+  120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60,
+  120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60,
+  120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60,
+  120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60,
+  120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60,
+  180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120,
+  180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120,
+  180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120,
+  180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120,
+  180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120,
+  180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120,
+  180, 120, 180, 120, 180, 120, -240, -300, -240, -300, -240, -300,
+  -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300,
+  -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300,
+  -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300,
+  -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300,
+  -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300,
+  -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300,
+  -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360,
+  -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360,
+  -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360,
+  -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360,
+  -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360,
+  -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360,
+  -300, -360, -300, -360, -300, -360, -360, -420, -360, -420, -360, -420,
+  -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420,
+  -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420,
+  -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420,
+  -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420,
+  -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420,
+  -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420,
+  -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480,
+  -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480,
+  -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480,
+  -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480,
+  -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480,
+  -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480,
+  -420, -480, -420, -480, -420, -480, 600, 660, 600, 660, 600, 660,
+  600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660,
+  600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660,
+  600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660,
+  600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660,
+  600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660,
+  600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660,
+};
+
+static const TIMEZONE_ZONE_TYPE TIMEZONE_Zones[NUM_OF_TIMEZONES] =
+{
+  {"UTC", 0, 0, 0},
+  {"Europe/Lisbon", 0, 0, 78},
+  {"Europe/London", 0, 0, 78},
+  {"Europe/Rome", 60, 78, 78},
+  {"Europe/Paris", 60, 78, 78},
+  {"Europe/Berlin", 60, 78, 78},
+  {"Europe/Madrid", 60, 78, 78},
+  {"Europe/Warsaw", 60, 78, 78},
+  {"Europe/Athens", 120, 156, 78},
+  {"Europe/Istanbul", 180, 0, 0},
+  {"Europe/Moscow", 180, 0, 0},
+  {"America/New_York", -300, 234, 78},
+  {"America/Chicago", -360, 312, 78},
+  {"America/Denver", -420, 390, 78},
+  {"America/Los_Angeles", -480, 468, 78},
+  {"Asia/Kolkata", 330, 0, 0},
+  {"Asia/Shanghai", 480, 0, 0},
+  {"Asia/Tokyo", 540, 0, 0},
+  {"Australia/Sydney", 660, 546, 78},
+};
+
+#endif
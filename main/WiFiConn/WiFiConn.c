@@ -15,56 +15,226 @@
 //-------------------------------------- Include Files ----------------------------------------------------------------
 #include <WiFiConn.h>
 #include <WiFiConn_prv.h>
+#include <stdio.h>
 #include <string.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
+#include "esp_timer.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
 
 #include "lwip/err.h"
 #include "lwip/sys.h"
 
+#include <Metrics.h>
+#include <BootSeq.h>
+#include <Settings.h>
+#include <HttpSrv.h>
+#include <SysMon.h>
+#include <BinLog.h>
+#include <FlightRec.h>
+
 //-------------------------------------- PUBLIC (Variables) -----------------------------------------------------------
 
 //-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
 
-/* FreeRTOS event group to signal when we are connected*/
-static EventGroupHandle_t s_wifi_event_group;
-
-/* The event group allows multiple bits for each event, but we only care about two events:
- * - we are connected to the AP with an IP
- * - we failed to connect after the maximum amount of retries */
-#define WIFI_CONNECTED_BIT BIT0
-#define WIFI_FAIL_BIT      BIT1
-
 static const char *TAG = "wifi station";
 
 static int s_retry_num = 0;
 
+static volatile bool s_connected = false;
+
+// [0] is the configured network, the others are stored in the settings
+static WIFICONN_CREDENTIAL_TYPE px_WiFiConn_Credential[1 + WIFICONN_MAX_CREDENTIALS];
+
+// the stored table is the credentials after the configured one
+_Static_assert((sizeof(px_WiFiConn_Credential) - sizeof(px_WiFiConn_Credential[0])) == SETTINGS_TABLE_WIFI_BYTES,
+               "WiFiConn: SETTINGS_TABLE_WIFI_BYTES out of date");
+
+static WIFICONN_STATE_TYPE x_WiFiConn_State;
+
+// records of the last scan, read in the event loop task
+static wifi_ap_record_t px_WiFiConn_Scan_Record[WIFICONN_SCAN_RECORDS];
+
+static esp_timer_handle_t x_WiFiConn_Scan_Timer;
+
+static portMUX_TYPE x_WiFiConn_Mux = portMUX_INITIALIZER_UNLOCKED;
+
 //-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
 static void event_handler(void* arg, esp_event_base_t event_base,
                                 int32_t event_id, void* event_data);
 
 static void wifi_init_sta(void);
+static void WiFiConnScanStart(void);
+static void WiFiConnScanDone(void);
+static bool WiFiConnBest(WIFICONN_AP_TYPE *px_best);
+static void WiFiConnConnect(const WIFICONN_AP_TYPE *px_ap);
+static void WiFiConnUnpin(void);
+static void WiFiConnRoamCheck(void);
+static void WiFiConnConnected(void);
+static void WiFiConnScanTimerCallback(void *pv_arg);
+static uint8_t WiFiConnFind(const char *pc_ssid);
+static uint16_t WiFiConnTableFill(void *pv_buffer, uint16_t u16_max_bytes);
+static esp_err_t WiFiConnHttpGetHandler(httpd_req_t *px_req);
+static esp_err_t WiFiConnHttpPostHandler(httpd_req_t *px_req);
 //=====================================================================================================================
 //-------------------------------------- Public Functions -------------------------------------------------------------
 //=====================================================================================================================
 
 //---------------------------------------------------------------------------------------------------------------------
 /**
- * @brief   Module initialization method
+ * @brief   Module initialization method: restores the stored networks,
+ *          starts the station and returns, the association goes on in the
+ *          background. To be called after Settings__Initialize().
  *
  */
 void WiFiConn__Initialize(void)
 {
+  const esp_timer_create_args_t x_timer_args =
+  {
+    .callback = WiFiConnScanTimerCallback,
+    .arg = NULL,
+    .name = "WiFiScan"
+  };
+  uint8_t u8_cred;
+
+  memcpy(px_WiFiConn_Credential[0].ssid, EXAMPLE_ESP_WIFI_SSID,
+         MIN(sizeof(EXAMPLE_ESP_WIFI_SSID), WIFICONN_SSID_BYTES - 1));
+  memcpy(px_WiFiConn_Credential[0].password, EXAMPLE_ESP_WIFI_PASS,
+         MIN(sizeof(EXAMPLE_ESP_WIFI_PASS), WIFICONN_PASSWORD_BYTES - 1));
+
+  (void)Settings__Load_Table(SETTINGS_TABLE_WIFI, &px_WiFiConn_Credential[1],
+                             sizeof(px_WiFiConn_Credential) - sizeof(px_WiFiConn_Credential[0]), WiFiConnTableFill);
+  for (u8_cred = 0; u8_cred < (1 + WIFICONN_MAX_CREDENTIALS); ++u8_cred)
+  {
+    px_WiFiConn_Credential[u8_cred].ssid[WIFICONN_SSID_BYTES - 1] = '\0';
+    px_WiFiConn_Credential[u8_cred].password[WIFICONN_PASSWORD_BYTES - 1] = '\0';
+  }
+
+  SysMon__Register_Module(TAG, sizeof(px_WiFiConn_Credential) + sizeof(x_WiFiConn_State) +
+                               sizeof(px_WiFiConn_Scan_Record));
+
+  ESP_ERROR_CHECK(esp_timer_create(&x_timer_args, &x_WiFiConn_Scan_Timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(x_WiFiConn_Scan_Timer, (uint64_t)WIFICONN_SCAN_PERIOD_S * 1000000));
+
   ESP_LOGI(TAG, "ESP_WIFI_MODE_STA");
   wifi_init_sta();
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Registers the network command, to be called after the HTTP server
+ *          is started.
+ *
+ */
+void WiFiConn__Http_Initialize(void)
+{
+  const httpd_uri_t x_get_uri =
+  {
+    .uri = WIFICONN_URI,
+    .method = HTTP_GET,
+    .handler = WiFiConnHttpGetHandler,
+    .user_ctx = NULL
+  };
+  const httpd_uri_t x_post_uri =
+  {
+    .uri = WIFICONN_URI,
+    .method = HTTP_POST,
+    .handler = WiFiConnHttpPostHandler,
+    .user_ctx = NULL
+  };
+
+  (void)HttpSrv__Register_Uri(&x_get_uri);
+  (void)HttpSrv__Register_Uri(&x_post_uri);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Returns the number of connection retries since the last successful connection.
+ *
+ * @return number of retries
+ */
+int WiFiConn__Get_Retry_Num(void)
+{
+  return s_retry_num;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Tells if the station is connected to the AP and has an IP address.
+ *
+ * @return true if connected
+ */
+bool WiFiConn__Is_Connected(void)
+{
+  return s_connected;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Defers the roaming while held, e.g. during a time sync window: the
+ *          background scans are skipped and a roam decided in the meantime is
+ *          started when the last hold is released. Holds nest.
+ *
+ * @param   b_hold    true to take a hold, false to release it
+ */
+void WiFiConn__Hold_Roaming(bool b_hold)
+{
+  bool b_resume = false;
+
+  portENTER_CRITICAL(&x_WiFiConn_Mux);
+  if (b_hold == true)
+  {
+    x_WiFiConn_State.hold++;
+  }
+  else if (x_WiFiConn_State.hold > 0)
+  {
+    x_WiFiConn_State.hold--;
+    if ((x_WiFiConn_State.hold == 0) && (x_WiFiConn_State.roam_pending == true))
+    {
+      x_WiFiConn_State.roam_pending = false;
+      b_resume = true;
+    }
+  }
+  portEXIT_CRITICAL(&x_WiFiConn_Mux);
+
+  if (b_resume == true)
+  {
+    // fresh results, the cached ones may be from before the hold
+    WiFiConnScanStart();
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief   Returns the roaming statistics and the AP in use.
+ *
+ * @param   px_stats    filled with the statistics
+ */
+void WiFiConn__Get_Stats(WIFICONN_STATS_TYPE *px_stats)
+{
+  wifi_ap_record_t x_ap;
+
+  portENTER_CRITICAL(&x_WiFiConn_Mux);
+  *px_stats = x_WiFiConn_State.stats;
+  portEXIT_CRITICAL(&x_WiFiConn_Mux);
+
+  memset(px_stats->bssid, 0, sizeof(px_stats->bssid));
+  px_stats->rssi = 0;
+  px_stats->channel = 0;
+  if ((s_connected == true) && (esp_wifi_sta_get_ap_info(&x_ap) == ESP_OK))
+  {
+    memcpy(px_stats->bssid, x_ap.bssid, sizeof(px_stats->bssid));
+    px_stats->rssi = x_ap.rssi;
+    px_stats->channel = x_ap.primary;
+  }
+}
+
 //=====================================================================================================================
 //-------------------------------------- Private Functions ------------------------------------------------------------
 //=====================================================================================================================
@@ -72,29 +242,60 @@ void WiFiConn__Initialize(void)
 static void event_handler(void* arg, esp_event_base_t event_base,
                                 int32_t event_id, void* event_data)
 {
+    const WIFICONN_CREDENTIAL_TYPE *px_cred = &px_WiFiConn_Credential[x_WiFiConn_State.credential];
+
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        Metrics__Counter_Add(METRICS_WIFI_DISCONNECT, 1);
+        s_connected = false;
+        portENTER_CRITICAL(&x_WiFiConn_Mux);
+        if (x_WiFiConn_State.disconnect_us == 0) {
+            x_WiFiConn_State.disconnect_us = esp_timer_get_time();
+        }
+        portEXIT_CRITICAL(&x_WiFiConn_Mux);
+        if (x_WiFiConn_State.roaming == true) {
+            // disconnection requested by WiFiConnRoamCheck(), straight to the new AP
+            x_WiFiConn_State.roaming = false;
+            WiFiConnConnect(&x_WiFiConn_State.target);
+            return;
+        }
+        if (x_WiFiConn_State.pinned == true) {
+            // the AP picked by the scan failed, the retries may use any AP of the network
+            WiFiConnUnpin();
+        }
+        // a flapping AP disconnects many times a second, rate limited by the log
+        BinLog__Event(BINLOG_WIFI_DISCONNECT, ((wifi_event_sta_disconnected_t*) event_data)->reason, s_retry_num);
+        FlightRec__Event(FLIGHTREC_WIFI_DISCONNECT, ((wifi_event_sta_disconnected_t*) event_data)->reason, s_retry_num);
         if (s_retry_num < EXAMPLE_ESP_MAXIMUM_RETRY) {
             esp_wifi_connect();
             s_retry_num++;
-            ESP_LOGI(TAG, "retry to connect to the AP");
         } else {
-            xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+            ESP_LOGI(TAG, "Failed to connect to SSID:%s", px_cred->ssid);
+            // look for the other APs and networks, the scan timer keeps trying
+            WiFiConnScanStart();
         }
-        ESP_LOGI(TAG,"connect to the AP fail");
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE) {
+        WiFiConnScanDone();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_BSS_RSSI_LOW) {
+        wifi_event_bss_rssi_low_t* event = (wifi_event_bss_rssi_low_t*) event_data;
+        ESP_LOGI(TAG, "RSSI %d dBm below %d dBm, looking for a stronger AP", event->rssi, WIFICONN_ROAM_RSSI);
+        FlightRec__Event(FLIGHTREC_WIFI_RSSI_LOW, (uint32_t)event->rssi, 0);
+        WiFiConnScanStart();
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
+        FlightRec__Event(FLIGHTREC_WIFI_GOT_IP, event->ip_info.ip.addr, 0);
         s_retry_num = 0;
-        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        s_connected = true;
+        BootSeq__Mark(BOOTSEQ_MARK_NETWORK_UP);
+        ESP_LOGI(TAG, "connected to ap SSID:%s", px_cred->ssid);
+        WiFiConnConnected();
     }
 }
 
 static void wifi_init_sta(void)
 {
-    s_wifi_event_group = xEventGroupCreate();
-
     ESP_ERROR_CHECK(esp_netif_init());
 
     ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -118,42 +319,477 @@ static void wifi_init_sta(void)
 
     wifi_config_t wifi_config = {
         .sta = {
-            .ssid = EXAMPLE_ESP_WIFI_SSID,
-            .password = EXAMPLE_ESP_WIFI_PASS,
             /* Setting a password implies station will connect to all security modes including WEP/WPA.
              * However these modes are deprecated and not advisable to be used. Incase your Access point
              * doesn't support WPA2, these mode can be enabled by commenting below line */
        .threshold.authmode = WIFI_AUTH_WPA2_PSK,
         },
     };
+    // the configured network first, the driver picks its strongest AP
+    memcpy(wifi_config.sta.ssid, px_WiFiConn_Credential[0].ssid,
+           strnlen(px_WiFiConn_Credential[0].ssid, sizeof(wifi_config.sta.ssid)));
+    memcpy(wifi_config.sta.password, px_WiFiConn_Credential[0].password,
+           strnlen(px_WiFiConn_Credential[0].password, sizeof(wifi_config.sta.password)));
+    wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    wifi_config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA) );
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config) );
     ESP_ERROR_CHECK(esp_wifi_start() );
 
+    /* The connection goes on in event_handler(), the handlers stay registered to follow
+     * disconnections and reconnections */
     ESP_LOGI(TAG, "wifi_init_sta finished.");
+}
+
+/**
+ * @brief   Starts a background scan of all the channels, unless one is
+ *          already running. While connected and held the scan is deferred to
+ *          the release of the hold.
+ *
+ */
+static void WiFiConnScanStart(void)
+{
+  const wifi_scan_config_t x_scan_config =
+  {
+    .ssid = NULL,
+    .bssid = NULL,
+    .channel = 0,
+    .show_hidden = false,
+    .scan_type = WIFI_SCAN_TYPE_ACTIVE
+  };
+  bool b_start = false;
+
+  portENTER_CRITICAL(&x_WiFiConn_Mux);
+  if ((s_connected == true) && (x_WiFiConn_State.hold > 0))
+  {
+    x_WiFiConn_State.roam_pending = true;
+  }
+  else if ((x_WiFiConn_State.scanning == false) && (x_WiFiConn_State.roaming == false))
+  {
+    x_WiFiConn_State.scanning = true;
+    b_start = true;
+  }
+  portEXIT_CRITICAL(&x_WiFiConn_Mux);
+
+  if ((b_start == true) && (esp_wifi_scan_start(&x_scan_config, false) != ESP_OK))
+  {
+    ESP_LOGW(TAG, "scan not started");
+    x_WiFiConn_State.scanning = false;
+  }
+}
+
+/**
+ * @brief   Reads the results of a scan, keeps the APs of the known networks
+ *          in the cache (strongest first, as sorted by the driver) and goes on
+ *          with the roaming or the reconnection. Called in the event loop task.
+ *
+ */
+static void WiFiConnScanDone(void)
+{
+  WIFICONN_AP_TYPE x_best;
+  uint16_t u16_num = WIFICONN_SCAN_RECORDS;
+  uint16_t u16_rec;
+  uint8_t u8_cred;
+  uint8_t u8_ap_num = 0;
+
+  if (esp_wifi_scan_get_ap_records(&u16_num, px_WiFiConn_Scan_Record) != ESP_OK)
+  {
+    u16_num = 0;
+  }
+
+  portENTER_CRITICAL(&x_WiFiConn_Mux);
+  for (u16_rec = 0; (u16_rec < u16_num) && (u8_ap_num < WIFICONN_AP_CACHE_SIZE); ++u16_rec)
+  {
+    u8_cred = WiFiConnFind((const char *)px_WiFiConn_Scan_Record[u16_rec].ssid);
+    if (u8_cred != WIFICONN_CREDENTIAL_NONE)
+    {
+      memcpy(x_WiFiConn_State.ap[u8_ap_num].bssid, px_WiFiConn_Scan_Record[u16_rec].bssid, 6);
+      x_WiFiConn_State.ap[u8_ap_num].channel = px_WiFiConn_Scan_Record[u16_rec].primary;
+      x_WiFiConn_State.ap[u8_ap_num].rssi = px_WiFiConn_Scan_Record[u16_rec].rssi;
+      x_WiFiConn_State.ap[u8_ap_num].credential = u8_cred;
+      u8_ap_num++;
+    }
+  }
+  x_WiFiConn_State.ap_num = u8_ap_num;
+  x_WiFiConn_State.scan_us = esp_timer_get_time();
+  x_WiFiConn_State.scanning = false;
+  portEXIT_CRITICAL(&x_WiFiConn_Mux);
+
+  ESP_LOGD(TAG, "scan: %u APs, %u of known networks", u16_num, u8_ap_num);
+
+  if (s_connected == true)
+  {
+    WiFiConnRoamCheck();
+  }
+  else if ((x_WiFiConn_State.roaming == false) && (s_retry_num >= EXAMPLE_ESP_MAXIMUM_RETRY))
+  {
+    // the retries on the last AP are over, start again on the strongest one found
+    if (WiFiConnBest(&x_best) == true)
+    {
+      s_retry_num = 0;
+      WiFiConnConnect(&x_best);
+    }
+  }
+}
+
+/**
+ * @brief   Returns the strongest AP of the cache, if the cache is recent.
+ *
+ * @param   px_best   filled with the AP
+ * @return  true if an AP is found
+ */
+static bool WiFiConnBest(WIFICONN_AP_TYPE *px_best)
+{
+  bool b_found = false;
+  uint8_t u8_ap;
+
+  portENTER_CRITICAL(&x_WiFiConn_Mux);
+  if ((esp_timer_get_time() - x_WiFiConn_State.scan_us) < WIFICONN_SCAN_MAX_AGE_US)
+  {
+    for (u8_ap = 0; u8_ap < x_WiFiConn_State.ap_num; ++u8_ap)
+    {
+      if ((b_found == false) || (x_WiFiConn_State.ap[u8_ap].rssi > px_best->rssi))
+      {
+        *px_best = x_WiFiConn_State.ap[u8_ap];
+        b_found = true;
+      }
+    }
+  }
+  portEXIT_CRITICAL(&x_WiFiConn_Mux);
+
+  return b_found;
+}
+
+/**
+ * @brief   Connects to an AP found by a scan: BSSID and channel are set so
+ *          that the driver does not scan again.
+ *
+ * @param   px_ap     AP and network to connect to
+ */
+static void WiFiConnConnect(const WIFICONN_AP_TYPE *px_ap)
+{
+  const WIFICONN_CREDENTIAL_TYPE *px_cred = &px_WiFiConn_Credential[px_ap->credential];
+  wifi_config_t x_config;
+
+  memset(&x_config, 0, sizeof(x_config));
+  memcpy(x_config.sta.ssid, px_cred->ssid, strnlen(px_cred->ssid, sizeof(x_config.sta.ssid)));
+  memcpy(x_config.sta.password, px_cred->password, strnlen(px_cred->password, sizeof(x_config.sta.password)));
+  x_config.sta.threshold.authmode = (px_cred->password[0] == '\0') ? WIFI_AUTH_OPEN : WIFI_AUTH_WPA2_PSK;
+  x_config.sta.bssid_set = true;
+  memcpy(x_config.sta.bssid, px_ap->bssid, sizeof(x_config.sta.bssid));
+  x_config.sta.channel = px_ap->channel;
+
+  x_WiFiConn_State.credential = px_ap->credential;
+  ESP_LOGI(TAG, "connecting to %s " MACSTR " channel %u, %d dBm",
+           px_cred->ssid, MAC2STR(px_ap->bssid), px_ap->channel, px_ap->rssi);
+  if (esp_wifi_set_config(WIFI_IF_STA, &x_config) != ESP_OK)
+  {
+    ESP_LOGW(TAG, "connection not started");
+    return;
+  }
+  x_WiFiConn_State.pinned = true;
+  if (esp_wifi_connect() != ESP_OK)
+  {
+    ESP_LOGW(TAG, "connection not started");
+    WiFiConnUnpin();
+  }
+}
+
+/**
+ * @brief   Clears the BSSID and channel set by WiFiConnConnect(), so that the
+ *          driver connects again to any AP of the network.
+ *
+ */
+static void WiFiConnUnpin(void)
+{
+  wifi_config_t x_config;
 
-    /* Waiting until either the connection is established (WIFI_CONNECTED_BIT) or connection failed for the maximum
-     * number of re-tries (WIFI_FAIL_BIT). The bits are set by event_handler() (see above) */
-    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
-            WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-            pdFALSE,
-            pdFALSE,
-            portMAX_DELAY);
-
-    /* xEventGroupWaitBits() returns the bits before the call returned, hence we can test which event actually
-     * happened. */
-    if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI(TAG, "connected to ap SSID:%s password:%s",
-                 EXAMPLE_ESP_WIFI_SSID, EXAMPLE_ESP_WIFI_PASS);
-    } else if (bits & WIFI_FAIL_BIT) {
-        ESP_LOGI(TAG, "Failed to connect to SSID:%s, password:%s",
-                 EXAMPLE_ESP_WIFI_SSID, EXAMPLE_ESP_WIFI_PASS);
-    } else {
-        ESP_LOGE(TAG, "UNEXPECTED EVENT");
+  x_WiFiConn_State.pinned = false;
+  if (esp_wifi_get_config(WIFI_IF_STA, &x_config) == ESP_OK)
+  {
+    x_config.sta.bssid_set = false;
+    x_config.sta.channel = 0;
+    (void)esp_wifi_set_config(WIFI_IF_STA, &x_config);
+  }
+}
+
+/**
+ * @brief   Roams to the strongest cached AP when the current one is below the
+ *          RSSI threshold and the other one is stronger by the hysteresis.
+ *          Deferred while held. The low RSSI event is armed again when the
+ *          station stays on its AP.
+ *
+ */
+static void WiFiConnRoamCheck(void)
+{
+  wifi_ap_record_t x_ap;
+  WIFICONN_AP_TYPE x_best;
+  bool b_roam = false;
+
+  if ((esp_wifi_sta_get_ap_info(&x_ap) != ESP_OK) || (x_ap.rssi >= WIFICONN_ROAM_RSSI))
+  {
+    (void)esp_wifi_set_rssi_threshold(WIFICONN_ROAM_RSSI);
+    return;
+  }
+  if ((WiFiConnBest(&x_best) == false) || (memcmp(x_best.bssid, x_ap.bssid, sizeof(x_ap.bssid)) == 0) ||
+      (x_best.rssi < (x_ap.rssi + WIFICONN_ROAM_HYSTERESIS_DB)))
+  {
+    (void)esp_wifi_set_rssi_threshold(WIFICONN_ROAM_RSSI);
+    return;
+  }
+
+  portENTER_CRITICAL(&x_WiFiConn_Mux);
+  if (x_WiFiConn_State.hold > 0)
+  {
+    x_WiFiConn_State.roam_pending = true;
+  }
+  else
+  {
+    x_WiFiConn_State.target = x_best;
+    x_WiFiConn_State.roaming = true;
+    x_WiFiConn_State.disconnect_us = esp_timer_get_time();
+    x_WiFiConn_State.stats.roams++;
+    b_roam = true;
+  }
+  portEXIT_CRITICAL(&x_WiFiConn_Mux);
+
+  if (b_roam == true)
+  {
+    Metrics__Counter_Add(METRICS_WIFI_ROAMS, 1);
+    ESP_LOGI(TAG, "roaming from " MACSTR " (%d dBm) to " MACSTR " (%d dBm)",
+             MAC2STR(x_ap.bssid), x_ap.rssi, MAC2STR(x_best.bssid), x_best.rssi);
+    // the connection to the target is started on the disconnection event
+    if (esp_wifi_disconnect() != ESP_OK)
+    {
+      x_WiFiConn_State.roaming = false;
+      b_roam = false;
+    }
+  }
+  if (b_roam == false)
+  {
+    // still on this AP (or roam deferred): the event was disarmed when raised
+    (void)esp_wifi_set_rssi_threshold(WIFICONN_ROAM_RSSI);
+  }
+}
+
+/**
+ * @brief   Records the time taken to connect and arms the low RSSI event,
+ *          which is disarmed each time it is raised.
+ *
+ */
+static void WiFiConnConnected(void)
+{
+  uint32_t u32_ms = 0;
+  uint32_t u32_roams;
+  bool b_timed = false;
+
+  portENTER_CRITICAL(&x_WiFiConn_Mux);
+  if (x_WiFiConn_State.disconnect_us != 0)
+  {
+    u32_ms = (uint32_t)((esp_timer_get_time() - x_WiFiConn_State.disconnect_us) / 1000);
+    x_WiFiConn_State.stats.reconnects++;
+    x_WiFiConn_State.stats.last_reconnect_ms = u32_ms;
+    x_WiFiConn_State.disconnect_us = 0;
+    b_timed = true;
+  }
+  u32_roams = x_WiFiConn_State.stats.roams;
+  portEXIT_CRITICAL(&x_WiFiConn_Mux);
+
+  if (b_timed == true)
+  {
+    Metrics__Histogram_Observe(METRICS_WIFI_RECONNECT_MS, u32_ms);
+    ESP_LOGI(TAG, "reconnected in %u ms, %u roams", u32_ms, u32_roams);
+  }
+  (void)esp_wifi_set_rssi_threshold(WIFICONN_ROAM_RSSI);
+}
+
+/**
+ * @brief   Scan period: refreshes the cache while connected (the results may
+ *          trigger a roam) and keeps looking for an AP once the retries are
+ *          over.
+ *
+ * @param   pv_arg    not used
+ */
+static void WiFiConnScanTimerCallback(void *pv_arg)
+{
+  if ((s_connected == true) || (s_retry_num >= EXAMPLE_ESP_MAXIMUM_RETRY))
+  {
+    WiFiConnScanStart();
+  }
+}
+
+/**
+ * @brief   Looks for a network in the list.
+ *
+ * @param   pc_ssid   network name
+ * @return  index in the list, WIFICONN_CREDENTIAL_NONE if not found
+ */
+static uint8_t WiFiConnFind(const char *pc_ssid)
+{
+  uint8_t u8_cred;
+
+  for (u8_cred = 0; u8_cred < (1 + WIFICONN_MAX_CREDENTIALS); ++u8_cred)
+  {
+    if ((px_WiFiConn_Credential[u8_cred].ssid[0] != '\0') &&
+        (strcmp(px_WiFiConn_Credential[u8_cred].ssid, pc_ssid) == 0))
+    {
+      return u8_cred;
+    }
+  }
+  return WIFICONN_CREDENTIAL_NONE;
+}
+
+/**
+ * @brief   Copies the stored networks to the settings buffer, called by the
+ *          settings task when the table is written.
+ *
+ * @param   pv_buffer       destination
+ * @param   u16_max_bytes   size of the destination
+ * @return  bytes written
+ */
+static uint16_t WiFiConnTableFill(void *pv_buffer, uint16_t u16_max_bytes)
+{
+  uint16_t u16_bytes = MIN(u16_max_bytes, sizeof(px_WiFiConn_Credential) - sizeof(px_WiFiConn_Credential[0]));
+
+  portENTER_CRITICAL(&x_WiFiConn_Mux);
+  memcpy(pv_buffer, &px_WiFiConn_Credential[1], u16_bytes);
+  portEXIT_CRITICAL(&x_WiFiConn_Mux);
+
+  return u16_bytes;
+}
+
+/**
+ * @brief   GET on the network command: networks (without the passwords),
+ *          cached APs, current AP and roaming statistics.
+ *
+ * @param   px_req    request
+ * @return  ESP_OK
+ */
+static esp_err_t WiFiConnHttpGetHandler(httpd_req_t *px_req)
+{
+  WIFICONN_STATE_TYPE x_state;
+  WIFICONN_STATS_TYPE x_stats;
+  char pc_line[96];
+  uint8_t u8_idx;
+
+  portENTER_CRITICAL(&x_WiFiConn_Mux);
+  x_state = x_WiFiConn_State;
+  portEXIT_CRITICAL(&x_WiFiConn_Mux);
+  WiFiConn__Get_Stats(&x_stats);
+
+  httpd_resp_set_type(px_req, "text/plain");
+  for (u8_idx = 0; u8_idx < (1 + WIFICONN_MAX_CREDENTIALS); ++u8_idx)
+  {
+    if (px_WiFiConn_Credential[u8_idx].ssid[0] != '\0')
+    {
+      snprintf(pc_line, sizeof(pc_line), "network %s%s\n", px_WiFiConn_Credential[u8_idx].ssid,
+               (u8_idx == 0) ? " (configured)" : "");
+      httpd_resp_send_chunk(px_req, pc_line, HTTPD_RESP_USE_STRLEN);
+    }
+  }
+  for (u8_idx = 0; u8_idx < x_state.ap_num; ++u8_idx)
+  {
+    snprintf(pc_line, sizeof(pc_line), "ap " MACSTR " channel %u %d dBm %s\n", MAC2STR(x_state.ap[u8_idx].bssid),
+             x_state.ap[u8_idx].channel, x_state.ap[u8_idx].rssi,
+             px_WiFiConn_Credential[x_state.ap[u8_idx].credential].ssid);
+    httpd_resp_send_chunk(px_req, pc_line, HTTPD_RESP_USE_STRLEN);
+  }
+  if (s_connected == true)
+  {
+    snprintf(pc_line, sizeof(pc_line), "connected " MACSTR " channel %u %d dBm\n", MAC2STR(x_stats.bssid),
+             x_stats.channel, x_stats.rssi);
+    httpd_resp_send_chunk(px_req, pc_line, HTTPD_RESP_USE_STRLEN);
+  }
+  snprintf(pc_line, sizeof(pc_line), "roams %u reconnects %u last %u ms hold %u\n", x_stats.roams,
+           x_stats.reconnects, x_stats.last_reconnect_ms, x_state.hold);
+  httpd_resp_send_chunk(px_req, pc_line, HTTPD_RESP_USE_STRLEN);
+
+  return httpd_resp_send_chunk(px_req, NULL, 0);
+}
+
+/**
+ * @brief   POST on the network command: "add <ssid> <password>" adds or
+ *          updates a stored network (no password for an open one),
+ *          "del <ssid>" removes it. SSIDs with spaces are not supported.
+ *
+ * @param   px_req    request
+ * @return  ESP_OK, ESP_FAIL on a bad request
+ */
+static esp_err_t WiFiConnHttpPostHandler(httpd_req_t *px_req)
+{
+  char pc_body[WIFICONN_HTTP_BODY_MAX + 1];
+  char *pc_ssid;
+  char *pc_password;
+  char *pc_save;
+  uint8_t u8_cred;
+  int i_len;
+
+  i_len = httpd_req_recv(px_req, pc_body, MIN(px_req->content_len, WIFICONN_HTTP_BODY_MAX));
+  if (i_len <= 0)
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "empty request");
+    return ESP_FAIL;
+  }
+  pc_body[i_len] = '\0';
+  pc_body[strcspn(pc_body, "\r\n")] = '\0';
+
+  if (strncmp(pc_body, "add ", 4) == 0)
+  {
+    pc_ssid = strtok_r(&pc_body[4], " ", &pc_save);
+    pc_password = strtok_r(NULL, " ", &pc_save);
+    if ((pc_ssid == NULL) || (strlen(pc_ssid) >= WIFICONN_SSID_BYTES) ||
+        ((pc_password != NULL) && (strlen(pc_password) >= WIFICONN_PASSWORD_BYTES)))
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "bad network");
+      return ESP_FAIL;
+    }
+    u8_cred = WiFiConnFind(pc_ssid);
+    if (u8_cred == 0)
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "configured network");
+      return ESP_FAIL;
+    }
+    if (u8_cred == WIFICONN_CREDENTIAL_NONE)
+    {
+      for (u8_cred = 1; (u8_cred < (1 + WIFICONN_MAX_CREDENTIALS)) &&
+                        (px_WiFiConn_Credential[u8_cred].ssid[0] != '\0'); ++u8_cred)
+      {
+      }
+      if (u8_cred == (1 + WIFICONN_MAX_CREDENTIALS))
+      {
+        httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "network list full");
+        return ESP_FAIL;
+      }
+    }
+    portENTER_CRITICAL(&x_WiFiConn_Mux);
+    memset(&px_WiFiConn_Credential[u8_cred], 0, sizeof(px_WiFiConn_Credential[u8_cred]));
+    memcpy(px_WiFiConn_Credential[u8_cred].ssid, pc_ssid, strlen(pc_ssid));
+    if (pc_password != NULL)
+    {
+      memcpy(px_WiFiConn_Credential[u8_cred].password, pc_password, strlen(pc_password));
+    }
+    portEXIT_CRITICAL(&x_WiFiConn_Mux);
+  }
+  else if (strncmp(pc_body, "del ", 4) == 0)
+  {
+    u8_cred = WiFiConnFind(&pc_body[4]);
+    if ((u8_cred == WIFICONN_CREDENTIAL_NONE) || (u8_cred == 0))
+    {
+      httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "unknown network");
+      return ESP_FAIL;
     }
+    // the cache refers to the list by index, it is rebuilt by the next scan
+    portENTER_CRITICAL(&x_WiFiConn_Mux);
+    memset(&px_WiFiConn_Credential[u8_cred], 0, sizeof(px_WiFiConn_Credential[u8_cred]));
+    x_WiFiConn_State.ap_num = 0;
+    portEXIT_CRITICAL(&x_WiFiConn_Mux);
+  }
+  else
+  {
+    httpd_resp_send_err(px_req, HTTPD_400_BAD_REQUEST, "unknown command");
+    return ESP_FAIL;
+  }
 
-    /* The event will not be processed after unregister */
-    ESP_ERROR_CHECK(esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, instance_got_ip));
-    ESP_ERROR_CHECK(esp_event_handler_instance_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, instance_any_id));
-    vEventGroupDelete(s_wifi_event_group);
+  Settings__Table_Changed(SETTINGS_TABLE_WIFI);
+  return httpd_resp_sendstr(px_req, "OK\n");
 }
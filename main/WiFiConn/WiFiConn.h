@@ -14,6 +14,7 @@
     #define WIFICONN_H
 
 //-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdbool.h>
 #include <WiFiConn_prm.h>
 
 
@@ -21,6 +22,11 @@
 //-------------------------------------- PUBLIC (Extern Variables, Constants & Defines) -------------------------------
 //=====================================================================================================================
 void WiFiConn__Initialize(void);
+int WiFiConn__Get_Retry_Num(void);
+bool WiFiConn__Is_Connected(void);
+void WiFiConn__Http_Initialize(void);
+void WiFiConn__Hold_Roaming(bool b_hold);
+void WiFiConn__Get_Stats(WIFICONN_STATS_TYPE *px_stats);
 
 //=====================================================================================================================
 //-------------------------------------- PUBLIC (Function Prototypes) -------------------------------------------------
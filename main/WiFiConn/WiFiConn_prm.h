@@ -14,9 +14,24 @@
     #define WIFICONN_PRM_H
 
 //-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
 
 //=====================================================================================================================
 //-------------------------------------- MODULE CONFIGURATION DEFINES AND TYPES ---------------------------------------
 //=====================================================================================================================
 
+// entry point of the network command: GET lists the networks, the cached APs and the connection,
+// POST "add <ssid> <password>" / "del <ssid>" changes the stored networks
+#define WIFICONN_URI                "/wifi"
+
+typedef struct
+{
+  uint32_t roams;                   // switches to a stronger AP
+  uint32_t reconnects;              // connections after a disconnection or a roam
+  uint32_t last_reconnect_ms;       // time from the disconnection (or the roam) to the IP address
+  int8_t rssi;                      // 0 if not connected
+  uint8_t channel;
+  uint8_t bssid[6];
+}WIFICONN_STATS_TYPE;
+
 #endif
@@ -14,6 +14,9 @@
     #define WIFICONN_PRV_H
 
 //-------------------------------------- Include Files ----------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <WiFiConn_prm.h>
 
 //=====================================================================================================================
 //-------------------------------------- PRIVATE (Variables, Constants & Defines) -------------------------------------
@@ -28,4 +31,62 @@
 #define EXAMPLE_ESP_WIFI_PASS      CONFIG_ESP_WIFI_PASSWORD
 #define EXAMPLE_ESP_MAXIMUM_RETRY  CONFIG_ESP_MAXIMUM_RETRY
 
+// networks stored in the settings, the configured one is always tried too
+#define WIFICONN_MAX_CREDENTIALS    CONFIG_WIFICONN_MAX_CREDENTIALS
+#define WIFICONN_SSID_BYTES         33
+#define WIFICONN_PASSWORD_BYTES     65
+
+#define WIFICONN_CREDENTIAL_NONE    0xFF
+
+typedef struct
+{
+  char ssid[WIFICONN_SSID_BYTES];
+  char password[WIFICONN_PASSWORD_BYTES];
+}WIFICONN_CREDENTIAL_TYPE;
+
+// background scan period while connected, the cache is also refreshed when the RSSI falls
+#define WIFICONN_SCAN_PERIOD_S      CONFIG_WIFICONN_SCAN_PERIOD_S
+
+// scan results older than this are not used to choose an AP
+#define WIFICONN_SCAN_MAX_AGE_US    ((int64_t)WIFICONN_SCAN_PERIOD_S * 2 * 1000000)
+
+// below this RSSI the station roams to an AP at least WIFICONN_ROAM_HYSTERESIS_DB stronger
+#define WIFICONN_ROAM_RSSI          CONFIG_WIFICONN_ROAM_RSSI
+#define WIFICONN_ROAM_HYSTERESIS_DB CONFIG_WIFICONN_ROAM_HYSTERESIS_DB
+
+// records read from a scan, and APs of the known networks kept from it
+#define WIFICONN_SCAN_RECORDS       20
+#define WIFICONN_AP_CACHE_SIZE      8
+
+typedef struct
+{
+  uint8_t bssid[6];
+  uint8_t channel;
+  int8_t rssi;
+  uint8_t credential;               // index in the network list
+}WIFICONN_AP_TYPE;
+
+/*
+ * Connection state, written by the event handler, the scan timer and the
+ * callers of WiFiConn__Hold_Roaming()
+ */
+typedef struct
+{
+  WIFICONN_AP_TYPE ap[WIFICONN_AP_CACHE_SIZE];
+  uint8_t ap_num;
+  int64_t scan_us;                  // time of the cached results
+  bool scanning;
+  bool roam_pending;                // roam deferred by a hold
+  uint8_t hold;
+  bool roaming;                     // disconnection requested to roam
+  bool pinned;                      // BSSID set in the station configuration
+  WIFICONN_AP_TYPE target;          // AP of the next connection
+  uint8_t credential;               // network in use
+  int64_t disconnect_us;            // 0 while connected
+  WIFICONN_STATS_TYPE stats;
+}WIFICONN_STATE_TYPE;
+
+// longest body of the network command
+#define WIFICONN_HTTP_BODY_MAX      (4 + WIFICONN_SSID_BYTES + WIFICONN_PASSWORD_BYTES)
+
 #endif
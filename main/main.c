@@ -16,8 +16,107 @@
 
 #include "WiFiConn.h"
 #include "Holtek.h"
+#include "SpiBus.h"
+#include "SysMon.h"
+#include "Metrics.h"
+#include "Remote.h"
+#include "HttpSrv.h"
+#include "Ota.h"
+#include "Settings.h"
+#include "BootSeq.h"
+#include "TimeZone.h"
+#include "Alarm.h"
+#include "Keys.h"
+#include "Standby.h"
+#include "ClockFace.h"
+#include "FrameLog.h"
+#include "TimeSync.h"
+#include "BinLog.h"
+#include "TestPattern.h"
+#include "Notify.h"
+#include "FlightRec.h"
+#include "Scene.h"
+#include "TickSync.h"
+
+static void NvsInitialize(void);
+
+/*
+ * Init steps, in table order: a step starts as soon as the steps it depends on
+ * are completed, so the display comes up while NVS is read and Wi-Fi associates.
+ */
+enum
+{
+    BOOT_SPI_BUS = 0,
+    BOOT_DISPLAY,
+    BOOT_NVS,
+    BOOT_SETTINGS,
+    BOOT_DISPLAY_SETTINGS,
+    BOOT_NETWORK,
+    BOOT_HTTP,
+    BOOT_NETWORK_COMMANDS,
+    BOOT_METRICS,
+    BOOT_REMOTE,
+    BOOT_OTA,
+    BOOT_TIME_ZONE,
+    BOOT_ALARM,
+    BOOT_KEYS,
+    BOOT_STANDBY,
+    BOOT_CLOCK_FACE,
+    BOOT_FRAME_LOG,
+    BOOT_TIME_SYNC,
+    BOOT_BIN_LOG,
+    BOOT_TEST_PATTERN,
+    BOOT_NOTIFY,
+    BOOT_FLIGHT_REC,
+    BOOT_SCENE,
+    BOOT_TICK_SYNC,
+    NUM_OF_BOOT_STEPS
+};
+
+// one event group bit per step: a new step needs two existing ones merged
+_Static_assert(NUM_OF_BOOT_STEPS <= BOOTSEQ_MAX_STEPS, "main: too many boot steps for BootSeq");
+
+static const BOOTSEQ_STEP_TYPE px_Boot_Steps[NUM_OF_BOOT_STEPS] =
+{
+    [BOOT_SPI_BUS]          = {"spi bus",          SpiBus__Initialize,        0},
+    [BOOT_DISPLAY]          = {"display",          Holtek__Initialize,        BOOTSEQ_DEP(BOOT_SPI_BUS)},
+    [BOOT_NVS]              = {"nvs",              NvsInitialize,             0},
+    [BOOT_SETTINGS]         = {"settings",         Settings__Initialize,      BOOTSEQ_DEP(BOOT_NVS)},
+    [BOOT_DISPLAY_SETTINGS] = {"display settings", Holtek__Apply_Settings,    BOOTSEQ_DEP(BOOT_DISPLAY) | BOOTSEQ_DEP(BOOT_SETTINGS)},
+    [BOOT_NETWORK]          = {"network",          WiFiConn__Initialize,      BOOTSEQ_DEP(BOOT_NVS) | BOOTSEQ_DEP(BOOT_SETTINGS)},
+    [BOOT_HTTP]             = {"http server",      HttpSrv__Initialize,       BOOTSEQ_DEP(BOOT_NETWORK)},
+    [BOOT_NETWORK_COMMANDS] = {"network commands", WiFiConn__Http_Initialize, BOOTSEQ_DEP(BOOT_HTTP)},
+    [BOOT_METRICS]          = {"metrics",          Metrics__Initialize,       BOOTSEQ_DEP(BOOT_HTTP)},
+    [BOOT_REMOTE]           = {"remote",           Remote__Initialize,        BOOTSEQ_DEP(BOOT_NETWORK) | BOOTSEQ_DEP(BOOT_DISPLAY)},
+    [BOOT_OTA]              = {"ota",              Ota__Initialize,           BOOTSEQ_DEP(BOOT_HTTP) | BOOTSEQ_DEP(BOOT_DISPLAY)},
+    [BOOT_TIME_ZONE]        = {"time zone",        TimeZone__Initialize,      BOOTSEQ_DEP(BOOT_SETTINGS) | BOOTSEQ_DEP(BOOT_HTTP)},
+    [BOOT_ALARM]            = {"alarm",            Alarm__Initialize,         BOOTSEQ_DEP(BOOT_SETTINGS) | BOOTSEQ_DEP(BOOT_TIME_ZONE) | BOOTSEQ_DEP(BOOT_HTTP)},
+    [BOOT_KEYS]             = {"keys",             Keys__Initialize,          BOOTSEQ_DEP(BOOT_DISPLAY) | BOOTSEQ_DEP(BOOT_HTTP)},
+    [BOOT_STANDBY]          = {"standby",          Standby__Initialize,       BOOTSEQ_DEP(BOOT_DISPLAY) | BOOTSEQ_DEP(BOOT_HTTP) | BOOTSEQ_DEP(BOOT_ALARM) | BOOTSEQ_DEP(BOOT_KEYS)},
+    [BOOT_CLOCK_FACE]       = {"clock face",       ClockFace__Initialize,     BOOTSEQ_DEP(BOOT_DISPLAY) | BOOTSEQ_DEP(BOOT_HTTP) | BOOTSEQ_DEP(BOOT_TIME_ZONE)},
+    [BOOT_FRAME_LOG]        = {"frame log",        FrameLog__Initialize,      BOOTSEQ_DEP(BOOT_HTTP)},
+    [BOOT_TIME_SYNC]        = {"time sync",        TimeSync__Initialize,      BOOTSEQ_DEP(BOOT_HTTP) | BOOTSEQ_DEP(BOOT_ALARM) | BOOTSEQ_DEP(BOOT_CLOCK_FACE)},
+    [BOOT_BIN_LOG]          = {"bin log",          BinLog__Initialize,        BOOTSEQ_DEP(BOOT_HTTP)},
+    [BOOT_TEST_PATTERN]     = {"test pattern",     TestPattern__Initialize,   BOOTSEQ_DEP(BOOT_DISPLAY) | BOOTSEQ_DEP(BOOT_HTTP) | BOOTSEQ_DEP(BOOT_KEYS)},
+    [BOOT_NOTIFY]           = {"notify",           Notify__Initialize,        BOOTSEQ_DEP(BOOT_DISPLAY) | BOOTSEQ_DEP(BOOT_HTTP) | BOOTSEQ_DEP(BOOT_ALARM)},
+    [BOOT_FLIGHT_REC]       = {"flight rec",       FlightRec__Start,          BOOTSEQ_DEP(BOOT_DISPLAY) | BOOTSEQ_DEP(BOOT_HTTP)},
+    [BOOT_SCENE]            = {"scene",            Scene__Initialize,         BOOTSEQ_DEP(BOOT_DISPLAY) | BOOTSEQ_DEP(BOOT_HTTP) | BOOTSEQ_DEP(BOOT_SETTINGS) | BOOTSEQ_DEP(BOOT_TIME_ZONE)},
+    [BOOT_TICK_SYNC]        = {"tick sync",        TickSync__Initialize,      BOOTSEQ_DEP(BOOT_NETWORK) | BOOTSEQ_DEP(BOOT_HTTP) | BOOTSEQ_DEP(BOOT_SETTINGS) | BOOTSEQ_DEP(BOOT_STANDBY) | BOOTSEQ_DEP(BOOT_CLOCK_FACE)},
+};
 
 void app_main(void)
+{
+    SysMon__Initialize();
+    // before any event is recorded, the ring still holds the previous boots
+    FlightRec__Initialize();
+
+    BootSeq__Run(px_Boot_Steps, NUM_OF_BOOT_STEPS);
+
+    // from here on the heap usage is reported as "used after boot"
+    SysMon__Boot_Completed();
+}
+
+static void NvsInitialize(void)
 {
     //Initialize NVS
     esp_err_t ret = nvs_flash_init();
@@ -26,7 +125,4 @@ void app_main(void)
       ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
-
-    Holtek__Initialize();
-    WiFiConn__Initialize();
 }
@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""Decode the binary event log downloaded on /binlog.
+
+    curl -o events.bin http://192.168.1.50/binlog
+    binlog_decode.py events.bin
+    binlog_decode.py events.bin --since 600 --event HOLTEK_SPI_FAULT
+
+The events and their formats are read from the firmware sources
+(main/BinLog/BinLog_prm.h and BinLog_prv.h), so the decoder must come from
+the same revision as the firmware. The log format is described in
+main/BinLog/BinLog_prv.h.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+MAGIC = 0x31474C42
+VERSION = 1
+HEADER = struct.Struct("<IHHIIq")
+RECORD = struct.Struct("<IHBBII")
+
+LEVELS = {"ESP_LOG_ERROR": "E", "ESP_LOG_WARN": "W", "ESP_LOG_INFO": "I",
+          "ESP_LOG_DEBUG": "D", "ESP_LOG_VERBOSE": "V"}
+
+SOURCES = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "main", "BinLog")
+
+
+def load_events(sources):
+    with open(os.path.join(sources, "BinLog_prm.h")) as f:
+        prm = f.read()
+    with open(os.path.join(sources, "BinLog_prv.h")) as f:
+        prv = f.read()
+
+    body = prm[prm.index("typedef enum"):prm.index("NUM_OF_BINLOG_EVENTS")]
+    names = re.findall(r"^\s*BINLOG_(\w+)", body, re.M)
+    desc = {}
+    for name, level, tag, fmt in re.findall(
+            r'\[BINLOG_(\w+)\]\s*=\s*\{(ESP_LOG_\w+),\s*"([^"]*)",\s*"([^"]*)"', prv):
+        desc[name] = (LEVELS.get(level, "?"), tag, fmt)
+    return [(name,) + desc.get(name, ("?", "?", "%u %u")) for name in names]
+
+
+def format_args(fmt, a, b):
+    # the arguments are 32 bits, %d ones are signed
+    args = []
+    for value, spec in zip((a, b), re.findall(r"%[-0-9.]*([udxX])", fmt)):
+        args.append(value - (1 << 32) if spec == "d" and value & 0x80000000 else value)
+    return fmt % tuple(args)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log")
+    parser.add_argument("--sources", default=SOURCES, help="directory of BinLog_prm.h and BinLog_prv.h")
+    parser.add_argument("--since", type=float, help="only the records of the last SINCE seconds")
+    parser.add_argument("--event", action="append", help="only these events (name without BINLOG_)")
+    args = parser.parse_args()
+
+    events = load_events(args.sources)
+    with open(args.log, "rb") as f:
+        data = f.read()
+
+    magic, version, num_events, records, lost, now_us = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        sys.exit("not a binary log")
+    if version != VERSION:
+        sys.exit("unknown version %d" % version)
+    if num_events != len(events):
+        print("warning: %d events in the log, %d in the sources" % (num_events, len(events)), file=sys.stderr)
+
+    pos = HEADER.size
+    suppressed = struct.unpack_from("<%dI" % num_events, data, pos)
+    pos += 4 * num_events
+
+    for _ in range(records):
+        if pos + RECORD.size > len(data):
+            print("truncated download", file=sys.stderr)
+            break
+        time_lo, time_hi, event, skipped, a, b = RECORD.unpack_from(data, pos)
+        pos += RECORD.size
+        t_us = time_hi << 32 | time_lo
+        if args.since is not None and now_us - t_us > args.since * 1e6:
+            continue
+        name, level, tag, fmt = events[event] if event < len(events) else ("#%d" % event, "?", "?", "%u %u")
+        if args.event and name not in args.event:
+            continue
+        note = ""
+        if skipped:
+            note = " (%s suppressed)" % ("255+" if skipped == 255 else skipped)
+        print("%c (%.3f s, -%.3f s) %s: %s%s" %
+              (level, t_us / 1e6, (now_us - t_us) / 1e6, tag, format_args(fmt, a, b), note))
+
+    print("\n%d records, %d lost before being formatted, uptime %.3f s" % (records, lost, now_us / 1e6))
+    for (name, _, _, _), count in zip(events, suppressed):
+        if count:
+            print("%-24s %d suppressed since boot" % (name, count))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
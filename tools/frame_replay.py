@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+"""Decode, replay and compare the display frame logs captured on /framelog.
+
+Examples:
+    curl -d start http://192.168.1.50/framelog
+    curl -o capture.bin http://192.168.1.50/framelog
+    esptool.py read_flash 0x1F0000 0x10000 capture.bin      (flash mode, also after a reset)
+
+    frame_replay.py stats capture.bin
+    frame_replay.py show capture.bin --session 3 --realtime --speed 2
+    frame_replay.py diff old_driver.bin new_driver.bin
+
+The log format is described in main/FrameLog/FrameLog_prv.h. Frames are the
+Holtek RAM image: byte i is segment i (SEG_A1 = 0 .. SEG_N = 15), bit 2 + d
+is digit d (LEFT_2 .. RIGHT_2), byte 1 bit 7 is the dot of LEFT_1 / WIFI.
+"""
+
+import argparse
+import statistics
+import struct
+import sys
+import time
+
+MAGIC = 0x31474C46
+VERSION = 1
+BLOCK_BYTES = 4096
+HEADER = struct.Struct("<IIHBBq")
+
+TAG_TYPE_MASK = 0xC0
+TAG_FLIPS = 0x00
+TAG_KEY = 0x40
+TAG_LOST = 0x80
+TAG_END = 0xFF
+
+NUM_OF_DIGITS = 5
+
+SEG_A1, SEG_A2, SEG_B, SEG_C, SEG_D1, SEG_D2, SEG_E, SEG_F = range(8)
+SEG_G1, SEG_G2, SEG_H, SEG_J, SEG_K, SEG_L, SEG_M, SEG_N = range(8, 16)
+
+
+class Frame:
+    def __init__(self, session, seq, t_us, ram, lost):
+        self.session = session
+        self.seq = seq
+        self.t_us = t_us
+        self.ram = ram
+        self.lost = lost
+
+
+def varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return value, pos
+        shift += 7
+
+
+def decode_block(block):
+    magic, seq, session, version, frame_bytes, start_us = HEADER.unpack_from(block)
+    if magic != MAGIC:
+        return None
+    if version != VERSION:
+        raise ValueError("block %d: unknown version %d" % (seq, version))
+
+    frames = []
+    ram = None
+    t_us = start_us
+    lost = 0
+    pos = HEADER.size
+    try:
+        while pos < len(block) and block[pos] != TAG_END:
+            tag = block[pos]
+            pos += 1
+            value, pos = varint(block, pos)
+            kind = tag & TAG_TYPE_MASK
+            if kind == TAG_LOST:
+                lost += value
+                continue
+            t_us += value
+            if kind == TAG_KEY:
+                ram = bytearray(block[pos:pos + frame_bytes])
+                pos += frame_bytes
+            elif kind == TAG_FLIPS and ram is not None:
+                ram = bytearray(ram)
+                for flip in block[pos:pos + (tag & ~TAG_TYPE_MASK)]:
+                    ram[flip >> 3] ^= 1 << (flip & 7)
+                pos += tag & ~TAG_TYPE_MASK
+            else:
+                raise ValueError("block %d: bad tag 0x%02x at %d" % (seq, tag, pos - 1))
+            frames.append(Frame(session, seq, t_us, bytes(ram), lost))
+            lost = 0
+    except IndexError:
+        # records never cross the end of a block
+        print("block %d: truncated record" % seq, file=sys.stderr)
+    return seq, session, frames
+
+
+def load(path, session=None):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    blocks = []
+    for offset in range(0, len(data) - HEADER.size + 1, BLOCK_BYTES):
+        decoded = decode_block(data[offset:offset + BLOCK_BYTES])
+        if decoded is not None:
+            blocks.append(decoded)
+    blocks.sort(key=lambda b: b[0])
+
+    if session is None and blocks:
+        session = blocks[-1][1]
+    frames = []
+    for _, block_session, block_frames in blocks:
+        if block_session == session:
+            frames.extend(block_frames)
+    return session, frames
+
+
+def digit_mask(ram, digit):
+    return sum(1 << seg for seg in range(16) if ram[seg] & (1 << (digit + 2)))
+
+
+def render(ram):
+    rows = [""] * 5
+    for digit in range(NUM_OF_DIGITS):
+        m = digit_mask(ram, digit)
+
+        def on(seg, ch):
+            return ch if m & (1 << seg) else " "
+
+        dp = "." if digit == 1 and ram[1] & 0x80 else " "
+        rows[0] += " " + on(SEG_A1, "--") + " " + on(SEG_A2, "--") + "   "
+        rows[1] += on(SEG_F, "|") + on(SEG_H, "\\") + " " + on(SEG_J, "|") + " " + on(SEG_K, "/") + on(SEG_B, "|") + "  "
+        rows[2] += " " + on(SEG_G1, "--") + " " + on(SEG_G2, "--") + "   "
+        rows[3] += on(SEG_E, "|") + on(SEG_N, "/") + " " + on(SEG_M, "|") + " " + on(SEG_L, "\\") + on(SEG_C, "|") + "  "
+        rows[4] += " " + on(SEG_D1, "--") + " " + on(SEG_D2, "--") + dp + "  "
+    return "\n".join(rows)
+
+
+def intervals(frames):
+    return [b.t_us - a.t_us for a, b in zip(frames, frames[1:])]
+
+
+def cmd_stats(args):
+    session, frames = load(args.log, args.session)
+    if not frames:
+        print("no frames")
+        return 1
+    gaps = intervals(frames)
+    lost = sum(f.lost for f in frames)
+    blocks = len({f.seq for f in frames})
+    print("session %d: %d frames in %d blocks, %.3f s, %d lost" %
+          (session, len(frames), blocks, (frames[-1].t_us - frames[0].t_us) / 1e6, lost))
+    if gaps:
+        print("interval between changes: min %d us, median %d us, max %d us" %
+              (min(gaps), statistics.median(gaps), max(gaps)))
+    return 0
+
+
+def cmd_show(args):
+    session, frames = load(args.log, args.session)
+    start_us = frames[0].t_us if frames else 0
+    wall = time.monotonic()
+    for frame in frames:
+        if args.realtime:
+            delay = (frame.t_us - start_us) / 1e6 / args.speed - (time.monotonic() - wall)
+            if delay > 0:
+                time.sleep(delay)
+            sys.stdout.write("\x1b[H\x1b[J")
+        note = "  (%d lost before)" % frame.lost if frame.lost else ""
+        print("%10.6f s  block %d  %s%s" % ((frame.t_us - start_us) / 1e6, frame.seq, frame.ram.hex(), note))
+        print(render(frame.ram))
+    return 0
+
+
+def cmd_diff(args):
+    _, a = load(args.a, args.session_a)
+    _, b = load(args.b, args.session_b)
+    same = 0
+    for fa, fb in zip(a, b):
+        if fa.ram != fb.ram:
+            break
+        same += 1
+
+    print("%d / %d frames, %d identical from the start" % (len(a), len(b), same))
+    if same < max(len(a), len(b)):
+        print("first difference at frame %d:" % same)
+        for name, frames in (("a", a), ("b", b)):
+            if same < len(frames):
+                print("%s %10.6f s %s" % (name, (frames[same].t_us - frames[0].t_us) / 1e6, frames[same].ram.hex()))
+                print(render(frames[same].ram))
+
+    ga = intervals(a[:same])
+    gb = intervals(b[:same])
+    if ga:
+        deltas = [abs(x - y) for x, y in zip(ga, gb)]
+        print("interval between changes, identical part: a median %d us, b median %d us, "
+              "difference mean %d us, max %d us" %
+              (statistics.median(ga), statistics.median(gb), statistics.mean(deltas), max(deltas)))
+    return 0 if same == len(a) == len(b) else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("stats", help="frames, time span and intervals of a capture")
+    p.add_argument("log")
+    p.add_argument("--session", type=int, help="capture session, default the last one")
+    p.set_defaults(fn=cmd_stats)
+
+    p = sub.add_parser("show", help="print the frames with their time, rendered as segments")
+    p.add_argument("log")
+    p.add_argument("--session", type=int, help="capture session, default the last one")
+    p.add_argument("--realtime", action="store_true", help="replay with the captured timing")
+    p.add_argument("--speed", type=float, default=1.0, help="replay speed factor")
+    p.set_defaults(fn=cmd_show)
+
+    p = sub.add_parser("diff", help="compare the frames and timing of two captures")
+    p.add_argument("a")
+    p.add_argument("b")
+    p.add_argument("--session-a", type=int)
+    p.add_argument("--session-b", type=int)
+    p.set_defaults(fn=cmd_diff)
+
+    args = parser.parse_args()
+    sys.exit(args.fn(args))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Generate the time zone transition table of the clock from the host tz database.
+
+Examples:
+    gen_tz_table.py
+    gen_tz_table.py --first-year 2024 --last-year 2070 Europe/Rome Europe/London UTC
+
+The table lists, for each zone, the UTC offset in use before the first year
+and every offset change up to the end of the last year. The device converts
+UTC to local time with the cached offset of the current interval, see
+main/TimeZone/TimeZone.c. Run again when the zone list changes or when the
+tz database brings new rules, and commit the result.
+"""
+
+import argparse
+import datetime
+import os
+from zoneinfo import ZoneInfo
+
+DEFAULT_ZONES = [
+    "UTC",
+    "Europe/Lisbon",
+    "Europe/London",
+    "Europe/Rome",
+    "Europe/Paris",
+    "Europe/Berlin",
+    "Europe/Madrid",
+    "Europe/Warsaw",
+    "Europe/Athens",
+    "Europe/Istanbul",
+    "Europe/Moscow",
+    "America/New_York",
+    "America/Chicago",
+    "America/Denver",
+    "America/Los_Angeles",
+    "Asia/Kolkata",
+    "Asia/Shanghai",
+    "Asia/Tokyo",
+    "Australia/Sydney",
+]
+
+DEFAULT_OUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "main", "TimeZone", "TimeZone_tbl.h")
+
+UTC = datetime.timezone.utc
+
+
+def offset_min(zone, ts):
+    off = datetime.datetime.fromtimestamp(ts, UTC).astimezone(zone).utcoffset()
+    minutes, rest = divmod(int(off.total_seconds()), 60)
+    if rest:
+        raise ValueError("%s: offset not in whole minutes" % zone.key)
+    return minutes
+
+
+def transitions(zone, first_ts, last_ts):
+    """Offset changes in [first_ts, last_ts): daily scan, then bisection to the second."""
+    initial = offset_min(zone, first_ts)
+    out = []
+    prev = initial
+    ts = first_ts
+    while ts < last_ts:
+        nxt = min(ts + 86400, last_ts)
+        cur = offset_min(zone, nxt)
+        if cur != prev:
+            lo, hi = ts, nxt
+            while hi - lo > 1:
+                mid = (lo + hi) // 2
+                if offset_min(zone, mid) == prev:
+                    lo = mid
+                else:
+                    hi = mid
+            out.append((hi, cur))
+            prev = cur
+        ts = nxt
+    return initial, out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("zones", nargs="*", default=DEFAULT_ZONES, help="IANA zone names")
+    parser.add_argument("--first-year", type=int, default=2022)
+    parser.add_argument("--last-year", type=int, default=2060)
+    parser.add_argument("--out", default=DEFAULT_OUT)
+    args = parser.parse_args()
+
+    first_ts = int(datetime.datetime(args.first_year, 1, 1, tzinfo=UTC).timestamp())
+    last_ts = int(datetime.datetime(args.last_year + 1, 1, 1, tzinfo=UTC).timestamp())
+    if last_ts >= 2 ** 32:
+        raise SystemExit("last year beyond the 32-bit UTC seconds of the table")
+
+    utc_rows = []
+    off_rows = []
+    zone_rows = []
+    shared = {}
+    for name in args.zones:
+        initial, trs = transitions(ZoneInfo(name), first_ts, last_ts)
+        # zones following the same rules (i.e. the EU ones) share their transitions
+        key = tuple(trs)
+        if key not in shared:
+            shared[key] = len(utc_rows)
+            for ts, off in trs:
+                utc_rows.append("%du" % ts)
+                off_rows.append("%d" % off)
+        zone_rows.append('  {"%s", %d, %d, %d},' % (name, initial, shared[key], len(trs)))
+
+    def wrap(values, per_line):
+        lines = []
+        for i in range(0, len(values), per_line):
+            lines.append("  " + ", ".join(values[i:i + per_line]) + ",")
+        return "\n".join(lines) if lines else "  0,"
+
+    text = """
+/**
+ *  @file       TimeZone_tbl.h
+ *
+ *  @brief      Time zone transition table, generated by tools/gen_tz_table.py: do not edit.
+ *
+ *
+ *  @copyright  Copyright 2022.
+ *              Haier Europe. All rights reserved - CONFIDENTIAL
+ */
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+#ifndef TIMEZONE_TBL_H
+    #define TIMEZONE_TBL_H
+
+#define TIMEZONE_TABLE_FIRST_YEAR   %(first)d
+#define TIMEZONE_TABLE_LAST_YEAR    %(last)d
+#define NUM_OF_TIMEZONES            %(zones_num)d
+
+// UTC time of each transition, zones one after the other
+static const uint32_t TIMEZONE_Transition_Utc[] =
+{
+%(utc)s
+};
+
+// UTC offset in minutes from each transition on
+static const int16_t TIMEZONE_Transition_Offset_Min[] =
+{
+%(off)s
+};
+
+static const TIMEZONE_ZONE_TYPE TIMEZONE_Zones[NUM_OF_TIMEZONES] =
+{
+%(zones)s
+};
+
+#endif
+""" % {
+        "first": args.first_year,
+        "last": args.last_year,
+        "zones_num": len(zone_rows),
+        "utc": wrap(utc_rows, 6),
+        "off": wrap(off_rows, 12),
+        "zones": "\n".join(zone_rows),
+    }
+
+    with open(args.out, "w", newline="\n") as f:
+        f.write(text)
+    print("%d zones, %d transitions, %d bytes" % (len(zone_rows), len(utc_rows), len(utc_rows) * 6))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Local NTP server for testing the time sync of the clock.
+
+It answers the NTP client requests with the time of this host, moved by a
+fixed offset and a drift, and can add a delay (symmetric or not) and a random
+jitter to each reply, so that the filter, the slewing and the drift estimate
+can be checked against known values:
+
+    ntp_standin.py --port 1123 --offset-ms 120 --drift-ppm 15 --jitter-ms 5
+    curl -d "servers 192.168.1.10:1123" http://192.168.1.50/timesync
+    curl http://192.168.1.50/timesync
+
+A reported offset of about +120 ms (then near 0 once slewed) and a drift
+converging to +15000 ppb are expected. Several instances on different ports
+emulate several servers, i.e. one with a large delay to see it filtered out.
+"""
+
+import argparse
+import random
+import socket
+import struct
+import threading
+import time
+
+NTP_UNIX_OFFSET_S = 2208988800
+PACKET = struct.Struct("!BBbbII4sQQQQ")
+
+
+def to_ntp(t):
+    seconds = int(t)
+    fraction = int((t - seconds) * (1 << 32))
+    return ((seconds + NTP_UNIX_OFFSET_S) & 0xFFFFFFFF) << 32 | fraction
+
+
+class Clock:
+    def __init__(self, offset_ms, drift_ppm):
+        self.start = time.time()
+        self.offset = offset_ms / 1000.0
+        self.drift = drift_ppm / 1e6
+
+    def now(self):
+        t = time.time()
+        return t + self.offset + (t - self.start) * self.drift
+
+
+def reply(sock, clock, args, request, addr):
+    version = (request[0] >> 3) & 0x07
+    transmit = request[40:48]
+    # the delay is split between the request path and the reply path
+    time.sleep(max(0.0, random.gauss(args.delay_ms, args.jitter_ms) * args.asymmetry) / 1000.0)
+    wall = time.time()
+    t_receive = clock.now()
+    t_transmit = clock.now()
+    time.sleep(max(0.0, random.gauss(args.delay_ms, args.jitter_ms) * (1 - args.asymmetry)) / 1000.0)
+    leap = 3 if args.unsynced else 0
+    packet = PACKET.pack((leap << 6) | (version << 3) | 4, args.stratum, 6, -20, 0, 0, b"LOCL",
+                         to_ntp(t_transmit), 0, to_ntp(t_receive), to_ntp(t_transmit))
+    # the origin timestamp is the transmit timestamp of the request, as sent
+    packet = packet[:24] + transmit + packet[32:]
+    sock.sendto(packet, addr)
+    print("%s:%d  offset %+.3f ms" % (addr[0], addr[1], (t_transmit - wall) * 1000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--bind", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=123)
+    parser.add_argument("--offset-ms", type=float, default=0.0, help="offset of the served time")
+    parser.add_argument("--drift-ppm", type=float, default=0.0, help="drift of the served time")
+    parser.add_argument("--delay-ms", type=float, default=0.0, help="mean round trip delay added")
+    parser.add_argument("--jitter-ms", type=float, default=0.0, help="standard deviation of the delay")
+    parser.add_argument("--asymmetry", type=float, default=0.5,
+                        help="share of the delay before the transmit timestamp (0.5: symmetric)")
+    parser.add_argument("--stratum", type=int, default=2, help="0 sends kiss of death packets")
+    parser.add_argument("--unsynced", action="store_true", help="reply with the leap bits of an unsynced server")
+    parser.add_argument("--drop", type=float, default=0.0, help="share of requests not answered")
+    args = parser.parse_args()
+
+    clock = Clock(args.offset_ms, args.drift_ppm)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    print("serving on %s:%d" % (args.bind, args.port))
+    while True:
+        request, addr = sock.recvfrom(512)
+        if len(request) < 48 or (request[0] & 0x07) != 3 or random.random() < args.drop:
+            continue
+        threading.Thread(target=reply, args=(sock, clock, args, request, addr), daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()
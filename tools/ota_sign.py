@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Sign application images and push them to the clock over HTTP.
+
+Examples:
+    ota_sign.py keygen ota_key.pem
+    ota_sign.py sign ota_key.pem build/wifi_station.bin
+    ota_sign.py push 192.168.1.50 build/wifi_station.bin --key ota_key.pem
+
+keygen writes a new P-256 private key and prints the public key to be set in
+CONFIG_APP_OTA_PUBLIC_KEY. The upload format is described in main/Ota/Ota_prv.h.
+Requires the "cryptography" package.
+"""
+
+import argparse
+import hashlib
+import sys
+import urllib.error
+import urllib.request
+
+from cryptography.hazmat.primitives import hashes, serialization
+from cryptography.hazmat.primitives.asymmetric import ec
+
+
+def load_key(path):
+    with open(path, "rb") as f:
+        return serialization.load_pem_private_key(f.read(), password=None)
+
+
+def public_key_hex(key):
+    return key.public_key().public_bytes(serialization.Encoding.X962,
+                                         serialization.PublicFormat.UncompressedPoint).hex()
+
+
+def sign(key, image):
+    # the clock verifies the DER signature against the SHA-256 of the image
+    return key.sign(image, ec.ECDSA(hashes.SHA256()))
+
+
+def cmd_keygen(args):
+    key = ec.generate_private_key(ec.SECP256R1())
+    with open(args.key, "wb") as f:
+        f.write(key.private_bytes(serialization.Encoding.PEM, serialization.PrivateFormat.PKCS8,
+                                  serialization.NoEncryption()))
+    print(public_key_hex(key))
+
+
+def cmd_sign(args):
+    image = open(args.image, "rb").read()
+    print("X-Image-Sha256:", hashlib.sha256(image).hexdigest())
+    print("X-Image-Signature:", sign(load_key(args.key), image).hex())
+
+
+def cmd_push(args):
+    image = open(args.image, "rb").read()
+    headers = {
+        "Content-Type": "application/octet-stream",
+        "X-Image-Sha256": hashlib.sha256(image).hexdigest(),
+    }
+    if args.key:
+        headers["X-Image-Signature"] = sign(load_key(args.key), image).hex()
+
+    url = "http://%s:%d/ota" % (args.host, args.port)
+    request = urllib.request.Request(url, data=image, headers=headers, method="POST")
+    try:
+        with urllib.request.urlopen(request, timeout=args.timeout) as response:
+            print(response.status, response.read().decode(errors="replace").strip())
+    except urllib.error.HTTPError as e:
+        print(e.code, e.read().decode(errors="replace").strip())
+        sys.exit(1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("keygen", help="create a signing key, print its public key")
+    p.add_argument("key", help="private key file to create (PEM)")
+    p.set_defaults(func=cmd_keygen)
+
+    p = sub.add_parser("sign", help="print the upload headers of an image")
+    p.add_argument("key", help="private key (PEM)")
+    p.add_argument("image", help="application image")
+    p.set_defaults(func=cmd_sign)
+
+    p = sub.add_parser("push", help="upload an image to a clock")
+    p.add_argument("host", help="clock address")
+    p.add_argument("image", help="application image")
+    p.add_argument("--key", help="private key (PEM), required unless the clock accepts unsigned images")
+    p.add_argument("--port", type=int, default=80)
+    p.add_argument("--timeout", type=float, default=120.0)
+    p.set_defaults(func=cmd_push)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
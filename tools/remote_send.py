@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""Push display frames to one or more clocks over the remote display protocol.
+
+Examples:
+    remote_send.py 192.168.1.50 --text "12.34"
+    remote_send.py 192.168.1.50 192.168.1.51 --clear --text " OK" --icons 1 --blink 500 500 --blink-digits 0x1f
+    remote_send.py 192.168.1.50 --segments 0 0x00ff 0xff00
+    remote_send.py 192.168.1.50 --release
+    remote_send.py 192.168.1.50 --text "00000" --count 1000 --interval 0.01 --counter
+
+The wire format is described in main/Remote/Remote_prv.h.
+"""
+
+import argparse
+import socket
+import struct
+import time
+
+MAGIC = b"CK"
+VERSION = 1
+
+FLAG_RESYNC = 0x01
+FLAG_RELEASE = 0x02
+
+TAG_CLEAR = 0x01
+TAG_TEXT = 0x02
+TAG_SEGMENTS = 0x03
+TAG_ICONS = 0x04
+TAG_BLINK = 0x05
+
+NUM_OF_DIGITS = 5
+
+
+def record(tag, value=b""):
+    if len(value) > 255:
+        raise ValueError("record too long")
+    return struct.pack("<BB", tag, len(value)) + value
+
+
+def build_packet(seq, flags, records):
+    return MAGIC + struct.pack("<BBI", VERSION, flags, seq & 0xFFFFFFFF) + b"".join(records)
+
+
+def bitmap(values):
+    out = 0
+    for v in values:
+        out |= 1 << int(v, 0)
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("hosts", nargs="+", help="clock addresses")
+    parser.add_argument("--port", type=int, default=4210)
+    parser.add_argument("--clear", action="store_true", help="blank digits, icons and blink first")
+    parser.add_argument("--text", help="text from --first-digit, a '.' lights the dot of the previous char")
+    parser.add_argument("--first-digit", type=int, default=0)
+    parser.add_argument("--segments", nargs="+", metavar="MASK",
+                        help="first digit followed by raw segment masks (bit 31 = dot)")
+    parser.add_argument("--icons", nargs="*", metavar="ICON", help="icons to light (DISPLAY_ICON_ENUM values)")
+    parser.add_argument("--blink", nargs=2, type=int, metavar=("ON_MS", "OFF_MS"))
+    parser.add_argument("--blink-digits", type=lambda v: int(v, 0), default=0, help="bitmap of blinking digits")
+    parser.add_argument("--blink-icons", nargs="*", default=[], metavar="ICON", help="blinking icons")
+    parser.add_argument("--release", action="store_true", help="give the display back to the local content")
+    parser.add_argument("--resync", action="store_true", help="ask the clock to accept any sequence number")
+    parser.add_argument("--seq", type=lambda v: int(v, 0),
+                        help="sequence number, default derived from the wall clock so it increases across runs")
+    parser.add_argument("--count", type=int, default=1, help="packets to send")
+    parser.add_argument("--interval", type=float, default=0.0, help="seconds between packets")
+    parser.add_argument("--counter", action="store_true", help="replace the text with a counter on each packet")
+    args = parser.parse_args()
+
+    seq = args.seq if args.seq is not None else int(time.time() * 1000)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+
+    for n in range(args.count):
+        flags = 0
+        records = []
+
+        if args.resync and n == 0:
+            flags |= FLAG_RESYNC
+        if args.release:
+            flags |= FLAG_RELEASE
+        if args.clear:
+            records.append(record(TAG_CLEAR))
+
+        text = args.text
+        if args.counter:
+            text = str(n % (10 ** NUM_OF_DIGITS)).rjust(NUM_OF_DIGITS)
+        if text is not None:
+            records.append(record(TAG_TEXT, bytes([args.first_digit]) + text.encode("latin-1")))
+
+        if args.segments:
+            first = int(args.segments[0], 0)
+            masks = [int(m, 0) for m in args.segments[1:]]
+            records.append(record(TAG_SEGMENTS, bytes([first]) + b"".join(struct.pack("<I", m) for m in masks)))
+
+        if args.icons is not None:
+            records.append(record(TAG_ICONS, struct.pack("<I", bitmap(args.icons))))
+
+        if args.blink:
+            records.append(record(TAG_BLINK, struct.pack("<HHBI", args.blink[0], args.blink[1],
+                                                         args.blink_digits, bitmap(args.blink_icons))))
+
+        packet = build_packet(seq, flags, records)
+        for host in args.hosts:
+            sock.sendto(packet, (host, args.port))
+
+        seq += 1
+        if args.interval and n + 1 < args.count:
+            time.sleep(args.interval)
+
+
+if __name__ == "__main__":
+    main()
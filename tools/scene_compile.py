@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""Compile a display scene to the bytecode run by the clock, and push it.
+
+Examples:
+    scene_compile.py welcome.scn -o welcome.bin
+    scene_compile.py welcome.scn --post 192.168.1.50
+    scene_compile.py clock.scn --store --post 192.168.1.50     (also run at boot)
+    scene_compile.py --stop --post 192.168.1.50
+    scene_compile.py welcome.scn --list
+
+A scene is one op per line, '#' starts a comment, numbers can be hex:
+
+    clear                           all digits, icons and blink off
+    text <digit> "<chars>"          a '.' lights the dot of the previous char
+    segs <digit> <mask> ...         raw segment masks, bit 31 = dot
+    icons <bitmap>                  bit n = DISPLAY_ICON_ENUM n
+    blink <on_ms> <off_ms> <digits> [<icons>]
+    show                            commits the frame
+    wait <ms>                       from the end of the previous wait
+    loop [<count>]                  up to the matching next, forever without count
+    next
+    time <digit> <field> [nozero]   hour, hour_12, minute, second, day, month, year
+    tick second|minute              waits for the next second or minute of the clock
+    end
+
+Digits are 0 (left) to 4 (right). The opcodes and the format are read from
+main/Scene/Scene_prm.h, so the compiler must come from the same revision as
+the firmware. The clock verifies the program again before running it; the
+interpreter time of its frames is on GET /scene and in the metrics.
+"""
+
+import argparse
+import os
+import re
+import shlex
+import struct
+import sys
+import urllib.error
+import urllib.request
+
+MAGIC = b"SC"
+HEADER = struct.Struct("<2sBBH")
+
+NUM_OF_DIGITS = 5
+LOOP_DEPTH = 4
+
+SOURCES = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "main", "Scene")
+
+
+class SceneError(Exception):
+    pass
+
+
+def load_format(sources):
+    with open(os.path.join(sources, "Scene_prm.h")) as f:
+        prm = f.read()
+
+    def enum(prefix):
+        return {name.lower(): int(value, 0)
+                for name, value in re.findall(r"^\s*%s(\w+)\s*=\s*(0x[0-9A-Fa-f]+)" % prefix, prm, re.M)}
+
+    def define(name):
+        return int(re.search(r"#define\s+%s\s+(\w+)" % name, prm).group(1), 0)
+
+    return {
+        "ops": enum("SCENE_OP_"),
+        "fields": enum("SCENE_TIME_"),
+        "ticks": enum("SCENE_TICK_"),
+        "version": define("SCENE_FORMAT_VERSION"),
+        "store": define("SCENE_FLAG_STORE"),
+        "no_zero": define("SCENE_TIME_NO_ZERO"),
+    }
+
+
+def number(word, low, high, what):
+    try:
+        value = int(word, 0)
+    except ValueError:
+        raise SceneError("%s expected, got %r" % (what, word))
+    if not low <= value <= high:
+        raise SceneError("%s out of range %d..%d" % (what, low, high))
+    return value
+
+
+def digit(word, span=1):
+    return number(word, 0, NUM_OF_DIGITS - span, "digit")
+
+
+def compile_line(fmt, words):
+    ops = fmt["ops"]
+    name, args = words[0].lower(), words[1:]
+    if name not in ops:
+        raise SceneError("unknown op %r" % name)
+    code = bytes([ops[name]])
+
+    def expect(low, high=None):
+        if not low <= len(args) <= (low if high is None else high):
+            raise SceneError("%s: wrong number of operands" % name)
+
+    if name in ("clear", "show", "next", "end"):
+        expect(0)
+    elif name == "text":
+        expect(2)
+        first = digit(args[0])
+        chars = args[1].encode("latin-1")
+        if len(chars) - chars[1:].count(b".") > NUM_OF_DIGITS - first:
+            raise SceneError("text out of the digits")
+        code += struct.pack("<BB", first, len(chars)) + chars
+    elif name == "segs":
+        if len(args) < 2:
+            raise SceneError("segs: digit and masks expected")
+        first = digit(args[0], len(args) - 1)
+        code += struct.pack("<BB", first, len(args) - 1)
+        code += b"".join(struct.pack("<I", number(m, 0, 0xFFFFFFFF, "mask")) for m in args[1:])
+    elif name == "icons":
+        expect(1)
+        code += struct.pack("<I", number(args[0], 0, 0xFFFFFFFF, "icons"))
+    elif name == "blink":
+        expect(3, 4)
+        code += struct.pack("<HHBI", number(args[0], 0, 0xFFFF, "on ms"), number(args[1], 0, 0xFFFF, "off ms"),
+                            number(args[2], 0, (1 << NUM_OF_DIGITS) - 1, "digits"),
+                            number(args[3], 0, 0xFFFFFFFF, "icons") if len(args) == 4 else 0)
+    elif name == "wait":
+        expect(1)
+        code += struct.pack("<H", number(args[0], 0, 0xFFFF, "ms"))
+    elif name == "loop":
+        expect(0, 1)
+        code += struct.pack("<B", number(args[0], 1, 255, "count") if args else 0)
+    elif name == "time":
+        expect(2, 3)
+        if args[1].lower() not in fmt["fields"]:
+            raise SceneError("unknown time field %r" % args[1])
+        field = fmt["fields"][args[1].lower()]
+        if len(args) == 3:
+            if args[2].lower() != "nozero":
+                raise SceneError("nozero expected, got %r" % args[2])
+            field |= fmt["no_zero"]
+        code += struct.pack("<BB", digit(args[0], 2), field)
+    elif name == "tick":
+        expect(1)
+        if args[0].lower() not in fmt["ticks"]:
+            raise SceneError("second or minute expected")
+        code += struct.pack("<B", fmt["ticks"][args[0].lower()])
+    return code
+
+
+def compile_scene(fmt, text):
+    code = b""
+    listing = []
+    depth = 0
+    for lineno, line in enumerate(text.splitlines(), 1):
+        try:
+            words = shlex.split(line, comments=True)
+            if not words:
+                continue
+            op = compile_line(fmt, words)
+            if words[0].lower() == "loop":
+                depth += 1
+                if depth > LOOP_DEPTH:
+                    raise SceneError("loops nested deeper than %d" % LOOP_DEPTH)
+            elif words[0].lower() == "next":
+                depth -= 1
+                if depth < 0:
+                    raise SceneError("next without loop")
+        except (SceneError, ValueError) as e:
+            raise SceneError("line %d: %s" % (lineno, e))
+        listing.append((len(code), op, line.strip()))
+        code += op
+    if depth != 0:
+        raise SceneError("loop without next")
+    return code, listing
+
+
+def post(host, body):
+    url = host if "://" in host else "http://%s/scene" % host
+    request = urllib.request.Request(url, data=body, method="POST",
+                                     headers={"Content-Type": "application/octet-stream"})
+    try:
+        with urllib.request.urlopen(request, timeout=10) as reply:
+            return reply.read().decode(errors="replace").strip()
+    except urllib.error.HTTPError as e:
+        raise SceneError("%s: %s" % (host, e.read().decode(errors="replace").strip() or e.reason))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("scene", nargs="?", help="scene source, - for stdin")
+    parser.add_argument("-o", "--output", help="write the compiled program")
+    parser.add_argument("--store", action="store_true", help="the clock also stores the program and runs it at boot")
+    parser.add_argument("--stop", action="store_true", help="stop the running scene, no source")
+    parser.add_argument("--post", action="append", metavar="HOST", help="clock address or URL, repeatable")
+    parser.add_argument("--list", action="store_true", help="print the code of each line")
+    parser.add_argument("--sources", default=SOURCES, help="directory of Scene_prm.h")
+    args = parser.parse_args()
+
+    if args.stop:
+        program = b""
+    elif args.scene is None:
+        parser.error("a scene source or --stop is needed")
+    else:
+        fmt = load_format(args.sources)
+        with (sys.stdin if args.scene == "-" else open(args.scene)) as f:
+            text = f.read()
+        try:
+            code, listing = compile_scene(fmt, text)
+        except SceneError as e:
+            sys.exit("%s: %s" % (args.scene, e))
+
+        flags = fmt["store"] if args.store else 0
+        program = HEADER.pack(MAGIC, fmt["version"], flags, len(code)) + code
+
+        if args.list:
+            for offset, op, line in listing:
+                print("%04x  %-24s %s" % (offset, op.hex(" ")[:24], line))
+        print("%d bytes, header included" % len(program), file=sys.stderr)
+
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(program)
+
+    for host in args.post or []:
+        try:
+            print("%s: %s" % (host, post(host, program)))
+        except (SceneError, OSError) as e:
+            sys.exit(str(e))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+"""Simulated clocks for the LAN tick sync, run on one host, with their skew.
+
+Each instance runs the protocol of main/TickSync on its own sockets: beacons
+to the multicast group, time requests and replies unicast, the same election
+(clock synced first, then lower priority, then lower identifier) and the same
+filter (the exchange with the shortest round trip of the last 8). Each one
+has its own crystal, moved from the host clock by a random offset and drift,
+and its own wall clock, synced with a random error or never synced:
+
+    ticksync_sim.py                                         4 clocks for 30 s
+    ticksync_sim.py -n 6 --drift-ppm 50 --jitter-ms 4 --loss 0.1
+    ticksync_sim.py -n 3 --unset 2 --check                  exit 1 over 2 ms
+    ticksync_sim.py -n 2 --iface 192.168.1.20 --duration 0  with the real clocks
+
+Every second the skew is printed: the spread of the shared times of the
+instances read at the same host time, that is the spread of their frame
+deadlines and of the boundaries of their clock faces. Real clocks with the
+sync on (curl -d on http://<ip>/ticksync) join the election when --iface is
+the address of this host on their LAN; their offset is on GET /ticksync.
+"""
+
+import argparse
+import heapq
+import random
+import selectors
+import socket
+import struct
+import sys
+import time
+
+PACKET = struct.Struct("<2sBBIBBHqqq")
+MAGIC = b"TK"
+VERSION = 1
+
+BEACON, REQUEST, REPLY = 1, 2, 3
+FLAG_CLOCK_SET, FLAG_MASTER = 0x01, 0x02
+
+PERIOD_S = 0.5
+PEER_TIMEOUT_S = 4 * PERIOD_S
+WINDOW = 8
+DELAY_MAX_US = 50000
+STEP_MARGIN_US = 2000
+
+
+def host_us():
+    return time.monotonic_ns() // 1000
+
+
+class Clock:
+    """One simulated clock: crystal, wall clock and protocol state."""
+
+    def __init__(self, sim, index, ident, priority, drift_ppm, wall_error_us, wall_set):
+        self.sim = sim
+        self.name = chr(ord("a") + index)
+        self.id = ident
+        self.priority = priority
+        self.drift = drift_ppm / 1e6
+        self.mono_base = random.randrange(1, 1 << 40)
+        now = self.local_us()
+        # synced to network time, TimeSync__Is_Synced() on the device
+        self.synced = wall_set
+        if wall_set:
+            self.wall_base = time.time_ns() // 1000 + wall_error_us - now
+        else:
+            # boot time of a clock without network time
+            self.wall_base = 0
+        self.peers = {}
+        self.master = ident
+        self.samples = []
+        self.request_us = 0
+        self.offset_us = None
+        self.delay_us = 0
+        self.mode = "alone"
+
+        self.mc = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.mc.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        if hasattr(socket, "SO_REUSEPORT"):
+            self.mc.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+        self.mc.bind(("", sim.port))
+        self.mc.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP,
+                           socket.inet_aton(sim.group) + socket.inet_aton(sim.iface))
+        self.uc = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.uc.bind((sim.iface, 0))
+        self.uc.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+        self.uc.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+        self.uc.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(sim.iface))
+
+    def local_us(self):
+        """esp_timer of the clock."""
+        return int(host_us() * (1 + self.drift)) + self.mono_base
+
+    def wall_us(self):
+        return self.local_us() + self.wall_base
+
+    def shared_us(self):
+        if self.offset_us is not None:
+            return self.local_us() + self.offset_us
+        return self.wall_us()
+
+    def flags(self):
+        return FLAG_CLOCK_SET if self.synced else 0
+
+    def rank(self, flags, priority, ident):
+        # sort key of the election, lowest wins
+        return (0 if flags & FLAG_CLOCK_SET else 1, priority, ident)
+
+    def send(self, kind, addr, t1=0, t2=0):
+        flags = self.flags() | (FLAG_MASTER if self.master == self.id else 0)
+        self.sim.send(self, addr, lambda: PACKET.pack(MAGIC, VERSION, kind, self.id, flags, self.priority, 0,
+                                                      t1, t2, self.shared_us()))
+
+    def tick(self):
+        now = self.local_us()
+        self.peers = {i: p for i, p in self.peers.items() if now - p["rx"] < PEER_TIMEOUT_S * 1e6}
+
+        best = (self.rank(self.flags(), self.priority, self.id), None)
+        for ident, peer in self.peers.items():
+            best = min(best, (self.rank(peer["flags"], peer["priority"], ident), ident))
+        master = best[1] if best[1] is not None else self.id
+        if master != self.master:
+            self.master = master
+            self.unlock()
+
+        if master != self.id:
+            self.mode = "follower"
+        else:
+            self.mode = "master" if self.peers else "alone"
+
+        self.send(BEACON, (self.sim.group, self.sim.port))
+        if master != self.id:
+            self.request_us = self.local_us()
+            self.send(REQUEST, self.peers[master]["addr"], t1=self.request_us)
+
+    def unlock(self):
+        self.samples = []
+        self.request_us = 0
+        self.offset_us = None
+        self.delay_us = 0
+
+    def receive(self, data, addr, rx_us, rx_shared_us):
+        if len(data) < PACKET.size:
+            return
+        magic, version, kind, ident, flags, priority, _, t1, t2, t3 = PACKET.unpack_from(data)
+        if magic != MAGIC or version != VERSION or ident == self.id:
+            return
+        if kind == BEACON:
+            self.peers[ident] = {"addr": addr, "flags": flags, "priority": priority, "rx": rx_us}
+        elif kind == REQUEST:
+            self.send(REPLY, addr, t1=t1, t2=rx_shared_us)
+        elif kind == REPLY:
+            self.sample(ident, t1, t2, t3, rx_us)
+
+    def sample(self, ident, t1, t2, t3, t4):
+        if self.request_us == 0 or t1 != self.request_us or ident != self.master:
+            self.sim.dropped += 1
+            return
+        self.request_us = 0
+        delay = (t4 - t1) - (t3 - t2)
+        offset = ((t2 - t1) + (t3 - t4)) // 2
+        if delay < 0 or delay > DELAY_MAX_US:
+            self.sim.dropped += 1
+            return
+        if self.samples:
+            best = min(self.samples, key=lambda s: s[1])
+            # disjoint error bounds: the master clock has been stepped
+            if abs(offset - best[0]) > (delay + best[1]) // 2 + STEP_MARGIN_US:
+                self.samples = []
+        self.samples = (self.samples + [(offset, delay)])[-WINDOW:]
+        self.offset_us, self.delay_us = min(self.samples, key=lambda s: s[1])
+
+
+class Sim:
+    def __init__(self, args):
+        self.group = args.group
+        self.port = args.port
+        self.iface = args.iface
+        self.delay_us = args.delay_ms * 1000
+        self.jitter_us = args.jitter_ms * 1000
+        self.loss = args.loss
+        self.dropped = 0
+        self.pending = []
+        self.selector = selectors.DefaultSelector()
+        self.clocks = []
+        for index in range(args.instances):
+            clock = Clock(self, index, random.randrange(1, 1 << 32), args.priority,
+                          random.uniform(-args.drift_ppm, args.drift_ppm),
+                          int(random.uniform(-args.offset_ms, args.offset_ms) * 1000),
+                          index < args.instances - args.unset)
+            self.clocks.append(clock)
+            self.selector.register(clock.mc, selectors.EVENT_READ, clock)
+            self.selector.register(clock.uc, selectors.EVENT_READ, clock)
+
+    def send(self, clock, addr, build):
+        """Queues a packet with the delay of the simulated network, built when it leaves."""
+        if random.random() < self.loss:
+            return
+        due = host_us() + self.delay_us + random.uniform(0, self.jitter_us)
+        heapq.heappush(self.pending, (due, id(build), clock, addr, build))
+
+    def flush(self):
+        while self.pending and self.pending[0][0] <= host_us():
+            _, _, clock, addr, build = heapq.heappop(self.pending)
+            clock.uc.sendto(build(), addr)
+
+    def skew_us(self):
+        now = [clock.shared_us() for clock in self.clocks]
+        return max(now) - min(now)
+
+    def run(self, duration, settle, verbose):
+        start = time.monotonic()
+        next_tick = [start + random.uniform(0, PERIOD_S) for _ in self.clocks]
+        next_report = start + 1
+        worst = 0
+        samples = 0
+        while duration == 0 or time.monotonic() - start < duration:
+            now = time.monotonic()
+            timeout = min(min(next_tick), next_report) - now
+            if self.pending:
+                timeout = min(timeout, (self.pending[0][0] - host_us()) / 1e6)
+            for key, _ in self.selector.select(max(0.0, timeout)):
+                clock = key.data
+                data, addr = key.fileobj.recvfrom(256)
+                # the reception times are taken first, as in the lwIP callback
+                clock.receive(data, addr, clock.local_us(), clock.shared_us())
+            self.flush()
+
+            now = time.monotonic()
+            for index, clock in enumerate(self.clocks):
+                if now >= next_tick[index]:
+                    next_tick[index] += PERIOD_S
+                    clock.tick()
+
+            if now >= next_report:
+                next_report += 1
+                skew = self.skew_us()
+                if now - start >= settle:
+                    worst = max(worst, skew)
+                    samples += 1
+                roles = " ".join("%s:%s" % (c.name, c.mode[0]) for c in self.clocks)
+                print("%6.1f s  skew %8.3f ms  %s" % (now - start, skew / 1000, roles))
+                if verbose:
+                    for c in self.clocks:
+                        print("          %s %08x %-8s master %08x offset %s delay %.3f ms samples %d" %
+                              (c.name, c.id, c.mode, c.master,
+                               "%+.3f ms" % ((c.shared_us() - c.wall_us()) / 1000) if c.offset_us is not None
+                               else "-", c.delay_us / 1000, len(c.samples)))
+        return worst, samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-n", "--instances", type=int, default=4, help="simulated clocks (default 4)")
+    parser.add_argument("--duration", type=float, default=30, help="seconds, 0 until interrupted (default 30)")
+    parser.add_argument("--settle", type=float, default=10, help="seconds not counted in the worst skew (default 10)")
+    parser.add_argument("--drift-ppm", type=float, default=30, help="max drift of the crystals (default 30)")
+    parser.add_argument("--offset-ms", type=float, default=200, help="max error of the wall clocks (default 200)")
+    parser.add_argument("--unset", type=int, default=0, help="instances whose wall clock is not set")
+    parser.add_argument("--priority", type=int, default=128, help="master priority of the instances (default 128)")
+    parser.add_argument("--delay-ms", type=float, default=0.5, help="one way network delay (default 0.5)")
+    parser.add_argument("--jitter-ms", type=float, default=2, help="random delay added to each packet (default 2)")
+    parser.add_argument("--loss", type=float, default=0, help="packet loss ratio")
+    parser.add_argument("--group", default="239.255.42.99", help="multicast group (CONFIG_TICKSYNC_GROUP)")
+    parser.add_argument("--port", type=int, default=4211, help="UDP port (CONFIG_TICKSYNC_PORT)")
+    parser.add_argument("--iface", default="0.0.0.0", help="address of the interface of the LAN")
+    parser.add_argument("--limit-ms", type=float, default=2, help="max skew accepted by --check (default 2)")
+    parser.add_argument("--check", action="store_true", help="exit 1 if the skew after the settle time is over the limit")
+    parser.add_argument("-v", "--verbose", action="store_true", help="state of each instance every second")
+    args = parser.parse_args()
+
+    if not 1 <= args.instances <= 26 or args.unset > args.instances:
+        parser.error("1 to 26 instances, --unset at most all of them")
+
+    try:
+        worst, samples = Sim(args).run(args.duration, args.settle, args.verbose)
+    except KeyboardInterrupt:
+        return 0
+    except OSError as e:
+        sys.exit("network: %s (try --iface with the address of this host)" % e)
+
+    if samples == 0:
+        print("no skew measured after %g s, the duration is too short" % args.settle)
+        return 1 if args.check else 0
+    print("worst skew after %g s: %.3f ms (%d samples)" % (args.settle, worst / 1000, samples))
+    if args.check and worst > args.limit_ms * 1000:
+        print("over the limit of %g ms" % args.limit_ms)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())